@@ -303,7 +303,7 @@ void Scm_WriteBinaryF64(ScmObj sval, ScmPort *oport, ScmSymbol *endian)
 
 static void extract(ScmUVector *uv, char *buf, int off, int eltsize)
 {
-    int size = Scm_UVectorSizeInBytes(uv);
+    ScmSmallInt size = Scm_UVectorSizeInBytes(uv);
     unsigned char *b = (unsigned char*)SCM_UVECTOR_ELEMENTS(uv) + off;
 
     if (off < 0 || off+eltsize > size) {
@@ -420,7 +420,7 @@ ScmObj Scm_GetBinaryF64(ScmUVector *uv, int off, ScmSymbol *endian)
 
 static void inject(ScmUVector *uv, char *buf, int off, int eltsize)
 {
-    int size = Scm_UVectorSizeInBytes(uv);
+    ScmSmallInt size = Scm_UVectorSizeInBytes(uv);
     unsigned char *b = (unsigned char*)SCM_UVECTOR_ELEMENTS(uv) + off;
 
     SCM_UVECTOR_CHECK_MUTABLE(SCM_OBJ(uv));
@@ -650,5 +650,65 @@
            (let1 r (list (dequeue/wait! qq) (dequeue/wait! qq))
              (list* r0 r1 r)))))
 
+;;---------------------------------------------------------------------
+(test-section "profiler on all threads")
+
+(define (prof-leaf-a x) (+ x 1))
+(define (prof-leaf-b x) (- x 1))
+(define (prof-run f n)
+  (let loop ([i 0]) (when (< i n) (f i) (loop (+ i 1)))))
+(define (prof-calls name result)
+  (and-let1 e (assq name result) (cadr e)))
+
+;; The counts exceed the counter buffer of each VM, so that they're
+;; flushed while running.
+(let ([ta (make-thread (cut prof-run prof-leaf-a 20000))]
+      [tb (make-thread (cut prof-run prof-leaf-b 30000))])
+  (profiler-reset)
+  (profiler-start #t)
+  (thread-start! ta)
+  (thread-start! tb)
+  (thread-join! ta)
+  (thread-join! tb)
+  (profiler-stop)
+  (let ([per-thread (profiler-get-thread-results)]
+        [merged (profiler-get-result)])
+    (test* "profiler per-thread result" '(20000 #f)
+           (and-let1 r (assq ta per-thread)
+             (list (prof-calls 'prof-leaf-a (cdr r))
+                   (prof-calls 'prof-leaf-b (cdr r)))))
+    (test* "profiler per-thread result" '(#f 30000)
+           (and-let1 r (assq tb per-thread)
+             (list (prof-calls 'prof-leaf-a (cdr r))
+                   (prof-calls 'prof-leaf-b (cdr r)))))
+    (test* "profiler merged result" '(20000 30000)
+           (list (prof-calls 'prof-leaf-a merged)
+                 (prof-calls 'prof-leaf-b merged))))
+  (profiler-reset)
+  (test* "profiler reset" '() (profiler-get-thread-results)))
+
+;;---------------------------------------------------------------------
+(test-section "sort and GC")
+
+;; A large sort runs on worker threads.  They must respond to GC's
+;; stop-the-world request, or a collection triggered by another thread
+;; waits forever.
+(let* ([n 400000]
+       [v (list->vector (map (^i (modulo (* i 7919) n)) (iota n)))]
+       [done #f]
+       [t (make-thread (^[] (let loop ([k 0])
+                              (unless done
+                                (make-list 1000 k)
+                                (when (zero? (modulo k 100)) (gc))
+                                (loop (+ k 1))))))])
+  (thread-start! t)
+  (test* "sort while another thread allocates" #t
+         (every (^_ (let1 r (sort v)
+                      (and (eqv? (vector-ref r 0) 0)
+                           (eqv? (vector-ref r (- n 1)) (- n 1)))))
+                (iota 10)))
+  (set! done #t)
+  (thread-join! t))
+
 (test-end)
 
@@ -89,7 +89,11 @@
    (getter          :getter getter-of)
    (setter          :getter setter-of)
    (backing-storage :init-keyword :backing-storage
-                    :getter backing-storage-of))
+                    :getter backing-storage-of)
+   ;; #t if the array maps indices to the whole backing storage in
+   ;; row-major order, as make-array does.  Shared arrays aren't dense.
+   (dense?          :init-keyword :dense? :init-value #f
+                    :getter dense-array?))
   :metaclass <array-meta>)
 
 (define-method initialize ((self <array-base>) initargs)
@@ -189,6 +193,7 @@
     :start-vector (start-vector-of self)
     :end-vector   (end-vector-of self)
     :mapper       (mapper-of self)
+    :dense?       (dense-array? self)
     :backing-storage (copy-object (backing-storage-of self))))
 
 ;; NB: these should be built-in; but here for now.
@@ -329,6 +334,7 @@
       :start-vector Vb
       :end-vector Ve
       :mapper (generate-amap Vb Ve)
+      :dense? #t
       :backing-storage (apply (backing-storage-creator-of class)
                               (fold * 1 (s32vector-sub Ve Vb))
                               maybe-init))))
@@ -16,6 +16,25 @@
 
 (select-module gauche.array)
 
+;; Dense f32/f64 arrays are handled by the native kernels in
+;; gauche.uvector instead of going through array-ref/array-set!.
+(define %uvector-matrix-mul! (with-module gauche.uvector %uvector-matrix-mul!))
+(define %uvector-matrix-transpose!
+  (with-module gauche.uvector %uvector-matrix-transpose!))
+(define %uvector-row-echelon! (with-module gauche.uvector %uvector-row-echelon!))
+(define %uvector-matrix-inverse!
+  (with-module gauche.uvector %uvector-matrix-inverse!))
+(define %uvector-matrix-determinant
+  (with-module gauche.uvector %uvector-matrix-determinant))
+
+(define (float-array? a)
+  (let1 c (class-of a)
+    (and (or (eq? c <f64array>) (eq? c <f32array>))
+         (dense-array? a))))
+
+(define (float-matrix? a)
+  (and (float-array? a) (= (array-rank a) 2)))
+
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;; general array manipulation
 
@@ -54,23 +73,31 @@
           (make-vector b-rank))
         c))))
 
+;; The result has the same class as A, whether we take the fast path or not.
 (define (array-transpose a :optional (dim1 0) (dim2 1))
   (let* ([sh (copy-object (array-shape a))]
          [rank (array-rank a)]
+         [class (class-of a)]
          [tmp0 (array-ref sh dim1 0)]
          [tmp1 (array-ref sh dim1 1)])
     (array-set! sh dim1 0 (array-ref sh dim2 0))
     (array-set! sh dim1 1 (array-ref sh dim2 1))
     (array-set! sh dim2 0 tmp0)
     (array-set! sh dim2 1 tmp1)
-    (rlet1 res (make-array sh)
-      (array-for-each-index a
-        (^[vec1] (let* ([vec2 (vector-copy vec1)]
-                        [tmp (vector-ref vec2 dim1)])
-                   (vector-set! vec2 dim1 (vector-ref vec2 dim2))
-                   (vector-set! vec2 dim2 tmp)
-                   (array-set! res vec2 (array-ref a vec1))))
-        (make-vector rank)))))
+    (if (and (= rank 2) (not (= dim1 dim2))
+             (dense-array? a) (uvector? (backing-storage-of a)))
+      (rlet1 res (make-array-internal class sh)
+        (%uvector-matrix-transpose! (backing-storage-of res)
+                                    (backing-storage-of a)
+                                    (array-length a 0) (array-length a 1)))
+      (rlet1 res (make-array-internal class sh)
+        (array-for-each-index a
+          (^[vec1] (let* ([vec2 (vector-copy vec1)]
+                          [tmp (vector-ref vec2 dim1)])
+                     (vector-set! vec2 dim1 (vector-ref vec2 dim2))
+                     (vector-set! vec2 dim2 tmp)
+                     (array-set! res vec2 (array-ref a vec1))))
+          (make-vector rank))))))
 
 (define (array-rotate-90 a :optional (dim1 0) (dim2 1))
   (let* ([sh (copy-object (array-shape a))]
@@ -125,46 +152,50 @@
 
 ;; Gaussian elimination, returns factor applied to determinant
 (define (array-row-echelon! a)
-  (let* ([start (start-vector-of a)]
-         [row-start (s32vector-ref start 0)]
-         [col-start (s32vector-ref start 1)]
-         [end (end-vector-of a)]
-         [row-end (s32vector-ref end 0)]
-         [col-end (s32vector-ref end 1)]
-         [row-col-offset (- row-start col-start)])
-    (define (row-swap! i j)
-      (do ([k col-start (+ k 1)])
-          [(= k col-end)]
-        (let1 temp (array-ref a i k)
-          (array-set! a i k (array-ref a j k))
-          (array-set! a j k temp))))
-    (define (row-sub! i j factor)
-      (do ([k col-start (+ k 1)])
-          [(= k col-end)]
-        (array-set! a i k (- (array-ref a i k) (* factor (array-ref a j k))))))
-    (let loop ([i row-start] [factor 1])
-      (let1 col (- i row-col-offset)
-        (cond [(= i row-end) factor]
-              [(zero? (array-ref a i col))
-               ;; pivot non-zero row to top
-               (let loop2 ((j (+ i 1)))
-                 (cond [(= j row-end) 0]
-                       [(zero? (array-ref a j col))
-                        (loop2 (+ j 1))]
-                       [else
-                        (row-swap! j i)
-                        (loop i (* factor -1))]))]
-              [else
-               ;; eliminate other non-zero rows
-               (let loop2 ([j (+ i 1)])
-                 (cond [(= j row-end) (loop (+ i 1) factor)]
-                       [(zero? (array-ref a j col))
-                        (loop2 (+ j 1))]
-                       [else
-                        (let1 factor (/ (array-ref a j col)
-                                        (array-ref a i col))
-                          (row-sub! j i factor)
-                          (loop2 (+ j 1)))]))])))))
+  (if (and (float-matrix? a)
+           (<= (array-length a 0) (array-length a 1)))
+    (%uvector-row-echelon! (backing-storage-of a)
+                           (array-length a 0) (array-length a 1))
+    (let* ([start (start-vector-of a)]
+           [row-start (s32vector-ref start 0)]
+           [col-start (s32vector-ref start 1)]
+           [end (end-vector-of a)]
+           [row-end (s32vector-ref end 0)]
+           [col-end (s32vector-ref end 1)]
+           [row-col-offset (- row-start col-start)])
+      (define (row-swap! i j)
+        (do ([k col-start (+ k 1)])
+            [(= k col-end)]
+          (let1 temp (array-ref a i k)
+            (array-set! a i k (array-ref a j k))
+            (array-set! a j k temp))))
+      (define (row-sub! i j factor)
+        (do ([k col-start (+ k 1)])
+            [(= k col-end)]
+          (array-set! a i k (- (array-ref a i k) (* factor (array-ref a j k))))))
+      (let loop ([i row-start] [factor 1])
+        (let1 col (- i row-col-offset)
+          (cond [(= i row-end) factor]
+                [(zero? (array-ref a i col))
+                 ;; pivot non-zero row to top
+                 (let loop2 ((j (+ i 1)))
+                   (cond [(= j row-end) 0]
+                         [(zero? (array-ref a j col))
+                          (loop2 (+ j 1))]
+                         [else
+                          (row-swap! j i)
+                          (loop i (* factor -1))]))]
+                [else
+                 ;; eliminate other non-zero rows
+                 (let loop2 ([j (+ i 1)])
+                   (cond [(= j row-end) (loop (+ i 1) factor)]
+                         [(zero? (array-ref a j col))
+                          (loop2 (+ j 1))]
+                         [else
+                          (let1 factor (/ (array-ref a j col)
+                                          (array-ref a i col))
+                            (row-sub! j i factor)
+                            (loop2 (+ j 1)))]))]))))))
 
 (define (array-solve-left-identity! a)
   (array-row-echelon! a)
@@ -208,42 +239,56 @@
       (error "can only compute inverses of 2D arrays"))
     (unless (= n m)
       (error "can only compute inverses of square matrices"))
-    (let* ([class (class-of a)]
-           [id (identity-array n (if (or (eq? class <f32array>)
-                                         (eq? class <f64array>))
-                                   class <array>))]
-           [tmp (array-concatenate a id 1)])
-      (array-solve-left-identity! tmp)
-      (and (= 1 (array-ref tmp (- (s32vector-ref end 0) 1)
-                           (- (s32vector-ref end 1) 1)))
-           (subarray tmp (shape (s32vector-ref start 0) (s32vector-ref end 0)
-                                (s32vector-ref end 1) (+ (s32vector-ref end 1) n)))))))
-
-
+    (if (float-array? a)
+      (let1 res (make-array-internal (class-of a) (shape 0 n 0 n))
+        (and (%uvector-matrix-inverse! (backing-storage-of res)
+                                       (backing-storage-of a) n)
+             res))
+      (let* ([class (class-of a)]
+             [id (identity-array n (if (or (eq? class <f32array>)
+                                           (eq? class <f64array>))
+                                     class <array>))]
+             [tmp (array-concatenate a id 1)])
+        (array-solve-left-identity! tmp)
+        (and (= 1 (array-ref tmp (- (s32vector-ref end 0) 1)
+                             (- (s32vector-ref end 1) 1)))
+             (subarray tmp (shape (s32vector-ref start 0) (s32vector-ref end 0)
+                                  (s32vector-ref end 1) (+ (s32vector-ref end 1) n))))))))
+
+
+(define (float-square-matrix? a)
+  (and (float-matrix? a) (= (array-length a 0) (array-length a 1))))
+
+;; For dense f32/f64 matrices, we use LU decomposition with partial
+;; pivoting, which leaves A intact.
 (define (determinant! a)
-  (let* ([start (s32vector->list (start-vector-of a))]
-         [end (s32vector->list (end-vector-of a))]
-         [row-col-offset (- (car start) (cadr start))]
-         [factor (array-row-echelon! a)])
-    (unless (= 2 (length start)) ; add determinant for the 2x2x2 case?
-      (error "can't compute hyperdeterminants in the general case"))
-    (unless (apply = (map - end start))
-      (error "can't compute determinants of non-square matrices"))
-    (apply * factor (map (^i (array-ref a i (- i row-col-offset)))
-                         (map (cute + <> (car start))
-                              (iota (- (car end) (car start))))))))
+  (if (float-square-matrix? a)
+    (%uvector-matrix-determinant (backing-storage-of a) (array-length a 0))
+    (let* ([start (s32vector->list (start-vector-of a))]
+           [end (s32vector->list (end-vector-of a))]
+           [row-col-offset (- (car start) (cadr start))]
+           [factor (array-row-echelon! a)])
+      (unless (= 2 (length start)) ; add determinant for the 2x2x2 case?
+        (error "can't compute hyperdeterminants in the general case"))
+      (unless (apply = (map - end start))
+        (error "can't compute determinants of non-square matrices"))
+      (apply * factor (map (^i (array-ref a i (- i row-col-offset)))
+                           (map (cute + <> (car start))
+                                (iota (- (car end) (car start)))))))))
 
 (define (determinant a)
   (let1 class (class-of a)
-    (if (or (eq? class <f32array>)
-            (eq? class <f64array>)
-            (eq? class <array>))
-      (determinant! (copy-object a))
-      (let* ([rank (s32vector-length (start-vector-of a))]
-             [b (tabulate-array (array-shape a)
-                                (^[ind] (array-ref a ind))
-                                (make-vector rank))])
-        (determinant! b)))))
+    (cond [(float-square-matrix? a) (determinant! a)]
+          [(or (eq? class <f32array>)
+               (eq? class <f64array>)
+               (eq? class <array>))
+           (determinant! (copy-object a))]
+          [else
+           (let* ([rank (s32vector-length (start-vector-of a))]
+                  [b (tabulate-array (array-shape a)
+                                     (^[ind] (array-ref a ind))
+                                     (make-vector rank))])
+             (determinant! b))])))
 
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
@@ -270,15 +315,21 @@
       (unless (= m (- (s32vector-ref b-end 0) (s32vector-ref b-start 0)))
         (errorf "dimension mismatch: can't mul shapes ~S and ~S"
                 (array-shape a) (array-shape b)))
-      (do ([i a-start-row (+ i 1)])       ; for-each row of a
-          [(= i a-end-row) res]
-        (do ([k b-start-col (+ k 1)])     ; for-each col of b
-            [(= k b-end-col)]
-          (let1 tmp 0
-            (do ([j a-start-col (+ j 1)]) ; for-each col of a & row of b
-                [(= j a-end-col)]
-              (inc! tmp (* (array-ref a i j) (array-ref b (- j a-col-b-row-off) k))))
-            (array-set! res (- i a-start-row) (- k b-start-col) tmp)))))))
+      (if (and (float-array? a) (float-array? b)
+               (eq? (class-of a) (class-of b)))
+        (begin
+          (%uvector-matrix-mul! (backing-storage-of res) (backing-storage-of a)
+                                (backing-storage-of b) n m p)
+          res)
+        (do ([i a-start-row (+ i 1)])       ; for-each row of a
+            [(= i a-end-row) res]
+          (do ([k b-start-col (+ k 1)])     ; for-each col of b
+              [(= k b-end-col)]
+            (let1 tmp 0
+              (do ([j a-start-col (+ j 1)]) ; for-each col of a & row of b
+                  [(= j a-end-col)]
+                (inc! tmp (* (array-ref a i j) (array-ref b (- j a-col-b-row-off) k))))
+              (array-set! res (- i a-start-row) (- k b-start-col) tmp))))))))
 
 (define (array-div-left a b)
   (if-let1 b-1 (array-inverse b)
@@ -308,6 +359,23 @@
 ;; element-wise operations (advantage over a direct array-map! is
 ;; ability to intermingle scalars)
 
+;; If A is a dense f32/f64 array, and B is a real number or a dense array
+;; of the same class and shape, applies the uvector arithmetic to A's
+;; backing storage and returns #t.  Otherwise returns #f.
+(define (float-elements-op! a b f32op f64op)
+  (and (float-array? a)
+       (let1 arg (cond [(real? b) b]
+                       [(and (eq? (class-of a) (class-of b))
+                             (dense-array? b)
+                             (equal? (start-vector-of a) (start-vector-of b))
+                             (equal? (end-vector-of a) (end-vector-of b)))
+                        (backing-storage-of b)]
+                       [else #f])
+         (and arg
+              (begin ((if (eq? (class-of a) <f64array>) f64op f32op)
+                      (backing-storage-of a) arg)
+                     #t)))))
+
 ;; add
 
 (define-method array-add-elements! ((a <array-base>) b c . rest)
@@ -318,13 +386,17 @@
   a)
 
 (define-method array-add-elements! ((a <array-base>) (b <number>))
-  (array-map! a (^i (+ b i)) a))
+  (if (float-elements-op! a b f32vector-add! f64vector-add!)
+    a
+    (array-map! a (^i (+ b i)) a)))
 
 (define-method array-add-elements! ((a <number>) (b <array-base>))
   (array-map! (copy-object b) (^i (+ a i)) b))
 
 (define-method array-add-elements! ((a <array-base>) (b <array-base>))
-  (array-map! a (^[i j] (+ i j)) a b))
+  (if (float-elements-op! a b f32vector-add! f64vector-add!)
+    a
+    (array-map! a (^[i j] (+ i j)) a b)))
 
 (define (array-add-elements a . rest)
   (rlet1 res (copy-object a)
@@ -340,13 +412,17 @@
   (apply array-sub-elements! a c rest))
 
 (define-method array-sub-elements! ((a <array-base>) (b <number>))
-  (array-map! a (^i (- i b)) a))
+  (if (float-elements-op! a b f32vector-sub! f64vector-sub!)
+    a
+    (array-map! a (^i (- i b)) a)))
 
 (define-method array-sub-elements! ((a <number>) (b <array-base>))
   (array-map! (copy-object b) (^i (- a i)) b))
 
 (define-method array-sub-elements! ((a <array-base>) (b <array-base>))
-  (array-map! a (^[i j] (- i j)) a b))
+  (if (float-elements-op! a b f32vector-sub! f64vector-sub!)
+    a
+    (array-map! a (^[i j] (- i j)) a b)))
 
 (define (array-sub-elements a . rest)
   (rlet1 res (copy-object a)
@@ -362,13 +438,17 @@
   a)
 
 (define-method array-mul-elements! ((a <array-base>) (b <number>))
-  (array-map! a (^i (* b i)) a))
+  (if (float-elements-op! a b f32vector-mul! f64vector-mul!)
+    a
+    (array-map! a (^i (* b i)) a)))
 
 (define-method array-mul-elements! ((a <number>) (b <array-base>))
   (array-map! (copy-object b) (^i (* a i)) b))
 
 (define-method array-mul-elements! ((a <array-base>) (b <array-base>))
-  (array-map! a (^[i j] (* i j)) a b))
+  (if (float-elements-op! a b f32vector-mul! f64vector-mul!)
+    a
+    (array-map! a (^[i j] (* i j)) a b)))
 
 (define (array-mul-elements a . rest)
   (rlet1 res (copy-object a)
@@ -384,13 +464,17 @@
   a)
 
 (define-method array-div-elements! ((a <array-base>) (b <number>))
-  (array-map! a (^i (/ i b)) a))
+  (if (float-elements-op! a b f32vector-div! f64vector-div!)
+    a
+    (array-map! a (^i (/ i b)) a)))
 
 (define-method array-div-elements! ((a <number>) (b <array-base>))
   (array-map! (copy-object b) (^i (/ a i)) b))
 
 (define-method array-div-elements! ((a <array-base>) (b <array-base>))
-  (array-map! a (^[i j] (/ i j)) a b))
+  (if (float-elements-op! a b f32vector-div! f64vector-div!)
+    a
+    (array-map! a (^[i j] (/ i j)) a b)))
 
 (define (array-div-elements a . rest)
   (rlet1 res (copy-object a)
@@ -788,6 +788,34 @@
 (flonum-arith-test-generate f32)
 (flonum-arith-test-generate f64)
 
+;; long vectors, processed in chunks by the vectorized kernels
+(let ([v0 (list->s16vector (iota 1000 -500))]
+      [v1 (make-s16vector 1000 32000)])
+  (test* "s16vector-add (long)" (map (cut + <> 32000) (iota 1000 -500))
+         (s16vector->list (s16vector-add v0 v1 'both)))
+  (test* "s16vector-add (long, clamp)"
+         (map (^x (min 32767 (+ x 32000))) (iota 1000 -500))
+         (s16vector->list (s16vector-add v0 v1 'high)))
+  (test* "s16vector-add (long, overflow)" (test-error)
+         (s16vector-add v0 v1))
+  ;; elements before the overflowing one are updated
+  (test* "s16vector-add! (long, overflow)" '(-499 1 100 32767 499)
+         (let1 v (s16vector-copy v0)
+           (s16vector-set! v 600 32767)
+           (guard (e [else (map (cut s16vector-ref v <>) '(0 500 599 600 999))])
+             (s16vector-add! v (make-s16vector 1000 1))
+             #f))))
+(test* "u8vector-sub (long, clamp)" (make-list 300 0)
+       (u8vector->list (u8vector-sub (make-u8vector 300 1)
+                                     (make-u8vector 300 2) 'low)))
+(test* "f32vector-mul (long)" (map (^x (* x 0.5)) (iota 1000 0.0))
+       (f32vector->list (f32vector-mul (list->f32vector (iota 1000 0.0))
+                                       (make-f32vector 1000 0.5))))
+(test* "s16vector-dot (long)" (* 1000 -32768 32767)
+       (s16vector-dot (make-s16vector 1000 -32768) (make-s16vector 1000 32767)))
+(test* "u8vector-clamp! (long)" (map (^x (clamp x 10 200)) (iota 256))
+       (u8vector->list (u8vector-clamp! (list->u8vector (iota 256)) 10 200)))
+
 ;;-------------------------------------------------------------------
 (test-section "bitwise operations")
 
@@ -1418,6 +1446,59 @@
   (run-across test-reverse-endian)
   )
 
+;;-------------------------------------------------------------------
+(test-section "mapped uvectors")
+
+(let ([data (list->u8vector (iota 256))])
+  (sys-unlink "test.o")
+  (call-with-output-file "test.o" (cut write-block data <>))
+
+  (test* "map-file->uvector" data (map-file->uvector <u8vector> "test.o"))
+  (test* "map-file->uvector (offset, size)" '#u8(8 9 10 11)
+         (map-file->uvector <u8vector> "test.o" :offset 8 :size 4))
+  (test* "map-file->uvector (u32)"
+         (uvector-alias <u32vector> data 4 12)
+         (map-file->uvector <u32vector> "test.o" :offset 4 :size 2))
+  (test* "map-file->uvector (port)" data
+         (call-with-input-file "test.o" (cut map-file->uvector <u8vector> <>)))
+  (test* "map-file->uvector (misaligned offset)" (test-error)
+         (map-file->uvector <u32vector> "test.o" :offset 2))
+  (test* "map-file->uvector (read is immutable)" (test-error)
+         (u8vector-set! (map-file->uvector <u8vector> "test.o") 0 1))
+  (test* "map-file->uvector (read is immutable, add!)" (test-error)
+         (u8vector-add! (map-file->uvector <u8vector> "test.o") 1))
+  (test* "map-file->uvector (read is immutable, ior!)" (test-error)
+         (u8vector-ior! (map-file->uvector <u8vector> "test.o") 1))
+  (test* "map-file->uvector (read is immutable, clamp!)" (test-error)
+         (u8vector-clamp! (map-file->uvector <u8vector> "test.o") 0 1))
+  (test* "map-file->uvector (read is immutable, swap-bytes!)" (test-error)
+         (uvector-swap-bytes! (map-file->uvector <u32vector> "test.o")))
+  (test* "map-file->uvector (size beyond the end)" (test-error)
+         (map-file->uvector <u8vector> "test.o" :offset 8
+                            :size (+ (u8vector-length data) 1)))
+  (test* "map-file->uvector (alias)" '#u8(2 3)
+         (uvector-alias <u8vector> (map-file->uvector <u8vector> "test.o")
+                        2 4))
+
+  (test* "map-file->uvector (private)" '(99 0)
+         (let1 v (map-file->uvector <u8vector> "test.o" :mode 'private)
+           (u8vector-set! v 0 99)
+           (list (u8vector-ref v 0)
+                 (u8vector-ref (map-file->uvector <u8vector> "test.o") 0))))
+  (test* "map-file->uvector (shared)" '(99 99)
+         (let1 v (map-file->uvector <u8vector> "test.o" :mode 'shared)
+           (u8vector-set! v 0 99)
+           (list (u8vector-ref v 0)
+                 (u8vector-ref (map-file->uvector <u8vector> "test.o") 0))))
+  (sys-unlink "test.o")
+  )
+
+(test* "make-mapped-uvector" '#f64(0.0 0.0 1.0)
+       (rlet1 v (make-mapped-uvector <f64vector> 3)
+         (f64vector-set! v 2 1.0)))
+(test* "make-mapped-uvector (empty)" '#u8()
+       (make-mapped-uvector <u8vector> 0))
+
 ;;-------------------------------------------------------------------
 (test-section "string <-> uvector")
 
@@ -2356,6 +2437,95 @@
      )))
 
 
+;; Dense f32/f64 arrays go through the native kernels; compare the
+;; results with those of generic arrays.
+(define (->generic-array a)
+  (tabulate-array (array-shape a) (^[i j] (array-ref a i j))))
+
+(define (make-test-f64array nrows ncols seed)
+  (rlet1 a (make-f64array (shape 0 nrows 0 ncols))
+    (let1 x seed
+      (dotimes [i nrows]
+        (dotimes [j ncols]
+          (set! x (modulo (+ (* x 1103515245) 12345) 2147483648))
+          (array-set! a i j (- (/ (modulo x 1000) 100.0) 5)))))))
+
+(let ([a (make-test-f64array 70 90 7)]
+      [b (make-test-f64array 90 65 5)])
+  (test* "array-mul (f64, blocked)" (array-mul (->generic-array a)
+                                               (->generic-array b))
+         (array-mul a b) array-approx-equal?)
+  (test* "array-mul (f64, class)" <f64array> (class-of (array-mul a b)))
+  (test* "array-transpose (f64)" (array-transpose (->generic-array a))
+         (array-transpose a))
+  (test* "array-transpose (f64, class)" <f64array>
+         (class-of (array-transpose a))))
+
+(test* "array-mul (f32)" #,(<f32array> (0 2 0 2) 14 22 16 29)
+       (array-mul #,(<f32array> (3 5 7 9) 3 1 4 1)
+                  #,(<f32array> (55 57 17 19) 2 7 8 1))
+       array-approx-equal?)
+(test* "array-transpose (u8)" #,(<u8array> (0 3 0 2) 1 4 2 5 3 6)
+       (array-transpose #,(<u8array> (0 2 0 3) 1 2 3 4 5 6)))
+(let1 a #,(<s32array> (0 2 0 3) 1 2 3 4 5 6)
+  (define (shared a) (share-array a (array-shape a) values))
+  (test* "array-transpose (s32, shared)" #,(<s32array> (0 3 0 2) 1 4 2 5 3 6)
+         (array-transpose (shared a)))
+  (test* "array-transpose (class)" '(<s32array> <s32array> <array> <array>)
+         (map (^x (class-name (class-of (array-transpose x))))
+              (list a (shared a)
+                    (->generic-array a) (shared (->generic-array a))))))
+
+(let1 i 0
+  (for-each
+   (^t (let-optionals* t (ar (inv #f) (det 0))
+         (test* (format "array-inverse (f64) ~D" (inc! i)) inv
+                (array-inverse ar)
+                array-approx-equal?)
+         (test* (format "determinant (f64) ~D" i) det
+                (determinant ar)
+                approx-equal?)))
+   '((#,(<f64array> (0 2 0 2) 1 2 3 4)
+      #,(<array> (0 2 0 2) -2.0 1.0 1.5 -0.5)
+      -2)
+     (#,(<f64array> (3 5 7 9) 1 2 3 4)
+      #,(<array> (0 2 0 2) -2.0 1.0 1.5 -0.5)
+      -2)
+     (#,(<f64array> (0 3 0 3) 0 -3 4 1 5 2 1 1 7)
+      #,(<array> (0 3 0 3) -33 -25 26 5 4 -4 4 3 -3)
+      -1)
+     (#,(<f64array> (0 3 0 3) 1 -1 3 2 1 2 -2 -2 1)
+      #,(<array> (0 3 0 3) 1 -1 -1 -1.2 1.4 0.8 -0.4 0.8 0.6)
+      5)
+     (#,(<f32array> (0 3 0 3) 2 0 1 1 1 0 3 2 1)
+      #,(<array> (0 3 0 3) 1 2 -1 -1 -1 1 -1 -4 2)
+      1)
+     (#,(<f64array> (0 2 0 2) 1 2 3 6))
+     )))
+
+(let1 a (make-test-f64array 40 40 3)
+  (test* "array-inverse (f64, larger)" (identity-array 40)
+         (array-mul a (array-inverse a))
+         (^[x y] (array-equal? x y (cut approx-equal? <> <> 1e-9))))
+  (test* "determinant (f64) doesn't modify the array" #t
+         (let1 b (copy-object a)
+           (determinant a)
+           (array-equal? a b))))
+
+(test* "array-add-elements (f64)" #,(<f64array> (0 2 0 2) 16 18 20 22)
+       (array-add-elements #,(<f64array> (0 2 0 2) 1 2 3 4)
+                           #,(<f64array> (0 2 0 2) 5 6 7 8)
+                           10))
+(test* "array-div-elements (f64)" #,(<f64array> (0 2 0 2) 0.5 1 1.5 2)
+       (array-div-elements #,(<f64array> (0 2 0 2) 1 2 3 4) 2))
+(test* "array-mul-elements (f32, mixed)" #,(<f32array> (0 2 0 2) 1 4 9 16)
+       (array-mul-elements #,(<f32array> (0 2 0 2) 1 2 3 4)
+                           #,(<array> (0 2 0 2) 1 2 3 4)))
+(test* "array-sub-elements (f64, shared)" #,(<f64array> (0 2 0 2) 0 -1 1 0)
+       (let1 a #,(<f64array> (0 2 0 2) 1 2 3 4)
+         (array-sub-elements a (share-array a (shape 0 2 0 2)
+                                            (^[i j] (values j i))))))
+
 ;;-------------------------------------------------------------------
 ;; NB: copy-port uses read-block! and write-block for block copy,
 ;;     so we test it here.
@@ -171,6 +171,8 @@
           u8vector-range-check u8vector-ref u8vector-set! u8vector-sub
           u8vector-sub! u8vector-xor u8vector-xor! u8vector=? u8vector?
 
+          make-mapped-uvector map-file->uvector
+
           uvector-alias uvector-binary-search uvector-class-element-size
           uvector-copy uvector-copy! uvector-ref uvector-set! uvector-size
           uvector-swap-bytes uvector-swap-bytes!
@@ -190,6 +192,7 @@
 
 (inline-stub
  "#include <math.h>"
+ "#include <fcntl.h>"
  "#define EXTUVECTOR_EXPORTS"
  "#include \"gauche/uvector.h\""
  "#include \"gauche/priv/vectorP.h\""
@@ -209,10 +212,68 @@
 ;; uvector-alias
 (inline-stub
  (define-cproc uvector-alias
-   (klass::<class> v::<uvector> :optional (start::<int> 0) (end::<int> -1))
+   (klass::<class> v::<uvector>
+    :optional (start::<fixnum> 0) (end::<fixnum> -1))
    Scm_UVectorAlias)
  )
 
+;; mapped uvectors
+(inline-stub
+ (define-cproc %make-mapped-uvector (klass::<class> fd::<int> offset
+                                     size::<fixnum> mode::<symbol>)
+   (let* ([m::int 0])
+     (cond [(SCM_EQ (SCM_OBJ mode) 'read)    (= m SCM_UVECTOR_MAP_READ)]
+           [(SCM_EQ (SCM_OBJ mode) 'shared)  (= m SCM_UVECTOR_MAP_SHARED)]
+           [(SCM_EQ (SCM_OBJ mode) 'private) (= m SCM_UVECTOR_MAP_PRIVATE)]
+           [else (Scm_TypeError "mode" "one of read, shared or private"
+                                (SCM_OBJ mode))])
+     (return (Scm_MakeMappedUVector klass fd (Scm_IntegerToOffset offset)
+                                    size m))))
+
+ (define-cproc %open-mapped-file (path::<const-cstring> writable::<boolean>)
+   ::<int>
+   (let* ([fd::int])
+     (SCM_SYSCALL fd (open path (?: writable O_RDWR O_RDONLY)))
+     (when (< fd 0) (Scm_SysError "couldn't open %s" path))
+     (return fd)))
+ )
+
+;; FILE may be a pathname, a port with a file descriptor, or
+;; a file descriptor.
+(define (map-file->uvector class file :key (offset 0) (size #f) (mode 'read))
+  (define (do-map fd) (%make-mapped-uvector class fd offset (or size -1) mode))
+  (cond [(string? file)
+         (let1 fd (%open-mapped-file file (eq? mode 'shared))
+           (unwind-protect (do-map fd) (sys-close fd)))]
+        [(port? file)
+         (if-let1 fd (port-file-number file)
+           (do-map fd)
+           (error "port doesn't have a file descriptor:" file))]
+        [(integer? file) (do-map file)]
+        [else (error "pathname, port or file descriptor required, but got:"
+                     file)]))
+
+;; An anonymous mapping; the elements are outside the GC heap.
+(define (make-mapped-uvector class size)
+  (%make-mapped-uvector class -1 0 size 'private))
+
+;; matrix kernels; internal, used by gauche.array
+(inline-stub
+ (define-cproc %uvector-matrix-mul! (c::<uvector> a::<uvector> b::<uvector>
+                                     n::<fixnum> m::<fixnum> p::<fixnum>)
+   ::<void> Scm_UVectorMatrixMul)
+ (define-cproc %uvector-matrix-transpose! (dst::<uvector> src::<uvector>
+                                           n::<fixnum> m::<fixnum>)
+   ::<void> Scm_UVectorMatrixTranspose)
+ (define-cproc %uvector-row-echelon! (a::<uvector> n::<fixnum> m::<fixnum>)
+   ::<int> Scm_UVectorRowEchelon)
+ (define-cproc %uvector-matrix-inverse! (dst::<uvector> src::<uvector>
+                                         n::<fixnum>)
+   ::<boolean> Scm_UVectorMatrixInverse)
+ (define-cproc %uvector-matrix-determinant (a::<uvector> n::<fixnum>)
+   ::<double> Scm_UVectorMatrixDeterminant)
+ )
+
 ;; byte swapping
 (inline-stub
  (define-cise-stmt swap-bytes-common
@@ -235,9 +296,9 @@
 ;; uvector-size
 (inline-stub
  (define-cproc uvector-size (v::<uvector>
-                             :optional (start::<int> 0) (end::<int> -1))
-   ::<int>
-   (let* ([len::int (SCM_UVECTOR_SIZE v)])
+                             :optional (start::<fixnum> 0) (end::<fixnum> -1))
+   ::<fixnum>
+   (let* ([len::ScmSmallInt (SCM_UVECTOR_SIZE v)])
      (SCM_CHECK_START_END start end len)
      (return (* (- end start)
                 (Scm_UVectorElementSize (Scm_ClassOf (SCM_OBJ v)))))))
@@ -308,12 +369,12 @@
  (define-cproc uvector-copy (v::<uvector>
                              :optional (start::<fixnum> 0)
                                        (end::<fixnum> -1))
-   (let* ([len::int (SCM_UVECTOR_SIZE v)]
+   (let* ([len::ScmSmallInt (SCM_UVECTOR_SIZE v)]
           [klass::ScmClass* (Scm_ClassOf (SCM_OBJ v))]
           [eltsize::int (Scm_UVectorElementSize klass)]
           [src::(const char *) (cast (const char *) (SCM_UVECTOR_ELEMENTS v))])
      (SCM_CHECK_START_END start end len)
-     (let* ([newsize::int (* (- end start) eltsize)]
+     (let* ([newsize::ScmSmallInt (* (- end start) eltsize)]
             [dst::char* (SCM_NEW_ATOMIC_ARRAY (char) newsize)])
        (memcpy dst (+ src (* start eltsize)) newsize)
        (return (Scm_MakeUVector klass (- end start) dst)))))
@@ -455,17 +516,17 @@
 
 ;; copy
 (inline-stub
- (define-cproc uvector-copy! (dest::<uvector> dstart::<int> src::<uvector>
-                              :optional (sstart::<int> 0)
-                                        (send::<int> -1))
+ (define-cproc uvector-copy! (dest::<uvector> dstart::<fixnum> src::<uvector>
+                              :optional (sstart::<fixnum> 0)
+                                        (send::<fixnum> -1))
    ::<void>
    (SCM_UVECTOR_CHECK_MUTABLE dest)
    (SCM_CHECK_START_END sstart send (SCM_UVECTOR_SIZE src))
    (let* ([deltsize::int (Scm_UVectorElementSize (Scm_ClassOf (SCM_OBJ dest)))]
-          [doff::int (* dstart deltsize)]
+          [doff::ScmSmallInt (* dstart deltsize)]
           [seltsize::int (Scm_UVectorElementSize (Scm_ClassOf (SCM_OBJ src)))]
-          [soff::int (* sstart seltsize)]
-          [size::int (- (* send seltsize) soff)])
+          [soff::ScmSmallInt (* sstart seltsize)]
+          [size::ScmSmallInt (- (* send seltsize) soff)])
      (memmove (+ (cast char* (SCM_UVECTOR_ELEMENTS dest)) doff)
               (+ (cast (const char*) (SCM_UVECTOR_ELEMENTS src)) soff)
               size)))
@@ -518,7 +579,7 @@
 
  (define-cfn string->bytevector!
    (v::ScmUVector* tstart::int s::ScmString* start::int end::int) :static
-   (let* ([tlen::int (SCM_UVECTOR_SIZE v)])
+   (let* ([tlen::ScmSmallInt (SCM_UVECTOR_SIZE v)])
      (when (and (>= tstart 0) (< tstart tlen))
        (SCM_UVECTOR_CHECK_MUTABLE v)
        (with-input-string-pointers (s start end sp ep)
@@ -544,7 +605,7 @@
 
  (define-cfn bytevector->string (v::ScmUVector* start::int end::int term)
    :static
-   (let* ([len::int (SCM_UVECTOR_SIZE v)])
+   (let* ([len::ScmSmallInt (SCM_UVECTOR_SIZE v)])
      ;; We automatically avoid copying the string contents when the
      ;; following conditions are met:
      ;; * The source vector is immutable
@@ -614,7 +675,7 @@
 
  (define-cfn string->wordvector!
    (v::ScmUVector* tstart::int s::ScmString* start::int end::int) :static
-   (let* ([tlen::int (SCM_UVECTOR_SIZE v)])
+   (let* ([tlen::ScmSmallInt (SCM_UVECTOR_SIZE v)])
      (when (and (>= tstart 0) (< tstart tlen))
        (SCM_UVECTOR_CHECK_MUTABLE v)
        (with-input-string-pointers (s start end sp ep)
@@ -643,7 +704,7 @@
 
  (define-cfn wordvector->string (v::ScmUVector* start::int end::int term)
    :static
-   (let* ([len::int (SCM_UVECTOR_SIZE v)]
+   (let* ([len::ScmSmallInt (SCM_UVECTOR_SIZE v)]
           [s (Scm_MakeOutputStringPort FALSE)])
      (SCM_CHECK_START_END start end len)
      (let* ([eltp::int32_t* (cast int32_t* (SCM_UVECTOR_ELEMENTS v))])
@@ -199,6 +199,22 @@ static inline ScmUInt64 range_u64lo(ScmUInt64 val, int clamp)
     return val;
 }
 
+/*
+ * UV_KERNEL - attribute for the element-wise loops written to be
+ * vectorized by the compiler.  On x86 with gcc, we compile them for
+ * AVX2 as well as for the baseline, and the one that suits the running
+ * CPU is chosen at load time.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 6) \
+    && (defined(__x86_64__) || defined(__i386__)) && defined(__linux__)
+#define UV_KERNEL \
+    __attribute__((target_clones("avx2","default"), optimize("tree-vectorize")))
+#elif defined(__GNUC__) && !defined(__clang__)
+#define UV_KERNEL __attribute__((optimize("tree-vectorize")))
+#else
+#define UV_KERNEL
+#endif
+
 /*
  * 'option' argument for Scm_UVectorSwapBytes.
  */
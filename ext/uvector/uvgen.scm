@@ -305,12 +305,25 @@
 ;; Uvector opertaion generator
 ;;
 
+;; Some of uvector-by-uvector operations have vectorized kernels
+;; (see "Vectorized kernels" in uvector.c.tmpl).  VECOP expands into
+;; a call of it, which returns the number of elements done.
+(define (vecop-rule rule opname)
+  (define tag (string->symbol (getval rule 't)))
+  (define (VECOP d s0 s1 size clamp)
+    (if (and (memq tag '(s8 u8 s16 u16 s32 u32 f32 f64))
+             (not (and (eq? tag 'u32) (equal? opname "mul"))))
+      #"~|tag|~|tag|_~|opname|_vec(~d, ~s0, ~s1, ~size, ~clamp)"
+      "0"))
+  `(VECOP ,VECOP))
+
 (define (generate-numop)
   (for-each (^[opname Opname Sopname]
               (dolist [rule (make-rules)]
                 (for-each (cute substitute <> `((opname  ,opname)
                                                 (Opname  ,Opname)
                                                 (Sopname ,Sopname)
+                                                ,(vecop-rule rule opname)
                                                 ,@rule))
                           *tmpl-numop*)))
             '("add" "sub" "mul")
@@ -320,6 +333,7 @@
     (for-each (cute substitute <> `((opname  "div")
                                     (Opname  "Div")
                                     (Sopname  "Div")
+                                    ,(vecop-rule rule "div")
                                     ,@rule))
               *tmpl-numop*)))
 
@@ -355,7 +369,11 @@
         (case tag
           [(s64 u64) #"SCM_SET_INT64_ZERO(~r)"]
           [else #"~r = 0"]))
-      (for-each (cute substitute <> `((ZERO  ,ZERO) ,@rule))
+      (define (VECDOT r x y size)
+        (if (memq tag '(s8 u8 s16 u16))
+          #"~|tag|vector_dot_vec(&~r, SCM_OBJ(~x), ~y, ~size)"
+          "0"))
+      (for-each (cute substitute <> `((ZERO  ,ZERO) (VECDOT ,VECDOT) ,@rule))
                 *tmpl-dotop*))))
 
 (define (generate-rangeop)
@@ -387,6 +405,17 @@
         (case tag
           [(s64 u64) #"INT64LT(~|a|, ~|b|)"]
           [else      #"(~a < ~b)"]))
+      ;; Clamping by constant limits uses the vectorized kernel.
+      ;; TARGET is the uvector to modify, which is also returned.
+      (define (CLAMPCONST target)
+        (if (memq tag '(s8 u8 s16 u16 s32 u32 f32 f64))
+          (tree->string
+           `("    if (mintype == ARGTYPE_CONST && maxtype == ARGTYPE_CONST) {\n"
+             "        ",(x->string tag)"vector_clamp_vec(",target", size,\n"
+             "                           minval, mindc, maxval, maxdc);\n"
+             "        return ",target";\n"
+             "    }"))
+          ""))
       (dolist [ops `(("range-check" "RangeCheck"
                       ""
                       "return Scm_MakeInteger(i)"
@@ -396,13 +425,17 @@
                       ,#"SCM_~|TAG|VECTOR_ELEMENTS(d)[i] = ~(cast \"val\")"
                       "d")
                      ("clamp!" "ClampX"
-                      ""
+                      "SCM_UVECTOR_CHECK_MUTABLE(x)"
                       ,#"SCM_~|TAG|VECTOR_ELEMENTS(x)[i] = ~(cast \"val\")"
                       "SCM_OBJ(x)")
                      )]
         (for-each (cute substitute <> `((GETLIM  ,GETLIM)
                                         (ZERO  ,ZERO)
                                         (LT  ,LT)
+                                        (CLAMPCONST
+                                         ,(if (equal? (ref ops 0) "range-check")
+                                            ""
+                                            (cut CLAMPCONST (ref ops 4))))
                                         (opname   ,(ref ops 0))
                                         (Opname   ,(ref ops 1))
                                         (dstdecl  ,(ref ops 2))
@@ -54,7 +54,8 @@
           (loop (reader port) (cons obj result)))))))
 
 (define (port->string-list port) (port->list (cut read-line <> #t) port))
-(define (port->sexp-list port)   (port->list read port))
+(define (port->sexp-list port)
+  ((with-module gauche.internal %read-all) port))
 
 ;;-----------------------------------------------------
 ;; copy-port
@@ -106,10 +107,26 @@
                   (begin (write-block buf dst 0 nr)
                          (loop (+ count nr))))))))))))
 
+;; Between file ports, we let the system copy the data (e.g. by sendfile(2))
+;; without going through the port buffers.  Returns #f if we can't.
+(define (%copy-file-port src dst size)
+  (and (port-file-number src)
+       (port-file-number dst)
+       (with-port-locking src
+         (^[]
+           (with-port-locking dst
+             (^[] ((with-module gauche.internal %copy-file-port)
+                   src dst size)))))))
+
 (define (copy-port src dst :key (unit 4096) (size -1))
   (check-arg input-port? src)
   (check-arg output-port? dst)
-  (cond [(eq? unit 'byte)
+  (cond [(and (or (eq? unit 'byte) (and (integer? unit) (>= unit 0)))
+              (%copy-file-port src dst (if (and (integer? size)
+                                                (not (negative? size)))
+                                         size
+                                         -1)))]
+        [(eq? unit 'byte)
          (if (and (integer? size) (not (negative? size)))
            (%do-copy/limit1 (read-byte src) (write-byte data dst) size)
            (%do-copy (read-byte src) (write-byte data dst) (+ count 1)))]
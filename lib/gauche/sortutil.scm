@@ -26,6 +26,22 @@
 (define %sort  (with-module gauche.internal %sort))
 (define %sort! (with-module gauche.internal %sort!))
 
+;; The builtin %sort and %sort! are stable, and fast if they don't need
+;; to call back Scheme for comparison.  If the optional arguments ARGS of
+;; sort etc. specify such an ordering, returns the CMP argument to pass
+;; to %sort; otherwise returns 'none.  The key procedure, if any, is
+;; also handled by %sort, which calls it only once per element.
+(define (%builtin-ordering args)
+  (let-optionals* args ([cmp #f] [key identity] . rest)
+    (cond [(pair? rest) 'none]
+          [(or (not cmp) (eq? cmp default-comparator)) #f]
+          [(or (eq? cmp <) (eq? cmp string<?)) cmp]
+          [else 'none])))
+
+(define (%builtin-key args)
+  (let-optionals* args ([cmp #f] [key identity] . rest)
+    (and (not (memq key `(,identity ,values))) key)))
+
 (define-syntax define-less?
   (syntax-rules ()
     [(_ less? cmp this)
@@ -137,12 +153,15 @@
 ;;; Warren, and first used in the DEC-10 Prolog system.  R. A. O'Keefe
 ;;; adapted it to work destructively in Scheme.
 
-(define (sort! seq . args)
-  (if (and (or (pair? seq) (vector? seq)) (null? args))
-    (%sort! seq)                  ; use internal version
-    (apply stable-sort! seq args)))
+(define (sort! seq . args) (apply stable-sort! seq args))
 
-(define (stable-sort! seq :optional (cmp #f) (key identity))
+(define (stable-sort! seq . args)
+  (let1 ord (if (or (pair? seq) (vector? seq)) (%builtin-ordering args) 'none)
+    (if (eq? ord 'none)
+      (apply %stable-sort! seq args)
+      (%sort! seq ord (%builtin-key args)))))  ; use internal version
+
+(define (%stable-sort! seq :optional (cmp #f) (key identity))
   (define-less? less? cmp 'sort!)
   (if (memq key `(,identity ,values))
     (letrec ([step (^n (cond [(> n 2) (let* ([j (ash n -1)]
@@ -184,7 +203,7 @@
              (do ([spine seq (cdr spine)])
                  [(null? spine)]
                (set-car! spine (cons (car spine) (key (car spine)))))
-             (let1 spine (stable-sort! seq kless?)
+             (let1 spine (%stable-sort! seq kless?)
                (do ([lis spine (cdr lis)])
                    [(null? lis)]
                  (set-car! lis (caar lis)))
@@ -195,7 +214,7 @@
                    [(= i len)]
                  (vector-set! seq i (cons (vector-ref seq i)
                                           (key (vector-ref seq i)))))
-               (do ([seq (stable-sort! seq kless?)]
+               (do ([seq (%stable-sort! seq kless?)]
                     [i 0 (+ i 1)])
                    [(= i len)]
                  (vector-set! seq i (car (vector-ref seq i))))
@@ -207,12 +226,15 @@
 ;;; sorts a vector or list non-destructively.  It does this by sorting a
 ;;; copy of the sequence.
 
-(define (sort seq . args)
-  (if (and (or (pair? seq) (vector? seq)) (null? args))
-    (%sort seq)  ;; use internal version
-    (apply stable-sort seq args)))
+(define (sort seq . args) (apply stable-sort seq args))
+
+(define (stable-sort seq . args)
+  (let1 ord (if (or (pair? seq) (vector? seq)) (%builtin-ordering args) 'none)
+    (if (eq? ord 'none)
+      (apply %stable-sort seq args)
+      (%sort seq ord (%builtin-key args)))))   ; use internal version
 
-(define (stable-sort seq :optional (cmp #f) (key identity))
+(define (%stable-sort seq :optional (cmp #f) (key identity))
   (define-less? less? cmp 'sort)
   (if (memq key `(,identity ,values))
     (cond [(null? seq) seq]
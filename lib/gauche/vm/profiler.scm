@@ -35,7 +35,9 @@
   (use srfi-13)
   (use util.match)
   (extend gauche.internal)
-  (export profiler-show profiler-get-result
+  (export profiler-show profiler-get-result profiler-get-thread-results
+          profiler-get-stacks profiler-write-folded-stacks
+          profiler-write-pprof
           profiler-show-load-stats with-profiler)
   )
 (select-module gauche.vm.profiler)
@@ -54,6 +56,39 @@
     (hash-table-map r (^(k v) (cons (entry-name k) v)))
     #f))
 
+;;
+;; Returns a list of (<thread> . <result>), where <result> is the same
+;; format as profiler-get-result.  Unless the profiler is started with
+;; all-threads flag, the list only contains the current thread.
+;;
+(define (profiler-get-thread-results)
+  (map (^p (cons (car p)
+                 (hash-table-map (cdr p) (^(k v) (cons (entry-name k) v)))))
+       (profiler-raw-thread-results)))
+
+;;
+;; Returns a list of (<stack> . <samples>), where <stack> is a list of
+;; the names of the frames, outermost first, and <samples> is the number
+;; of samples taken with the stack.  The stacks of all threads are merged.
+;;
+(define (profiler-get-stacks)
+  (stack-trees->stacks (profiler-raw-stacks)))
+
+;;
+;; Write the call stacks in the folded format, one stack per line,
+;; which can be fed to flamegraph.pl.
+;;
+(define (profiler-write-folded-stacks :optional (port (current-output-port)))
+  (write-folded-stacks (profiler-get-stacks) port))
+
+;;
+;; Write the call stacks in pprof's profile.proto format (uncompressed),
+;; which can be read by 'pprof' tool.  Each sample has two values,
+;; the number of samples and the sampled cpu time in nanoseconds.
+;;
+(define (profiler-write-pprof :optional (port (current-output-port)))
+  (write-pprof (profiler-get-stacks) port))
+
 ;;
 ;; Show the profiler result.
 ;;
@@ -62,13 +97,22 @@
 ;;               If not given, the current result is used.
 ;;    :sort-by - either one of 'time, 'count, or 'time-per-call
 ;;    :max-rows - # of rows to be shown.  #f to show everything.
+;;    :per-thread - if true, show the result of each thread separately,
+;;               followed by the total.  Ignored if :results is given.
 ;;
-(define (profiler-show :key (results #f) (sort-by 'time) (max-rows 50))
+(define (profiler-show :key (results #f) (sort-by 'time) (max-rows 50)
+                            (per-thread #f))
   (if (not results)
     ;; use the current result
-    (if-let1 r (profiler-get-result)
-      (show-stats r sort-by max-rows)
-      (print "No profiling data has been gathered."))
+    (begin
+      (when per-thread
+        (dolist [p (profiler-get-thread-results)]
+          (format #t "Thread ~s:\n" (car p))
+          (show-stats (cdr p) sort-by max-rows)
+          (newline)))
+      (if-let1 r (profiler-get-result)
+        (show-stats r sort-by max-rows)
+        (print "No profiling data has been gathered.")))
     ;; gather all the results
     (let1 ht (make-hash-table 'equal?)
       ;; gather stats
@@ -120,12 +164,14 @@
       (start (reverse stats)))))
 
 ;; Convenience API
-(define (with-profiler thunk)
+;;  If ALL-THREADS is true, samples every thread, and shows the result
+;;  of each thread as well.
+(define (with-profiler thunk :optional (all-threads #f))
   (receive vals (dynamic-wind
-                  profiler-start
+                  (cut profiler-start all-threads)
                   thunk
                   profiler-stop)
-    (profiler-show)
+    (profiler-show :per-thread all-threads)
     (profiler-reset)
     (apply values vals)))
 
@@ -178,6 +224,121 @@
         (receive (q r) (quotient&remainder val 10000)
           (format "~2d.~4,'0d" q r))))))
 
+;; ROOTS is a list of the trees returned by profiler-raw-stacks.
+;; Each node is (<sample-hits> . <children>), where <children> is #f or
+;; an eq hashtable from a frame to a node.  Keep this in sync with
+;; src/prof.c.  The result is sorted by the number of samples, then
+;; by the stack, so that the output doesn't depend on the hashtables.
+(define (stack-trees->stacks roots)
+  (let1 ht (make-hash-table 'equal?)
+    (define (walk node path)
+      (let* ([kids (if (cdr node)
+                     (hash-table-fold (cdr node)
+                                      (^(frame child sum)
+                                        (walk child
+                                              (cons (frame-label frame) path))
+                                        (+ sum (car child)))
+                                      0)
+                     0)]
+             [self (- (car node) kids)])
+        (when (and (> self 0) (pair? path))
+          (hash-table-update! ht (reverse path) (cut + <> self) 0))))
+    (dolist [root roots]
+      (walk root '()))
+    (sort (hash-table->alist ht)
+          (^(a b) (or (> (cdr a) (cdr b))
+                      (and (= (cdr a) (cdr b))
+                           (string<? (string-join (car a) ";")
+                                     (string-join (car b) ";"))))))))
+
+(define (write-folded-stacks stacks port)
+  (define (escape label)
+    (string-map (^c (if (char=? c #\;) #\: c)) label))
+  (dolist [e stacks]
+    (format port "~a ~d\n" (string-join (map escape (car e)) ";") (cdr e))))
+
+(define (write-pprof stacks port)
+  (let ([strings (make-hash-table 'equal?)] ; string -> index
+        [strtab '()]                        ; reversed string table
+        [funcs (make-hash-table 'equal?)]   ; label -> id
+        [labels '()])                       ; reversed labels
+    (define (string-index s)
+      (or (hash-table-get strings s #f)
+          (rlet1 i (hash-table-num-entries strings)
+            (hash-table-put! strings s i)
+            (push! strtab s))))
+    (define (func-id label)
+      (or (hash-table-get funcs label #f)
+          (rlet1 id (+ (hash-table-num-entries funcs) 1)
+            (hash-table-put! funcs label id)
+            (push! labels label))))
+    (define (value-type type unit)
+      (^p (pb-int 1 (string-index type) p) (pb-int 2 (string-index unit) p)))
+
+    (string-index "")                   ;string_table[0] must be ""
+    ;; sample_type
+    (pb-message 1 (value-type "samples" "count") port)
+    (pb-message 1 (value-type "cpu" "nanoseconds") port)
+    ;; sample; location ids are innermost first
+    (dolist [e stacks]
+      (pb-message 2 (^p (pb-packed 1 (reverse (map func-id (car e))) p)
+                        (pb-packed 2 (list (cdr e)
+                                           (* (cdr e) *sampling-period-ns*))
+                                   p))
+                  port))
+    ;; location and function.  we use the same id for both.
+    (for-each
+     (^(label id)
+       (pb-message 4 (^p (pb-int 1 id p)
+                         (pb-message 4 (^q (pb-int 1 id q)) p))
+                   port)
+       (pb-message 5 (^p (pb-int 1 id p)
+                         (pb-int 2 (string-index label) p)
+                         (pb-int 3 (string-index label) p))
+                   port))
+     (reverse labels)
+     (iota (length labels) 1))
+    ;; string_table
+    (dolist [s (reverse strtab)]
+      (pb-bytes 6 s port))
+    ;; period_type and period
+    (pb-message 11 (value-type "cpu" "nanoseconds") port)
+    (pb-int 12 *sampling-period-ns* port)))
+
+;; Keep this in sync with SAMPLING_PERIOD in src/prof.c
+(define-constant *sampling-period-ns* 10000000)
+
+;; Return a string to name a frame of the call stack
+(define (frame-label frame)
+  (case frame
+    [(#t) "..."]                        ;truncated stack
+    [(#f) "[toplevel]"]
+    [else (let1 name (entry-name frame)
+            (if (string? name) name (write-to-string name display)))]))
+
+;; Minimal protocol buffer encoder for profiler-write-pprof.
+;; Messages are built in string ports; they may be incomplete strings.
+(define (pb-varint n port)
+  (if (< n 128)
+    (write-byte n port)
+    (begin (write-byte (logior (logand n #x7f) #x80) port)
+           (pb-varint (ash n -7) port))))
+
+(define (pb-int field n port)
+  (pb-varint (ash field 3) port)        ;wire type 0
+  (pb-varint n port))
+
+(define (pb-bytes field s port)
+  (pb-varint (logior (ash field 3) 2) port) ;wire type 2
+  (pb-varint (string-size s) port)
+  (display s port))
+
+(define (pb-message field proc port)
+  (pb-bytes field (call-with-output-string proc) port))
+
+(define (pb-packed field ns port)
+  (pb-message field (^p (dolist [n ns] (pb-varint n p))) port))
+
 ;; Return a 'printable' notation of sampled code location
 (define (entry-name obj)
   (cond
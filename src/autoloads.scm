@@ -142,7 +142,9 @@
           debug-print-pre debug-print-post debug-funcall-pre)
 
 (autoload gauche.vm.profiler
-          profiler-show profiler-show-load-stats with-profiler)
+          profiler-show profiler-show-load-stats with-profiler
+          profiler-get-thread-results profiler-get-stacks
+          profiler-write-folded-stacks profiler-write-pprof)
 
 (autoload srfi-0  (:macro cond-expand))
 (autoload srfi-7  (:macro program))
@@ -95,6 +95,7 @@ static ScmBignum *bignum_lshift(ScmBignum *br, const ScmBignum *bx, int amount);
 static int bignum_safe_size_for_add(const ScmBignum *x, const ScmBignum *y);
 static ScmBignum *bignum_add_int(ScmBignum *br, const ScmBignum *bx, const ScmBignum *by);
 static ScmBignum *bignum_2scmpl(ScmBignum *br);
+static u_long bignum_sdiv(ScmBignum *dividend, u_long divisor);
 
 /*---------------------------------------------------------------------
  * Constructor
@@ -838,12 +839,331 @@ static ScmBignum *bignum_mul_word(ScmBignum *br, const ScmBignum *bx,
     return br;
 }
 
+/*
+ * Multiplication of magnitudes.
+ *
+ * Small numbers are multiplied by the schoolbook method.  When the
+ * smaller operand gets longer than karatsuba_threshold words we switch
+ * to Karatsuba, and longer than toom3_threshold words to Toom-3.
+ * The crossover points depend on the platform; run
+ * test/bignum-performance.scm to find them, and give them as
+ * -DBIGNUM_KARATSUBA_THRESHOLD=n and -DBIGNUM_TOOM3_THRESHOLD=n
+ * in CFLAGS.
+ *
+ * The schoolbook and Karatsuba routines work on bare word arrays
+ * (least significant word first) with a scratch area, so that the
+ * recursion doesn't allocate.  Toom-3 is only used for large numbers,
+ * so it works on bignums for simplicity.
+ */
+
+#ifndef BIGNUM_KARATSUBA_THRESHOLD
+#define BIGNUM_KARATSUBA_THRESHOLD 32
+#endif
+#ifndef BIGNUM_TOOM3_THRESHOLD
+#define BIGNUM_TOOM3_THRESHOLD 3000
+#endif
+
+/* The scratch area estimation in words_mul relies on this. */
+#define KARATSUBA_THRESHOLD_MIN 8
+#define TOOM3_THRESHOLD_MIN     16
+
+#if BIGNUM_KARATSUBA_THRESHOLD < KARATSUBA_THRESHOLD_MIN
+#error "BIGNUM_KARATSUBA_THRESHOLD too small"
+#endif
+
+static int karatsuba_threshold = BIGNUM_KARATSUBA_THRESHOLD;
+static int toom3_threshold = BIGNUM_TOOM3_THRESHOLD;
+
+/* For tuning.  If *karatsuba or *toom3 is positive, the threshold is
+   set to it.  The current values are returned in them. */
+void Scm__BignumMulThresholds(int *karatsuba, int *toom3)
+{
+    if (*karatsuba > 0) {
+        karatsuba_threshold = max(*karatsuba, KARATSUBA_THRESHOLD_MIN);
+    }
+    if (*toom3 > 0) {
+        toom3_threshold = max(*toom3, TOOM3_THRESHOLD_MIN);
+    }
+    *karatsuba = karatsuba_threshold;
+    *toom3 = toom3_threshold;
+}
+
+/* r[0..xn) = x[0..xn) + y[0..yn), xn >= yn.  Returns carry.
+   r can be the same as x. */
+static u_long words_add(u_long *r, const u_long *x, int xn,
+                        const u_long *y, int yn)
+{
+    u_long c = 0, t;
+    int i;
+    for (i=0; i<yn; i++) { UADD(t, c, x[i], y[i]); r[i] = t; }
+    for (; i<xn; i++)    { UADD(t, c, x[i], 0);    r[i] = t; }
+    return c;
+}
+
+/* r[0..xn) = x[0..xn) - y[0..yn), xn >= yn.  Returns borrow.
+   r can be the same as x. */
+static u_long words_sub(u_long *r, const u_long *x, int xn,
+                        const u_long *y, int yn)
+{
+    u_long c = 0, t;
+    int i;
+    for (i=0; i<yn; i++) { USUB(t, c, x[i], y[i]); r[i] = t; }
+    for (; i<xn; i++)    { USUB(t, c, x[i], 0);    r[i] = t; }
+    return c;
+}
+
+/* r[off..rn) += x[0..xn).  The carry out of r is discarded. */
+static void words_add_at(u_long *r, int rn, const u_long *x, int xn, int off)
+{
+    u_long c = 0, t;
+    int i;
+    for (i=0; i<xn && i+off<rn; i++) {
+        UADD(t, c, r[i+off], x[i]); r[i+off] = t;
+    }
+    for (i+=off; c && i<rn; i++) {
+        UADD(t, c, r[i], 0); r[i] = t;
+    }
+}
+
+/* r[0..n) = |a[0..n) - b[0..bn)|, n >= bn.  Returns TRUE iff a < b. */
+static int words_absdiff(u_long *r, const u_long *a, const u_long *b,
+                         int bn, int n)
+{
+    int i;
+    for (i=n-1; i>=bn; i--) {
+        if (a[i]) break;
+    }
+    if (i < bn) {
+        for (i=bn-1; i>=0 && a[i]==b[i]; i--)
+            ;
+        if (i >= 0 && a[i] < b[i]) {
+            words_sub(r, b, bn, a, bn);
+            for (i=bn; i<n; i++) r[i] = 0;
+            return TRUE;
+        }
+    }
+    words_sub(r, a, n, b, bn);
+    return FALSE;
+}
+
+/* r[0..xn+yn) = x[0..xn) * y[0..yn) */
+static void words_mul_basecase(u_long *r, const u_long *x, int xn,
+                               const u_long *y, int yn)
+{
+    for (int i=0; i<xn+yn; i++) r[i] = 0;
+    for (int j=0; j<yn; j++) {
+        u_long yj = y[j], c = 0;
+        if (yj == 0) continue;
+        for (int i=0; i<xn; i++) {
+            u_long hi, lo, t;
+            UMUL(hi, lo, x[i], yj);
+            lo += c;
+            hi += (lo < c);
+            t = r[i+j] + lo;
+            hi += (t < lo);     /* never overflows */
+            r[i+j] = t;
+            c = hi;
+        }
+        r[j+xn] = c;
+    }
+}
+
+/* r[0..2n) = x[0..n)^2.  Each cross product is calculated once and
+   doubled. */
+static void words_sqr_basecase(u_long *r, const u_long *x, int n)
+{
+    for (int i=0; i<2*n; i++) r[i] = 0;
+    for (int j=0; j<n-1; j++) {
+        u_long xj = x[j], c = 0;
+        if (xj == 0) continue;
+        for (int i=j+1; i<n; i++) {
+            u_long hi, lo, t;
+            UMUL(hi, lo, x[i], xj);
+            lo += c;
+            hi += (lo < c);
+            t = r[i+j] + lo;
+            hi += (t < lo);     /* never overflows */
+            r[i+j] = t;
+            c = hi;
+        }
+        r[j+n] = c;
+    }
+    for (int i=2*n-1; i>0; i--) {
+        r[i] = (r[i]<<1) | (r[i-1]>>(WORD_BITS-1));
+    }
+    r[0] <<= 1;
+    u_long c = 0;
+    for (int i=0; i<n; i++) {
+        u_long hi, lo, t;
+        UMUL(hi, lo, x[i], x[i]);
+        UADD(t, c, r[2*i], lo);   r[2*i] = t;
+        UADD(t, c, r[2*i+1], hi); r[2*i+1] = t;
+    }
+}
+
+static void words_mul(u_long *r, const u_long *x, int xn,
+                      const u_long *y, int yn, u_long *w);
+
+/* Karatsuba.  xn >= yn > h, where h = ceil(xn/2).
+   Let x = x1*B^h + x0, y = y1*B^h + y0.  Then
+     x*y = z2*B^2h + (z0 + z2 - (x0-x1)(y0-y1))*B^h + z0
+   where z0 = x0*y0, z2 = x1*y1.  Uses 6h+1 words of w, besides the
+   ones used by the recursive calls. */
+static void words_karatsuba(u_long *r, const u_long *x, int xn,
+                            const u_long *y, int yn, u_long *w)
+{
+    int h = (xn+1)/2;
+    int x1n = xn - h, y1n = yn - h;
+    int square = (x == y && xn == yn);
+    u_long *dx = w, *dy = w+h, *zm = w+2*h, *t = w+4*h, *ww = w+6*h+1;
+
+    /* dx = |x0 - x1|, dy = |y0 - y1|, zm = dx*dy */
+    int nx = words_absdiff(dx, x, x+h, x1n, h);
+    int ny = nx;
+    if (square) dy = dx;
+    else        ny = words_absdiff(dy, y, y+h, y1n, h);
+    words_mul(zm, dx, h, dy, h, ww);
+
+    /* z0 and z2 go directly to the lower and upper half of r */
+    words_mul(r, x, h, y, h, ww);
+    words_mul(r+2*h, x+h, x1n, y+h, y1n, ww);
+
+    /* t = z0 + z2 -/+ zm, which is x0*y1 + x1*y0 >= 0 */
+    t[2*h] = words_add(t, r, 2*h, r+2*h, x1n+y1n);
+    if (nx == ny) words_sub(t, t, 2*h+1, zm, 2*h);
+    else          words_add(t, t, 2*h+1, zm, 2*h);
+    words_add_at(r, xn+yn, t, 2*h+1, h);
+}
+
+/* r[0..xn+yn) = x[0..xn) * y[0..yn), xn >= yn.
+   W is a scratch area of at least 8*xn words; it may be NULL if
+   yn < karatsuba_threshold.
+
+   The scratch area estimation: Let W(n) be the words used to multiply
+   n-word number, then Karatsuba needs 6h+1 + W(h) words (h = ceil(n/2)),
+   and the unbalanced case needs 2yn + W(yn) words for yn <= ceil(n/2).
+   Both are below 8n as far as the threshold >= 8. */
+static void words_mul(u_long *r, const u_long *x, int xn,
+                      const u_long *y, int yn, u_long *w)
+{
+    if (yn < karatsuba_threshold) {
+        if (x == y && xn == yn) words_sqr_basecase(r, x, xn);
+        else words_mul_basecase(r, x, xn, y, yn);
+    } else if (yn <= (xn+1)/2) {
+        /* Unbalanced.  Cut x into yn-word pieces. */
+        u_long *t = w;
+        for (int i=0; i<xn+yn; i++) r[i] = 0;
+        for (int off=0; off<xn; off+=yn) {
+            int n = min(yn, xn-off);
+            words_mul(t, y, yn, x+off, n, w+2*yn);
+            words_add_at(r, xn+yn, t, yn+n, off);
+        }
+    } else {
+        words_karatsuba(r, x, xn, y, yn, w);
+    }
+}
+
+/* Returns a new positive bignum with the words [from, to) of b.
+   from < b->size. */
+static ScmBignum *bignum_slice(const ScmBignum *b, int from, int to)
+{
+    if (to > (int)b->size) to = b->size;
+    ScmBignum *r = make_bignum(to - from);
+    for (int i=from; i<to; i++) r->values[i-from] = b->values[i];
+    return r;
+}
+
+/* Drops the leading zero words, leaving at least one word. */
+static ScmBignum *bignum_trim(ScmBignum *b)
+{
+    while (b->size > 1 && b->values[b->size-1] == 0) b->size--;
+    return b;
+}
+
+#define TRIMMED_ADD(x, y)  bignum_trim(bignum_add(x, y))
+#define TRIMMED_SUB(x, y)  bignum_trim(bignum_sub(x, y))
+
+static ScmBignum *bignum_mul(const ScmBignum *bx, const ScmBignum *by);
+
+/* Toom-3.  bx->size >= by->size > 2k, where k = ceil(bx->size/3).
+   Splitting x and y into three k-word pieces, we evaluate them at
+   0, 1, -1, -2 and infinity, multiply those five pairs, and
+   interpolate the product by the sequence of Bodrato.
+   The sign of the result is left for the caller. */
+static ScmBignum *bignum_mul_toom3(const ScmBignum *bx, const ScmBignum *by)
+{
+    int k = (bx->size+2)/3;
+    ScmBignum *x0 = bignum_trim(bignum_slice(bx, 0, k));
+    ScmBignum *x1 = bignum_trim(bignum_slice(bx, k, 2*k));
+    ScmBignum *x2 = bignum_trim(bignum_slice(bx, 2*k, bx->size));
+    ScmBignum *y0, *y1, *y2;
+    ScmBignum *p1, *pm1, *pm2, *q1, *qm1, *qm2, *t;
+
+    /* evaluation */
+    t   = TRIMMED_ADD(x0, x2);
+    p1  = TRIMMED_ADD(t, x1);
+    pm1 = TRIMMED_SUB(t, x1);
+    t   = TRIMMED_ADD(pm1, x2);
+    pm2 = TRIMMED_SUB(TRIMMED_ADD(t, t), x0);
+    if (bx == by) {
+        y0 = x0; y1 = x1; y2 = x2; q1 = p1; qm1 = pm1; qm2 = pm2;
+    } else {
+        y0 = bignum_trim(bignum_slice(by, 0, k));
+        y1 = bignum_trim(bignum_slice(by, k, 2*k));
+        y2 = bignum_trim(bignum_slice(by, 2*k, by->size));
+        t   = TRIMMED_ADD(y0, y2);
+        q1  = TRIMMED_ADD(t, y1);
+        qm1 = TRIMMED_SUB(t, y1);
+        t   = TRIMMED_ADD(qm1, y2);
+        qm2 = TRIMMED_SUB(TRIMMED_ADD(t, t), y0);
+    }
+
+    /* pointwise multiplication */
+    ScmBignum *r0   = bignum_trim(bignum_mul(x0, y0));
+    ScmBignum *r1   = bignum_trim(bignum_mul(p1, q1));
+    ScmBignum *rm1  = bignum_trim(bignum_mul(pm1, qm1));
+    ScmBignum *rm2  = bignum_trim(bignum_mul(pm2, qm2));
+    ScmBignum *rinf = bignum_trim(bignum_mul(x2, y2));
+    ScmBignum *r2, *r3;
+
+    /* interpolation.  all divisions are exact. */
+    r3 = TRIMMED_SUB(rm2, r1);
+    bignum_sdiv(r3, 3);
+    r1 = TRIMMED_SUB(r1, rm1);
+    bignum_rshift(r1, r1, 1);
+    r2 = TRIMMED_SUB(rm1, r0);
+    r3 = TRIMMED_SUB(r2, r3);
+    bignum_rshift(r3, r3, 1);
+    r3 = TRIMMED_ADD(r3, TRIMMED_ADD(rinf, rinf));
+    r2 = TRIMMED_SUB(TRIMMED_ADD(r2, r1), rinf);
+    r1 = TRIMMED_SUB(r1, r3);
+
+    /* recomposition.  the coefficients are all nonnegative here. */
+    ScmBignum *br = make_bignum(bx->size + by->size);
+    words_add_at(br->values, br->size, r0->values, r0->size, 0);
+    words_add_at(br->values, br->size, r1->values, r1->size, k);
+    words_add_at(br->values, br->size, r2->values, r2->size, 2*k);
+    words_add_at(br->values, br->size, r3->values, r3->size, 3*k);
+    words_add_at(br->values, br->size, rinf->values, rinf->size, 4*k);
+    return br;
+}
+
 /* returns bx * by.  not normalized */
 static ScmBignum *bignum_mul(const ScmBignum *bx, const ScmBignum *by)
 {
-    ScmBignum *br = make_bignum(bx->size + by->size);
-    for (u_int i=0; i<by->size; i++) {
-        bignum_mul_word(br, bx, by->values[i], i);
+    if (bx->size < by->size) {
+        const ScmBignum *t = bx; bx = by; by = t;
+    }
+    int xs = bx->size, ys = by->size;
+    ScmBignum *br;
+
+    if (ys >= toom3_threshold && ys > 2*((xs+2)/3)) {
+        br = bignum_mul_toom3(bx, by);
+    } else {
+        br = make_bignum(xs + ys);
+        u_long *w = NULL;
+        if (ys >= karatsuba_threshold) w = SCM_NEW_ATOMIC_ARRAY(u_long, 8*xs);
+        words_mul(br->values, bx->values, xs, by->values, ys, w);
     }
     br->sign = bx->sign * by->sign;
     return br;
@@ -1274,27 +1594,280 @@ int Scm_BignumLogCount(const ScmBignum *b)
 
 
 /*-----------------------------------------------------------------------
- * Printing
+ * Radix conversion
+ *
+ *  Converting between a bignum and its digit string by one word at
+ *  a time takes O(n^2).  For large numbers we divide and conquer with
+ *  the powers of the radix, radix^(d*2^i), so that the cost is dominated
+ *  by a few multiplications of the size of the number.  When printing,
+ *  the division by the power is done by multiplying its reciprocal,
+ *  which is calculated by Newton iteration.
  */
 
+/* Numbers smaller than this many words are converted one word at
+   a time. */
+#ifndef BIGNUM_RADIX_CONV_THRESHOLD
+#define BIGNUM_RADIX_CONV_THRESHOLD  40
+#endif
+
+/* Divisors smaller than this many words are handled by the ordinary
+   division. */
+#ifndef BIGNUM_RECIPROCAL_THRESHOLD
+#define BIGNUM_RECIPROCAL_THRESHOLD  60
+#endif
+
+#define RADIX_POWS_MAX  40
+
+struct radix_pow {
+    ScmObj pow;                 /* radix^digits */
+    ScmObj recip;               /* approx. 2^(2*bits)/pow, or #f */
+    long bits;                  /* integer-length of pow */
+    int digits;
+};
+
+struct radix_conv {
+    int radix;
+    u_long chunk;               /* radix^chunkdigits, fits in a half word */
+    int chunkdigits;
+    int needrecip;              /* TRUE if we divide by the powers */
+    int npows;
+    struct radix_pow pows[RADIX_POWS_MAX];
+};
+
+/* NEEDRECIP is TRUE for integer->string conversion, which divides the
+   number by the powers.  String->integer conversion only multiplies,
+   so we don't waste time to compute the reciprocals. */
+static void radix_conv_init(struct radix_conv *rc, int radix, int needrecip)
+{
+    rc->radix = radix;
+    rc->needrecip = needrecip;
+    rc->chunk = radix;
+    rc->chunkdigits = 1;
+    while (rc->chunk < ((u_long)1<<HALF_BITS)/radix) {
+        rc->chunk *= radix;
+        rc->chunkdigits++;
+    }
+    rc->npows = 0;
+}
+
+/* Returns an approximation of 2^(2k)/p, where k = integer-length(p).
+   The error is within a few units. */
+static ScmObj reciprocal(ScmObj p, long k)
+{
+    if (k <= BIGNUM_RECIPROCAL_THRESHOLD*WORD_BITS) {
+        return Scm_Quotient(Scm_Ash(SCM_MAKE_INT(1), 2*k), p, NULL);
+    }
+    /* The reciprocal of the upper h bits gives about h bits of precision,
+       and one Newton step r' = 2r - p*r^2/2^2k doubles it. */
+    long h = k/2 + 32;
+    ScmObj r = Scm_Ash(reciprocal(Scm_Ash(p, h-k), h), k-h);
+    ScmObj e = Scm_Ash(Scm_Mul(p, Scm_Mul(r, r)), -2*k);
+    return Scm_Sub(Scm_Ash(r, 1), e);
+}
+
+/* Adds the next power, radix^digits, to the table.  The first one is
+   the smallest power with about BIGNUM_RADIX_CONV_THRESHOLD/2 words;
+   the following ones are its squares.  Returns FALSE if the table is
+   full. */
+static int radix_conv_add_pow(struct radix_conv *rc)
+{
+    struct radix_pow *p = &rc->pows[rc->npows];
+    if (rc->npows == RADIX_POWS_MAX) return FALSE;
+    if (rc->npows == 0) {
+        int d = rc->chunkdigits;
+        while (d < BIGNUM_RADIX_CONV_THRESHOLD * rc->chunkdigits) d *= 2;
+        p->digits = d;
+        p->pow = Scm_ExactIntegerExpt(SCM_MAKE_INT(rc->radix),
+                                      SCM_MAKE_INT(d));
+    } else {
+        p->digits = p[-1].digits * 2;
+        p->pow = Scm_Mul(p[-1].pow, p[-1].pow);
+    }
+    p->bits = Scm_BitsHighest1((ScmBits*)SCM_BIGNUM(p->pow)->values, 0,
+                               SCM_BIGNUM_SIZE(p->pow)*WORD_BITS) + 1;
+    p->recip = SCM_FALSE;
+    if (rc->needrecip
+        && SCM_BIGNUM_SIZE(p->pow) >= BIGNUM_RECIPROCAL_THRESHOLD) {
+        p->recip = reciprocal(p->pow, p->bits);
+    }
+    rc->npows++;
+    return TRUE;
+}
+
+/* Returns n / p->pow and sets the remainder to *rem.  0 <= n < pow^2. */
+static ScmObj radix_divrem(ScmObj n, struct radix_pow *p, ScmObj *rem)
+{
+    if (SCM_FALSEP(p->recip)) return Scm_Quotient(n, p->pow, rem);
+
+    ScmObj q = Scm_Ash(Scm_Mul(n, p->recip), -2*p->bits);
+    ScmObj r = Scm_Sub(n, Scm_Mul(q, p->pow));
+    while (Scm_Sign(r) < 0) {
+        q = Scm_Sub(q, SCM_MAKE_INT(1));
+        r = Scm_Add(r, p->pow);
+    }
+    while (Scm_NumCmp(r, p->pow) >= 0) {
+        q = Scm_Add(q, SCM_MAKE_INT(1));
+        r = Scm_Sub(r, p->pow);
+    }
+    *rem = r;
+    return q;
+}
+
+/* Writes the digits of nonnegative integer n backwards from END, and
+   returns the pointer to the first digit.  If PAD > 0, exactly PAD
+   digits are written with leading zeros. */
+static char *radix_conv_small(struct radix_conv *rc, ScmObj n,
+                              const char *tab, char *end, int pad)
+{
+    char *p = end;
+    int radix = rc->radix;
+
+    if (SCM_INTP(n)) {
+        for (u_long v = SCM_INT_VALUE(n); v > 0; v /= radix) {
+            *--p = tab[v % radix];
+        }
+    } else {
+        ScmBignum *q;
+        int size = SCM_BIGNUM_SIZE(n);
+        ALLOC_TEMP_BIGNUM(q, size);
+        for (int i=0; i<size; i++) q->values[i] = SCM_BIGNUM(n)->values[i];
+        while (q->size > 0) {
+            u_long rem = bignum_sdiv(q, rc->chunk);
+            while (q->size > 0 && q->values[q->size-1] == 0) q->size--;
+            if (q->size > 0) {
+                for (int i=0; i<rc->chunkdigits; i++, rem /= radix) {
+                    *--p = tab[rem % radix];
+                }
+            } else {
+                for (; rem > 0; rem /= radix) *--p = tab[rem % radix];
+            }
+        }
+    }
+    if (pad > 0) {
+        while (p > end - pad) *--p = '0';
+    }
+    return p;
+}
+
+/* Same as radix_conv_small, but divides n by rc->pows[level] and
+   recurses.  n < pows[level+1]. */
+static char *radix_conv_rec(struct radix_conv *rc, ScmObj n, int level,
+                            const char *tab, char *end, int pad)
+{
+    if (level < 0 || SCM_INTP(n)
+        || SCM_BIGNUM_SIZE(n) < BIGNUM_RADIX_CONV_THRESHOLD) {
+        return radix_conv_small(rc, n, tab, end, pad);
+    }
+    struct radix_pow *p = &rc->pows[level];
+    if (pad == 0 && Scm_NumCmp(n, p->pow) < 0) {
+        return radix_conv_rec(rc, n, level-1, tab, end, 0);
+    }
+    ScmObj r;
+    ScmObj q = radix_divrem(n, p, &r);
+    radix_conv_rec(rc, r, level-1, tab, end, p->digits);
+    return radix_conv_rec(rc, q, level-1, tab, end - p->digits,
+                          (pad > 0)? pad - p->digits : 0);
+}
+
 ScmObj Scm_BignumToString(const ScmBignum *b, int radix, int use_upper)
 {
     static const char ltab[] = "0123456789abcdefghijklmnopqrstuvwxyz";
     static const char utab[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
     const char *tab = use_upper? utab : ltab;
-    ScmObj h = SCM_NIL, t = SCM_NIL;
     if (radix < 2 || radix > 36)
         Scm_Error("radix out of range: %d", radix);
-    ScmBignum *q = SCM_BIGNUM(Scm_BignumCopy(b));
-    for (;q->size > 0;) {
-        long rem = bignum_sdiv(q, radix);
-        SCM_ASSERT(rem >= 0 && rem < radix);
-        SCM_APPEND1(h, t, SCM_MAKE_CHAR(tab[rem]));
-        for (; q->values[q->size-1] == 0 && q->size > 0; q->size--)
-            ;
+
+    struct radix_conv rc;
+    radix_conv_init(&rc, radix, TRUE);
+
+    /* Upper bound of the number of digits, plus the sign. */
+    long nbits = (long)b->size * WORD_BITS;
+    int lg = 0;
+    while ((2<<lg) <= radix) lg++;   /* floor(log2(radix)) */
+    long buflen = nbits/lg + 2;
+    char *buf = SCM_NEW_ATOMIC2(char*, buflen + 1);
+    char *end = buf + buflen;
+
+    ScmObj n = (b->sign < 0)? Scm_BignumNegate(b) : SCM_OBJ(b);
+    char *p;
+    if (b->size < BIGNUM_RADIX_CONV_THRESHOLD) {
+        p = radix_conv_small(&rc, n, tab, end, 0);
+    } else {
+        /* Prepare the powers up to the one whose square exceeds n. */
+        do {
+            if (!radix_conv_add_pow(&rc)) break;
+        } while (Scm_NumCmp(rc.pows[rc.npows-1].pow, n) <= 0);
+        p = radix_conv_rec(&rc, n, rc.npows-1, tab, end, 0);
+    }
+    if (p == end) *--p = '0';
+    if (b->sign < 0) *--p = '-';
+    long len = end - p;
+    memmove(buf, p, len);
+    buf[len] = '\0';
+    return Scm_MakeString(buf, len, len, 0);
+}
+
+/* Digit values of the characters; -1 for non-digits. */
+static int digit_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+    return -1;
+}
+
+static ScmObj digits_small(struct radix_conv *rc, const char *s, int len)
+{
+    /* Each digit needs less than log2(radix)+1 bits */
+    int lg = 1;
+    while ((1<<lg) < rc->radix) lg++;
+    int size = (len*lg)/WORD_BITS + 1;
+    ScmBignum *b = make_bignum(size);
+    int used = 0;               /* # of words in use */
+    int i = 0;
+    while (i < len) {
+        u_long m = 1, a = 0;
+        for (int j=0; j<rc->chunkdigits && i < len; j++, i++) {
+            a = a * rc->radix + digit_value(s[i]);
+            m *= rc->radix;
+        }
+        /* b = b*m + a */
+        u_long c = a;
+        for (int k=0; k<used; k++) {
+            u_long hi, lo;
+            UMUL(hi, lo, b->values[k], m);
+            lo += c;
+            hi += (lo < c);
+            b->values[k] = lo;
+            c = hi;
+        }
+        if (c) b->values[used++] = c;
     }
-    if (q->sign < 0) SCM_APPEND1(h, t, SCM_MAKE_CHAR('-'));
-    return Scm_ListToString(Scm_ReverseX(h));
+    return Scm_NormalizeBignum(b);
+}
+
+static ScmObj digits_rec(struct radix_conv *rc, const char *s, int len,
+                         int level)
+{
+    while (level >= 0 && rc->pows[level].digits >= len) level--;
+    if (level < 0) return digits_small(rc, s, len);
+    int w = rc->pows[level].digits;
+    ScmObj hi = digits_rec(rc, s, len - w, level-1);
+    ScmObj lo = digits_rec(rc, s + len - w, w, level-1);
+    return Scm_Add(Scm_Mul(hi, rc->pows[level].pow), lo);
+}
+
+/* Returns the nonnegative integer represented by LEN digits from S in
+   RADIX.  The caller must ensure they're all valid digits.  Used by the
+   reader for long numbers. */
+ScmObj Scm__DigitsToInteger(const char *s, int len, int radix)
+{
+    struct radix_conv rc;
+    radix_conv_init(&rc, radix, FALSE);
+    do {
+        if (!radix_conv_add_pow(&rc)) break;
+    } while (rc.pows[rc.npows-1].digits*2 < len);
+    return digits_rec(&rc, s, len, rc.npows-1);
 }
 
 int Scm_DumpBignum(const ScmBignum *b, ScmPort *out)
@@ -33,7 +33,7 @@
                   {{ SCM_CLASS_STATIC_TAG(Scm_SymbolClass) }, \
                    SCM_STRING(s), SCM_SYMBOL_FLAG_INTERNED }")
     (cgen-init "#define INTERN(s, i) \
-                  Scm_HashTableSet(obtable, s, SCM_OBJ(&Scm_BuiltinSymbols[i]), 0)")
+                  (void)symtab_intern(&Scm_BuiltinSymbols[i])")
 
     (for-each-with-index
      (^[index entry]
@@ -38,12 +38,18 @@
 #include "gauche/priv/builtin-syms.h"
 #include "gauche/priv/macroP.h"
 #include "gauche/priv/writerP.h"
+#include "gauche/priv/lftableP.h"
 
 /* Some routines uses small array on stack to keep data about
    arguments to dispatch.  If the # of args used for dispach is bigger
    than this, the routine allocates an array in heap. */
 #define PREALLOC_SIZE  32
 
+/* Discards the dispatch cache of generic function GF.  Must be called
+   with gf->lock held.  See "Dispatch cache" below. */
+static void invalidate_dispatch_cache(ScmGeneric *gf);
+#define INVALIDATE_DISPATCH_CACHE(gf)  invalidate_dispatch_cache(gf)
+
 /*===================================================================
  * Built-in classes
  */
@@ -65,6 +71,7 @@ static ScmObj instance_class_redefinition(ScmObj obj, ScmClass *old);
 static ScmObj slot_set_using_accessor(ScmObj obj, ScmSlotAccessor *sa,
                                       ScmObj val);
 static ScmObj instance_allocate(ScmClass *klass, ScmObj initargs);
+static void bump_dispatch_generation(void);
 
 static int    object_compare(ScmObj x, ScmObj y, int equalp);
 static ScmObj fallback_compare(ScmObj *, int, ScmGeneric *);
@@ -1033,6 +1040,9 @@ void Scm_CommitClassRedefinition(ScmClass *klass, ScmObj newklass)
     }
     (void)SCM_INTERNAL_MUTEX_UNLOCK(klass->mutex);
 
+    /* Applicable methods may have been changed. */
+    bump_dispatch_generation();
+
     /* Decrement the recursive global lock. */
     unlock_class_redefinition(vm);
 }
@@ -2055,6 +2065,7 @@ static void generic_methods_set(ScmGeneric *gf, ScmObj val)
     (void)SCM_INTERNAL_MUTEX_LOCK(gf->lock);
     gf->methods = val;
     gf->maxReqargs = reqs;
+    INVALIDATE_DISPATCH_CACHE(gf);
     (void)SCM_INTERNAL_MUTEX_UNLOCK(gf->lock);
 }
 
@@ -2111,32 +2122,30 @@ int Scm_MethodApplicableForClasses(ScmMethod *m, ScmClass *types[], int nargs)
     return TRUE;
 }
 
-/* compute-applicable-methods */
-ScmObj Scm_ComputeApplicableMethods(ScmGeneric *gf, ScmObj *argv, int argc,
-                                    int applyargs)
+/* Stores the classes of the first NSEL arguments into TYPEV, and returns
+   the total number of arguments.  If APPLYARGS is true, the last element
+   of ARGV is a list of the rest arguments. */
+static int collect_arg_classes(ScmObj *argv, int argc, int applyargs,
+                               ScmClass **typev, int nsel)
 {
-    ScmObj methods = gf->methods, mp, ap;
-    ScmObj h = SCM_NIL, t = SCM_NIL;
-    ScmClass *typev_s[PREALLOC_SIZE], **typev = typev_s;
-    int i, nsel;
-
-    if (SCM_NULLP(methods)) return SCM_NIL;
-
-    if (gf->maxReqargs > PREALLOC_SIZE) {
-        typev = SCM_NEW_ATOMIC_ARRAY(ScmClass*, gf->maxReqargs);
-    }
-    nsel = gf->maxReqargs;
+    int i = 0;
     if (applyargs) argc--;
-    for (i = 0; i < argc && nsel >= 0; i++, nsel--) {
+    for (; i < argc && i < nsel; i++) {
         typev[i] = Scm_ClassOf(argv[i]);
     }
-    if (applyargs && nsel) {
+    if (applyargs) {
+        ScmObj ap;
         SCM_FOR_EACH(ap, argv[argc]) {
-            if (--nsel >= 0) typev[i++] = Scm_ClassOf(SCM_CAR(ap));
+            if (i < nsel) typev[i++] = Scm_ClassOf(SCM_CAR(ap));
             argc++;
         }
     }
+    return argc;
+}
 
+static ScmObj applicable_methods(ScmObj methods, ScmClass **typev, int argc)
+{
+    ScmObj h = SCM_NIL, t = SCM_NIL, mp;
     SCM_FOR_EACH(mp, methods) {
         ScmObj m = SCM_CAR(mp);
         SCM_ASSERT(SCM_METHODP(m));
@@ -2147,6 +2156,22 @@ ScmObj Scm_ComputeApplicableMethods(ScmGeneric *gf, ScmObj *argv, int argc,
     return h;
 }
 
+/* compute-applicable-methods */
+ScmObj Scm_ComputeApplicableMethods(ScmGeneric *gf, ScmObj *argv, int argc,
+                                    int applyargs)
+{
+    ScmObj methods = gf->methods;
+    ScmClass *typev_s[PREALLOC_SIZE], **typev = typev_s;
+
+    if (SCM_NULLP(methods)) return SCM_NIL;
+
+    if (gf->maxReqargs > PREALLOC_SIZE) {
+        typev = SCM_NEW_ATOMIC_ARRAY(ScmClass*, gf->maxReqargs);
+    }
+    argc = collect_arg_classes(argv, argc, applyargs, typev, gf->maxReqargs);
+    return applicable_methods(methods, typev, argc);
+}
+
 static ScmObj compute_applicable_methods(ScmNextMethod *nm,
                                          ScmObj *argv,
                                          int argc,
@@ -2243,14 +2268,12 @@ static SCM_DEFINE_METHOD(method_more_specific_p_rec,
  *  TODO: can't we carry around the method list in array
  *  instead of list, at least internally?
  */
-ScmObj Scm_SortMethods(ScmObj methods, ScmObj *argv, int argc)
+static ScmObj sort_methods(ScmObj methods, ScmClass **targv, int argc)
 {
     ScmObj array_s[PREALLOC_SIZE], *array = array_s;
-    ScmClass *targv_s[PREALLOC_SIZE], **targv = targv_s;
     int cnt = 0, len = Scm_Length(methods);
 
     if (len >= PREALLOC_SIZE)  array = SCM_NEW_ARRAY(ScmObj, len);
-    if (argc >= PREALLOC_SIZE) targv = SCM_NEW_ARRAY(ScmClass*, argc);
 
     ScmObj mp;
     SCM_FOR_EACH(mp, methods) {
@@ -2259,7 +2282,6 @@ ScmObj Scm_SortMethods(ScmObj methods, ScmObj *argv, int argc)
         array[cnt] = SCM_CAR(mp);
         cnt++;
     }
-    for (int i=0; i<argc; i++) targv[i] = Scm_ClassOf(argv[i]);
 
     for (int step = len/2; step > 0; step /= 2) {
         for (int i=step; i<len; i++) {
@@ -2279,6 +2301,304 @@ ScmObj Scm_SortMethods(ScmObj methods, ScmObj *argv, int argc)
     return Scm_ArrayToList(array, len);
 }
 
+ScmObj Scm_SortMethods(ScmObj methods, ScmObj *argv, int argc)
+{
+    ScmClass *targv_s[PREALLOC_SIZE], **targv = targv_s;
+
+    if (argc >= PREALLOC_SIZE) targv = SCM_NEW_ARRAY(ScmClass*, argc);
+    for (int i=0; i<argc; i++) targv[i] = Scm_ClassOf(argv[i]);
+    return sort_methods(methods, targv, argc);
+}
+
+/*
+ * Dispatch cache
+ *
+ *   The sorted list of applicable methods only depends on the number of
+ *   arguments and the classes of the first maxReqargs arguments.  Each
+ *   generic function keeps a hash table that maps them to the sorted
+ *   methods, so that the VM doesn't need to scan and sort methods on
+ *   every pure generic application.
+ *
+ *   The table is an ScmLFTable (gauche/priv/lftableP.h), so the lookup
+ *   doesn't need a lock.  Adding a new entry is done with gf->lock, and
+ *   only if the table is still the current one of the generic.
+ *
+ *   Adding, deleting or replacing a method discards the table of the
+ *   generic.  Class redefinition may alter the specializers of methods
+ *   in any generic function, so it bumps dispatchGeneration, which makes
+ *   all tables created before obsolete.
+ *
+ *   When a table gets crowded, we start over with a new, larger table,
+ *   up to DISPATCH_CACHE_MAX_BUCKETS.  Entries of the old table are
+ *   recovered lazily.
+ *
+ *   ScmGeneric may be statically allocated by extensions with
+ *   SCM_DEFINE_GENERIC, so we can't add slots to it.  The table and the
+ *   statistics of each generic are kept in a GenericDispatch record,
+ *   which we find from a global ScmLFTable keyed by the generic.  The
+ *   generic is held weakly; records of generics that are gone are
+ *   dropped when the global table is rehashed.
+ */
+
+#define DISPATCH_CACHE_INITIAL_BUCKETS  8
+#define DISPATCH_CACHE_MAX_BUCKETS      512
+
+typedef struct DispatchEntryRec {
+    ScmLFEntry hdr;
+    int argc;                   /* total # of args */
+    int nsel;                   /* # of classes in the key */
+    ScmObj methods;             /* sorted applicable methods */
+    ScmClass *classes[1];       /* variable length */
+} DispatchEntry;
+
+typedef struct DispatchCacheRec {
+    AO_t generation;
+    ScmObj methods;             /* gf->methods when created */
+    int maxReqargs;             /* gf->maxReqargs when created */
+    ScmLFTable *table;          /* DispatchEntry; added with gf->lock */
+} DispatchCache;
+
+typedef struct GenericDispatchRec {
+    ScmWeakBox *gf;             /* ScmGeneric* */
+    AO_t cache;                 /* DispatchCache*; modified with gf->lock */
+    AO_t hits;                  /* statistics */
+    AO_t misses;
+} GenericDispatch;
+
+/* An entry of the global table.  Records are shared by the old and new
+   tables when the global table is rehashed. */
+typedef struct GenericDispatchEntryRec {
+    ScmLFEntry hdr;
+    GenericDispatch *d;
+} GenericDispatchEntry;
+
+#define GENERIC_DISPATCH_INITIAL_BUCKETS  256
+#define GENERIC_DISPATCH_MAX_AVG_CHAIN    2
+
+static struct {
+    AO_t table;                 /* ScmLFTable* of GenericDispatch */
+    ScmInternalMutex mutex;     /* for adding records */
+} genericDispatch = { 0, SCM_INTERNAL_MUTEX_INITIALIZER };
+
+static AO_t dispatchGeneration = 0;
+
+static void bump_dispatch_generation(void)
+{
+    AO_t g;
+    do {
+        g = AO_load(&dispatchGeneration);
+    } while (!AO_compare_and_swap_full(&dispatchGeneration, g, g+1));
+}
+
+static GenericDispatch *generic_dispatch_lookup(ScmLFTable *t,
+                                                ScmGeneric *gf,
+                                                u_long hashval)
+{
+    for (ScmLFEntry *e = Scm__LFTableChain(t, hashval); e; e = e->next) {
+        GenericDispatch *d = ((GenericDispatchEntry*)e)->d;
+        if (e->hashval == hashval && Scm_WeakBoxRef(d->gf) == (void*)gf) {
+            return d;
+        }
+    }
+    return NULL;
+}
+
+static ScmLFEntry *generic_dispatch_copy(const ScmLFEntry *e)
+{
+    GenericDispatch *d = ((const GenericDispatchEntry*)e)->d;
+    if (Scm_WeakBoxEmptyP(d->gf)) return NULL;
+    GenericDispatchEntry *ne = SCM_NEW(GenericDispatchEntry);
+    ne->d = d;
+    return &ne->hdr;
+}
+
+/* Returns the GenericDispatch record of GF.  If GF doesn't have one
+   yet, creates one if CREATE is TRUE, or returns NULL otherwise. */
+static GenericDispatch *generic_dispatch(ScmGeneric *gf, int create)
+{
+    u_long hashval = Scm_EqHash(SCM_OBJ(gf));
+    hashval ^= hashval >> 16;   /* lower bits of address hash are sparse */
+    ScmLFTable *t = (ScmLFTable*)Scm__LFLoad(&genericDispatch.table);
+    GenericDispatch *d = NULL;
+
+    if (t) d = generic_dispatch_lookup(t, gf, hashval);
+    if (d || !create) return d;
+
+    (void)SCM_INTERNAL_MUTEX_LOCK(genericDispatch.mutex);
+    t = (ScmLFTable*)AO_load(&genericDispatch.table);
+    if (t == NULL) {
+        t = Scm__LFTableNew(GENERIC_DISPATCH_INITIAL_BUCKETS);
+        Scm__LFPublish(&genericDispatch.table, t);
+    }
+    d = generic_dispatch_lookup(t, gf, hashval);
+    if (d == NULL) {
+        if (t->numEntries >= t->numBuckets*GENERIC_DISPATCH_MAX_AVG_CHAIN) {
+            /* Drop the records of generics that are gone first; grow
+               the table only if it's still crowded. */
+            t = Scm__LFTableRehash(t, t->numBuckets, generic_dispatch_copy);
+            if (t->numEntries*2
+                >= t->numBuckets*GENERIC_DISPATCH_MAX_AVG_CHAIN) {
+                t = Scm__LFTableRehash(t, t->numBuckets*4,
+                                       generic_dispatch_copy);
+            }
+            Scm__LFPublish(&genericDispatch.table, t);
+        }
+        GenericDispatchEntry *e = SCM_NEW(GenericDispatchEntry);
+        d = SCM_NEW(GenericDispatch);
+        d->gf = Scm_MakeWeakBox(gf);
+        d->cache = 0;
+        d->hits = d->misses = 0;
+        e->d = d;
+        Scm__LFTableAdd(t, &e->hdr, hashval);
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(genericDispatch.mutex);
+    return d;
+}
+
+static void invalidate_dispatch_cache(ScmGeneric *gf)
+{
+    GenericDispatch *d = generic_dispatch(gf, FALSE);
+    if (d) Scm__LFPublish(&d->cache, NULL);
+}
+
+static DispatchCache *make_dispatch_cache(u_long numBuckets,
+                                          AO_t generation)
+{
+    DispatchCache *c = SCM_NEW(DispatchCache);
+    c->generation = generation;
+    c->methods = SCM_NIL;
+    c->maxReqargs = 0;
+    c->table = Scm__LFTableNew(numBuckets);
+    return c;
+}
+
+static u_long dispatch_hash(int argc, ScmClass **typev, int nsel)
+{
+    u_long h = (u_long)argc;
+    for (int i=0; i<nsel; i++) {
+        h = Scm_CombineHashValue(h, Scm_EqHash(SCM_OBJ(typev[i])));
+    }
+    return h;
+}
+
+static DispatchEntry *dispatch_lookup(DispatchCache *c, u_long hashval,
+                                      int argc, ScmClass **typev, int nsel)
+{
+    ScmLFEntry *h = Scm__LFTableChain(c->table, hashval);
+    for (; h; h = h->next) {
+        DispatchEntry *e = (DispatchEntry*)h;
+        if (h->hashval != hashval || e->argc != argc || e->nsel != nsel)
+            continue;
+        int i = 0;
+        for (; i<nsel; i++) {
+            if (e->classes[i] != typev[i]) break;
+        }
+        if (i == nsel) return e;
+    }
+    return NULL;
+}
+
+/* Returns applicable methods of GF for the given arguments, sorted
+   from the most specific one.  Arguments are passed in the same way
+   as Scm_ComputeApplicableMethods. */
+ScmObj Scm_SortedApplicableMethods(ScmGeneric *gf, ScmObj *argv, int argc,
+                                   int applyargs)
+{
+    ScmClass *typev_s[PREALLOC_SIZE], **typev = typev_s;
+    AO_t gen = AO_load_acquire(&dispatchGeneration);
+    GenericDispatch *d = generic_dispatch(gf, TRUE);
+    DispatchCache *cur = (DispatchCache*)Scm__LFLoad(&d->cache);
+    DispatchCache *c = (cur && cur->generation == gen)? cur : NULL;
+    int nargs = 0, nsel = 0, maxReqargs = -1;
+    u_long hashval = 0;
+
+    if (c) {
+        maxReqargs = c->maxReqargs;
+        if (maxReqargs > PREALLOC_SIZE) {
+            typev = SCM_NEW_ATOMIC_ARRAY(ScmClass*, maxReqargs);
+        }
+        nargs = collect_arg_classes(argv, argc, applyargs, typev, maxReqargs);
+        nsel = (nargs < maxReqargs)? nargs : maxReqargs;
+        hashval = dispatch_hash(nargs, typev, nsel);
+        DispatchEntry *e = dispatch_lookup(c, hashval, nargs, typev, nsel);
+        if (e) {
+            AO_fetch_and_add1(&d->hits);
+            return e->methods;
+        }
+    }
+    AO_fetch_and_add1(&d->misses);
+
+    /* If the table is obsolete or crowded, replace it with a new one,
+       taking a snapshot of the methods at the same time.  If the generic
+       is modified after that, the table is discarded and we won't cache
+       a stale result. */
+    if (c == NULL || c->table->numEntries >= c->table->numBuckets*2) {
+        u_long size = DISPATCH_CACHE_INITIAL_BUCKETS;
+        if (c) {
+            size = c->table->numBuckets*4;
+            if (size > DISPATCH_CACHE_MAX_BUCKETS) {
+                size = DISPATCH_CACHE_MAX_BUCKETS;
+            }
+        }
+        DispatchCache *nc = make_dispatch_cache(size, gen);
+        (void)SCM_INTERNAL_MUTEX_LOCK(gf->lock);
+        nc->methods = gf->methods;
+        nc->maxReqargs = gf->maxReqargs;
+        if ((DispatchCache*)AO_load(&d->cache) == cur) {
+            Scm__LFPublish(&d->cache, nc);
+        }
+        (void)SCM_INTERNAL_MUTEX_UNLOCK(gf->lock);
+        c = nc;
+    }
+
+    if (c->maxReqargs != maxReqargs) {
+        maxReqargs = c->maxReqargs;
+        if (maxReqargs > PREALLOC_SIZE) {
+            typev = SCM_NEW_ATOMIC_ARRAY(ScmClass*, maxReqargs);
+        }
+        nargs = collect_arg_classes(argv, argc, applyargs, typev, maxReqargs);
+        nsel = (nargs < maxReqargs)? nargs : maxReqargs;
+        hashval = dispatch_hash(nargs, typev, nsel);
+    }
+
+    ScmObj mm = applicable_methods(c->methods, typev, nargs);
+    if (!SCM_NULLP(mm)) mm = sort_methods(mm, typev, nsel);
+
+    DispatchEntry *e = SCM_NEW2(DispatchEntry*,
+                                sizeof(DispatchEntry)
+                                + sizeof(ScmClass*)*(nsel > 0? nsel-1 : 0));
+    e->argc = nargs;
+    e->nsel = nsel;
+    e->methods = mm;
+    for (int i=0; i<nsel; i++) e->classes[i] = typev[i];
+
+    (void)SCM_INTERNAL_MUTEX_LOCK(gf->lock);
+    if ((DispatchCache*)AO_load(&d->cache) == c
+        && dispatch_lookup(c, hashval, nargs, typev, nsel) == NULL) {
+        Scm__LFTableAdd(c->table, &e->hdr, hashval);
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(gf->lock);
+    return mm;
+}
+
+/* Returns statistics of the dispatch cache, for tuning. */
+ScmObj Scm_GenericDispatchStat(ScmGeneric *gf)
+{
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    GenericDispatch *d = generic_dispatch(gf, FALSE);
+    DispatchCache *c = d? (DispatchCache*)Scm__LFLoad(&d->cache) : NULL;
+    int valid = (c && c->generation == AO_load_acquire(&dispatchGeneration));
+    SCM_APPEND1(h, t, SCM_MAKE_KEYWORD("hits"));
+    SCM_APPEND1(h, t, Scm_MakeIntegerU(d? AO_load(&d->hits) : 0));
+    SCM_APPEND1(h, t, SCM_MAKE_KEYWORD("misses"));
+    SCM_APPEND1(h, t, Scm_MakeIntegerU(d? AO_load(&d->misses) : 0));
+    SCM_APPEND1(h, t, SCM_MAKE_KEYWORD("num-entries"));
+    SCM_APPEND1(h, t, Scm_MakeIntegerU(valid? c->table->numEntries : 0));
+    SCM_APPEND1(h, t, SCM_MAKE_KEYWORD("num-buckets"));
+    SCM_APPEND1(h, t, Scm_MakeIntegerU(valid? c->table->numBuckets : 0));
+    return h;
+}
+
 /*=====================================================================
  * Method
  */
@@ -2426,6 +2746,11 @@ static void method_specializers_set(ScmMethod *m, ScmObj val)
         m->specializers = NULL;
     else
         m->specializers = class_list_to_array(val, len);
+    if (m->generic) {
+        (void)SCM_INTERNAL_MUTEX_LOCK(m->generic->lock);
+        INVALIDATE_DISPATCH_CACHE(m->generic);
+        (void)SCM_INTERNAL_MUTEX_UNLOCK(m->generic->lock);
+    }
 }
 
 /* update-direct-method! method old-class new-class
@@ -2450,6 +2775,7 @@ ScmObj Scm_UpdateDirectMethod(ScmMethod *m, ScmClass *old, ScmClass *newc)
     for (int i=0; i<rec; i++) {
         if (sp[i] == old) sp[i] = newc;
     }
+    bump_dispatch_generation();
     if (SCM_FALSEP(Scm_Memq(SCM_OBJ(m), newc->directMethods))) {
         newc->directMethods = Scm_Cons(SCM_OBJ(m), newc->directMethods);
     }
@@ -2526,6 +2852,7 @@ ScmObj Scm_AddMethod(ScmGeneric *gf, ScmMethod *method)
         gf->methods = pair;
         gf->maxReqargs = reqs;
     }
+    if (method_locked == NULL) INVALIDATE_DISPATCH_CACHE(gf);
     (void)SCM_INTERNAL_MUTEX_UNLOCK(gf->lock);
 
     if (method_locked != NULL) {
@@ -2580,6 +2907,7 @@ ScmObj Scm_DeleteMethod(ScmGeneric *gf, ScmMethod *method)
             gf->maxReqargs = SCM_PROCEDURE_REQUIRED(SCM_CAR(mp));
         }
     }
+    INVALIDATE_DISPATCH_CACHE(gf);
     (void)SCM_INTERNAL_MUTEX_UNLOCK(gf->lock);
     return SCM_UNDEFINED;
 }
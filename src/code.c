@@ -38,6 +38,7 @@
 #include "gauche/vminsn.h"
 #include "gauche/priv/codeP.h"
 #include "gauche/priv/builtin-syms.h"
+#include "atomic_ops.h"
 
 /*===============================================================
  * NVM related stuff
@@ -879,6 +880,95 @@ ScmObj Scm_CompiledCodeToList(ScmCompiledCode *cc)
     return h;
 }
 
+/* Inverse of Scm_CompiledCodeToList.  Creates a new compiled code
+   whose code vector is built from CODELIST, e.g. restored from the
+   load cache.  Debug info isn't recovered.  Compiled codes in the
+   operands that don't have a parent yet become the children of the
+   new code. */
+ScmObj Scm_ListToCompiledCode(ScmObj codelist, int maxstack,
+                              int reqargs, int optargs,
+                              ScmObj name, ScmObj signatureInfo)
+{
+    int size = Scm_Length(codelist);
+    if (size < 0) Scm_Error("proper list required, but got %S", codelist);
+
+    ScmCompiledCode *cc = make_compiled_code();
+    cc->code = SCM_NEW_ATOMIC2(ScmWord *, size * sizeof(ScmWord));
+    cc->codeSize = size;
+    cc->maxstack = maxstack;
+    cc->requiredArgs = reqargs;
+    cc->optionalArgs = optargs;
+    cc->name = name;
+    cc->signatureInfo = signatureInfo;
+
+    ScmObj consts = SCM_NIL, cp = codelist;
+    int numConstants = 0;
+    for (int i=0; i<size; i++, cp = SCM_CDR(cp)) {
+        ScmWord insn = Scm_VMInsnBuild(SCM_CAR(cp));
+        u_int code = SCM_VM_INSN_CODE(insn);
+        int nwords = 0;
+        cc->code[i] = insn;
+
+        switch (Scm_VMInsnOperandType(code)) {
+        case SCM_VM_OPERAND_NONE: break;
+        case SCM_VM_OPERAND_OBJ:;
+        case SCM_VM_OPERAND_CODE:;
+        case SCM_VM_OPERAND_CODES:;
+        case SCM_VM_OPERAND_ADDR: nwords = 1; break;
+        case SCM_VM_OPERAND_OBJ_ADDR: nwords = 2; break;
+        }
+        if (i + nwords >= size) goto badcode;
+
+        for (int k=0; k<nwords; k++) {
+            ScmObj operand;
+            int addrp = (Scm_VMInsnOperandType(code) == SCM_VM_OPERAND_ADDR
+                         || k == 1);
+            cp = SCM_CDR(cp);
+            operand = SCM_CAR(cp);
+            i++;
+            if (addrp) {
+                if (!SCM_INTP(operand)
+                    || SCM_INT_VALUE(operand) < 0
+                    || SCM_INT_VALUE(operand) >= size) goto badcode;
+                cc->code[i] = SCM_WORD(cc->code + SCM_INT_VALUE(operand));
+                continue;
+            }
+            cc->code[i] = SCM_WORD(operand);
+            if (SCM_PTRP(operand)) {
+                consts = Scm_Cons(operand, consts);
+                numConstants++;
+            }
+            /* adopt the nested closure bodies */
+            if (SCM_COMPILED_CODE_P(operand)
+                && SCM_FALSEP(SCM_COMPILED_CODE(operand)->parent)) {
+                SCM_COMPILED_CODE(operand)->parent = SCM_OBJ(cc);
+            } else if (SCM_PAIRP(operand)) {
+                ScmObj lp;
+                SCM_FOR_EACH(lp, operand) {
+                    ScmObj c = SCM_CAR(lp);
+                    if (SCM_COMPILED_CODE_P(c)
+                        && SCM_FALSEP(SCM_COMPILED_CODE(c)->parent)) {
+                        SCM_COMPILED_CODE(c)->parent = SCM_OBJ(cc);
+                    }
+                }
+            }
+        }
+    }
+
+    if (numConstants > 0) {
+        cc->constants = SCM_NEW_ARRAY(ScmObj, numConstants);
+        for (int i=numConstants-1; i>=0; i--, consts=SCM_CDR(consts)) {
+            cc->constants[i] = SCM_CAR(consts);
+        }
+    }
+    cc->constantSize = numConstants;
+    return SCM_OBJ(cc);
+
+  badcode:
+    Scm_Error("malformed code list: %S", codelist);
+    return SCM_UNDEFINED;       /* dummy */
+}
+
 /*===========================================================
  * VM Instruction introspection
  */
@@ -926,10 +1016,34 @@ int Scm_VMInsnOperandType(u_int code)
     return insn_table[code].operandType;
 }
 
+/* Maps insn name symbol -> code.  Built on demand.  If more than one
+   thread build it at the same time, one of them is just wasted. */
+static ScmHashTable *insn_name_table = NULL;
+
+static ScmHashTable *insn_names(void)
+{
+    ScmHashTable *t =
+        (ScmHashTable*)AO_load_acquire((AO_t*)&insn_name_table);
+    if (t == NULL) {
+        t = SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_EQ,
+                                                   SCM_VM_NUM_INSNS));
+        for (int i=0; i<SCM_VM_NUM_INSNS; i++) {
+            Scm_HashTableSet(t, SCM_INTERN(insn_table[i].name),
+                             SCM_MAKE_INT(i), 0);
+        }
+        AO_store_release((AO_t*)&insn_name_table, (AO_t)t);
+    }
+    return t;
+}
+
 int Scm_VMInsnNameToCode(ScmObj name)
 {
-    if (SCM_SYMBOLP(name))  name = SCM_OBJ(SCM_SYMBOL_NAME(name));
-    else if (!SCM_STRINGP(name)) {
+    if (SCM_SYMBOLP(name)) {
+        /* fast path */
+        ScmObj c = Scm_HashTableRef(insn_names(), name, SCM_FALSE);
+        if (SCM_INTP(c)) return SCM_INT_VALUE(c);
+        name = SCM_OBJ(SCM_SYMBOL_NAME(name));
+    } else if (!SCM_STRINGP(name)) {
         Scm_Error("vm-insn-name->code: requires a symbol or a string, but got %S", name);
     }
     const char *n = Scm_GetStringConst(SCM_STRING(name));
@@ -32,6 +32,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #define LIBGAUCHE_BODY
 #include "gauche.h"
 #include "gauche/class.h"
@@ -262,8 +263,8 @@ int Scm_Compare(ScmObj x, ScmObj y)
 /* NB: It turns out that calling back Scheme funtion from sort routine
    is very inefficient and runs much slower than Scheme version, if
    a Scheme comarison function is given.
-   So, as of 0.7.2, the C function is only used when a comparison
-   function is omitted. */
+   So the C function is only used when a comparison function is omitted,
+   or it is a builtin one we can do without calling back (see below). */
 
 /*
  * Basic function for sort family.  An array pointed by elts will be
@@ -278,122 +279,412 @@ int Scm_Compare(ScmObj x, ScmObj y)
  *
  * If cmpfn is #f, the first object's default compare method is used.
  *
- * Some notes:
- *  - We can't use libc's qsort, since it doesn't pass closure to cmpfn.
- *  - The naive Quicksort behaves too badly in the worst case.
- *  - The comparison operation is far more costly than exchange.
+ * The sort is stable.  It is a bottom-up merge sort; first we sort
+ * each short block by binary insertion, then merge the blocks of doubling
+ * width.  Both steps skip the work if the elements are already in order,
+ * so presorted input takes only O(n) comparisons.  Merging goes through
+ * a temporary buffer and the result is copied back at once, so the array
+ * always keeps a permutation of the original elements even if the
+ * comparison raises an error.
  *
- * The current implementation is hybrid of Quicksort and Heapsort.  First
- * the algorithm proceeds by Quicksort, but when it detects the recursion
- * is too deep, it switches to Heapsort.  See Knuth, The Art of Computer
- * Programming Second Edition, Section 5.2.2, p.122.
+ * The comparison is the dominant cost.  If all the elements are fixnums,
+ * flonums (other than NaN) or strings, and the ordering is the default
+ * one or the builtin `<' or `string<?', we use the specialized kernels
+ * that compare inline.  Those kernels never call back Scheme nor raise
+ * an error, so large arrays are sorted by multiple threads.
  */
 
-/* Heap sort */
-static inline void shift_up(ScmObj *elts, int root, int nelts,
-                            int (*cmp)(ScmObj, ScmObj, ScmObj), ScmObj data)
+#define SORT_BLOCK 32               /* size of insertion-sorted blocks */
+
+#ifndef SORT_PARALLEL_THRESHOLD     /* minimum size to sort in parallel */
+#define SORT_PARALLEL_THRESHOLD 100000
+#endif
+#define SORT_MAX_THREADS 8
+
+enum {
+    SORT_GENERIC,               /* Scm_Compare */
+    SORT_PROC,                  /* calls back Scheme */
+    SORT_FIXNUM,
+    SORT_FLONUM,
+    SORT_STRING
+};
+
+static int cmp_scm(ScmObj x, ScmObj y, ScmObj fn)
 {
-    int l = root+1, maxchild;
-    while (l*2 <= nelts) {
-        if (l*2 == nelts) {
-            maxchild = nelts-1;
-        } else if (cmp(elts[l*2-1], elts[l*2], data) < 0) {
-            maxchild = l*2;
-        } else {
-            maxchild = l*2-1;
+    ScmObj r = Scm_ApplyRec(fn, SCM_LIST2(x, y));
+    if (SCM_TRUEP(r) || (SCM_INTP(r) && SCM_INT_VALUE(r) < 0))
+        return -1;
+    else
+        return 1;
+}
+
+/* Each LESS(x, y, data) must be true iff x comes strictly before y. */
+#define LESS_GENERIC(x, y, data) (Scm_Compare(x, y) < 0)
+#define LESS_PROC(x, y, data)    (cmp_scm(x, y, data) < 0)
+#define LESS_FIXNUM(x, y, data)  ((long)SCM_WORD(x) < (long)SCM_WORD(y))
+#define LESS_FLONUM(x, y, data)  (SCM_FLONUM_VALUE(x) < SCM_FLONUM_VALUE(y))
+#define LESS_STRING(x, y, data) \
+    (Scm_StringCmp(SCM_STRING(x), SCM_STRING(y)) < 0)
+
+#define DEFINE_SORTER(name, LESS)                                       \
+/* Sorts elts[lo..hi) by binary insertion.  elts[lo..start) is sorted. */ \
+static void SCM_CPP_CAT(name, _insert)(ScmObj *elts, int lo, int start,  \
+                                        int hi, ScmObj data)            \
+{                                                                       \
+    for (int i = start; i < hi; i++) {                                  \
+        ScmObj x = elts[i];                                             \
+        if (!LESS(x, elts[i-1], data)) continue;                        \
+        int l = lo, r = i-1;                                            \
+        while (l < r) {                                                 \
+            int m = l + (r-l)/2;                                        \
+            if (LESS(x, elts[m], data)) r = m;                          \
+            else l = m+1;                                               \
+        }                                                               \
+        memmove(elts+l+1, elts+l, (i-l)*sizeof(ScmObj));                \
+        elts[l] = x;                                                    \
+    }                                                                   \
+}                                                                       \
+                                                                        \
+/* Merges sorted elts[lo..mid) and elts[mid..hi), using tmp[lo..hi). */ \
+static void SCM_CPP_CAT(name, _merge)(ScmObj *elts, ScmObj *tmp,        \
+                                       int lo, int mid, int hi,         \
+                                       ScmObj data)                     \
+{                                                                       \
+    if (!LESS(elts[mid], elts[mid-1], data)) return;                    \
+    int i = lo, j = mid, k = lo;                                        \
+    while (i < mid && j < hi) {                                         \
+        if (LESS(elts[j], elts[i], data)) tmp[k++] = elts[j++];         \
+        else                              tmp[k++] = elts[i++];         \
+    }                                                                   \
+    while (i < mid) tmp[k++] = elts[i++];                               \
+    /* elts[j..hi) are already in place */                              \
+    memcpy(elts+lo, tmp+lo, (k-lo)*sizeof(ScmObj));                     \
+}                                                                       \
+                                                                        \
+static void SCM_CPP_CAT(name, _sort)(ScmObj *elts, ScmObj *tmp,         \
+                                      int lo, int hi, ScmObj data)      \
+{                                                                       \
+    for (int b = lo; b < hi; b += SORT_BLOCK) {                         \
+        int e = (hi - b > SORT_BLOCK)? b + SORT_BLOCK : hi;             \
+        SCM_CPP_CAT(name, _insert)(elts, b, b+1, e, data);              \
+    }                                                                   \
+    for (int w = SORT_BLOCK; w < hi - lo; w *= 2) {                     \
+        for (int b = lo; b + w < hi; b += 2*w) {                        \
+            int e = (hi - b > 2*w)? b + 2*w : hi;                       \
+            SCM_CPP_CAT(name, _merge)(elts, tmp, b, b+w, e, data);      \
+        }                                                               \
+    }                                                                   \
+}
+
+DEFINE_SORTER(sort_generic, LESS_GENERIC)
+DEFINE_SORTER(sort_proc,    LESS_PROC)
+DEFINE_SORTER(sort_fixnum,  LESS_FIXNUM)
+DEFINE_SORTER(sort_flonum,  LESS_FLONUM)
+DEFINE_SORTER(sort_string,  LESS_STRING)
+
+/* For sorting by keys; the elements are (key . elt). */
+#define LESS_KGENERIC(x, y, data) LESS_GENERIC(SCM_CAR(x), SCM_CAR(y), data)
+#define LESS_KPROC(x, y, data)    LESS_PROC(SCM_CAR(x), SCM_CAR(y), data)
+#define LESS_KFIXNUM(x, y, data)  LESS_FIXNUM(SCM_CAR(x), SCM_CAR(y), data)
+#define LESS_KFLONUM(x, y, data)  LESS_FLONUM(SCM_CAR(x), SCM_CAR(y), data)
+#define LESS_KSTRING(x, y, data)  LESS_STRING(SCM_CAR(x), SCM_CAR(y), data)
+
+DEFINE_SORTER(sort_kgeneric, LESS_KGENERIC)
+DEFINE_SORTER(sort_kproc,    LESS_KPROC)
+DEFINE_SORTER(sort_kfixnum,  LESS_KFIXNUM)
+DEFINE_SORTER(sort_kflonum,  LESS_KFLONUM)
+DEFINE_SORTER(sort_kstring,  LESS_KSTRING)
+
+typedef void (*sorter_t)(ScmObj*, ScmObj*, int, int, ScmObj);
+typedef void (*merger_t)(ScmObj*, ScmObj*, int, int, int, ScmObj);
+
+/* Builtin procedures we know the ordering of. */
+static ScmObj num_lt_proc = SCM_UNDEFINED;
+static ScmObj str_lt_proc = SCM_UNDEFINED;
+
+/* Find out which kernel we can use. */
+static int sort_kind(ScmObj *elts, int nelts, ScmObj cmpfn)
+{
+    int numeric = TRUE, stringy = TRUE;
+    if (SCM_PROCEDUREP(cmpfn)) {
+        SCM_BIND_PROC(num_lt_proc, "<", Scm_GaucheModule());
+        SCM_BIND_PROC(str_lt_proc, "string<?", Scm_GaucheModule());
+        if (SCM_EQ(cmpfn, num_lt_proc))      stringy = FALSE;
+        else if (SCM_EQ(cmpfn, str_lt_proc)) numeric = FALSE;
+        else return SORT_PROC;
+    }
+    int fallback = SCM_FALSEP(cmpfn)? SORT_GENERIC : SORT_PROC;
+
+    ScmObj x0 = elts[0];
+    if (SCM_INTP(x0) && numeric) {
+        for (int i=1; i<nelts; i++) {
+            if (!SCM_INTP(elts[i])) return fallback;
         }
-        if (cmp(elts[l-1], elts[maxchild], data) < 0) {
-            ScmObj tmp = elts[maxchild];
-            elts[maxchild] = elts[l-1];
-            elts[l-1] = tmp;
-            l = maxchild+1;
-        } else {
-            break;
+        return SORT_FIXNUM;
+    }
+    if (SCM_FLONUMP(x0) && numeric) {
+        for (int i=0; i<nelts; i++) {
+            if (!SCM_FLONUMP(elts[i])) return fallback;
+            double v = SCM_FLONUM_VALUE(elts[i]);
+            if (v != v) return fallback; /* NaN */
+        }
+        return SORT_FLONUM;
+    }
+    if (SCM_STRINGP(x0) && stringy) {
+        /* Scm_StringCmp raises an error to compare complete and
+           incomplete strings. */
+        u_long f = SCM_STRING_BODY_FLAGS(SCM_STRING_BODY(x0))
+            & SCM_STRING_INCOMPLETE;
+        for (int i=1; i<nelts; i++) {
+            if (!SCM_STRINGP(elts[i])
+                || ((SCM_STRING_BODY_FLAGS(SCM_STRING_BODY(elts[i]))
+                     & SCM_STRING_INCOMPLETE) != f)) {
+                return fallback;
+            }
         }
+        return SORT_STRING;
     }
+    return fallback;
+}
+
+/*
+ * Parallel sorting.
+ * The array is split into chunks, each of which is sorted by a thread;
+ * then the adjacent pairs of chunks are merged in parallel until one
+ * chunk remains.  The worker threads don't touch Scheme world except
+ * reading the elements.
+ */
+#if defined(GAUCHE_USE_PTHREADS)
+
+typedef struct sort_job_rec {
+    sorter_t sorter;
+    merger_t merger;
+    ScmObj *elts;
+    ScmObj *tmp;
+    int lo, mid, hi;            /* mid < 0 for sorting */
+} sort_job;
+
+static void *sort_worker(void *arg)
+{
+    sort_job *j = (sort_job*)arg;
+    if (j->mid < 0) j->sorter(j->elts, j->tmp, j->lo, j->hi, SCM_FALSE);
+    else j->merger(j->elts, j->tmp, j->lo, j->mid, j->hi, SCM_FALSE);
+    return NULL;
 }
 
-static void sort_h(ScmObj *elts, int nelts,
-                   int (*cmp)(ScmObj, ScmObj, ScmObj), ScmObj data)
+/* Runs jobs[0..njobs) in parallel.  If we can't create a thread,
+   the job is run by the calling thread. */
+static void sort_run_jobs(sort_job *jobs, int njobs)
 {
-    for (int l=nelts/2-1; l>=0; l--) {
-        shift_up(elts, l, nelts, cmp, data);
+    pthread_t tids[SORT_MAX_THREADS];
+    int started[SORT_MAX_THREADS];
+    sigset_t set, omask;
+
+    /* Worker threads shouldn't receive signals, except the ones GC uses
+       to stop and restart the world; the workers are registered to GC
+       (pthread_create is redirected to GC_pthread_create), so GC waits
+       for them to respond while another thread collects. */
+    Scm_SigFillSetMostly(&set);
+    pthread_sigmask(SIG_SETMASK, &set, &omask);
+    for (int i=1; i<njobs; i++) {
+        started[i] = (pthread_create(&tids[i], NULL, sort_worker, &jobs[i])
+                      == 0);
     }
-    for (int r=nelts-1; r>=1; r--) {
-        ScmObj tmp = elts[r];
-        elts[r] = elts[0];
-        elts[0] = tmp;
-        shift_up(elts, 0, r, cmp, data);
+    pthread_sigmask(SIG_SETMASK, &omask, NULL);
+
+    sort_worker(&jobs[0]);
+    for (int i=1; i<njobs; i++) {
+        if (started[i]) pthread_join(tids[i], NULL);
+        else sort_worker(&jobs[i]);
     }
 }
 
-/* Quick sort */
-static void sort_q(ScmObj *elts, int lo, int hi, int depth, int limit,
-                   int (*cmp)(ScmObj, ScmObj, ScmObj), ScmObj data)
+static void sort_parallel(ScmObj *elts, ScmObj *tmp, int nelts,
+                          sorter_t sorter, merger_t merger, int nchunks)
 {
-    while (lo < hi) {
-        if (depth >= limit) {
-            sort_h(elts+lo, (hi-lo+1), cmp, data);
-            break;
-        } else {
-            int l = lo, r = hi;
-            ScmObj pivot = elts[lo];
-            while (l <= r) {
-                while (l <= r && cmp(elts[l], pivot, data) < 0) l++;
-                while (l <= r && cmp(pivot, elts[r], data) < 0) r--;
-                if (l > r) break;
-                ScmObj tmp = elts[l]; elts[l] = elts[r]; elts[r] = tmp;
-                l++;
-                r--;
-            }
-            if (lo < r) sort_q(elts, lo, r, depth+1, limit, cmp, data);
-            /* tail call to
-               sort_q(elts, l, hi, depth+1, limit, cmp, data); */
-            lo = l;
-            depth++;
+    int bounds[SORT_MAX_THREADS+1];
+    sort_job jobs[SORT_MAX_THREADS];
+
+    for (int i=0; i<=nchunks; i++) {
+        bounds[i] = (int)(((long long)nelts * i) / nchunks);
+    }
+    for (int i=0; i<nchunks; i++) {
+        jobs[i].sorter = sorter;
+        jobs[i].elts = elts;
+        jobs[i].tmp = tmp;
+        jobs[i].lo = bounds[i];
+        jobs[i].mid = -1;
+        jobs[i].hi = bounds[i+1];
+    }
+    sort_run_jobs(jobs, nchunks);
+
+    for (int w=1; w<nchunks; w*=2) {
+        int njobs = 0;
+        for (int i=0; i+w<nchunks; i+=2*w) {
+            int e = (i+2*w < nchunks)? i+2*w : nchunks;
+            jobs[njobs].merger = merger;
+            jobs[njobs].elts = elts;
+            jobs[njobs].tmp = tmp;
+            jobs[njobs].lo = bounds[i];
+            jobs[njobs].mid = bounds[i+w];
+            jobs[njobs].hi = bounds[e];
+            njobs++;
         }
+        sort_run_jobs(jobs, njobs);
     }
 }
 
-static int cmp_scm(ScmObj x, ScmObj y, ScmObj fn)
+#endif /*GAUCHE_USE_PTHREADS*/
+
+/* Sorts with one of the specialized kernels, in parallel if the array
+   is large enough. */
+static void sort_inline(ScmObj *elts, ScmObj *tmp, int nelts,
+                        sorter_t sorter, merger_t merger)
 {
-    ScmObj r = Scm_ApplyRec(fn, SCM_LIST2(x, y));
-    if (SCM_TRUEP(r) || (SCM_INTP(r) && SCM_INT_VALUE(r) < 0))
-        return -1;
-    else
-        return 1;
+#if defined(GAUCHE_USE_PTHREADS)
+    if (nelts >= SORT_PARALLEL_THRESHOLD) {
+        int nproc = Scm_AvailableProcessors();
+        int nchunks = 1;
+        while (nchunks*2 <= nproc && nchunks*2 <= SORT_MAX_THREADS
+               && nelts/(nchunks*2) >= SORT_PARALLEL_THRESHOLD/2) {
+            nchunks *= 2;
+        }
+        if (nchunks > 1) {
+            sort_parallel(elts, tmp, nelts, sorter, merger, nchunks);
+            return;
+        }
+    }
+#endif /*GAUCHE_USE_PTHREADS*/
+    sorter(elts, tmp, 0, nelts, SCM_FALSE);
 }
 
-static int cmp_int(ScmObj x, ScmObj y, ScmObj dummy)
+#define STATIC_SIZE 32
+
+void Scm_SortArray(ScmObj *elts, int nelts, ScmObj cmpfn)
 {
-    return Scm_Compare(x, y);
+    ScmObj sttmp[STATIC_SIZE];
+
+    if (nelts <= 1) return;
+    ScmObj *tmp = (nelts <= STATIC_SIZE)? sttmp : SCM_NEW_ARRAY(ScmObj, nelts);
+
+    switch (sort_kind(elts, nelts, cmpfn)) {
+    case SORT_GENERIC:
+        sort_generic_sort(elts, tmp, 0, nelts, SCM_FALSE); break;
+    case SORT_PROC:
+        sort_proc_sort(elts, tmp, 0, nelts, cmpfn); break;
+    case SORT_FIXNUM:
+        sort_inline(elts, tmp, nelts, sort_fixnum_sort, sort_fixnum_merge);
+        break;
+    case SORT_FLONUM:
+        sort_inline(elts, tmp, nelts, sort_flonum_sort, sort_flonum_merge);
+        break;
+    default:
+        sort_inline(elts, tmp, nelts, sort_string_sort, sort_string_merge);
+        break;
+    }
 }
 
-void Scm_SortArray(ScmObj *elts, int nelts, ScmObj cmpfn)
+/*
+ * Sorting by keys (decorate-sort-undecorate).
+ * Scm_SortArrayByKey sorts elts by the results of applying the procedure
+ * KEY on each element, which is called exactly once per element.  CMPFN
+ * is applied on the keys, as in Scm_SortArray.
+ *
+ * If all the keys are fixnums or flonums under the numeric ordering,
+ * we use LSD radix sort on the keys mapped to unsigned 64-bit integers
+ * that preserves the order, carrying the elements along.  Otherwise we
+ * sort (key . elt) pairs with the merge sort.
+ */
+
+#define SORT_RADIX_THRESHOLD 64
+
+static inline uint64_t radix_key(ScmObj k, int flonump)
+{
+    static const uint64_t signbit = (uint64_t)1 << 63;
+    if (!flonump) return (uint64_t)(int64_t)SCM_INT_VALUE(k) ^ signbit;
+
+    union { double d; uint64_t u; } v;
+    v.d = SCM_FLONUM_VALUE(k);
+    if (v.d == 0.0) v.d = 0.0;  /* -0.0 and 0.0 are the same key */
+    return (v.u & signbit)? ~v.u : (v.u ^ signbit);
+}
+
+/* Stable; 8 bits per pass, skipping the passes where all the keys have
+   the same digit. */
+static void radix_sort(ScmObj *elts, ScmObj *keys, int nelts, int flonump)
+{
+    int count[8][256];
+    uint64_t *ks = SCM_NEW_ATOMIC_ARRAY(uint64_t, nelts);
+    uint64_t *kd = SCM_NEW_ATOMIC_ARRAY(uint64_t, nelts);
+    ScmObj *es = elts, *ed = SCM_NEW_ARRAY(ScmObj, nelts);
+
+    memset(count, 0, sizeof(count));
+    for (int i=0; i<nelts; i++) {
+        uint64_t k = radix_key(keys[i], flonump);
+        ks[i] = k;
+        for (int b=0; b<8; b++) count[b][(k >> (b*8)) & 0xff]++;
+    }
+
+    for (int b=0; b<8; b++) {
+        int *c = count[b], shift = b*8;
+        if (c[(ks[0] >> shift) & 0xff] == nelts) continue;
+        for (int d=0, sum=0; d<256; d++) {
+            int n = c[d]; c[d] = sum; sum += n;
+        }
+        for (int i=0; i<nelts; i++) {
+            int pos = c[(ks[i] >> shift) & 0xff]++;
+            kd[pos] = ks[i];
+            ed[pos] = es[i];
+        }
+        uint64_t *kt = ks; ks = kd; kd = kt;
+        ScmObj *et = es; es = ed; ed = et;
+    }
+    if (es != elts) memcpy(elts, es, nelts*sizeof(ScmObj));
+}
+
+void Scm_SortArrayByKey(ScmObj *elts, int nelts, ScmObj cmpfn, ScmObj key)
 {
-    int limit, i;
     if (nelts <= 1) return;
-    /* approximate 2*log2(nelts) */
-    for (i=nelts,limit=1; i > 0; limit++) {i>>=1;}
-    if (SCM_PROCEDUREP(cmpfn)) {
-        sort_q(elts, 0, nelts-1, 0, limit, cmp_scm, cmpfn);
-    } else {
-        sort_q(elts, 0, nelts-1, 0, limit, cmp_int, NULL);
+    ScmObj *keys = SCM_NEW_ARRAY(ScmObj, nelts);
+    for (int i=0; i<nelts; i++) keys[i] = Scm_ApplyRec1(key, elts[i]);
+
+    int kind = sort_kind(keys, nelts, cmpfn);
+    if ((kind == SORT_FIXNUM || kind == SORT_FLONUM)
+        && nelts >= SORT_RADIX_THRESHOLD) {
+        radix_sort(elts, keys, nelts, kind == SORT_FLONUM);
+        return;
+    }
+
+    for (int i=0; i<nelts; i++) keys[i] = Scm_Cons(keys[i], elts[i]);
+    ScmObj *tmp = SCM_NEW_ARRAY(ScmObj, nelts);
+    switch (kind) {
+    case SORT_GENERIC:
+        sort_kgeneric_sort(keys, tmp, 0, nelts, SCM_FALSE); break;
+    case SORT_PROC:
+        sort_kproc_sort(keys, tmp, 0, nelts, cmpfn); break;
+    case SORT_FIXNUM:
+        sort_kfixnum_sort(keys, tmp, 0, nelts, SCM_FALSE); break;
+    case SORT_FLONUM:
+        sort_kflonum_sort(keys, tmp, 0, nelts, SCM_FALSE); break;
+    default:
+        sort_inline(keys, tmp, nelts, sort_kstring_sort, sort_kstring_merge);
+        break;
     }
+    for (int i=0; i<nelts; i++) elts[i] = SCM_CDR(keys[i]);
 }
 
 /*
  * higher-level fns
  */
 
-#define STATIC_SIZE 32
-
-static ScmObj sort_list_int(ScmObj objs, ScmObj fn, int destructive)
+static ScmObj sort_list_int(ScmObj objs, ScmObj fn, ScmObj key,
+                            int destructive)
 {
     ScmObj starray[STATIC_SIZE];
     int len = STATIC_SIZE;
     ScmObj *array = Scm_ListToArray(objs, &len, starray, TRUE);
-    Scm_SortArray(array, len, fn);
+    if (SCM_FALSEP(key)) Scm_SortArray(array, len, fn);
+    else Scm_SortArrayByKey(array, len, fn, key);
     if (destructive) {
         ScmObj cp = objs;
         for (int i=0; i<len; i++, cp = SCM_CDR(cp)) {
@@ -407,12 +698,22 @@ static ScmObj sort_list_int(ScmObj objs, ScmObj fn, int destructive)
 
 ScmObj Scm_SortList(ScmObj objs, ScmObj fn)
 {
-    return sort_list_int(objs, fn, FALSE);
+    return sort_list_int(objs, fn, SCM_FALSE, FALSE);
 }
 
 ScmObj Scm_SortListX(ScmObj objs, ScmObj fn)
 {
-    return sort_list_int(objs, fn, TRUE);
+    return sort_list_int(objs, fn, SCM_FALSE, TRUE);
+}
+
+ScmObj Scm_SortListByKey(ScmObj objs, ScmObj fn, ScmObj key)
+{
+    return sort_list_int(objs, fn, key, FALSE);
+}
+
+ScmObj Scm_SortListByKeyX(ScmObj objs, ScmObj fn, ScmObj key)
+{
+    return sort_list_int(objs, fn, key, TRUE);
 }
 
 /*
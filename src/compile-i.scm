@@ -313,3 +313,84 @@
                     )))))]
       [_ (undefined)])))
 
+
+;;--------------------------------------------------------
+;; Inlining higher-order list procedures
+;;
+
+;; A closure passed to for-each or map makes get_env move the enclosing
+;; env frames to the heap, even though the closure never outlives the call.
+;; If the procedure argument is a literal lambda and there's only one list,
+;; we expand the call into a loop that calls the lambda through a fresh
+;; lvar.  The lvar is referenced only at the call site, so it can't escape,
+;; and Pass 2 inlines the lambda body into the loop.  No closure is created,
+;; and the frames stay on the stack.
+(define (gen-list-loop-inliner body-gen)
+  (^[src args]
+    (match args
+      [(proc lis)
+       (if (and (has-tag? proc $LAMBDA)
+                (= ($lambda-reqargs proc) 1)
+                (= ($lambda-optarg proc) 0))
+         (let ([p (make-lvar 'proc)]
+               [l (make-lvar 'lis)]
+               [loop (make-lvar 'loop)])
+           (lvar-initval-set! p proc)
+           (lvar-initval-set! l lis)
+           ($let src 'let (list p l) (list proc lis)
+                 (body-gen src p l loop)))
+         (undefined))]
+      [_ (undefined)])))
+
+(define (gen-improper-list-error src l)
+  ($call src ($gref (global-id 'error))
+         (list ($const "improper list not allowed:") ($lref l))))
+
+;; (let loop ([xs lis])
+;;   (cond [(pair? xs) (proc (car xs)) (loop (cdr xs))]
+;;         [(null? xs) (undefined)]
+;;         [else (error "improper list not allowed:" lis)]))
+(define-builtin-inliner for-each
+  (gen-list-loop-inliner
+   (^[src p l loop]
+     (let* ([xs (make-lvar 'xs)]
+            [lmda ($lambda src 'for-each 1 0 (list xs)
+                           ($if src ($asm #f `(,PAIRP) (list ($lref xs)))
+                                ($seq
+                                 (list ($call src ($lref p)
+                                              (list ($asm #f `(,CAR)
+                                                          (list ($lref xs)))))
+                                       ($call #f ($lref loop)
+                                              (list ($asm #f `(,CDR)
+                                                          (list ($lref xs)))))))
+                                ($if #f ($asm #f `(,NULLP) (list ($lref xs)))
+                                     ($const-undef)
+                                     (gen-improper-list-error src l))))])
+       (lvar-initval-set! loop lmda)
+       ($let src 'rec (list loop) (list lmda)
+             ($call #f ($lref loop) (list ($lref l))))))))
+
+;; (let loop ([xs lis] [r '()])
+;;   (cond [(pair? xs) (loop (cdr xs) (cons (proc (car xs)) r))]
+;;         [(null? xs) (reverse r)]
+;;         [else (error "improper list not allowed:" lis)]))
+(define-builtin-inliner map
+  (gen-list-loop-inliner
+   (^[src p l loop]
+     (let* ([xs (make-lvar 'xs)]
+            [r  (make-lvar 'r)]
+            [lmda ($lambda src 'map 2 0 (list xs r)
+                           ($if src ($asm #f `(,PAIRP) (list ($lref xs)))
+                                ($call #f ($lref loop)
+                                       (list ($asm #f `(,CDR) (list ($lref xs)))
+                                             ($asm #f `(,CONS)
+                                                   (list ($call src ($lref p)
+                                                                (list ($asm #f `(,CAR)
+                                                                            (list ($lref xs)))))
+                                                         ($lref r)))))
+                                ($if #f ($asm #f `(,NULLP) (list ($lref xs)))
+                                     ($asm #f `(,REVERSE) (list ($lref r)))
+                                     (gen-improper-list-error src l))))])
+       (lvar-initval-set! loop lmda)
+       ($let src 'rec (list loop) (list lmda)
+             ($call #f ($lref loop) (list ($lref l) ($const-nil))))))))
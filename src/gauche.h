@@ -1783,6 +1783,9 @@ SCM_CLASS_DECL(Scm_RegexpClass);
 /* flags */
 #define SCM_REGEXP_CASE_FOLD      (1L<<0)
 #define SCM_REGEXP_PARSE_ONLY     (1L<<1)
+#define SCM_REGEXP_BACKTRACK      (1L<<4) /* always use backtracking matcher */
+#define SCM_REGEXP_DFA            (1L<<5) /* always use DFA matcher */
+#define SCM_REGEXP_ENGINE_MASK    (SCM_REGEXP_BACKTRACK|SCM_REGEXP_DFA)
 
 SCM_EXTERN ScmObj Scm_RegComp(ScmString *pattern, int flags);
 SCM_EXTERN ScmObj Scm_RegCompFromAST(ScmObj ast);
@@ -1866,6 +1869,7 @@ SCM_EXTERN void   Scm_SetSigmask(sigset_t *mask);
  */
 
 SCM_EXTERN void   Scm_ProfilerStart(void);
+SCM_EXTERN void   Scm_ProfilerStartAllThreads(void);
 SCM_EXTERN int    Scm_ProfilerStop(void);
 SCM_EXTERN void   Scm_ProfilerReset(void);
 
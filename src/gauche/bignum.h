@@ -88,6 +88,10 @@ SCM_EXTERN ScmBignum *Scm_BignumAccMultAddUI(ScmBignum *acc,
                                              u_long coef, u_long c);
 
 SCM_EXTERN int Scm_DumpBignum(const ScmBignum *b, ScmPort *out);
+SCM_EXTERN ScmObj Scm__DigitsToInteger(const char *s, int len, int radix);
+
+/* for tuning; see test/bignum-performance.scm */
+SCM_EXTERN void Scm__BignumMulThresholds(int *karatsuba, int *toom3);
 
 #endif /* GAUCHE_BIGNUM_H */
 
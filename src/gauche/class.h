@@ -144,6 +144,11 @@ SCM_EXTERN ScmObj Scm_ComputeApplicableMethods(ScmGeneric *gf,
                                                int argc,
                                                int applyargs);
 SCM_EXTERN ScmObj Scm_SortMethods(ScmObj methods, ScmObj *argv, int argc);
+SCM_EXTERN ScmObj Scm_SortedApplicableMethods(ScmGeneric *gf,
+                                              ScmObj *argv,
+                                              int argc,
+                                              int applyargs);
+SCM_EXTERN ScmObj Scm_GenericDispatchStat(ScmGeneric *gf);
 SCM_EXTERN ScmObj Scm_MakeNextMethod(ScmGeneric *gf, ScmObj methods,
                                      ScmObj *argv, int argc,
                                      int copyargs, int applyargs);
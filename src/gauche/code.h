@@ -129,6 +129,9 @@ SCM_EXTERN void   Scm_CompiledCodeCopyX(ScmCompiledCode *dest,
                                         const ScmCompiledCode *src);
 SCM_EXTERN void   Scm_CompiledCodeDump(ScmCompiledCode *cc);
 SCM_EXTERN ScmObj Scm_CompiledCodeToList(ScmCompiledCode *cc);
+SCM_EXTERN ScmObj Scm_ListToCompiledCode(ScmObj codelist, int maxstack,
+                                        int reqargs, int optargs,
+                                        ScmObj name, ScmObj signatureInfo);
 SCM_EXTERN ScmObj Scm_CompiledCodeFullName(ScmCompiledCode *cc);
 SCM_EXTERN void   Scm_VMExecuteToplevels(ScmCompiledCode *cv[]);
 
@@ -104,6 +104,10 @@ SCM_EXTERN int    Scm_Compare(ScmObj x, ScmObj y);
 SCM_EXTERN void   Scm_SortArray(ScmObj *elts, int nelts, ScmObj cmpfn);
 SCM_EXTERN ScmObj Scm_SortList(ScmObj objs, ScmObj fn);
 SCM_EXTERN ScmObj Scm_SortListX(ScmObj objs, ScmObj fn);
+SCM_EXTERN void   Scm_SortArrayByKey(ScmObj *elts, int nelts, ScmObj cmpfn,
+                                  ScmObj key);
+SCM_EXTERN ScmObj Scm_SortListByKey(ScmObj objs, ScmObj fn, ScmObj key);
+SCM_EXTERN ScmObj Scm_SortListByKeyX(ScmObj objs, ScmObj fn, ScmObj key);
 
 
 SCM_DECL_END
@@ -63,6 +63,8 @@ typedef u_long ScmHashProc(const ScmHashCore *hc, intptr_t key);
 typedef int    ScmHashCompareProc(const ScmHashCore *hc, intptr_t key,
                                   intptr_t entrykey);
 
+/* The layout of the array pointed by BUCKETS is an implementation
+   detail; use the API below. */
 struct ScmHashCoreRec {
     void **buckets;
     int numBuckets;
@@ -91,10 +93,19 @@ SCM_EXTERN int  Scm_HashCoreTypeToProcs(ScmHashType type,
 
 SCM_EXTERN void Scm_HashCoreCopy(ScmHashCore *dst, const ScmHashCore *src);
 
+/* NB: The returned entry of eq?, eqv? and string=? tables is valid only
+   until the next modification of the table.  Don't keep it across
+   operations that may insert to or delete from the same table. */
 SCM_EXTERN ScmDictEntry *Scm_HashCoreSearch(ScmHashCore *core,
                                             intptr_t key,
                                             ScmDictOp op);
 
+/* Deletes KEY, and copies the key and value of the deleted entry to
+   RESULT.  Returns RESULT if found, NULL otherwise. */
+SCM_EXTERN ScmDictEntry *Scm_HashCoreDelete(ScmHashCore *core,
+                                            intptr_t key,
+                                            ScmDictEntry *result);
+
 SCM_EXTERN int  Scm_HashCoreNumEntries(ScmHashCore *core);
 
 SCM_EXTERN void Scm_HashCoreClear(ScmHashCore *core);
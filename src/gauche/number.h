@@ -353,6 +353,7 @@ typedef struct ScmNumberFormatRec {
 SCM_EXTERN void   Scm_NumberFormatInit(ScmNumberFormat*);
 SCM_EXTERN size_t Scm_PrintNumber(ScmPort *port, ScmObj n, ScmNumberFormat *f);
 SCM_EXTERN size_t Scm_PrintDouble(ScmPort *port, double d, ScmNumberFormat *f);
+SCM_EXTERN int    Scm__FastFlonumConversion(int flag); /* for testing */
 
 /* Higher-level convenience routines */
 SCM_EXTERN ScmObj Scm_NumberToString(ScmObj num, int radix, u_long flags);
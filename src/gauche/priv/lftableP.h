@@ -0,0 +1,147 @@
+/*
+ * gauche/priv/lftableP.h - Hash table with lock-free lookup
+ *
+ *   Copyright (c) 2016  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GAUCHE_PRIV_LFTABLEP_H
+#define GAUCHE_PRIV_LFTABLEP_H
+
+#include "atomic_ops.h"
+
+/*
+ * Publication of immutable data
+ *
+ *   A writer fills a freshly allocated object and then stores the
+ *   pointer to it with Scm__LFPublish.  A reader that loads the pointer
+ *   with Scm__LFLoad sees the object fully initialized.  Readers don't
+ *   need a lock, as far as the object isn't modified after publication.
+ *   Writers to the same location must be serialized by the caller.
+ */
+static inline void *Scm__LFLoad(volatile AO_t *loc)
+{
+    return (void*)AO_load_acquire(loc);
+}
+
+static inline void Scm__LFPublish(volatile AO_t *loc, const void *ptr)
+{
+    AO_store_release(loc, (AO_t)ptr);
+}
+
+/*
+ * Lock-free lookup table
+ *
+ *   A bucket array of singly linked chains.  The user's entry structure
+ *   begins with ScmLFEntry; the rest of it is up to the user, and so is
+ *   comparing keys.  Once an entry is added, it must not be modified.
+ *   Scm__LFTableAdd prepends the entry to the chain with
+ *   Scm__LFPublish, so a reader that sees a bucket head sees a
+ *   consistent chain.
+ *
+ *   Scm__LFTableAdd and Scm__LFTableRehash must be serialized by the
+ *   caller, typically with a mutex.  Lookup can run concurrently with
+ *   them.
+ *
+ *   The table doesn't grow by itself.  Scm__LFTableRehash returns a new
+ *   table with copies of the entries (we can't relink the entries, for
+ *   readers may be walking them), which the caller publishes in place of
+ *   the old one.  Readers still walking the old table see a stale but
+ *   valid snapshot, so the caller should retry a missed lookup with the
+ *   lock held before adding an entry.
+ *
+ *   Lookup:
+ *
+ *     for (e = Scm__LFTableChain(t, h); e; e = e->next) {
+ *         if (e->hashval == h && <key of e matches>) return e;
+ *     }
+ */
+
+typedef struct ScmLFEntryRec {
+    struct ScmLFEntryRec *next; /* immutable once published */
+    u_long hashval;
+} ScmLFEntry;
+
+typedef struct ScmLFTableRec {
+    u_long numBuckets;          /* always power of 2 */
+    u_long numEntries;          /* modified only by the writer */
+    AO_t buckets[1];            /* ScmLFEntry*, variable length */
+} ScmLFTable;
+
+static inline ScmLFTable *Scm__LFTableNew(u_long numBuckets)
+{
+    ScmLFTable *t = SCM_NEW2(ScmLFTable*,
+                             sizeof(ScmLFTable)+sizeof(AO_t)*(numBuckets-1));
+    t->numBuckets = numBuckets;
+    t->numEntries = 0;
+    for (u_long i=0; i<numBuckets; i++) t->buckets[i] = 0;
+    return t;
+}
+
+/* Returns the head of the chain HASHVAL belongs to. */
+static inline ScmLFEntry *Scm__LFTableChain(ScmLFTable *t, u_long hashval)
+{
+    return (ScmLFEntry*)Scm__LFLoad(&t->buckets[hashval&(t->numBuckets-1)]);
+}
+
+static inline void Scm__LFTableAdd(ScmLFTable *t, ScmLFEntry *e,
+                                   u_long hashval)
+{
+    volatile AO_t *bucket = &t->buckets[hashval&(t->numBuckets-1)];
+    e->hashval = hashval;
+    e->next = (ScmLFEntry*)AO_load(bucket);
+    Scm__LFPublish(bucket, e);
+    t->numEntries++;
+}
+
+/* COPY returns a fresh copy of the given entry; its header is
+   overwritten.  If COPY returns NULL, the entry is dropped. */
+typedef ScmLFEntry *ScmLFEntryCopyProc(const ScmLFEntry *e);
+
+static inline ScmLFTable *Scm__LFTableRehash(ScmLFTable *t,
+                                             u_long numBuckets,
+                                             ScmLFEntryCopyProc *copy)
+{
+    ScmLFTable *n = Scm__LFTableNew(numBuckets);
+    for (u_long i=0; i<t->numBuckets; i++) {
+        for (ScmLFEntry *e = (ScmLFEntry*)t->buckets[i]; e; e = e->next) {
+            /* N isn't visible yet, so plain stores suffice. */
+            AO_t *bucket = &n->buckets[e->hashval&(numBuckets-1)];
+            ScmLFEntry *ne = copy(e);
+            if (ne == NULL) continue;
+            ne->hashval = e->hashval;
+            ne->next = (ScmLFEntry*)*bucket;
+            *bucket = (AO_t)ne;
+            n->numEntries++;
+        }
+    }
+    return n;
+}
+
+#endif /*GAUCHE_PRIV_LFTABLEP_H*/
@@ -41,6 +41,8 @@
  */
 
 SCM_EXTERN void Scm__InstallCodingAwarePortHook(ScmPort *(*)(ScmPort*, const char*));
+SCM_EXTERN ScmSmallInt Scm__CopyFilePort(ScmPort *src, ScmPort *dst,
+                                         ScmSmallInt size);
 
 /* Windows-specific initialization */
 #if defined(GAUCHE_WINDOWS)
@@ -59,6 +61,55 @@ void Scm__SetupPortsForWindows(int has_console);
 #define PORT_LOCK_OWNER_P(port, vm) \
     ((port)->lockOwner == (vm))
 
+/*================================================================
+ * Direct access to the input buffer
+ *
+ *  The reader scans tokens directly in the port's buffer when it can,
+ *  instead of fetching characters one by one.  The port must be locked
+ *  by the caller.
+ *
+ *  PORT_INPUT_SPAN returns the beginning of the input bytes readily
+ *  available without further I/O, and sets END to their end.  EOFP is
+ *  set to TRUE if END is the end of the whole input (input string port).
+ *  Returns NULL if the port has a peeked character or it isn't buffered;
+ *  the caller should use Getc then.
+ *
+ *  PORT_INPUT_SKIP consumes the input up to TO, which must be within
+ *  the span.  NLINES is the number of newlines in the consumed bytes.
+ */
+
+static inline const char *PORT_INPUT_SPAN(ScmPort *p, const char **end,
+                                          int *eofp)
+{
+    if (p->scrcnt > 0 || p->ungotten != SCM_CHAR_INVALID || p->closed) {
+        return NULL;
+    }
+    switch (SCM_PORT_TYPE(p)) {
+    case SCM_PORT_FILE:
+        *end = p->src.buf.end;
+        *eofp = FALSE;
+        return p->src.buf.current;
+    case SCM_PORT_ISTR:
+        *end = p->src.istr.end;
+        *eofp = TRUE;
+        return p->src.istr.current;
+    default:
+        return NULL;
+    }
+}
+
+static inline void PORT_INPUT_SKIP(ScmPort *p, const char *to, int nlines)
+{
+    if (SCM_PORT_TYPE(p) == SCM_PORT_FILE) {
+        p->bytes += to - p->src.buf.current;
+        p->src.buf.current = (char*)to;
+    } else {
+        p->bytes += to - p->src.istr.current;
+        p->src.istr.current = to;
+    }
+    p->line += nlines;
+}
+
 /*================================================================
  * Locking the ports
  *
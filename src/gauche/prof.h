@@ -50,8 +50,14 @@
  * execution on the thread.   Each entry just records the address of
  * the called object.
  *
- * TODO: It is not known if sampling profiler works when more than one
- * thread requests profiling.  Should be considrered later.
+ * The profiler normally works only on the thread that started it.
+ * Scm_ProfilerStartAllThreads starts profiling on every VM attached to
+ * a thread (including the ones attached later), and Scm_ProfilerStop,
+ * Scm_ProfilerReset and Scm_ProfilerRawResult act on all of them until
+ * the profiler is reset.  Each VM still keeps its own buffer; the
+ * results are merged by Scm_ProfilerRawResult, while
+ * Scm_ProfilerRawThreadResults gives the result of each VM.
+ * See prof.c for the details of sampling in this mode.
  *
  * When the on-memory buffer of the call counter gets full, it is collected
  * to a hash table.  When the statistic sampling buffer gets full, it
@@ -59,6 +65,16 @@
  * flushing may be done within a signal handler and we can't call allocator
  * in it).
  *
+ * The call stack of each sample is also recorded.  The sampler can't
+ * walk the continuation frames, since the VM may be in the middle of
+ * pushing or popping a frame when it is interrupted.  So it only counts
+ * the samples whose stack is pending, and asks the VM to walk the frames
+ * at the next safe point.  The VM folds the stack into a tree (stackTree)
+ * there.  The stacks can't be saved to the file, for the frames may not
+ * be recorded by the call counter and thus may be GCed.  If the profiler
+ * is stopped before the VM reaches a safe point, the pending stacks are
+ * dropped.
+ *
  * Profiler status:
  *
  *        Scm_ProfilerStart    Scm_ProfilerStop
@@ -90,6 +106,16 @@ typedef struct ScmProfSampleRec {
 /* # of on-memory samples for the statistic sampler. */
 #define SCM_PROF_SAMPLES_IN_BUFFER  6000
 
+/* Max # of frames recorded for a call stack. */
+#define SCM_PROF_STACK_DEPTH  64
+
+/* A call stack of a sample, innermost frame first.  If the stack is
+   deeper than SCM_PROF_STACK_DEPTH, the last frame is #t. */
+typedef struct ScmProfStackRec {
+    int depth;
+    ScmObj frames[SCM_PROF_STACK_DEPTH];
+} ScmProfStack;
+
 /* A record of call counter */
 typedef struct ScmProfCountRec {
     ScmObj func;                /* Called Function */
@@ -112,6 +138,24 @@ struct ScmVMProfilerRec {
     ScmHashTable* statHash;     /* hashtable for collected data.
                                    value is a pair of integers,
                                    (<call-count> . <sample-hits>) */
+    ScmInternalMutex lock;      /* protects statHash while flushing, and
+                                   counts in all-threads mode */
+    int allThreads;             /* TRUE if this VM is profiled by
+                                   Scm_ProfilerStartAllThreads */
+    int timerRequest;           /* TRUE if another thread asks this VM
+                                   to start its own sampling timer */
+    volatile intptr_t inSample; /* TRUE while the sampler is running */
+    void *threadTimer;          /* private; see prof.c */
+    int pendingStacks;          /* # of samples whose stack is to be
+                                   recorded at the next safe point */
+    ScmObj pendingTop;          /* func of the last pending sample */
+    int droppedStacks;          /* # of samples whose stack is lost */
+    int stackRequest;           /* TRUE if the sampler asks the VM to
+                                   record the stack */
+    ScmObj stackTree;           /* folded call stacks.  Each node is
+                                   (<sample-hits> . <children>), where
+                                   <children> is #f or an eq hashtable
+                                   from a frame to a node. */
 #if defined(GAUCHE_WINDOWS)
     HANDLE hTargetThread;       /* target thread */
     HANDLE hObserverThread;     /* observer thread */
@@ -123,19 +167,31 @@ struct ScmVMProfilerRec {
 };
 
 SCM_EXTERN ScmObj Scm_ProfilerRawResult(void);
+SCM_EXTERN ScmObj Scm_ProfilerRawThreadResults(void);
+SCM_EXTERN ScmObj Scm_ProfilerRawStacks(void);
+
+/* Called from the VM */
+SCM_EXTERN void Scm__ProfilerAttachVM(ScmVM *vm);
+SCM_EXTERN void Scm__ProfilerDetachVM(ScmVM *vm);
+SCM_EXTERN void Scm__ProfilerHandleRequest(ScmVM *vm);
 
 /* Call Counter API */
 
 SCM_EXTERN void Scm_ProfilerCountBufferFlush(ScmVM *vm);
+SCM_EXTERN void Scm__ProfilerCountCall(ScmVM *vm, ScmObj func);
 
 #ifdef GAUCHE_PROFILE
 #define SCM_PROF_COUNT_CALL(vm, obj)                                    \
     do {                                                                \
         if (vm->profilerRunning) {                                      \
-            if (vm->prof->currentCount == SCM_PROF_COUNTER_IN_BUFFER) { \
-                Scm_ProfilerCountBufferFlush(vm);                       \
+            if (vm->prof->allThreads) {                                 \
+                Scm__ProfilerCountCall(vm, obj);                        \
+            } else {                                                    \
+                if (vm->prof->currentCount == SCM_PROF_COUNTER_IN_BUFFER) { \
+                    Scm_ProfilerCountBufferFlush(vm);                   \
+                }                                                       \
+                vm->prof->counts[vm->prof->currentCount++].func = obj;  \
             }                                                           \
-            vm->prof->counts[vm->prof->currentCount++].func = obj;      \
         }                                                               \
     } while (0)
 #else  /*!GAUCHE_PROFILE*/
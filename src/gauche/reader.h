@@ -90,6 +90,8 @@ SCM_EXTERN ScmObj Scm_ReadWithContext(ScmObj port, ScmReadContext *ctx);
 SCM_EXTERN ScmObj Scm_ReadList(ScmObj port, ScmChar closer);
 SCM_EXTERN ScmObj Scm_ReadListWithContext(ScmObj port, ScmChar closer,
                                           ScmReadContext *ctx);
+SCM_EXTERN ScmObj Scm_ReadAll(ScmObj port);
+SCM_EXTERN ScmObj Scm_ReadAllWithContext(ScmObj port, ScmReadContext *ctx);
 SCM_EXTERN ScmObj Scm_ReadFromString(ScmString *string);
 SCM_EXTERN ScmObj Scm_ReadFromCString(const char *string);
 
@@ -54,6 +54,8 @@ struct ScmRegexpRec {
                             match at the beginning of the regexp.  It can be
                             used to skip input start position when regexp
                             isn't BOL_ANCHORED. */
+    void *dfa;           /* Lazy DFA, or NULL if the regexp needs the
+                            backtracking matcher.  Private to regexp.c. */
 };
 
 struct ScmRegMatchRec {
@@ -382,6 +382,9 @@ typedef struct ScmStringPointerRec {
     const char *start;
     int index;
     const char *current;
+    const ScmStringBody *body;  /* the body we're pointing into */
+    const char *bodyStart;      /* start of the body's content */
+    int bodyOffset;             /* character offset of start in body */
 } ScmStringPointer;
 
 SCM_CLASS_DECL(Scm_StringPointerClass);
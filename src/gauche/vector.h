@@ -98,12 +98,22 @@ SCM_CLASS_DECL(Scm_UVectorClass);
 #if !GAUCHE_API_0_95
 #define SCM_UVECTOR_SIZE(obj)     (SCM_UVECTOR(obj)->size)
 #define SCM_UVECTOR_IMMUTABLE_P(obj) (SCM_UVECTOR(obj)->immutable)
+#define SCM_UVECTOR_IMMUTABLE_SET(obj, flag) \
+    (SCM_UVECTOR(obj)->immutable = ((flag)?1:0))
+#define SCM_UVECTOR_MAX_SIZE      ((ScmSmallInt)(INT_MAX>>1))
 #define SCM_UVECTOR_INITIALIZER(klass, size, elements, immutable, owner) \
     { { SCM_CLASS_STATIC_TAG(klass) }, (immutable), (size), \
       (owner), (elements) }
 #else  /* GAUCHE_API_0_95 */
-#define SCM_UVECTOR_SIZE(obj)     (SCM_UVECTOR(obj)->size_flags >> 1)
+/* The length is kept in a word, so a uvector can be larger than 2GB
+   on 64-bit platforms. */
+#define SCM_UVECTOR_SIZE(obj)  ((ScmSmallInt)(SCM_UVECTOR(obj)->size_flags >> 1))
 #define SCM_UVECTOR_IMMUTABLE_P(obj) (SCM_UVECTOR(obj)->size_flags & 1)
+#define SCM_UVECTOR_IMMUTABLE_SET(obj, flag)    \
+    ((flag)                                     \
+     ? (SCM_UVECTOR(obj)->size_flags |= 1)      \
+     : (SCM_UVECTOR(obj)->size_flags &= ~(ScmWord)1))
+#define SCM_UVECTOR_MAX_SIZE      SCM_SMALL_INT_MAX
 #define SCM_UVECTOR_INITIALIZER(klass, size, elements, immutable, owner) \
     { { SCM_CLASS_STATIC_TAG(klass) }, (((size)<<1)|(immutable?1:0)),    \
       (owner), (elements) }
@@ -142,7 +152,7 @@ typedef enum {
 SCM_EXTERN ScmUVectorType Scm_UVectorType(ScmClass *klass);
 SCM_EXTERN const char *Scm_UVectorTypeName(int type);
 SCM_EXTERN int    Scm_UVectorElementSize(ScmClass *klass);
-SCM_EXTERN int    Scm_UVectorSizeInBytes(ScmUVector *v);
+SCM_EXTERN ScmSmallInt Scm_UVectorSizeInBytes(ScmUVector *v);
 SCM_EXTERN ScmObj Scm_MakeUVector(ScmClass *klass,
                                   ScmSmallInt size, void *init);
 SCM_EXTERN ScmObj Scm_MakeUVectorFull(ScmClass *klass,
@@ -139,6 +139,9 @@ SCM_EXTERN void Scm_CallCC(ScmObj body);
 
 SCM_EXTERN int  Scm__VMProtectStack(ScmVM *vm);
 SCM_EXTERN void Scm__VMUnprotectStack(ScmVM *vm);
+SCM_EXTERN ScmObj Scm__AttachedVMs(void);
+SCM_EXTERN int  Scm__VMSampleStack(ScmVM *vm, ScmObj *frames, int maxdepth);
+SCM_EXTERN u_long Scm__VMEnvSaveCount(void);
 
 /*
  * Syntactic closure
@@ -728,4 +731,10 @@ SCM_EXTERN ScmModule* Scm_GaucheInternalModule(void);
 
 SCM_EXTERN ScmObj Scm__VMInsnOffsets(void);
 
+/* Instruction counting; see vmstat.c */
+SCM_EXTERN void   Scm_VMInsnCountingStart(void);
+SCM_EXTERN void   Scm_VMInsnCountingStop(void);
+SCM_EXTERN void   Scm_VMInsnCountingReset(void);
+SCM_EXTERN ScmObj Scm_VMInsnCountingSnapshot(void);
+
 #endif /* GAUCHE_VM_H */
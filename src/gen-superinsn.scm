@@ -0,0 +1,179 @@
+;;;
+;;;  gen-superinsn.scm - propose combined VM instructions from profiles
+;;;
+;;;   Copyright (c) 2005-2016  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;; Reads instruction pair frequencies gathered from real workloads,
+;; and generates define-insn forms of combined instructions for the most
+;; frequent pairs.
+;;
+;; A profile is a file containing the value of (vm-insn-counting-snapshot)
+;; written by 'write'; see test/vminsn-performance.scm for an example.
+;; Multiple profiles are summed up.  The profiles must be taken by
+;; the same build of gosh that runs this script, since instruction codes
+;; are looked up in gauche.vm.insn.
+;;
+;;   gosh ./gen-superinsn.scm [-n <count>] [--apply <vminsn.scm>] <profile> ...
+;;
+;; Without --apply, the forms are written to stdout.  With --apply,
+;; they are appended at the end of the given vminsn.scm, so that
+;; the existing instructions keep their codes.
+;;
+;; We only generate the combinations geninsn knows how to construct
+;; (see do-combined in geninsn):
+;;
+;;   (X PUSH), (X RET) - X's body gives its result by $result
+;;   (X CALL), (X TAIL-CALL) - ditto, and X takes no parameters
+;;   (PUSH X)
+;;
+;; geninsn also derives the state transition table of the instruction
+;; combiner from the 'combined' field, so pass5 can emit the generated
+;; insns without a hand-written rule.
+;;
+;; This only proposes candidates; no insns generated by it are checked
+;; in.  The count of a pair is an upper bound of the dispatches the
+;; combined insn saves, for the combiner doesn't combine insns across
+;; a jump target and picks one of the overlapping combinations.  Each new insn
+;; also makes the VM loop bigger.  Measure the result before adopting it.
+
+(use srfi-1)
+(use srfi-13)
+(use util.match)
+(use gauche.parseopt)
+(use gauche.vm.insn)
+
+;; Returns a list of ((<first> <second>) . <count>) and the total number of
+;; dispatched instructions.
+(define (read-pair-counts files)
+  (let ([pairs (make-hash-table 'equal?)]
+        [total 0])
+    (dolist [file files]
+      (let* ([snapshot (call-with-input-file file read)]
+             [insn1 (get-keyword :insn1 snapshot)]
+             [insn2 (get-keyword :insn2 snapshot)])
+        (inc! total (fold + 0 (vector->list insn1)))
+        (dotimes [i (vector-length insn2)]
+          (dotimes [j (vector-length (vector-ref insn2 i))]
+            (let1 c (vector-ref (vector-ref insn2 i) j)
+              (when (positive? c)
+                (hash-table-update! pairs
+                                    (list (insn-name i) (insn-name j))
+                                    (cut + <> c) 0)))))))
+    (values (sort-by (hash-table->alist pairs) cdr >) total)))
+
+(define insn-name
+  (let1 tab (make-hash-table 'eqv?)
+    (dolist [p (class-slot-ref <vm-insn-info> 'all-insns)]
+      (hash-table-put! tab (~ (cdr p)'code) (car p)))
+    (^[code]
+      (or (hash-table-get tab code #f)
+          (error "Unknown instruction code in the profile; \
+                  is it taken by another build?" code)))))
+
+(define (find-insn name)
+  (assq-ref (class-slot-ref <vm-insn-info> 'all-insns) name))
+
+(define (gives-result? info)
+  (let loop ([body (~ info'body)])
+    (cond [(pair? body) (or (loop (car body)) (loop (cdr body)))]
+          [(symbol? body) (string-prefix? "$result" (symbol->string body))]
+          [else #f])))
+
+(define (already-combined? comb)
+  (any (^p (equal? (~ (cdr p)'combined) comb))
+       (class-slot-ref <vm-insn-info> 'all-insns)))
+
+;; Returns (define-insn ...) form for the pair, or #f if we can't combine it.
+(define (combined-insn first second)
+  (let ([a (find-insn first)]
+        [b (find-insn second)]
+        [name (string->symbol #"~|first|-~|second|")])
+    (define (params info)
+      (if (null? (~ info'alt-num-params))
+        (~ info'num-params)
+        (cons (~ info'num-params) (~ info'alt-num-params))))
+    (and (not (~ a'obsoleted))
+         (not (~ b'obsoleted))
+         (not (find-insn name))
+         (not (already-combined? (list first second)))
+         (cond
+          [(and (memq second '(PUSH RET)) (gives-result? a))
+           `(define-insn ,name ,(params a) ,(~ a'operand-type)
+              (,first ,second))]
+          [(and (memq second '(CALL TAIL-CALL)) (gives-result? a)
+                (eqv? (~ a'num-params) 0))
+           `(define-insn ,name ,(params b) ,(~ a'operand-type)
+              (,first ,second))]
+          [(and (eq? first 'PUSH) (not (memq second '(PUSH RET))))
+           `(define-insn ,name ,(params b) ,(~ b'operand-type)
+              (,first ,second))]
+          [else #f]))))
+
+;; Returns a list of (<define-insn form> . <count>), at most N entries.
+(define (choose-candidates pairs n)
+  (let loop ([pairs pairs] [r '()] [k 0])
+    (cond [(or (null? pairs) (>= k n)) (reverse r)]
+          [(apply combined-insn (caar pairs))
+           => (^[form] (loop (cdr pairs) `((,form . ,(cdar pairs)) ,@r) (+ k 1)))]
+          [else (loop (cdr pairs) r k)])))
+
+(define (emit-candidates candidates total files port)
+  (format port "\n;; Generated by gen-superinsn.scm from ~a\n"
+          (string-join files " "))
+  (format port ";; ~d dispatches in total.\n" total)
+  (dolist [c candidates]
+    (format port ";; ~d pairs (~a%)\n" (cdr c) (percentage (cdr c) total))
+    (write (car c) port)
+    (newline port)))
+
+(define (percentage n total)
+  (if (zero? total) 0 (/ (round (* 10000.0 (/ n total))) 100)))
+
+(define (usage)
+  (exit 1 "Usage: gosh ./gen-superinsn.scm [-n <count>] [--apply <vminsn.scm>] <profile> ..."))
+
+(define (main args)
+  (let-args (cdr args) ([n "n=i" 8]
+                        [apply-to "apply=s" #f]
+                        [else => (^ _ (usage))]
+                        . files)
+    (when (null? files) (usage))
+    (receive (pairs total) (read-pair-counts files)
+      (let ([candidates (choose-candidates pairs n)]
+            [num-insns (length (class-slot-ref <vm-insn-info> 'all-insns))])
+        (when (> (+ num-insns (length candidates)) 256)
+          (exit 1 "Too many instructions; VM can have at most 256."))
+        (if apply-to
+          (call-with-output-file apply-to
+            (cut emit-candidates candidates total files <>)
+            :if-exists :append)
+          (emit-candidates candidates total files (current-output-port))))))
+  0)
@@ -49,21 +49,71 @@ typedef struct EntryRec {
     u_long   hashval;
 } Entry;
 
-#define BUCKETS(hc)   ((Entry**)hc->buckets)
-
 #define DEFAULT_NUM_BUCKETS    4
 #define MAX_AVG_CHAIN_LIMITS   3
 #define EXTEND_BITS            2
 
+/* Open addressing layout (see "Open addressing" section below).
+   The beginning of this structure must match ScmDictEntry. */
+typedef struct FlatSlotRec {
+    intptr_t key;
+    intptr_t value;
+    u_long   hashval;
+} FlatSlot;
+
+/* We keep the layout of ScmHashCore for the binary compatibility.
+   The BUCKETS field of the core points to HashBody, which holds
+   the additional states followed by the actual array, either of
+   Entry* (chained buckets) or of FlatSlot (open addressing). */
+typedef struct HashBodyRec {
+    unsigned char *ctrl;        /* open addressing: slot states, or NULL */
+    struct RehashRec *rehash;   /* incremental rehashing state, or NULL */
+    long numDeleted;            /* open addressing: # of deleted slots */
+    void *array[1];             /* variable length */
+} HashBody;
+
+#define BODY(hc)        ((HashBody*)(hc)->buckets)
+#define BUCKETS(hc)     ((Entry**)BODY(hc)->array)
+#define FLAT_SLOTS(hc)  ((FlatSlot*)BODY(hc)->array)
+#define FLAT_CTRL(hc)   (BODY(hc)->ctrl)
+#define FLAT_P(hc)      (FLAT_CTRL(hc) != NULL)
+
+/* Incremental rehashing.
+   Extending a big table at once may take a long time.  If the new
+   table size is INCREMENTAL_REHASH_MIN or more, we keep the old array
+   in the Rehash structure and move a few buckets (or slots) to the new
+   array at each insertion, while lookups consult both arrays.  Buckets
+   (or slots) below INDEX in the old array are already migrated. */
+typedef struct RehashRec {
+    HashBody *body;             /* old array */
+    int numBuckets;
+    int numBucketsLog2;
+    int numEntries;             /* entries left in the old array */
+    int index;                  /* next bucket (or slot) to migrate */
+} Rehash;
+
+#define REHASH(hc)      (BODY(hc)->rehash)
+
+#define INCREMENTAL_REHASH_MIN  65536
+#define REHASH_BUCKETS_PER_OP   8   /* chained: old buckets per insertion */
+#define REHASH_SLOTS_PER_OP     32  /* open addressing: old slots per insertion */
+
 /* We limit portable hash value to 32bits */
 #define PORTABLE_HASHMASK  0xffffffffUL
 
 /* For other hash values, we limit it in the fixnum range. */
 #define HASHMASK SCM_SMALL_INT_MAX
 
-typedef Entry *SearchProc(ScmHashCore *core, intptr_t key, ScmDictOp op);
+/* For SCM_DICT_DELETE, the accessor may copy the key and the value of
+   the deleted entry to DELETED and return it, instead of returning
+   the detached entry. */
+typedef ScmDictEntry *SearchProc(ScmHashCore *core, intptr_t key, ScmDictOp op,
+                                 ScmDictEntry *deleted);
 
 static u_int round2up(unsigned int val);
+static int iter_num_buckets(ScmHashCore *core);
+static Entry *iter_chain(ScmHashCore *core, int i);
+static FlatSlot *iter_slot(ScmHashCore *core, int i);
 
 /*============================================================
  * Hash salt
@@ -407,9 +457,47 @@ u_long Scm_CombineHashValue(u_long a, u_long b)
  * throw Scheme error.  Be aware of that.
  */
 
+/* Allocate a body with the cleared array of NUM elements of SIZE bytes. */
+static HashBody *make_body(int num, size_t size)
+{
+    HashBody *b = SCM_NEW2(HashBody*,
+                           sizeof(HashBody) - sizeof(void*) + size*num);
+    b->ctrl = NULL;
+    b->rehash = NULL;
+    b->numDeleted = 0;
+    memset(b->array, 0, size*num);
+    return b;
+}
+
 /*
- * Common function called when the accessor function needs to add an entry.
+ * Common functions for chained buckets.
  */
+
+/* Move up to NBUCKETS buckets from the old array to the new one. */
+static void chained_migrate(ScmHashCore *table, int nbuckets)
+{
+    Rehash *r = REHASH(table);
+    Entry **oldb = (Entry**)r->body->array;
+    Entry **newb = BUCKETS(table);
+    int end = (nbuckets < 0)? r->numBuckets : r->index + nbuckets;
+    if (end > r->numBuckets) end = r->numBuckets;
+
+    for (int i = r->index; i < end; i++) {
+        Entry *e = oldb[i], *next;
+        for (; e; e = next) {
+            next = e->next;
+            int index = HASH2INDEX(table->numBuckets, table->numBucketsLog2,
+                                   e->hashval);
+            e->next = newb[index];
+            newb[index] = e;
+        }
+        oldb[i] = NULL;         /* gc friendliness */
+    }
+    r->index = end;
+    if (end == r->numBuckets) REHASH(table) = NULL;
+}
+
+/* Called when the accessor function needs to add an entry. */
 static Entry *insert_entry(ScmHashCore *table,
                            intptr_t key,
                            u_long   hashval,
@@ -424,28 +512,42 @@ static Entry *insert_entry(ScmHashCore *table,
     buckets[index] = e;
     table->numEntries++;
 
+    if (REHASH(table)) chained_migrate(table, REHASH_BUCKETS_PER_OP);
+
     if (table->numEntries > table->numBuckets*MAX_AVG_CHAIN_LIMITS) {
         /* Extend the table */
+        if (REHASH(table)) chained_migrate(table, -1); /* finish */
+
         int newsize = (table->numBuckets << EXTEND_BITS);
         int newbits = table->numBucketsLog2 + EXTEND_BITS;
 
-        Entry **newb = SCM_NEW_ARRAY(Entry*, newsize);
-        for (int i=0; i<newsize; i++) newb[i] = NULL;
-
-        ScmHashIter iter;
-        Entry *f;
-        Scm_HashIterInit(&iter, table);
-        while ((f = (Entry*)Scm_HashIterNext(&iter)) != NULL) {
-            index = HASH2INDEX(newsize, newbits, f->hashval);
-            f->next = newb[index];
-            newb[index] = f;
+        HashBody *nbody = make_body(newsize, sizeof(Entry*));
+        Entry **newb = (Entry**)nbody->array;
+
+        if (newsize >= INCREMENTAL_REHASH_MIN) {
+            Rehash *r = SCM_NEW(Rehash);
+            r->body = BODY(table);
+            r->numBuckets = table->numBuckets;
+            r->numBucketsLog2 = table->numBucketsLog2;
+            r->numEntries = 0;  /* not used */
+            r->index = 0;
+            nbody->rehash = r;
+        } else {
+            ScmHashIter iter;
+            Entry *f;
+            Scm_HashIterInit(&iter, table);
+            while ((f = (Entry*)Scm_HashIterNext(&iter)) != NULL) {
+                index = HASH2INDEX(newsize, newbits, f->hashval);
+                f->next = newb[index];
+                newb[index] = f;
+            }
+            /* gc friendliness */
+            for (int i=0; i<table->numBuckets; i++) BUCKETS(table)[i] = NULL;
         }
-        /* gc friendliness */
-        for (int i=0; i<table->numBuckets; i++) table->buckets[i] = NULL;
 
         table->numBuckets = newsize;
         table->numBucketsLog2 = newbits;
-        table->buckets = (void**)newb;
+        table->buckets = (void**)nbody;
     }
     return e;
 }
@@ -454,58 +556,44 @@ static Entry *insert_entry(ScmHashCore *table,
    the "next" link for the sake of weak-gc robustness.  The hash core
    iterator prefetches a pointer to the next entry, so deleting the
    "current" entry of iteration is safe as far as other iterators
-   are running on the same hash table. */
+   are running on the same hash table.  We don't migrate buckets on
+   deletion for the same reason.
+   BUCKETS is either the current array or the old array in rehashing. */
 static Entry *delete_entry(ScmHashCore *table,
                            Entry *entry, Entry *prev,
-                           int index)
+                           Entry **buckets, int index)
 {
     if (prev) prev->next = entry->next;
-    else table->buckets[index] = (void*)entry->next;
+    else buckets[index] = entry->next;
     table->numEntries--;
     SCM_ASSERT(table->numEntries >= 0);
     entry->next = NULL;         /* GC friendliness */
     return entry;
 }
 
-#define FOUND(table, op, e, p, index)                   \
+#define FOUND(table, op, e, p, buckets, index)          \
     do {                                                \
         switch (op) {                                   \
         case SCM_DICT_GET:;                             \
         case SCM_DICT_CREATE:;                          \
-            return e;                                   \
+            return (ScmDictEntry*)e;                    \
         case SCM_DICT_DELETE:;                          \
-            return delete_entry(table, e, p, index);    \
+            return (ScmDictEntry*)delete_entry(table, e, p, buckets, index); \
         }                                               \
     } while (0)
 
 #define NOTFOUND(table, op, key, hashval, index)                \
     do {                                                        \
         if (op == SCM_DICT_CREATE) {                            \
-           return insert_entry(table, key, hashval, index);     \
+           return (ScmDictEntry*)insert_entry(table, key, hashval, index); \
         } else {                                                \
            return NULL;                                         \
         }                                                       \
     } while (0)
 
 /*
- * Accessor function for address.   Used for EQ-type hash.
+ * Hash and compare functions for address.   Used for EQ-type hash.
  */
-static Entry *address_access(ScmHashCore *table,
-                             intptr_t key,
-                             ScmDictOp op)
-{
-    u_long hashval, index;
-    Entry **buckets = (Entry**)table->buckets;
-
-    ADDRESS_HASH(hashval, key);
-    index = HASH2INDEX(table->numBuckets, table->numBucketsLog2, hashval);
-
-    for (Entry *e = buckets[index], *p = NULL; e; p = e, e = e->next) {
-        if (e->key == key) FOUND(table, op, e, p, index);
-    }
-    NOTFOUND(table, op, key, hashval, index);
-}
-
 static u_long address_hash(const ScmHashCore *ht, intptr_t obj)
 {
     u_long hashval;
@@ -544,34 +632,8 @@ static int equal_cmp(const ScmHashCore *table, intptr_t key, intptr_t k2)
 
 
 /*
- * Accessor function for string type.
+ * Hash and compare functions for string type.
  */
-static Entry *string_access(ScmHashCore *table, intptr_t k, ScmDictOp op)
-{
-    ScmObj key = SCM_OBJ(k);
-
-    if (!SCM_STRINGP(key)) {
-        Scm_Error("Got non-string key %S to the string hashtable.", key);
-    }
-    u_long hashval = Scm_HashString(SCM_STRING(key), 0);
-    u_long index = HASH2INDEX(table->numBuckets, table->numBucketsLog2, hashval);
-    Entry **buckets = (Entry**)table->buckets;
-
-    const ScmStringBody *keyb = SCM_STRING_BODY(key);
-    long size = SCM_STRING_BODY_SIZE(keyb);
-    for (Entry *e = buckets[index], *p = NULL; e; p = e, e = e->next) {
-        ScmObj ee = SCM_OBJ(e->key);
-        const ScmStringBody *eeb = SCM_STRING_BODY(ee);
-        int eesize = SCM_STRING_BODY_SIZE(eeb);
-        if (size == eesize
-            && memcmp(SCM_STRING_BODY_START(keyb),
-                      SCM_STRING_BODY_START(eeb), eesize) == 0){
-            FOUND(table, op, e, p, index);
-        }
-    }
-    NOTFOUND(table, op, k, hashval, index);
-}
-
 static u_long string_hash(const ScmHashCore *table, intptr_t key)
 {
     return Scm_HashString(SCM_STRING(key), 0);
@@ -613,11 +675,11 @@ static Entry *multiword_access(ScmHashCore *table, intptr_t k, ScmDictOp op)
 
     hashval = multiword_hash(table, k);
     index = HASH2INDEX(table->numBuckets, table->numBucketsLog2, hashval);
-    Entry **buckets = (Entry**)table->buckets;
+    Entry **buckets = BUCKETS(table);
 
     for (Entry *e = buckets[index], *p = NULL; e; p = e, e = e->next) {
         if (memcmp((void*)k, (void*)e->key, keysize*sizeof(ScmWord)) == 0)
-            FOUND(table, op, e, p, index);
+            FOUND(table, op, e, p, buckets, index);
     }
     NOTFOUND(table, op, k, hashval, index);
 }
@@ -628,20 +690,304 @@ static Entry *multiword_access(ScmHashCore *table, intptr_t k, ScmDictOp op)
  * Accessor function for general case
  *    (hashfn and cmpfn are given by user)
  */
-static Entry *general_access(ScmHashCore *table, intptr_t key, ScmDictOp op)
+static ScmDictEntry *general_access(ScmHashCore *table, intptr_t key,
+                                    ScmDictOp op,
+                                    ScmDictEntry *deleted)
 {
     u_long hashval, index;
 
     hashval = table->hashfn(table, key);
     index = HASH2INDEX(table->numBuckets, table->numBucketsLog2, hashval);
-    Entry **buckets = (Entry**)table->buckets;
+    Entry **buckets = BUCKETS(table);
 
     for (Entry *e = buckets[index], *p = NULL; e; p = e, e = e->next) {
-        if (table->cmpfn(table, key, e->key)) FOUND(table, op, e, p, index);
+        if (table->cmpfn(table, key, e->key)) {
+            FOUND(table, op, e, p, buckets, index);
+        }
+    }
+    if (REHASH(table)) {
+        Rehash *r = REHASH(table);
+        u_long oindex = HASH2INDEX(r->numBuckets, r->numBucketsLog2, hashval);
+        Entry **oldb = (Entry**)r->body->array;
+        for (Entry *e = oldb[oindex], *p = NULL; e; p = e, e = e->next) {
+            if (table->cmpfn(table, key, e->key)) {
+                FOUND(table, op, e, p, oldb, oindex);
+            }
+        }
     }
     NOTFOUND(table, op, key, hashval, index);
 }
 
+/*============================================================
+ * Open addressing
+ */
+
+/* The predefined eq?, eqv? and string=? tables (and the word table)
+ * don't use the chained buckets.  Instead, BUCKETS holds a flat array
+ * of FlatSlot, each of which contains the key, the value and the hash
+ * value inline, and CTRL holds a byte per slot which is either
+ * FLAT_EMPTY, FLAT_DELETED, or a 7-bit tag taken from the hash value
+ * of the occupying key.  We probe linearly, scanning the compact control
+ * bytes and touching a slot only if its tag matches.  This saves
+ * the per-entry allocation and the pointer chasing of chained buckets.
+ *
+ * Deletion leaves a tombstone (FLAT_DELETED), unless the next slot is
+ * empty, so that deleting the current entry during iteration is safe,
+ * just as in the chained layout.  Unlike the chained layout, however,
+ * the entry pointer returned by Scm_HashCoreSearch is only valid until
+ * the next modification of the table, for slots are moved when the
+ * table is rebuilt.  The key and value of a deleted entry are copied
+ * to the storage the caller supplies (see Scm_HashCoreDelete).
+ *
+ * During incremental rehashing, the old array keeps its own control
+ * bytes.  A migrated slot of the old array is marked as deleted, so
+ * that probe sequences of the remaining entries are kept intact.
+ */
+
+#define FLAT_EMPTY      0x80
+#define FLAT_DELETED    0xfe
+#define FLAT_TAG(hv)    ((unsigned char)(((hv)>>25) & 0x7f))
+#define FLAT_FULLP(c)   (((c) & 0x80) == 0)
+
+#define FLAT_MIN_SLOTS  8
+/* We rebuild the table when occupied slots (including tombstones)
+   exceed 3/4 of the slots.  The rebuilt table is at most half full. */
+#define FLAT_OVERLOADED(numOccupied, numSlots) \
+    ((u_long)(numOccupied)*4 > (u_long)(numSlots)*3)
+
+static void flat_alloc(ScmHashCore *table, int numSlots)
+{
+    HashBody *b = make_body(numSlots, sizeof(FlatSlot));
+    b->ctrl = SCM_NEW_ATOMIC2(unsigned char*, numSlots);
+    memset(b->ctrl, FLAT_EMPTY, numSlots);
+    table->buckets = (void**)b;
+    table->numBuckets = numSlots;
+    table->numBucketsLog2 = 0;
+    for (int i=numSlots; i > 1; i /= 2) table->numBucketsLog2++;
+}
+
+/* Returns the index of the first empty or deleted slot in the probe
+   sequence of HASHVAL in the current array. */
+static u_long flat_free_slot(ScmHashCore *table, u_long hashval)
+{
+    u_long mask = table->numBuckets - 1;
+    u_long i = HASH2INDEX(table->numBuckets, table->numBucketsLog2, hashval);
+    while (FLAT_FULLP(FLAT_CTRL(table)[i])) i = (i+1) & mask;
+    return i;
+}
+
+/* Put the content of slot S to the current array. */
+static void flat_put_slot(ScmHashCore *table, FlatSlot *s)
+{
+    u_long j = flat_free_slot(table, s->hashval);
+    if (FLAT_CTRL(table)[j] == FLAT_DELETED) BODY(table)->numDeleted--;
+    FLAT_SLOTS(table)[j] = *s;
+    FLAT_CTRL(table)[j] = FLAT_TAG(s->hashval);
+}
+
+/* Move up to NSLOTS slots from the old array to the current one.
+   Negative NSLOTS means all the rest. */
+static void flat_migrate(ScmHashCore *table, int nslots)
+{
+    Rehash *r = REHASH(table);
+    FlatSlot *oslots = (FlatSlot*)r->body->array;
+    int end = (nslots < 0)? r->numBuckets : r->index + nslots;
+    if (end > r->numBuckets) end = r->numBuckets;
+
+    for (int i = r->index; i < end && r->numEntries > 0; i++) {
+        if (!FLAT_FULLP(r->body->ctrl[i])) continue;
+        flat_put_slot(table, &oslots[i]);
+        oslots[i].key = oslots[i].value = 0; /* gc friendliness */
+        r->body->ctrl[i] = FLAT_DELETED;
+        r->numEntries--;
+    }
+    r->index = end;
+    if (end == r->numBuckets || r->numEntries == 0) REHASH(table) = NULL;
+}
+
+/* Rehash all entries into a fresh array of NUMSLOTS, dropping tombstones.
+   If the table is big, we just set up the fresh array and leave the
+   actual migration to the subsequent insertions. */
+static void flat_rebuild(ScmHashCore *table, int numSlots)
+{
+    HashBody *obody = BODY(table);
+    FlatSlot *oslots = (FlatSlot*)obody->array;
+    unsigned char *octrl = obody->ctrl;
+    int onum = table->numBuckets;
+    int obits = table->numBucketsLog2;
+
+    SCM_ASSERT(REHASH(table) == NULL);
+    flat_alloc(table, numSlots);
+    if (numSlots >= INCREMENTAL_REHASH_MIN) {
+        Rehash *r = SCM_NEW(Rehash);
+        r->body = obody;
+        r->numBuckets = onum;
+        r->numBucketsLog2 = obits;
+        r->numEntries = table->numEntries;
+        r->index = 0;
+        REHASH(table) = r;
+    } else {
+        for (int i=0; i<onum; i++) {
+            if (FLAT_FULLP(octrl[i])) flat_put_slot(table, &oslots[i]);
+        }
+    }
+}
+
+/* Put a new entry to the current array.  INDEX is the empty or deleted
+   slot found by probing, but it may be recalculated if we move things. */
+static ScmDictEntry *flat_insert(ScmHashCore *table, intptr_t key,
+                                 u_long hashval, u_long index)
+{
+    if (REHASH(table)) {
+        flat_migrate(table, REHASH_SLOTS_PER_OP);
+        index = flat_free_slot(table, hashval);
+    }
+    if (FLAT_CTRL(table)[index] == FLAT_DELETED) {
+        BODY(table)->numDeleted--;
+    } else {
+        int numOld = REHASH(table)? REHASH(table)->numEntries : 0;
+        long numOccupied =
+            table->numEntries - numOld + BODY(table)->numDeleted + 1;
+        if (FLAT_OVERLOADED(numOccupied, table->numBuckets)) {
+            if (REHASH(table)) flat_migrate(table, -1);
+            int newsize = table->numBuckets;
+            while (table->numEntries+1 > newsize/2) newsize <<= 1;
+            flat_rebuild(table, newsize);
+            index = flat_free_slot(table, hashval);
+            if (FLAT_CTRL(table)[index] == FLAT_DELETED) {
+                BODY(table)->numDeleted--;
+            }
+        }
+    }
+    FlatSlot *s = &FLAT_SLOTS(table)[index];
+    s->key = key;
+    s->value = 0;
+    s->hashval = hashval;
+    FLAT_CTRL(table)[index] = FLAT_TAG(hashval);
+    table->numEntries++;
+    return (ScmDictEntry*)s;
+}
+
+/* Delete the entry at INDEX, either of the current array (R == NULL)
+   or of the old array in rehashing.  The slot may be reused, so we copy
+   its key and value to DELETED, supplied by the caller. */
+static ScmDictEntry *flat_delete(ScmHashCore *table, Rehash *r, u_long index,
+                                 ScmDictEntry *deleted)
+{
+    HashBody *b = r? r->body : BODY(table);
+    FlatSlot *s = &((FlatSlot*)b->array)[index];
+    unsigned char *ctrl = b->ctrl;
+    u_long mask = (r? r->numBuckets : table->numBuckets) - 1;
+
+    SCM_ASSERT(deleted != NULL);
+    memcpy(deleted, s, sizeof(ScmDictEntry));
+    s->key = s->value = 0;      /* GC friendliness */
+    if (ctrl[(index+1) & mask] == FLAT_EMPTY) {
+        /* No probe sequence goes beyond this slot. */
+        ctrl[index] = FLAT_EMPTY;
+    } else {
+        ctrl[index] = FLAT_DELETED;
+        if (!r) BODY(table)->numDeleted++;
+    }
+    if (r) r->numEntries--;
+    table->numEntries--;
+    SCM_ASSERT(table->numEntries >= 0);
+    return deleted;
+}
+
+/* Probe SLOTS/CTRL for the key.  MATCHP is an expression to compare
+   the key and s->key; it's evaluated only when the hash values match.
+   Sets FOUND to the index of the matching slot or -1, and AVAIL to
+   the index of the first empty or deleted slot. */
+#define FLAT_PROBE(slots, ctrl, num, bits, hashval, matchp, found, avail) \
+    do {                                                                \
+        unsigned char tag_ = FLAT_TAG(hashval);                         \
+        u_long mask_ = (num) - 1;                                       \
+        u_long i_ = HASH2INDEX(num, bits, hashval);                     \
+        (found) = (avail) = -1;                                         \
+        for (;; i_ = (i_+1) & mask_) {                                  \
+            unsigned char c_ = (ctrl)[i_];                              \
+            if (c_ == tag_) {                                           \
+                FlatSlot *s = &(slots)[i_];                             \
+                if (s->hashval == (hashval) && (matchp)) {              \
+                    (found) = (long)i_;                                 \
+                    break;                                              \
+                }                                                       \
+            } else if (c_ == FLAT_EMPTY) {                              \
+                if ((avail) < 0) (avail) = (long)i_;                    \
+                break;                                                  \
+            } else if (c_ == FLAT_DELETED && (avail) < 0) {             \
+                (avail) = (long)i_;                                     \
+            }                                                           \
+        }                                                               \
+    } while (0)
+
+/* The body of flat accessors. */
+#define FLAT_ACCESS(table, key, op, deleted, hashval, matchp)           \
+    do {                                                                \
+        long found, avail, dummy;                                       \
+        FLAT_PROBE(FLAT_SLOTS(table), FLAT_CTRL(table), table->numBuckets, \
+                   table->numBucketsLog2, hashval, matchp, found, avail); \
+        if (found >= 0) {                                               \
+            if (op == SCM_DICT_DELETE)                                  \
+                return flat_delete(table, NULL, found, deleted);        \
+            return (ScmDictEntry*)&FLAT_SLOTS(table)[found];            \
+        }                                                               \
+        if (REHASH(table)) {                                            \
+            Rehash *r = REHASH(table);                                  \
+            FlatSlot *oslots = (FlatSlot*)r->body->array;               \
+            FLAT_PROBE(oslots, r->body->ctrl, r->numBuckets,            \
+                       r->numBucketsLog2, hashval, matchp, found, dummy); \
+            if (found >= 0) {                                           \
+                if (op == SCM_DICT_DELETE)                              \
+                    return flat_delete(table, r, found, deleted);       \
+                return (ScmDictEntry*)&oslots[found];                   \
+            }                                                           \
+        }                                                               \
+        if (op != SCM_DICT_CREATE) return NULL;                         \
+        return flat_insert(table, key, hashval, (u_long)avail);         \
+    } while (0)
+
+static ScmDictEntry *flat_address_access(ScmHashCore *table,
+                                         intptr_t key,
+                                         ScmDictOp op,
+                                         ScmDictEntry *deleted)
+{
+    u_long hashval;
+    ADDRESS_HASH(hashval, key);
+    FLAT_ACCESS(table, key, op, deleted, hashval, s->key == key);
+}
+
+static ScmDictEntry *flat_eqv_access(ScmHashCore *table,
+                                     intptr_t key,
+                                     ScmDictOp op,
+                                     ScmDictEntry *deleted)
+{
+    u_long hashval = Scm_EqvHash(SCM_OBJ(key));
+    FLAT_ACCESS(table, key, op, deleted, hashval,
+                (s->key == key || Scm_EqvP(SCM_OBJ(key), SCM_OBJ(s->key))));
+}
+
+static ScmDictEntry *flat_string_access(ScmHashCore *table,
+                                        intptr_t k,
+                                        ScmDictOp op,
+                                        ScmDictEntry *deleted)
+{
+    ScmObj key = SCM_OBJ(k);
+
+    if (!SCM_STRINGP(key)) {
+        Scm_Error("Got non-string key %S to the string hashtable.", key);
+    }
+    u_long hashval = Scm_HashString(SCM_STRING(key), 0);
+    const ScmStringBody *keyb = SCM_STRING_BODY(key);
+    long size = SCM_STRING_BODY_SIZE(keyb);
+    FLAT_ACCESS(table, k, op, deleted, hashval,
+                (SCM_STRING_BODY_SIZE(SCM_STRING_BODY(s->key)) == size
+                 && memcmp(SCM_STRING_BODY_START(keyb),
+                           SCM_STRING_BODY_START(SCM_STRING_BODY(s->key)),
+                           size) == 0));
+}
+
 /*============================================================
  * Hash Core functions
  */
@@ -653,22 +999,31 @@ static void hash_core_init(ScmHashCore *table,
                            unsigned int initSize,
                            void *data)
 {
-    if (initSize != 0) initSize = round2up(initSize);
-    else initSize = DEFAULT_NUM_BUCKETS;
-
-    Entry **b = SCM_NEW_ARRAY(Entry*, initSize);
-    table->buckets = (void**)b;
-    table->numBuckets = initSize;
     table->numEntries = 0;
     table->accessfn = (void*)accessfn;
     table->hashfn = hashfn;
     table->cmpfn = cmpfn;
     table->data = data;
+
+    if (accessfn == flat_address_access
+        || accessfn == flat_eqv_access
+        || accessfn == flat_string_access) {
+        /* Make INITSIZE entries fit without rebuilding. */
+        if (initSize < FLAT_MIN_SLOTS/2) initSize = FLAT_MIN_SLOTS;
+        else initSize = round2up(initSize*2);
+        flat_alloc(table, initSize);
+        return;
+    }
+
+    if (initSize != 0) initSize = round2up(initSize);
+    else initSize = DEFAULT_NUM_BUCKETS;
+
+    table->buckets = (void**)make_body(initSize, sizeof(Entry*));
+    table->numBuckets = initSize;
     table->numBucketsLog2 = 0;
     for (u_int i=initSize; i > 1; i /= 2) {
         table->numBucketsLog2++;
     }
-    for (u_int i=0; i<initSize; i++) table->buckets[i] = NULL;
 }
 
 /* choose appropriate procedures for predefined hash types. */
@@ -680,12 +1035,12 @@ int  hash_core_predef_procs(ScmHashType type,
     switch (type) {
     case SCM_HASH_EQ:
     case SCM_HASH_WORD:
-        *accessfn = address_access;
+        *accessfn = flat_address_access;
         *hashfn = address_hash;
         *cmpfn  = address_cmp;
         return TRUE;
     case SCM_HASH_EQV:
-        *accessfn = general_access;
+        *accessfn = flat_eqv_access;
         *hashfn = eqv_hash;
         *cmpfn  = eqv_cmp;
         return TRUE;
@@ -695,7 +1050,7 @@ int  hash_core_predef_procs(ScmHashType type,
         *cmpfn  = equal_cmp;
         return TRUE;
     case SCM_HASH_STRING:
-        *accessfn = string_access;
+        *accessfn = flat_string_access;
         *hashfn = string_hash;
         *cmpfn  = string_cmp;
         return TRUE;
@@ -739,41 +1094,77 @@ int Scm_HashCoreTypeToProcs(ScmHashType type,
 
 void Scm_HashCoreCopy(ScmHashCore *dst, const ScmHashCore *src)
 {
-    Entry **b = SCM_NEW_ARRAY(Entry*, src->numBuckets);
-
-    for (int i=0; i<src->numBuckets; i++) {
-        Entry *p = NULL;
-        Entry *s = (Entry*)src->buckets[i];
-        b[i] = NULL;
-        while (s) {
-            Entry *e = SCM_NEW(Entry);
-            e->key = s->key;
-            e->value = s->value;
-            e->next = NULL;
-            if (p) p->next = e;
-            else   b[i] = e;
-            p = e;
-            s = s->next;
+    /* During incremental rehashing, we walk both the old and the current
+       arrays of SRC and put the entries to a fresh array.  SRC itself is
+       never modified; it may be shared by other threads for reading. */
+    ScmHashCore *s = (ScmHashCore*)src;
+    int n = iter_num_buckets(s);
+    ScmHashCore tmp;
+
+    if (FLAT_P(src) && REHASH(src) == NULL) {
+        HashBody *b = make_body(src->numBuckets, sizeof(FlatSlot));
+        b->ctrl = SCM_NEW_ATOMIC2(unsigned char*, src->numBuckets);
+        memcpy(b->array, FLAT_SLOTS(src), sizeof(FlatSlot)*src->numBuckets);
+        memcpy(b->ctrl, FLAT_CTRL(src), src->numBuckets);
+        b->numDeleted = BODY(src)->numDeleted;
+        tmp.buckets = (void**)b;
+        tmp.numBuckets = src->numBuckets;
+        tmp.numBucketsLog2 = src->numBucketsLog2;
+    } else if (FLAT_P(src)) {
+        int newsize = src->numBuckets;
+        while (src->numEntries+1 > newsize/2) newsize <<= 1;
+        flat_alloc(&tmp, newsize);
+        for (int i=0; i<n; i++) {
+            FlatSlot *f = iter_slot(s, i);
+            if (f) flat_put_slot(&tmp, f);
         }
+    } else {
+        HashBody *body = make_body(src->numBuckets, sizeof(Entry*));
+        Entry **b = (Entry**)body->array;
+        for (int i=0; i<n; i++) {
+            for (Entry *f = iter_chain(s, i); f; f = f->next) {
+                Entry *e = SCM_NEW(Entry);
+                e->key = f->key;
+                e->value = f->value;
+                e->hashval = f->hashval;
+                e->next = NULL;
+                /* Append, to keep the order of the chain. */
+                int index = HASH2INDEX(src->numBuckets, src->numBucketsLog2,
+                                       f->hashval);
+                Entry **p = &b[index];
+                while (*p) p = &(*p)->next;
+                *p = e;
+            }
+        }
+        tmp.buckets = (void**)body;
+        tmp.numBuckets = src->numBuckets;
+        tmp.numBucketsLog2 = src->numBucketsLog2;
     }
 
     /* A little trick to avoid hazard in careless race condition */
     dst->numBuckets = dst->numEntries = 0;
 
-    dst->buckets = (void**)b;
+    dst->buckets  = tmp.buckets;
     dst->hashfn   = src->hashfn;
     dst->cmpfn    = src->cmpfn;
     dst->accessfn = src->accessfn;
     dst->data     = src->data;
     dst->numEntries = src->numEntries;
-    dst->numBucketsLog2 = src->numBucketsLog2;
-    dst->numBuckets = src->numBuckets;
+    dst->numBucketsLog2 = tmp.numBucketsLog2;
+    dst->numBuckets = tmp.numBuckets;
 }
 
 void Scm_HashCoreClear(ScmHashCore *table)
 {
-    for (int i=0; i<table->numBuckets; i++) {
-        table->buckets[i] = NULL;
+    REHASH(table) = NULL;
+    if (FLAT_P(table)) {
+        memset(FLAT_SLOTS(table), 0, sizeof(FlatSlot)*table->numBuckets);
+        memset(FLAT_CTRL(table), FLAT_EMPTY, table->numBuckets);
+        BODY(table)->numDeleted = 0;
+    } else {
+        for (int i=0; i<table->numBuckets; i++) {
+            BUCKETS(table)[i] = NULL;
+        }
     }
     table->numEntries = 0;
 }
@@ -782,7 +1173,28 @@ ScmDictEntry *Scm_HashCoreSearch(ScmHashCore *table, intptr_t key,
                                  ScmDictOp op)
 {
     SearchProc *p = (SearchProc*)table->accessfn;
-    return (ScmDictEntry*)p(table, key, op);
+    if (op == SCM_DICT_DELETE && FLAT_P(table)) {
+        /* The deleted slot may be reused, so we return a fresh copy.
+           Use Scm_HashCoreDelete to avoid allocation. */
+        ScmDictEntry d;
+        if (Scm_HashCoreDelete(table, key, &d) == NULL) return NULL;
+        ScmDictEntry *e = SCM_NEW(ScmDictEntry);
+        memcpy(e, &d, sizeof(ScmDictEntry));
+        return e;
+    }
+    return (ScmDictEntry*)p(table, key, op, NULL);
+}
+
+/* Deletes the entry with KEY.  If found, its key and value are copied
+   to RESULT and RESULT is returned.  Otherwise NULL is returned. */
+ScmDictEntry *Scm_HashCoreDelete(ScmHashCore *table, intptr_t key,
+                                 ScmDictEntry *result)
+{
+    SearchProc *p = (SearchProc*)table->accessfn;
+    ScmDictEntry *e = p(table, key, SCM_DICT_DELETE, result);
+    if (e == NULL) return NULL;
+    if (e != result) memcpy(result, e, sizeof(ScmDictEntry));
+    return result;
 }
 
 int Scm_HashCoreNumEntries(ScmHashCore *table)
@@ -794,14 +1206,59 @@ int Scm_HashCoreNumEntries(ScmHashCore *table)
  * NB: It is important to keep the pointer to the "next" entry,
  * not the "current", since the current entry may be deleted,
  * erasing its next pointer.
+ *
+ * During incremental rehashing, we walk the old array first, then
+ * the current array.  BUCKET is a virtual index; [0, N) for the old
+ * array of size N, and [N, N+numBuckets) for the current array.
+ * If the table is extended or rebuilt during iteration, we just go on
+ * with the new arrays; some entries may be skipped or visited twice.
  */
+static int iter_num_buckets(ScmHashCore *core)
+{
+    return core->numBuckets + (REHASH(core)? REHASH(core)->numBuckets : 0);
+}
+
+/* Returns the head of chain at the virtual index I. */
+static Entry *iter_chain(ScmHashCore *core, int i)
+{
+    Rehash *r = REHASH(core);
+    if (r) {
+        if (i < r->numBuckets) return ((Entry**)r->body->array)[i];
+        i -= r->numBuckets;
+    }
+    return BUCKETS(core)[i];
+}
+
+/* Returns the slot at the virtual index I if it's occupied, NULL
+   otherwise. */
+static FlatSlot *iter_slot(ScmHashCore *core, int i)
+{
+    Rehash *r = REHASH(core);
+    if (r) {
+        if (i < r->numBuckets) {
+            FlatSlot *oslots = (FlatSlot*)r->body->array;
+            return FLAT_FULLP(r->body->ctrl[i])? &oslots[i] : NULL;
+        }
+        i -= r->numBuckets;
+    }
+    return FLAT_FULLP(FLAT_CTRL(core)[i])? &FLAT_SLOTS(core)[i] : NULL;
+}
+
 void Scm_HashIterInit(ScmHashIter *iter, ScmHashCore *table)
 {
     iter->core = table;
-    for (int i=0; i<table->numBuckets; i++) {
-        if (table->buckets[i]) {
+    if (FLAT_P(table)) {
+        /* For open addressing, BUCKET is the next slot to look at. */
+        iter->bucket = 0;
+        iter->next = NULL;
+        return;
+    }
+    int n = iter_num_buckets(table);
+    for (int i=0; i<n; i++) {
+        Entry *e = iter_chain(table, i);
+        if (e) {
             iter->bucket = i;
-            iter->next = table->buckets[i];
+            iter->next = e;
             return;
         }
     }
@@ -810,15 +1267,30 @@ void Scm_HashIterInit(ScmHashIter *iter, ScmHashCore *table)
 
 ScmDictEntry *Scm_HashIterNext(ScmHashIter *iter)
 {
+    ScmHashCore *core = iter->core;
+    int n = iter_num_buckets(core);
+    if (FLAT_P(core)) {
+        for (int i = iter->bucket; i < n; i++) {
+            FlatSlot *s = iter_slot(core, i);
+            if (s) {
+                iter->bucket = i+1;
+                return (ScmDictEntry*)s;
+            }
+        }
+        iter->bucket = n;
+        return NULL;
+    }
+
     Entry *e = (Entry*)iter->next;
     if (e != NULL) {
         if (e->next) iter->next = e->next;
         else {
             int i = iter->bucket + 1;
-            for (; i < iter->core->numBuckets; i++) {
-                if (iter->core->buckets[i]) {
+            for (; i < n; i++) {
+                Entry *f = iter_chain(core, i);
+                if (f) {
                     iter->bucket = i;
-                    iter->next = iter->core->buckets[i];
+                    iter->next = f;
                     return (ScmDictEntry*)e;
                 }
             }
@@ -901,8 +1373,9 @@ ScmObj Scm_HashTableSet(ScmHashTable *ht, ScmObj key, ScmObj value, int flags)
 
 ScmObj Scm_HashTableDelete(ScmHashTable *ht, ScmObj key)
 {
-    ScmDictEntry *e = Scm_HashCoreSearch(SCM_HASH_TABLE_CORE(ht),
-                                         (intptr_t)key, SCM_DICT_DELETE);
+    ScmDictEntry d;
+    ScmDictEntry *e = Scm_HashCoreDelete(SCM_HASH_TABLE_CORE(ht),
+                                         (intptr_t)key, &d);
     if (e && e->value) return SCM_DICT_VALUE(e);
     else               return SCM_UNBOUND;
 }
@@ -941,14 +1414,37 @@ ScmObj Scm_HashTableStat(ScmHashTable *table)
     SCM_APPEND1(h, t, Scm_MakeInteger(c->numBuckets));
     SCM_APPEND1(h, t, SCM_MAKE_KEYWORD("num-buckets-log2"));
     SCM_APPEND1(h, t, Scm_MakeInteger(c->numBucketsLog2));
+    /* (<migrated> . <total>) in old buckets (or slots) if incremental
+       rehashing is in progress, #f otherwise. */
+    SCM_APPEND1(h, t, SCM_MAKE_KEYWORD("rehash-progress"));
+    if (REHASH(c)) {
+        SCM_APPEND1(h, t, Scm_Cons(Scm_MakeInteger(REHASH(c)->index),
+                                   Scm_MakeInteger(REHASH(c)->numBuckets)));
+    } else {
+        SCM_APPEND1(h, t, SCM_FALSE);
+    }
 
-    Entry** b = BUCKETS(c);
-    ScmVector *v = SCM_VECTOR(Scm_MakeVector(c->numBuckets, SCM_NIL));
+    /* During incremental rehashing, the contents vector has the buckets
+       (or slots) of the old array followed by the ones of the current
+       array, in the same order as the iterator. */
+    int n = iter_num_buckets(c);
+    ScmVector *v = SCM_VECTOR(Scm_MakeVector(n, SCM_NIL));
     ScmObj *vp = SCM_VECTOR_ELEMENTS(v);
-    for (int i = 0; i<c->numBuckets; i++, vp++) {
-        Entry *e = b[i];
-        for (; e; e = e->next) {
-            *vp = Scm_Acons(SCM_DICT_KEY(e), SCM_DICT_VALUE(e), *vp);
+    if (FLAT_P(c)) {
+        SCM_APPEND1(h, t, SCM_MAKE_KEYWORD("num-deleted"));
+        SCM_APPEND1(h, t, Scm_MakeInteger(BODY(c)->numDeleted));
+        for (int i = 0; i<n; i++, vp++) {
+            FlatSlot *s = iter_slot(c, i);
+            if (s) {
+                *vp = SCM_LIST1(Scm_Cons(SCM_DICT_KEY(s), SCM_DICT_VALUE(s)));
+            }
+        }
+    } else {
+        for (int i = 0; i<n; i++, vp++) {
+            Entry *e = iter_chain(c, i);
+            for (; e; e = e->next) {
+                *vp = Scm_Acons(SCM_DICT_KEY(e), SCM_DICT_VALUE(e), *vp);
+            }
         }
     }
     SCM_APPEND1(h, t, SCM_MAKE_KEYWORD("contents"));
@@ -281,22 +281,38 @@
 
 ;; The public API for sorting is in lib/gauche/sortutil.scm and
 ;; will be autoloaded.  We provide a C-implemented low-level routines.
+;; The sort is stable.  CMP is #f for the default ordering, or a procedure;
+;; see Scm_SortArray for the details.  If KEY is given, it is called once
+;; on each element and the elements are ordered by the results.
 (select-module gauche.internal)
 
-(define-cproc %sort (seq)
+(inline-stub
+ (define-cfn sort-array (elts::ScmObj* n::int cmp key) ::void :static
+   (if (SCM_FALSEP key)
+     (Scm_SortArray elts n cmp)
+     (Scm_SortArrayByKey elts n cmp key)))
+ )
+
+(define-cproc %sort (seq :optional (cmp #f) (key #f))
   (cond [(SCM_VECTORP seq)
          (let* ([r (Scm_VectorCopy (SCM_VECTOR seq) 0 -1 SCM_UNDEFINED)])
-           (Scm_SortArray (SCM_VECTOR_ELEMENTS r) (SCM_VECTOR_SIZE r) '#f)
+           (sort-array (SCM_VECTOR_ELEMENTS r) (SCM_VECTOR_SIZE r) cmp key)
            (return r))]
-        [(>= (Scm_Length seq) 0) (return (Scm_SortList seq '#f))]
+        [(>= (Scm_Length seq) 0)
+         (return (?: (SCM_FALSEP key)
+                     (Scm_SortList seq cmp)
+                     (Scm_SortListByKey seq cmp key)))]
         [else (SCM_TYPE_ERROR seq "proper list or vector")
               (return SCM_UNDEFINED)]))
 
-(define-cproc %sort! (seq)
+(define-cproc %sort! (seq :optional (cmp #f) (key #f))
   (cond [(SCM_VECTORP seq)
-         (Scm_SortArray (SCM_VECTOR_ELEMENTS seq) (SCM_VECTOR_SIZE seq) '#f)
+         (sort-array (SCM_VECTOR_ELEMENTS seq) (SCM_VECTOR_SIZE seq) cmp key)
          (return seq)]
-        [(>= (Scm_Length seq) 0) (return (Scm_SortListX seq '#f))]
+        [(>= (Scm_Length seq) 0)
+         (return (?: (SCM_FALSEP key)
+                     (Scm_SortListX seq cmp)
+                     (Scm_SortListByKeyX seq cmp key)))]
         [else (SCM_TYPE_ERROR seq "proper list or vector")
               (return SCM_UNDEFINED)]))
 
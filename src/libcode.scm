@@ -39,7 +39,8 @@
 (define-module gauche.vm.code
   (export vm-dump-code vm-code->list vm-insn-build
           vm-insn-code->name vm-insn-name->code
-          
+          vm-insn-operand-type list->compiled-code
+
           make-compiled-code-builder
           compiled-code-emit0! compiled-code-emit0o!
           compiled-code-emit0i! compiled-code-emit0oi!
@@ -75,6 +76,21 @@
    (return (SCM_INTERN (Scm_VMInsnName opcode))))
  (define-cproc vm-insn-name->code (insn-name) ::<int>
    Scm_VMInsnNameToCode)
+ (define-cproc vm-insn-operand-type (opcode::<uint>)
+   (case (Scm_VMInsnOperandType opcode)
+     [(SCM_VM_OPERAND_NONE)     (return 'none)]
+     [(SCM_VM_OPERAND_OBJ)      (return 'obj)]
+     [(SCM_VM_OPERAND_ADDR)     (return 'addr)]
+     [(SCM_VM_OPERAND_CODE)     (return 'code)]
+     [(SCM_VM_OPERAND_CODES)    (return 'codes)]
+     [(SCM_VM_OPERAND_OBJ_ADDR) (return 'obj+addr)]
+     [else (return SCM_FALSE)]))
+
+ ;; Inverse of vm-code->list.  Debug info isn't recovered.
+ (define-cproc list->compiled-code (codelist maxstack::<int>
+                                    reqargs::<uint16> optargs::<uint16>
+                                    name signature-info)
+   Scm_ListToCompiledCode)
 
  (define-cproc make-compiled-code-builder (reqargs::<uint16> optargs::<uint16>
                                            name parent intform)
@@ -55,7 +55,7 @@
  (define-cise-stmt dict-update!
    [(_ dict searcher xtractor cc) ;; assumes key, proc, and fallback
     `(let* ([e::ScmDictEntry*]
-            [data::(.array void* (1))])
+            [data::(.array void* (3))])
        (cond [(SCM_UNBOUNDP fallback)
               (set! e (,searcher (,xtractor ,dict) (cast intptr_t key)
                                  SCM_DICT_GET))
@@ -65,8 +65,12 @@
                                  SCM_DICT_CREATE))
               (unless (-> e value)
                 (cast void (SCM_DICT_SET_VALUE e fallback)))])
-       (set! (aref data 0) (cast void* e))
-       (Scm_VMPushCC ,cc data 1)
+       ;; CC receives the entry, as well as the dictionary and the key
+       ;; in case the entry may be invalidated by PROC.
+       (set! (aref data 0) (cast void* e)
+             (aref data 1) (cast void* ,dict)
+             (aref data 2) (cast void* key))
+       (Scm_VMPushCC ,cc data 3)
        (return (Scm_VMApply1 proc (SCM_DICT_VALUE e))))])
 
  (define-cise-stmt dict-push!
@@ -280,9 +284,13 @@
   (return (dict-exists? hash Scm_HashTableRef)))
 
 (inline-stub
+ ;; NB: The entry of eq?, eqv? and string=? tables may be moved if PROC
+ ;; modifies the table, so we search the entry again.  If PROC deleted
+ ;; the key, we don't add it back.
  (define-cfn hash-table-update-cc (result (data :: void**)) :static
-   (let* ([e::ScmDictEntry* (cast ScmDictEntry* (aref data 0))])
-     (cast void (SCM_DICT_SET_VALUE e result))
+   (let* ([hash::ScmHashTable* (cast ScmHashTable* (aref data 1))]
+          [key (SCM_OBJ (aref data 2))])
+     (Scm_HashTableSet hash key result SCM_DICT_NO_CREATE)
      (return result)))
  )
 
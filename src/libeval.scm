@@ -36,7 +36,8 @@
 (inline-stub
  (declcode (.include <gauche/vminsn.h>
                      <gauche/class.h>
-                     <gauche/priv/readerP.h>)))
+                     <gauche/priv/readerP.h>
+                     <gauche/priv/moduleP.h>)))
 
 (declare (keep-private-macro autoload add-load-path))
 
@@ -85,13 +86,20 @@
                 (make-string (* (length (current-load-history)) 2) #\space)
                 path
                 (if hooked? " (hooked) " "")))
-      (if (not (input-port? port))
-        (and error-if-not-found (raise port))
+      (cond
+       [(not (input-port? port)) (and error-if-not-found (raise port))]
+       [(and (not hooked?) (%load-cache-file path environment))
+        => (^[cache]
+             (%load-with-cache (if ignore-coding
+                                 port
+                                 (open-coding-aware-port port))
+                               path cache environment remaining-paths))]
+       [else
         (load-from-port (if ignore-coding
                           port
                           (open-coding-aware-port port))
                         :environment environment
-                        :paths remaining-paths)))))
+                        :paths remaining-paths)]))))
 
 
 (select-module gauche.internal)
@@ -100,6 +108,16 @@
 (define-in-module gauche (load-from-port port
                                          :key (paths #f)
                                               (environment #f))
+  (%load-from-port port paths environment
+                   (^[]
+                     (do ([s (read port) (read port)])
+                         [(eof-object? s)]
+                       (eval s #f))))
+  #t)
+
+;; Sets up the context to load from PORT, and calls THUNK.  Returns
+;; what THUNK returns.
+(define (%load-from-port port paths environment thunk)
   (unless (input-port? port)
     (error "input port required, but got:" port))
   (unless (or (module? environment) (not environment))
@@ -139,21 +157,18 @@
       (%record-load-stat #f)
       (%port-unlock! port))
 
-    (guard (e [else (let1 e2 (if (condition? e)
-                               ($ make-compound-condition e
-                                  $ make <load-condition-mixin>
-                                  :history (current-load-history)
-                                  :port (current-load-port)
-                                  :expr #f)
-                               e)
-                      (restore-load-context)
-                      (raise e2))])
-      (setup-load-context)
-      (do ([s (read port) (read port)])
-          [(eof-object? s)]
-        (eval s #f)))
-    (restore-load-context)
-    #t))
+    (rlet1 r (guard (e [else (let1 e2 (if (condition? e)
+                                        ($ make-compound-condition e
+                                           $ make <load-condition-mixin>
+                                           :history (current-load-history)
+                                           :port (current-load-port)
+                                           :expr #f)
+                                        e)
+                               (restore-load-context)
+                               (raise e2))])
+               (setup-load-context)
+               (thunk))
+      (restore-load-context))))
 
 ;; A few helper procedures
 (define-cproc %record-load-stat (path) ::<void>
@@ -169,17 +184,298 @@
                       (?: (SCM_FALSEP path) t (Scm_Cons path t))
                       (ref (-> vm stat) loadStat)))))))))
 
-(define-cproc %new-read-context-for-load ()
+(define-cproc %new-read-context-for-load (:optional (source-info::<boolean> #t))
   (let* ([ctx::ScmReadContext* (Scm_MakeReadContext NULL)])
-    (set! (-> ctx flags)
-          (logior (-> ctx flags)
-                  (logior RCTX_LITERAL_IMMUTABLE
-                          RCTX_SOURCE_INFO)))
+    (set! (-> ctx flags) (logior (-> ctx flags) RCTX_LITERAL_IMMUTABLE))
+    (when source-info
+      (set! (-> ctx flags) (logior (-> ctx flags) RCTX_SOURCE_INFO)))
     (return (SCM_OBJ ctx))))
 
 (define-cproc %load-verbose? () ::<boolean>
   (return (SCM_VM_RUNTIME_FLAG_IS_SET (Scm_VM) SCM_LOAD_VERBOSE)))
 
+;;;
+;;; Load cache
+;;;
+
+;; If the environment variable GAUCHE_LOAD_CACHE names a directory, `load'
+;; saves the compiled code of the loaded files in it, and uses them
+;; instead of reading and compiling the source next time.
+;;
+;; The cache of /path/to/foo.scm is <cache-dir>/path/to/foo.scm.cache.
+;; It is a text file:
+;;
+;;   (gauche-load-cache <key> ...)
+;;   <entry> ...
+;;
+;; The header is valid as long as Gauche, the source file's mtime and size,
+;; and the initial module are the same.  Each <entry> corresponds to a
+;; toplevel form of the source, and is either (code . <encoded-code>) or
+;; (eval . <form>).  We save the form itself if compiling it alters
+;; the global environment (e.g. define-syntax, define-module, select-module
+;; and use), for such effects aren't in the compiled code; or if the compiled
+;; code can't be written out (e.g. it has a procedure as a literal).
+;;
+;; Like precompiled code, the cached code doesn't have debug info, and
+;; it isn't invalidated when a macro or an inlinable procedure defined in
+;; other files is changed.
+
+(define *load-cache-directory* #f) ; #f: not initialized, "": disabled
+
+;; Returns the cache directory, or #f if load cache is disabled.
+;; With DIR, sets the cache directory (#f to disable).  For testing.
+(define (%load-cache-directory :optional (dir (undefined)))
+  (unless (undefined? dir)
+    (set! *load-cache-directory*
+          (if dir (sys-normalize-pathname dir :absolute #t) "")))
+  (unless *load-cache-directory*
+    (set! *load-cache-directory*
+          (if-let1 d (sys-getenv "GAUCHE_LOAD_CACHE")
+            (if (equal? d "") "" (sys-normalize-pathname d :absolute #t))
+            "")))
+  (and (not (equal? *load-cache-directory* "")) *load-cache-directory*))
+
+;; Returns the cache file name of PATH, or #f if we don't use the cache.
+(define (%load-cache-file path environment)
+  (and-let* ([dir (%load-cache-directory)]
+             [ (module-name (or environment (vm-current-module))) ]
+             [abs (sys-normalize-pathname path :absolute #t :canonicalize #t)])
+    (string-append dir "/"
+                   (regexp-replace-all #/:/ (regexp-replace #/^\// abs "") "_")
+                   ".cache")))
+
+(define-cproc %load-cache-version ()
+  (return (SCM_LIST4 (SCM_MAKE_STR GAUCHE_VERSION)
+                     (SCM_MAKE_STR_IMMUTABLE (Scm_HostArchitecture))
+                     (SCM_MAKE_INT SCM_VM_NUM_INSNS)
+                     (Scm_MakeIntegerU (-> (Scm_VM) compilerFlags)))))
+
+(define-cproc %module-stamp () ::<ulong> Scm__ModuleStamp)
+
+(define (%load-with-cache port path cache environment paths)
+  (let* ([st (sys-stat path)]
+         [key `(gauche-load-cache ,(%load-cache-version)
+                                  ,(symbol? :a) ; keyword-symbol mode
+                                  ,path
+                                  ,(slot-ref st 'mtime)
+                                  ,(slot-ref st 'size)
+                                  ,(module-name
+                                    (or environment (vm-current-module))))])
+    (if-let1 in (%open-load-cache cache key)
+      (%load-from-port port paths environment
+                       (^[] (unwind-protect (%run-load-cache in)
+                              (close-port in))))
+      ($ %write-load-cache cache key (slot-ref st 'mtime)
+         $ %load-from-port port paths environment
+         (^[] (%load-and-record port))))
+    #t))
+
+;; Returns an input port to read the entries if CACHE is valid for KEY.
+(define (%open-load-cache cache key)
+  (and-let* ([ (file-is-regular? cache) ]
+             [in (open-input-file cache :if-does-not-exist #f)])
+    (if (equal? (guard (e [else #f]) (read in)) key)
+      in
+      (begin (close-port in) #f))))
+
+(define (%run-load-cache in)
+  (current-read-context (%new-read-context-for-load #f))
+  (let loop ()
+    (let1 entry (read in)
+      (unless (eof-object? entry)
+        (if (eq? (car entry) 'code)
+          ((make-toplevel-closure (%decode-compiled-code (cdr entry))))
+          (eval (cdr entry) #f))
+        (loop)))))
+
+;; Loads toplevel forms from PORT as load-from-port does, while
+;; recording the cache entries.  Returns the list of entries, or #f
+;; if the file can't be cached.
+(define (%load-and-record port)
+  (let loop ([entries '()] [ok #t])
+    (let1 form (read port)
+      (if (eof-object? form)
+        (and ok (reverse! entries))
+        (let* ([mod (vm-current-module)]
+               [stamp (%module-stamp)]
+               [code (compile form #f)]
+               [entry (and ok
+                           (or (and (not (%load-cache-eval-form? form))
+                                    (eq? mod (vm-current-module))
+                                    (= stamp (%module-stamp))
+                                    (not (%load-cache-unsafe-form? form))
+                                    (and-let1 c (%encode-compiled-code code)
+                                      `(code . ,c)))
+                               (and (%load-cache-literal? form #f)
+                                    `(eval . ,form))))])
+          ((make-toplevel-closure code))
+          (if entry
+            (loop (cons entry entries) ok)
+            (loop '() #f)))))))
+
+;; These forms have effects at compile time, which may be no-op when
+;; we record the file (e.g. require of a feature already provided, or
+;; export of names already exported) but are needed when the cache is
+;; replayed in a fresh process.  So we always keep them as source.
+;; We also look into the toplevel forms that may contain them.
+(define (%load-cache-eval-form? form)
+  (define (any-form? xs)
+    (and (pair? xs)
+         (or (%load-cache-eval-form? (car xs))
+             (any-form? (cdr xs)))))
+  (and (pair? form)
+       (case (car form)
+         [(require define-module export export-all import use extend
+           select-module define-syntax define-macro define-library) #t]
+         [(begin) (any-form? (cdr form))]
+         [(when unless) (and (pair? (cdr form)) (any-form? (cddr form)))]
+         [(cond-expand)
+          (let loop ([clauses (cdr form)])
+            (and (pair? clauses)
+                 (or (and (pair? (car clauses)) (any-form? (cdar clauses)))
+                     (loop (cdr clauses)))))]
+         [else #f])))
+
+;; Compiling these forms depends on other files, or may change the
+;; global state in a way we can't detect.
+(define (%load-cache-unsafe-form? form)
+  (let rec ([x form])
+    (cond [(pair? x) (or (rec (car x)) (rec (cdr x)))]
+          [else (memq x '(include include-ci eval-when))])))
+
+(define (%write-load-cache cache key mtime entries)
+  ;; We don't cache a file modified just now, since it may be modified
+  ;; again within the resolution of mtime.
+  (when (and entries (< mtime (- (sys-time) 1)))
+    (let1 tmp #"~|cache|.~(sys-getpid).tmp"
+      (guard (e [else (sys-unlink tmp)]) ; if we can't write, just give up
+        (%make-directory* (sys-dirname cache))
+        (call-with-output-file tmp
+          (^[out]
+            (write key out) (newline out)
+            (dolist [e entries] (write e out) (newline out))))
+        (sys-rename tmp cache)))))
+
+(define (%make-directory* dir)
+  (unless (file-is-directory? dir)
+    (%make-directory* (sys-dirname dir))
+    (guard (e [(file-is-directory? dir)]) ; another process may have made it
+      (sys-mkdir dir #o755))))
+
+;; Returns #t iff OBJ can be written out and read back to an equal object.
+(define (%load-cache-literal? obj uninterned-ok?)
+  (let1 seen (make-hash-table 'eq?)
+    (let rec ([x obj])
+      (cond [(or (null? x) (boolean? x) (char? x) (number? x) (string? x)
+                 (keyword? x) (char-set? x) (regexp? x))
+             #t]
+            [(symbol? x) (or uninterned-ok? (symbol-interned? x))]
+            [(or (pair? x) (vector? x))
+             (or (hash-table-exists? seen x)
+                 (begin
+                   (hash-table-put! seen x #t)
+                   (if (pair? x)
+                     (and (rec (car x)) (rec (cdr x)))
+                     (let loop ([i 0])
+                       (or (= i (vector-length x))
+                           (and (rec (vector-ref x i)) (loop (+ i 1))))))))]
+            [else #f]))))
+
+;; Encoding compiled code.  Returns #f if CODE can't be encoded.
+;; The encoded code is a vector:
+;;   #(<name> <reqargs> <optargs> <maxstack> <signature> <code-list>)
+;; <code-list> is what vm-code->list returns, with each operand encoded:
+;;   (q . <literal>)
+;;   (i <name> . <module-name>)   ; identifier
+;;   (m . <module-name>)          ; module
+;;   (c . <encoded-code>)         ; compiled code
+;;   (u)                          ; #<undef>
+;; An operand of LOCAL-ENV-CLOSURES is a list of encoded objects.
+(define (%encode-compiled-code code)
+  (let/cc return
+    (define (enc-obj x)
+      (cond [(identifier? x)
+             (let ([name (identifier->symbol x)]
+                   [mod (identifier-module x)])
+               (unless (and (null? (identifier-env x))
+                            (symbol-interned? name)
+                            (module-name mod))
+                 (return #f))
+               `(i ,name . ,(module-name mod)))]
+            [(module? x) (if (module-name x) `(m . ,(module-name x)) (return #f))]
+            [(is-a? x <compiled-code>) `(c . ,(enc-code x))]
+            [(undefined? x) '(u)]
+            [(%load-cache-literal? x #f) `(q . ,x)]
+            [else (return #f)]))
+    (define (enc-code code)
+      (when (slot-ref code 'intermediate-form) (return #f))
+      (vector (enc-name (slot-ref code 'name))
+              (slot-ref code 'required-args)
+              (slot-ref code 'optional-args)
+              (slot-ref code 'max-stack)
+              (enc-signature (slot-ref code 'signature-info))
+              (enc-code-list (vm-code->list code))))
+    (define (enc-code-list cv)
+      (let loop ([cv cv] [r '()])
+        (if (null? cv)
+          (reverse! r)
+          (let1 insn (car cv)
+            (case (vm-insn-operand-type (vm-insn-name->code (car insn)))
+              [(none) (loop (cdr cv) (cons insn r))]
+              [(addr) (loop (cddr cv) (list* (cadr cv) insn r))]
+              [(obj code) (loop (cddr cv) (list* (enc-obj (cadr cv)) insn r))]
+              [(codes) (loop (cddr cv) (list* (map enc-obj (cadr cv)) insn r))]
+              [(obj+addr) (loop (cdddr cv)
+                                (list* (caddr cv) (enc-obj (cadr cv)) insn r))]
+              [else (return #f)])))))
+    (define (enc-name name)
+      (let1 n (unwrap-syntax name)
+        (and (%load-cache-literal? n #t) n)))
+    ;; Signature info is (<sig>), where <sig> is (<name> . <args>) with
+    ;; source-info pair attribute.  We save it as (<source-info> . <sig>).
+    (define (enc-signature sig)
+      (and-let* ([ (pair? sig) ]
+                 [ (pair? (car sig)) ]
+                 [s (unwrap-syntax (car sig))]
+                 [ (%load-cache-literal? s #t) ])
+        (let1 si (pair-attribute-get (car sig) 'source-info #f)
+          (cons (and (%load-cache-literal? si #f) si) s))))
+    (enc-code code)))
+
+(define (%decode-compiled-code v)
+  (define (dec-obj x)
+    (case (car x)
+      [(q) (cdr x)]
+      [(i) (make-identifier (cadr x) (%find-module-create (cddr x)) '())]
+      [(m) (%find-module-create (cdr x))]
+      [(c) (%decode-compiled-code (cdr x))]
+      [(u) (undefined)]
+      [else (error "bad load cache entry:" x)]))
+  (define (dec-code-list cv)
+    (let loop ([cv cv] [r '()])
+      (if (null? cv)
+        (reverse! r)
+        (let1 insn (car cv)
+          (case (vm-insn-operand-type (vm-insn-name->code (car insn)))
+            [(none) (loop (cdr cv) (cons insn r))]
+            [(addr) (loop (cddr cv) (list* (cadr cv) insn r))]
+            [(obj code) (loop (cddr cv) (list* (dec-obj (cadr cv)) insn r))]
+            [(codes) (loop (cddr cv) (list* (map dec-obj (cadr cv)) insn r))]
+            [(obj+addr) (loop (cdddr cv)
+                              (list* (caddr cv) (dec-obj (cadr cv)) insn r))])))))
+  (define (dec-signature s)
+    (and s
+         (let1 sig (extended-cons (cadr s) (cddr s))
+           (when (car s)
+             (pair-attribute-set! sig 'source-info (car s)))
+           (list sig))))
+  (list->compiled-code (dec-code-list (vector-ref v 5))
+                       (vector-ref v 3) (vector-ref v 1) (vector-ref v 2)
+                       (vector-ref v 0) (dec-signature (vector-ref v 4))))
+
+(define (%find-module-create name)
+  (or (find-module name) (make-module name)))
+
 ;; Called from Scm_DynLoad to get initfn name, which always begins with #\_.
 ;; If INITFN is given, we just add "_" in front of it.  Otherwise we
 ;; derive it from the name of DSO.
@@ -539,6 +835,13 @@
   ((with-module gauche.internal %show-stack-trace)
    trace port maxdepth skip offset))
 
+;; API
+;; Instruction counting.  See src/vmstat.c for the format of the snapshot.
+(define-cproc vm-insn-counting-start () ::<void> Scm_VMInsnCountingStart)
+(define-cproc vm-insn-counting-stop () ::<void> Scm_VMInsnCountingStop)
+(define-cproc vm-insn-counting-reset () ::<void> Scm_VMInsnCountingReset)
+(define-cproc vm-insn-counting-snapshot () Scm_VMInsnCountingSnapshot)
+
 (select-module gauche.internal)
 (define-cproc %vm-get-insn-offsets () Scm__VMInsnOffsets)
 
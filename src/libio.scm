@@ -426,14 +426,28 @@
     (PORT_LOCK port vm)))
 (define-cproc %port-unlock! (port::<port>) ::<void>
   (PORT_UNLOCK port))
+;; Returns #t iff the calling thread holds the lock of PORT.
+;; Private ports are always locked by their owners.
+(define-cproc %port-locked? (port::<port>) ::<boolean>
+  (return (PORT_LOCKED port (Scm_VM))))
+
+;; Used by copy-port.  Both ports must be locked.  Returns the number of
+;; bytes copied, or #f if the ports aren't file ports.
+(define-cproc %copy-file-port (src::<port> dst::<port> size::<long>)
+  (let* ([n::ScmSmallInt (Scm__CopyFilePort src dst size)])
+    (return (?: (< n 0) SCM_FALSE (Scm_MakeInteger n)))))
 
 ;; Passing extra args is unusual for with-* style, but it can allow avoiding
 ;; closure allocation and may be useful for performance-sensitive parts.
+;; If we already hold the lock, whoever acquired it will release it,
+;; so we don't need to set up unwind-protect.
 (define-in-module gauche (with-port-locking port proc . args)
-  (unwind-protect
-      (begin (%port-lock! port)
-             (apply proc args))
-    (%port-unlock! port)))
+  (if (%port-locked? port)
+    (apply proc args)
+    (unwind-protect
+        (begin (%port-lock! port)
+               (apply proc args))
+      (%port-unlock! port))))
 
 (define-in-module gauche.internal ; used by two-pass output
   (%with-2pass-setup port walker emitter . args)
@@ -564,6 +578,13 @@
                          :optional (port (current-input-port)))
   (return (Scm_ReadList port closer)))
 
+(select-module gauche.internal)
+;; Reads all data until EOF, locking the port only once.
+;; Used by port->sexp-list.
+(define-cproc %read-all (port::<input-port>)
+  (return (Scm_ReadAll (SCM_OBJ port))))
+(select-module gauche)
+
 (define-cproc port->byte-string (port::<input-port>)
   (let* ([ds::ScmDString] [buf::(.array char (1024))])
     (Scm_DStringInit (& ds))
@@ -102,6 +102,22 @@
   (when (SCM_BIGNUMP obj)
     (Scm_DumpBignum (SCM_BIGNUM obj) SCM_CUROUT)))
 
+;; Get/set the operand sizes, in words, to switch bignum multiplication
+;; to Karatsuba and Toom-3.  For tuning; see test/bignum-performance.scm.
+(define-cproc %bignum-mul-thresholds (:optional (karatsuba::<fixnum> 0)
+                                                (toom3::<fixnum> 0))
+  ::(<int> <int>)
+  (let* ([k::int karatsuba] [t::int toom3])
+    (Scm__BignumMulThresholds (& k) (& t))
+    (return k t)))
+
+;; Turn on/off the fast paths of flonum printing and reading, if FLAG is
+;; given.  Returns the previous setting.  For testing; see test/number.scm.
+(define-cproc %fast-flonum-conversion (:optional flag) ::<boolean>
+  (if (SCM_UNBOUNDP flag)
+    (return (Scm__FastFlonumConversion -1))
+    (return (Scm__FastFlonumConversion (not (SCM_FALSEP flag))))))
+
 ;;
 ;; Comparison
 ;;
@@ -39,6 +39,7 @@
            "#include <gauche/vminsn.h>")
  (define-type <slot-accessor> "ScmSlotAccessor*")
  (define-type <method> "ScmMethod*")
+ (define-type <generic> "ScmGeneric*")
  )
 
 ;; This module is not meant to be `use'd.   It is just to hide
@@ -654,6 +655,10 @@
               classes)
     (return (Scm_MethodApplicableForClasses m cp argc))))
 
+;; Returns a plist of dispatch cache statistics of a generic function;
+;; :hits, :misses, :num-entries and :num-buckets.
+(define-cproc generic-dispatch-stat (gf::<generic>) Scm_GenericDispatchStat)
+
 ;;----------------------------------------------------------------
 ;; Introspection routines
 ;;
@@ -833,7 +838,7 @@
                 slot-exists? slot-exists-using-class?
                 change-class
                 apply-generic sort-applicable-methods
-                apply-methods apply-method
+                apply-methods apply-method generic-dispatch-stat
                 class-of current-class-of is-a? subtype? slot-ref slot-set!
                 slot-bound? slot-ref-using-accessor slot-bound-using-accessor?
                 slot-set-using-accessor! slot-initialize-using-accessor!
@@ -211,7 +211,10 @@
 ;;;
 
 (select-module gauche)
-(define-cproc profiler-start () ::<void> Scm_ProfilerStart)
+(define-cproc profiler-start (:optional (all-threads::<boolean> #f)) ::<void>
+  (if all-threads
+    (Scm_ProfilerStartAllThreads)
+    (Scm_ProfilerStart)))
 (define-cproc profiler-stop  () ::<int>  Scm_ProfilerStop)
 (define-cproc profiler-reset () ::<void> Scm_ProfilerReset)
 
@@ -219,6 +222,8 @@
 ;; Autoloaded profiler-get-result will use this.
 ;; See lib/gauche/vm/profiler.scm
 (define-cproc profiler-raw-result () Scm_ProfilerRawResult)
+(define-cproc profiler-raw-thread-results () Scm_ProfilerRawThreadResults)
+(define-cproc profiler-raw-stacks () Scm_ProfilerRawStacks)
 
 ;;;
 ;;; Introspection
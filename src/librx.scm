@@ -39,12 +39,19 @@
 (define-cproc regexp? (obj)   ::<boolean> :constant SCM_REGEXPP)
 (define-cproc regmatch? (obj) ::<boolean> SCM_REGMATCHP)
 
-(define-cproc string->regexp (str::<string> :key (case-fold #f))
+(define-cproc string->regexp (str::<string> :key (case-fold #f) (engine #f))
   (let* ([flags::int (?: (SCM_BOOL_VALUE case-fold) SCM_REGEXP_CASE_FOLD 0)])
+    (cond [(SCM_EQ engine 'backtrack) (logior= flags SCM_REGEXP_BACKTRACK)]
+          [(SCM_EQ engine 'dfa) (logior= flags SCM_REGEXP_DFA)]
+          [(not (or (SCM_FALSEP engine) (SCM_EQ engine 'auto)))
+           (Scm_Error "engine must be either auto, backtrack or dfa, \
+                       but got: %S" engine)])
     (return (Scm_RegComp str flags))))
 (define-cproc regexp-ast (regexp::<regexp>) (return (-> regexp ast)))
 (define-cproc regexp-case-fold? (regexp::<regexp>) ::<boolean>
   (return (logand (-> regexp flags) SCM_REGEXP_CASE_FOLD)))
+(define-cproc regexp-engine (regexp::<regexp>)
+  (return (?: (-> regexp dfa) 'dfa 'backtrack)))
 
 (define-cproc regexp-parse (str::<string> :key (case-fold #f))
   (let* ([flags::int (?: (SCM_BOOL_VALUE case-fold) SCM_REGEXP_CASE_FOLD 0)])
@@ -324,6 +324,9 @@ void cleanup_main(void *data)
                 (vm->stat.sovCount > 0?
                  (double)(vm->stat.sovTime/vm->stat.sovCount)/1000.0 :
                  0.0));
+        fprintf(stderr,
+                ";;  env frames moved to heap: %lu\n",
+                Scm__VMEnvSaveCount());
     }
 
     /* EXPERIMENTAL */
@@ -36,6 +36,7 @@
 #include "gauche/class.h"
 #include "gauche/priv/builtin-syms.h"
 #include "gauche/priv/moduleP.h"
+#include "gauche/priv/lftableP.h"
 
 /*
  * Modules
@@ -126,6 +127,183 @@ static struct {
                                lookup_module may hold the lock. */
 } modules;
 
+/* Module state stamp.
+ * Incremented whenever a binding is created or redefined, a named module
+ * is created, or the binding generation is bumped.  Unlike the binding
+ * generation, this also catches the changes that don't affect binding
+ * resolution, e.g. redefining an existing macro.  The load cache compares
+ * it before and after compiling a toplevel form to see if the compiler
+ * changed the global environment.  See libeval.scm.
+ * Modified only while modules.mutex is held.
+ */
+static AO_t moduleStamp = 1;
+
+#define BUMP_MODULE_STAMP() \
+    AO_store(&moduleStamp, AO_load(&moduleStamp)+1)
+
+u_long Scm__ModuleStamp(void)
+{
+    return (u_long)AO_load(&moduleStamp);
+}
+
+/* Binding generations.
+ * The result of global binding resolution of a symbol S may change when
+ * a new gloc of S is inserted in a module's table, or when the import
+ * list or the precedence list of a module is modified.  The former bumps
+ * the generation of S, and the latter bumps the global generation.
+ * Changing the value of an existing gloc doesn't count.
+ * We don't have a room for the generation in ScmSymbol, so we keep it in
+ * a small array indexed by the hash of the symbol; symbols sharing the
+ * same slot just invalidate each other's cache.  See "Binding cache"
+ * below.
+ * Modified only while modules.mutex is held.
+ */
+static AO_t bindingGeneration = 1;
+
+#define SYMBOL_GENERATION_SLOTS  1024   /* must be a power of 2 */
+static AO_t symbolGenerations[SYMBOL_GENERATION_SLOTS];
+
+static inline AO_t *symbol_generation(ScmSymbol *symbol)
+{
+    /* The upper bits of the address hash are better distributed. */
+    u_long h = Scm_EqHash(SCM_OBJ(symbol));
+    return &symbolGenerations[(h >> 22) & (SYMBOL_GENERATION_SLOTS-1)];
+}
+
+#define BUMP_BINDING_GENERATION()                                        \
+    do {                                                                \
+        AO_store_release(&bindingGeneration, AO_load(&bindingGeneration)+1); \
+        BUMP_MODULE_STAMP();                                            \
+    } while (0)
+
+#define BUMP_SYMBOL_GENERATION(sym)                                     \
+    do {                                                                \
+        AO_t *g__ = symbol_generation(sym);                             \
+        AO_store_release(g__, AO_load(g__)+1);                          \
+        BUMP_MODULE_STAMP();                                            \
+    } while (0)
+
+/* Binding cache.
+ * Maps (module, symbol) to the result of the global binding search, so
+ * that resolving the same global variable again (e.g. by the compiler)
+ * doesn't walk the imported modules.  The result is tagged with the
+ * global generation and the generation of the symbol, both read before
+ * the search; it's valid while both stay the same.
+ * We don't cache a search that looked up a different name on the way,
+ * that is, through a prefixed import or a renamed export, since a change
+ * of the binding of that name doesn't bump the generation of the symbol
+ * we're looking for.  Neither do we cache searches in anonymous modules
+ * or of uninterned symbols, for the cache would keep them from being
+ * collected.
+ */
+typedef struct BindingCacheRec {
+    ScmGloc *gloc;              /* may be NULL */
+    u_long generation;
+    u_long symbolGeneration;
+} BindingCache;
+
+typedef struct BindingCacheEntryRec {
+    ScmLFEntry hdr;
+    ScmModule *module;
+    ScmSymbol *symbol;
+    AO_t cache;                 /* BindingCache*; set with the mutex */
+} BindingCacheEntry;
+
+#define BINDING_CACHE_INITIAL_BUCKETS  1024
+#define BINDING_CACHE_MAX_AVG_CHAIN    2
+#define BINDING_CACHE_EXTEND_FACTOR    4
+
+static struct {
+    AO_t table;                 /* ScmLFTable* of BindingCacheEntry */
+    ScmInternalMutex mutex;
+} bindingCache = { 0, SCM_INTERNAL_MUTEX_INITIALIZER };
+
+static inline u_long binding_cache_hash(ScmModule *module, ScmSymbol *symbol)
+{
+    u_long h = Scm_CombineHashValue(Scm_EqHash(SCM_OBJ(module)),
+                                    Scm_EqHash(SCM_OBJ(symbol)));
+    return h ^ (h >> 16);
+}
+
+static BindingCacheEntry *binding_cache_lookup(ScmLFTable *t,
+                                               ScmModule *module,
+                                               ScmSymbol *symbol,
+                                               u_long hashval)
+{
+    for (ScmLFEntry *e = Scm__LFTableChain(t, hashval); e; e = e->next) {
+        BindingCacheEntry *be = (BindingCacheEntry*)e;
+        if (e->hashval == hashval
+            && be->module == module && be->symbol == symbol) {
+            return be;
+        }
+    }
+    return NULL;
+}
+
+static ScmLFEntry *binding_cache_copy(const ScmLFEntry *e)
+{
+    const BindingCacheEntry *be = (const BindingCacheEntry*)e;
+    BindingCacheEntry *ne = SCM_NEW(BindingCacheEntry);
+    ne->module = be->module;
+    ne->symbol = be->symbol;
+    ne->cache = AO_load(&be->cache);
+    return &ne->hdr;
+}
+
+/* Returns the cached result of the search of SYMBOL in MODULE, or
+   SCM_UNBOUND if it's not cached. */
+static ScmObj binding_cache_ref(ScmModule *module, ScmSymbol *symbol,
+                                u_long gen, u_long symgen)
+{
+    ScmLFTable *t = (ScmLFTable*)Scm__LFLoad(&bindingCache.table);
+    if (t == NULL) return SCM_UNBOUND;
+    BindingCacheEntry *e =
+        binding_cache_lookup(t, module, symbol,
+                             binding_cache_hash(module, symbol));
+    if (e == NULL) return SCM_UNBOUND;
+    BindingCache *c = (BindingCache*)Scm__LFLoad(&e->cache);
+    if (c->generation != gen || c->symbolGeneration != symgen) {
+        return SCM_UNBOUND;
+    }
+    return SCM_OBJ(c->gloc);    /* NB: may be NULL */
+}
+
+static void binding_cache_set(ScmModule *module, ScmSymbol *symbol,
+                              ScmGloc *gloc, u_long gen, u_long symgen)
+{
+    if (SCM_FALSEP(module->name) || !SCM_SYMBOL_INTERNED(symbol)) return;
+
+    u_long hashval = binding_cache_hash(module, symbol);
+    BindingCache *c = SCM_NEW(BindingCache);
+    c->gloc = gloc;
+    c->generation = gen;
+    c->symbolGeneration = symgen;
+
+    (void)SCM_INTERNAL_MUTEX_LOCK(bindingCache.mutex);
+    ScmLFTable *t = (ScmLFTable*)AO_load(&bindingCache.table);
+    if (t == NULL) {
+        t = Scm__LFTableNew(BINDING_CACHE_INITIAL_BUCKETS);
+        Scm__LFPublish(&bindingCache.table, t);
+    }
+    BindingCacheEntry *e = binding_cache_lookup(t, module, symbol, hashval);
+    if (e == NULL) {
+        if (t->numEntries >= t->numBuckets*BINDING_CACHE_MAX_AVG_CHAIN) {
+            t = Scm__LFTableRehash(t,
+                                   t->numBuckets*BINDING_CACHE_EXTEND_FACTOR,
+                                   binding_cache_copy);
+            Scm__LFPublish(&bindingCache.table, t);
+        }
+        e = SCM_NEW(BindingCacheEntry);
+        e->module = module;
+        e->symbol = symbol;
+        e->cache = (AO_t)c;
+        Scm__LFTableAdd(t, &e->hdr, hashval);
+    } else {
+        Scm__LFPublish(&e->cache, c);
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(bindingCache.mutex);
+}
+
 /* Predefined modules - slots will be initialized by Scm__InitModule */
 #define DEFINE_STATIC_MODULE(cname) \
     static ScmModule cname = { { NULL } }
@@ -192,12 +370,15 @@ static ScmModule *lookup_module_create(ScmSymbol *name, int *created)
                                          SCM_DICT_CREATE);
     if (e->value == 0) {
         (void)SCM_DICT_SET_VALUE(e, make_module(SCM_OBJ(name), NULL));
+        BUMP_MODULE_STAMP();
         *created = TRUE;
     } else {
         *created = FALSE;
     }
+    /* NB: E may be invalidated once we release the lock */
+    ScmModule *m = SCM_MODULE(e->value);
     (void)SCM_INTERNAL_MUTEX_UNLOCK(modules.mutex);
-    return SCM_MODULE(e->value);
+    return m;
 }
 
 ScmObj Scm_MakeModule(ScmSymbol *name, int error_if_exists)
@@ -300,10 +481,12 @@ static inline void module_add_visited(module_cache *c, ScmModule *m)
    we need recursive searching in case of phantom binding (see gloc.h
    about phantom bindings).  The flags stay_in_module and external_only
    corresponds to the flags passed to Scm_FindBinding.  The exclude_self
-   flag is only used in recursive search. */
+   flag is only used in recursive search.  If we look up a name other
+   than SYMBOL on the way, *RENAMED is set to TRUE (see "Binding cache"
+   above). */
 static ScmGloc *search_binding(ScmModule *module, ScmSymbol *symbol,
                                int stay_in_module, int external_only,
-                               int exclude_self)
+                               int exclude_self, int *renamed)
 {
     module_cache searched;
     init_module_cache(&searched);
@@ -322,6 +505,7 @@ static ScmGloc *search_binding(ScmModule *module, ScmSymbol *symbol,
                    when we search inherited modules we look into it's
                    internal bindings. */
                 external_only = FALSE;
+                if (symbol != SCM_GLOC(v)->name) *renamed = TRUE;
                 symbol = SCM_GLOC(v)->name; /* in case it's renamed on export */
             } else {
                 return SCM_GLOC(v);
@@ -347,6 +531,7 @@ static ScmGloc *search_binding(ScmModule *module, ScmSymbol *symbol,
             ScmModule *m = SCM_MODULE(SCM_CAR(mp));
             if (!prefixed && module_visited_p(&searched, m)) continue;
             if (SCM_SYMBOLP(m->prefix)) {
+                *renamed = TRUE;
                 sym = Scm_SymbolSansPrefix(SCM_SYMBOL(sym),
                                            SCM_SYMBOL(m->prefix));
                 if (!SCM_SYMBOLP(sym)) break;
@@ -358,7 +543,9 @@ static ScmGloc *search_binding(ScmModule *module, ScmSymbol *symbol,
                 g = SCM_GLOC(v);
                 if (g->hidden) break;
                 if (SCM_GLOC_PHANTOM_BINDING_P(g)) {
-                    g = search_binding(m, g->name, FALSE, FALSE, TRUE);
+                    if (SCM_OBJ(g->name) != sym) *renamed = TRUE;
+                    g = search_binding(m, g->name, FALSE, FALSE, TRUE,
+                                       renamed);
                     if (g) return g;
                 } else {
                     return g;
@@ -375,6 +562,7 @@ static ScmGloc *search_binding(ScmModule *module, ScmSymbol *symbol,
         ScmModule *m = SCM_MODULE(SCM_CAR(mp));
 
         if (SCM_SYMBOLP(m->prefix)) {
+            *renamed = TRUE;
             ScmObj sym = Scm_SymbolSansPrefix(symbol, SCM_SYMBOL(m->prefix));
             if (!SCM_SYMBOLP(sym)) return NULL;
             symbol = SCM_SYMBOL(sym);
@@ -384,6 +572,7 @@ static ScmGloc *search_binding(ScmModule *module, ScmSymbol *symbol,
         if (SCM_GLOCP(v)) {
             if (SCM_GLOC_PHANTOM_BINDING_P(SCM_GLOC(v))) {
                 external_only = FALSE; /* See above comment */
+                if (symbol != SCM_GLOC(v)->name) *renamed = TRUE;
                 symbol = SCM_GLOC(v)->name; /* in case it's renamed on export */
             } else {
                 return SCM_GLOC(v);
@@ -397,11 +586,24 @@ ScmGloc *Scm_FindBinding(ScmModule *module, ScmSymbol *symbol, int flags)
 {
     int stay_in_module = flags&SCM_BINDING_STAY_IN_MODULE;
     int external_only = flags&SCM_BINDING_EXTERNAL;
+    int renamed = FALSE;
     ScmGloc *gloc = NULL;
 
+    /* NB: We must read the generations before searching. */
+    u_long gen = AO_load_acquire(&bindingGeneration);
+    u_long symgen = AO_load_acquire(symbol_generation(symbol));
+    if (flags == 0) {
+        ScmObj c = binding_cache_ref(module, symbol, gen, symgen);
+        if (!SCM_UNBOUNDP(c)) return SCM_GLOC(c);
+    }
+
     SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(modules.mutex);
-    gloc = search_binding(module, symbol, stay_in_module, external_only, FALSE);
+    gloc = search_binding(module, symbol, stay_in_module, external_only, FALSE,
+                          &renamed);
     SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+    if (flags == 0 && !renamed) {
+        binding_cache_set(module, symbol, gloc, gen, symgen);
+    }
     return gloc;
 }
 
@@ -452,7 +654,9 @@ ScmGloc *Scm_MakeBinding(ScmModule *module, ScmSymbol *symbol,
         if (module->exportAll && SCM_SYMBOL_INTERNED(symbol)) {
             Scm_HashTableSet(module->external, SCM_OBJ(symbol), SCM_OBJ(g), 0);
         }
+        BUMP_SYMBOL_GENERATION(symbol);
     }
+    BUMP_MODULE_STAMP();
     SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
 
     g->value = value;
@@ -507,6 +711,7 @@ void Scm_HideBinding(ScmModule *module, ScmSymbol *symbol)
         ScmGloc *g = SCM_GLOC(Scm_MakeGloc(symbol, module));
         g->hidden = TRUE;
         Scm_HashTableSet(module->external, SCM_OBJ(symbol), SCM_OBJ(g), 0);
+        BUMP_SYMBOL_GENERATION(symbol);
     }
     (void)SCM_INTERNAL_MUTEX_UNLOCK(modules.mutex);
 
@@ -550,6 +755,7 @@ int Scm_AliasBinding(ScmModule *target, ScmSymbol *targetName,
     SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(modules.mutex);
     Scm_HashTableSet(target->external, SCM_OBJ(targetName), SCM_OBJ(g), 0);
     Scm_HashTableSet(target->internal, SCM_OBJ(targetName), SCM_OBJ(g), 0);
+    BUMP_SYMBOL_GENERATION(targetName);
     SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
     return TRUE;
 }
@@ -603,6 +809,7 @@ ScmObj Scm_ImportModule(ScmModule *module,
             break;
         }
         module->imported = p;
+        BUMP_BINDING_GENERATION();
     }
     (void)SCM_INTERNAL_MUTEX_UNLOCK(modules.mutex);
 
@@ -667,8 +874,9 @@ ScmObj Scm_ExportSymbols(ScmModule *module, ScmObj specs)
                                                  SCM_OBJ(g->name),
                                                  SCM_OBJ(name)),
                                        overwritten);
-                Scm_HashCoreSearch(SCM_HASH_TABLE_CORE(module->external),
-                                   (intptr_t)exported_name, SCM_DICT_DELETE);
+                ScmDictEntry d;
+                Scm_HashCoreDelete(SCM_HASH_TABLE_CORE(module->external),
+                                   (intptr_t)exported_name, &d);
                 e = NULL;
             }
         }
@@ -682,9 +890,11 @@ ScmObj Scm_ExportSymbols(ScmModule *module, ScmObj specs)
             if (!e->value) {
                 ScmGloc *g = SCM_GLOC(Scm_MakeGloc(name, module));
                 (void)SCM_DICT_SET_VALUE(e, SCM_OBJ(g));
+                BUMP_SYMBOL_GENERATION(name);
             }
             Scm_HashTableSet(module->external, SCM_OBJ(exported_name),
                              SCM_DICT_VALUE(e), 0);
+            BUMP_SYMBOL_GENERATION(exported_name);
         }
     }
     (void)SCM_INTERNAL_MUTEX_UNLOCK(modules.mutex);
@@ -726,6 +936,7 @@ ScmObj Scm_ExportAll(ScmModule *module)
                 (void)SCM_DICT_SET_VALUE(ee, SCM_DICT_VALUE(e));
             }
         }
+        BUMP_BINDING_GENERATION();
     }
     (void)SCM_INTERNAL_MUTEX_UNLOCK(modules.mutex);
     return SCM_OBJ(module);
@@ -779,8 +990,12 @@ ScmObj Scm_ExtendModule(ScmModule *module, ScmObj supers)
     if (SCM_FALSEP(mpl)) {
         Scm_Error("can't extend those modules simultaneously because of inconsistent precedence lists: %S", supers);
     }
-    module->mpl = Scm_Cons(SCM_OBJ(module), mpl);
-    return module->mpl;
+    mpl = Scm_Cons(SCM_OBJ(module), mpl);
+    (void)SCM_INTERNAL_MUTEX_LOCK(modules.mutex);
+    module->mpl = mpl;
+    BUMP_BINDING_GENERATION();
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(modules.mutex);
+    return mpl;
 }
 
 /*----------------------------------------------------------------------
@@ -936,6 +1151,7 @@ void Scm__InitModule(void)
     const char **modname;
 
     (void)SCM_INTERNAL_MUTEX_INIT(modules.mutex);
+    (void)SCM_INTERNAL_MUTEX_INIT(bindingCache.mutex);
     modules.table = SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_EQ, 64));
 
     /* standard module chain */
@@ -3300,7 +3300,7 @@ static double dexpt2_minus_53  = 0.0;  /* 2.0^-53 */
 
 /* max N where 10.0^N can be representable exactly in double.
    it is max N where N * log2(5) < 53. */
-#define MAX_EXACT_10_EXP  23
+#define MAX_EXACT_10_EXP  22
 
 /* fast 10^n for limited cases */
 static inline ScmObj iexpt10(int e)
@@ -3381,6 +3381,255 @@ static inline int numcmp3(ScmObj x, ScmObj d, ScmObj y)
     }
 }
 
+/*
+ * Shortest representation by Ryu
+ *
+ *  Burger&Dybvig's algorithm in print_double works on bignums, so it's
+ *  slow.  If we have 128bit integer arithmetic, we first try Ryu (Ulf
+ *  Adams, "Ryu: Fast Float-to-String Conversion", PLDI '18), which finds
+ *  the same digits with a few multiplications of 64bit and 128bit
+ *  integers.  The tie-breaking rule is adjusted to match print_double.
+ *  We use it only for the free-format output (precision < 0).
+ *
+ *  Ryu's tables (128bit approximations of 5^i and 5^-i) are calculated
+ *  by Scm__InitNumber, using bignums.
+ */
+
+#if defined(__SIZEOF_INT128__)
+#define FAST_FLONUM_CONVERSION 1
+typedef unsigned __int128 u128_t;
+
+/* Turned off to compare the results with the slower paths in tests. */
+static int fast_flonum_conversion = TRUE;
+
+/* Splits nonnegative V < 2^128 into two 64bit words */
+static void split_u128(ScmObj v, uint64_t *hi, uint64_t *lo)
+{
+    ScmObj mask = Scm_Sub(Scm_Ash(SCM_MAKE_INT(1), 64), SCM_MAKE_INT(1));
+    *lo = Scm_GetIntegerU64Clamp(Scm_LogAnd(v, mask), SCM_CLAMP_NONE, NULL);
+    *hi = Scm_GetIntegerU64Clamp(Scm_Ash(v, -64), SCM_CLAMP_NONE, NULL);
+}
+
+#define RYU_POW5_BITCOUNT      125
+#define RYU_POW5_INV_BITCOUNT  125
+#define RYU_POW5_TABLESIZ      326
+#define RYU_POW5_INV_TABLESIZ  342
+
+static uint64_t ryu_pow5[RYU_POW5_TABLESIZ][2];         /* {lo, hi} */
+static uint64_t ryu_pow5_inv[RYU_POW5_INV_TABLESIZ][2]; /* {lo, hi} */
+
+static inline int32_t pow5bits(int32_t e)     /* bit length of 5^e */
+{
+    return (int32_t)(((uint32_t)e * 1217359) >> 19) + 1;
+}
+
+static inline uint32_t log10pow2(int32_t e)    /* floor(log10(2^e)) */
+{
+    return ((uint32_t)e * 78913) >> 18;
+}
+
+static inline uint32_t log10pow5(int32_t e)    /* floor(log10(5^e)) */
+{
+    return ((uint32_t)e * 732923) >> 20;
+}
+
+static void ryu_init(void)
+{
+    ScmObj p = SCM_MAKE_INT(1);
+    for (int i=0; i<RYU_POW5_INV_TABLESIZ; i++) {
+        int len = pow5bits(i);
+        if (i < RYU_POW5_TABLESIZ) {
+            /* the upper 125 bits of 5^i */
+            split_u128(Scm_Ash(p, RYU_POW5_BITCOUNT - len),
+                       &ryu_pow5[i][1], &ryu_pow5[i][0]);
+        }
+        /* floor(2^(len-1+125) / 5^i) + 1 */
+        ScmObj inv = Scm_Quotient(Scm_Ash(SCM_MAKE_INT(1),
+                                          len - 1 + RYU_POW5_INV_BITCOUNT),
+                                  p, NULL);
+        split_u128(Scm_Add(inv, SCM_MAKE_INT(1)),
+                   &ryu_pow5_inv[i][1], &ryu_pow5_inv[i][0]);
+        p = Scm_Mul(p, SCM_MAKE_INT(5));
+    }
+}
+
+static inline int pow5_factor(uint64_t v)
+{
+    int count = 0;
+    for (; v % 5 == 0; v /= 5) count++;
+    return count;
+}
+
+/* (m * mul) >> j, where mul is 128bit and j >= 64 */
+static inline uint64_t mul_shift64(uint64_t m, const uint64_t *mul, int32_t j)
+{
+    u128_t b0 = (u128_t)m * mul[0];
+    u128_t b2 = (u128_t)m * mul[1];
+    return (uint64_t)(((b0 >> 64) + b2) >> (j - 64));
+}
+
+/* Finds the shortest digits D and exponent E such that D*10^E reads
+   back to positive finite double VAL.  Among the shortest, the closest
+   one to VAL is chosen.  If two are equally close, we round down if
+   the mantissa of VAL is even and up otherwise, as print_double does. */
+static void ryu_shortest(double val, uint64_t *digits, int *exponent)
+{
+    union { double d; uint64_t u; } bits;
+    bits.d = val;
+    uint64_t ieee_mant = bits.u & ((1ULL<<52) - 1);
+    int ieee_exp = (int)((bits.u >> 52) & 0x7ff);
+    int32_t e2;
+    uint64_t m2;
+
+    if (ieee_exp == 0) {
+        e2 = 1 - 1023 - 52 - 2;
+        m2 = ieee_mant;
+    } else {
+        e2 = ieee_exp - 1023 - 52 - 2;
+        m2 = (1ULL<<52) | ieee_mant;
+    }
+    int even = (m2 & 1) == 0;
+    int accept_bounds = even;
+
+    /* The interval of numbers that read back to VAL is [mv-mm, mv+2]
+       * 2^e2, where mm is 2 normally but 1 if the lower neighbor is
+       closer.  We scale them down by 10^e10. */
+    uint64_t mv = 4*m2;
+    uint32_t mm_shift = (ieee_mant != 0 || ieee_exp <= 1);
+    uint64_t vr, vp, vm;
+    int32_t e10;
+    int vm_trailing_zeros = FALSE, vr_trailing_zeros = FALSE;
+
+    if (e2 >= 0) {
+        uint32_t q = log10pow2(e2) - (e2 > 3);
+        int32_t k = RYU_POW5_INV_BITCOUNT + pow5bits(q) - 1;
+        int32_t i = -e2 + (int32_t)q + k;
+        e10 = (int32_t)q;
+        vr = mul_shift64(4*m2,              ryu_pow5_inv[q], i);
+        vp = mul_shift64(4*m2 + 2,          ryu_pow5_inv[q], i);
+        vm = mul_shift64(4*m2 - 1 - mm_shift, ryu_pow5_inv[q], i);
+        if (q <= 21) {
+            /* Only here can the scaled numbers be exact. */
+            if (mv % 5 == 0) {
+                vr_trailing_zeros = pow5_factor(mv) >= (int)q;
+            } else if (accept_bounds) {
+                vm_trailing_zeros = pow5_factor(mv - 1 - mm_shift) >= (int)q;
+            } else {
+                vp -= pow5_factor(mv + 2) >= (int)q;
+            }
+        }
+    } else {
+        uint32_t q = log10pow5(-e2) - (-e2 > 1);
+        int32_t i = -e2 - (int32_t)q;
+        int32_t k = pow5bits(i) - RYU_POW5_BITCOUNT;
+        int32_t j = (int32_t)q - k;
+        e10 = (int32_t)q + e2;
+        vr = mul_shift64(4*m2,              ryu_pow5[i], j);
+        vp = mul_shift64(4*m2 + 2,          ryu_pow5[i], j);
+        vm = mul_shift64(4*m2 - 1 - mm_shift, ryu_pow5[i], j);
+        if (q <= 1) {
+            vr_trailing_zeros = TRUE;
+            if (accept_bounds) vm_trailing_zeros = (mm_shift == 1);
+            else vp--;
+        } else if (q < 63) {
+            /* vr is exact iff mv is a multiple of 2^q */
+            vr_trailing_zeros = (mv & ((1ULL<<q) - 1)) == 0;
+        }
+    }
+
+    /* Remove digits while the interval allows. */
+    int removed = 0;
+    int last_removed = 0;
+    uint64_t output;
+    if (vm_trailing_zeros || vr_trailing_zeros) {
+        for (; vp/10 > vm/10; removed++) {
+            vm_trailing_zeros &= (vm % 10 == 0);
+            vr_trailing_zeros &= (last_removed == 0);
+            last_removed = (int)(vr % 10);
+            vr /= 10; vp /= 10; vm /= 10;
+        }
+        if (vm_trailing_zeros) {
+            for (; vm % 10 == 0; removed++) {
+                vr_trailing_zeros &= (last_removed == 0);
+                last_removed = (int)(vr % 10);
+                vr /= 10; vp /= 10; vm /= 10;
+            }
+        }
+        if (vr_trailing_zeros && last_removed == 5) {
+            /* exactly halfway */
+            last_removed = even? 4 : 5;
+        }
+        output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros))
+                       || last_removed >= 5);
+    } else {
+        int round_up = FALSE;
+        if (vp/100 > vm/100) {
+            round_up = (vr % 100) >= 50;
+            vr /= 100; vp /= 100; vm /= 100;
+            removed += 2;
+        }
+        for (; vp/10 > vm/10; removed++) {
+            round_up = (vr % 10) >= 5;
+            vr /= 10; vp /= 10; vm /= 10;
+        }
+        output = vr + (vr == vm || round_up);
+    }
+    *digits = output;
+    *exponent = e10 + removed;
+}
+
+/* Prints DIGITS * 10^E in the same format as print_double.
+   Returns FALSE if it doesn't fit in BUFLEN; print_double takes over
+   such unusual cases. */
+static int print_digits(char *buf, int buflen, uint64_t digits, int e,
+                        int exp_lo, int exp_hi)
+{
+    char ds[24];
+    int n = 0;
+    for (; digits > 0; digits /= 10) ds[n++] = (char)('0' + digits % 10);
+
+    /* VAL = 0.DDD * 10^est */
+    int est = n + e;
+    int point;
+    if (est < exp_hi && est > exp_lo) { point = est; est = 1; }
+    else { point = 1; }
+    if (point < 30 - buflen || point > buflen - 30) return FALSE;
+
+    if (point <= 0) {
+        *buf++ = '0';
+        *buf++ = '.';
+        for (int i=point; i<0; i++) *buf++ = '0';
+    }
+    for (int i=1; i<=n; i++) {
+        *buf++ = ds[n-i];
+        if (i == point && i < n) *buf++ = '.';
+    }
+    if (n <= point) {
+        for (int i=n; i<point; i++) *buf++ = '0';
+        *buf++ = '.';
+        *buf++ = '0';
+    }
+    est--;
+    if (est != 0) sprintf(buf, "e%d", est);
+    else *buf = '\0';
+    return TRUE;
+}
+#endif /*__SIZEOF_INT128__*/
+
+/* For testing.  Switches the fast paths of flonum printing and reading
+   if FLAG >= 0, and returns the previous setting.  Returns FALSE if we
+   don't have the fast paths. */
+int Scm__FastFlonumConversion(int flag)
+{
+#if defined(FAST_FLONUM_CONVERSION)
+    int prev = fast_flonum_conversion;
+    if (flag >= 0) fast_flonum_conversion = flag;
+    return prev;
+#else  /*!FAST_FLONUM_CONVERSION*/
+    return FALSE;
+#endif /*!FAST_FLONUM_CONVERSION*/
+}
+
 /* The main routine to get string representation of double.
    Convert VAL to a string and store to BUF, which must have at least FLT_BUF
    bytes long.
@@ -3415,6 +3664,16 @@ static void print_double(char *buf, int buflen, double val, int plus_sign,
 
     if (val < 0.0) *buf++ = '-', buflen--;
     else if (plus_sign) *buf++ = '+', buflen--;
+
+#if defined(FAST_FLONUM_CONVERSION)
+    if (precision < 0 && fast_flonum_conversion) {
+        uint64_t digits;
+        int e;
+        ryu_shortest(val < 0? -val : val, &digits, &e);
+        if (print_digits(buf, buflen, digits, e, exp_lo, exp_hi)) return;
+    }
+#endif /*FAST_FLONUM_CONVERSION*/
+
     {
         /* variable names follows Burger&Dybvig paper. mp, mm for m+, m-.
            note that m+ == m- for most cases, and m+ == 2*m- for the rest.
@@ -3786,6 +4045,25 @@ static u_long bigdig[RADIX_MAX-RADIX_MIN+1] = { 0 };
 
 static ScmObj numread_error(const char *msg, struct numread_packet *context);
 
+/* Number of digits at least to use Scm__DigitsToInteger in read_uint. */
+#define LONG_DIGITS_THRESHOLD 1000
+
+/* Returns the length of the longest prefix of STR consisting of the
+   digits of RADIX. */
+static int digit_run(const char *str, int len, int radix)
+{
+    int i;
+    for (i=0; i<len; i++) {
+        int c = (unsigned char)str[i];
+        int d = (c >= '0' && c <= '9')? c - '0'
+            : (c >= 'a' && c <= 'z')? c - 'a' + 10
+            : (c >= 'A' && c <= 'Z')? c - 'A' + 10
+            : -1;
+        if (d < 0 || d >= radix) break;
+    }
+    return i;
+}
+
 /* Returns either small integer or bignum.
    initval may be a Scheme integer that will be 'concatenated' before
    the integer to be read; it is used to read floating-point number.
@@ -3821,6 +4099,21 @@ static ScmObj read_uint(const char **strp, int *lenp,
         digread = TRUE;
     }
 
+    /* A long run of digits is converted at once by divide-and-conquer,
+       which is much faster than accumulating digits one by one.
+       The rest, if any, is handled by the loop below. */
+    if (SCM_FALSEP(initval) && !ctx->padread) {
+        int run = digit_run(str, len, radix);
+        if (run >= LONG_DIGITS_THRESHOLD) {
+            ScmObj v = Scm__DigitsToInteger(str, run, radix);
+            SCM_ASSERT(SCM_BIGNUMP(v));
+            value_big = SCM_BIGNUM(v);
+            str += run;
+            len -= run;
+            digread = TRUE;
+        }
+    }
+
     while (len--) {
         int digval = -1;
         char c = tolower(*str++);
@@ -3985,6 +4278,109 @@ static double algorithmR(ScmObj f, int e, double z)
     /*NOTREACHED*/
 }
 
+#if defined(FAST_FLONUM_CONVERSION)
+/*
+ * Fast path of reading by Eisel-Lemire algorithm
+ *
+ *  (Daniel Lemire, "Number Parsing at a Gigabyte per Second",
+ *  Software: Practice and Experience 51(8), 2021).  If the decimal
+ *  mantissa fits in 64 bits, multiplying it by 128bit approximation of
+ *  10^e gives the correctly rounded double, except rare cases in which
+ *  the approximation error may matter.  We give up then, and
+ *  algorithmR takes over.  The table is calculated by Scm__InitNumber.
+ */
+
+#define LEMIRE_MIN_EXP10  (-348)
+#define LEMIRE_MAX_EXP10  347
+#define LEMIRE_TABLESIZ   (LEMIRE_MAX_EXP10 - LEMIRE_MIN_EXP10 + 1)
+
+/* Upper 128bits of 10^e, rounded down. {lo, hi} */
+static uint64_t lemire_pow10[LEMIRE_TABLESIZ][2];
+
+static void lemire_init(void)
+{
+    /* 5^e has the same mantissa as 10^e */
+    ScmObj p = SCM_MAKE_INT(1);
+    for (int e=0; e<=-LEMIRE_MIN_EXP10; e++) {
+        int len = pow5bits(e);
+        if (e <= LEMIRE_MAX_EXP10) {
+            split_u128(Scm_Ash(p, 128 - len),
+                       &lemire_pow10[e-LEMIRE_MIN_EXP10][1],
+                       &lemire_pow10[e-LEMIRE_MIN_EXP10][0]);
+        }
+        if (e > 0) {
+            /* floor(2^(len+127) / 5^e) has exactly 128 bits */
+            ScmObj r = Scm_Quotient(Scm_Ash(SCM_MAKE_INT(1), len + 127),
+                                    p, NULL);
+            split_u128(r, &lemire_pow10[-e-LEMIRE_MIN_EXP10][1],
+                       &lemire_pow10[-e-LEMIRE_MIN_EXP10][0]);
+        }
+        p = Scm_Mul(p, SCM_MAKE_INT(5));
+    }
+}
+
+static inline int clz64(uint64_t x)
+{
+    int n = 0;
+    for (; !(x & (1ULL<<63)); x <<= 1) n++;
+    return n;
+}
+
+/* Sets *result to the double closest to MAN * 10^EXP10 and returns TRUE,
+   or returns FALSE if we can't decide it quickly. */
+static int eisel_lemire(uint64_t man, long exp10, double *result)
+{
+    if (man == 0) { *result = 0.0; return TRUE; }
+    if (exp10 < LEMIRE_MIN_EXP10 || exp10 > LEMIRE_MAX_EXP10) return FALSE;
+
+    const uint64_t *pow10 = lemire_pow10[exp10 - LEMIRE_MIN_EXP10];
+    int clz = clz64(man);
+    man <<= clz;
+    uint64_t ret_exp2 = (uint64_t)(((217706*exp10)>>16) + 64 + 1023) - clz;
+
+    u128_t x = (u128_t)man * pow10[1];
+    uint64_t x_hi = (uint64_t)(x >> 64), x_lo = (uint64_t)x;
+
+    /* If the lower bits are all ones, the truncated part of 10^e may
+       carry into the upper bits.  Use the full 128bits. */
+    if ((x_hi & 0x1ff) == 0x1ff && x_lo + man < man) {
+        u128_t y = (u128_t)man * pow10[0];
+        uint64_t y_hi = (uint64_t)(y >> 64), y_lo = (uint64_t)y;
+        uint64_t merged_hi = x_hi, merged_lo = x_lo + y_hi;
+        if (merged_lo < x_lo) merged_hi++;
+        if ((merged_hi & 0x1ff) == 0x1ff && merged_lo + 1 == 0
+            && y_lo + man < man) {
+            return FALSE;
+        }
+        x_hi = merged_hi;
+        x_lo = merged_lo;
+    }
+
+    /* Take 54 bits */
+    uint64_t msb = x_hi >> 63;
+    uint64_t mant = x_hi >> (msb + 9);
+    ret_exp2 -= 1 ^ msb;
+
+    /* Possibly exactly halfway; we can't tell. */
+    if (x_lo == 0 && (x_hi & 0x1ff) == 0 && (mant & 3) == 1) return FALSE;
+
+    /* Round to 53 bits */
+    mant += mant & 1;
+    mant >>= 1;
+    if (mant >> 53) {
+        mant >>= 1;
+        ret_exp2++;
+    }
+    /* Subnormals, overflow */
+    if (ret_exp2 - 1 >= 0x7ff - 1) return FALSE;
+
+    union { double d; uint64_t u; } bits;
+    bits.u = (ret_exp2 << 52) | (mant & ((1ULL<<52) - 1));
+    *result = bits.d;
+    return TRUE;
+}
+#endif /*FAST_FLONUM_CONVERSION*/
+
 static ScmObj read_real(const char **strp, int *lenp,
                         struct numread_packet *ctx)
 {
@@ -4137,6 +4533,17 @@ static ScmObj read_real(const char **strp, int *lenp,
         else        return e;
     } 
       
+#if defined(FAST_FLONUM_CONVERSION)
+    if (fast_flonum_conversion) {
+        int oor = FALSE;
+        uint64_t man = Scm_GetIntegerU64Clamp(fraction, SCM_CLAMP_NONE, &oor);
+        double d;
+        if (!oor && eisel_lemire(man, exponent - fracdigs, &d)) {
+            return Scm_MakeFlonum(minusp? -d : d);
+        }
+    }
+#endif /*FAST_FLONUM_CONVERSION*/
+
     /* Get double approximaiton of fraction.  If fraction >= 2^53 we'll
        only get approximation, but the error will be corrected in
        AlgorithmR.  We have to be careful, however, not to overflow
@@ -4396,6 +4803,13 @@ void Scm__InitNumber(void)
     dexpt2_minus_52 = ldexp(1.0, -52);
     dexpt2_minus_53 = ldexp(1.0, -53);
 
+#if defined(FAST_FLONUM_CONVERSION)
+    /* Built here rather than on demand, so that other threads never
+       see partially filled tables. */
+    ryu_init();
+    lemire_init();
+#endif /*FAST_FLONUM_CONVERSION*/
+
     Scm_InitBuiltinGeneric(&generic_add, "object-+", mod);
     Scm_InitBuiltinGeneric(&generic_sub, "object--", mod);
     Scm_InitBuiltinGeneric(&generic_mul, "object-*", mod);
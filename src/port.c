@@ -41,6 +41,12 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <ctype.h>
+#if defined(HAVE_SYS_UIO_H)
+#include <sys/uio.h>
+#endif
+#if defined(HAVE_SYS_SENDFILE_H)
+#include <sys/sendfile.h>
+#endif
 
 #undef MAX
 #undef MIN
@@ -68,6 +74,7 @@ static void bufport_flush(ScmPort*, int, int);
 static void file_closer(ScmPort *p);
 static int  file_buffered_port_p(ScmPort *p);       /* for Scm_PortFdDup */
 static void file_buffered_port_set_fd(ScmPort *p, int fd); /* ditto */
+static int  file_write_through(ScmPort *p, const char *src, int siz);
 
 static ScmObj get_port_name(ScmPort *port)
 {
@@ -734,6 +741,13 @@ static void bufport_flush(ScmPort *p, int cnt, int forcep)
    the port's buffer.  Won't return until entire siz bytes are written. */
 static void bufport_write(ScmPort *p, const char *src, int siz)
 {
+    /* If the data doesn't fit in the buffer anyway, we skip copying
+       it into the buffer if we can. */
+    if (siz >= p->src.buf.size
+        && siz > (int)(p->src.buf.end - p->src.buf.current)
+        && file_write_through(p, src, siz)) {
+        return;
+    }
     do {
         int room = (int)(p->src.buf.end - p->src.buf.current);
         if (room >= siz) {
@@ -1074,6 +1088,21 @@ static int file_filler(ScmPort *p, int cnt)
     return nread;
 }
 
+static void file_write_error(ScmPort *p)
+{
+    if (SCM_PORT_BUFFER_SIGPIPE_SENSITIVE_P(p)) {
+        /* (sort of) emulate termination by SIGPIPE.
+           NB: The difference is visible from the outside world
+           as the process exit status differ (WIFEXITED
+           instead of WIFSIGNALED).  If it becomes a problem,
+           we can reset the signal handler to SIG_DFL and
+           send SIGPIPE to self. */
+        Scm_Exit(1);    /* exit code is somewhat arbitrary */
+    }
+    p->error = TRUE;
+    Scm_SysError("write failed on %S", p);
+}
+
 static int file_flusher(ScmPort *p, int cnt, int forcep)
 {
     int nwrote = 0;
@@ -1088,17 +1117,7 @@ static int file_flusher(ScmPort *p, int cnt, int forcep)
         errno = 0;
         SCM_SYSCALL(r, write(fd, datptr, datsiz-nwrote));
         if (r < 0) {
-            if (SCM_PORT_BUFFER_SIGPIPE_SENSITIVE_P(p)) {
-                /* (sort of) emulate termination by SIGPIPE.
-                   NB: The difference is visible from the outside world
-                   as the process exit status differ (WIFEXITED
-                   instead of WIFSIGNALED).  If it becomes a problem,
-                   we can reset the signal handler to SIG_DFL and
-                   send SIGPIPE to self. */
-                Scm_Exit(1);    /* exit code is somewhat arbitrary */
-            }
-            p->error = TRUE;
-            Scm_SysError("write failed on %S", p);
+            file_write_error(p);
         } else {
             datptr += r;
             nwrote += r;
@@ -1107,6 +1126,43 @@ static int file_flusher(ScmPort *p, int cnt, int forcep)
     return nwrote;
 }
 
+/* Called from bufport_write.  Writes out the pending data in the buffer
+   of a file port P followed by SIZ bytes from SRC, without copying them
+   into the buffer.  Returns FALSE if P isn't a file port, or the system
+   doesn't have writev(); the caller should go through the buffer then. */
+static int file_write_through(ScmPort *p, const char *src, int siz)
+{
+#if defined(HAVE_WRITEV)
+    if (p->src.buf.flusher != file_flusher) return FALSE;
+    int fd = FILE_PORT_DATA(p)->fd;
+    SCM_ASSERT(fd >= 0);
+
+    struct iovec iov[2];
+    iov[0].iov_base = p->src.buf.buffer;
+    iov[0].iov_len  = SCM_PORT_BUFFER_AVAIL(p);
+    iov[1].iov_base = (void*)src;
+    iov[1].iov_len  = siz;
+    int i = (iov[0].iov_len == 0)? 1 : 0;
+    while (i < 2) {
+        ssize_t r;
+        errno = 0;
+        SCM_SYSCALL(r, writev(fd, iov+i, 2-i));
+        if (r < 0) file_write_error(p);
+        for (; i < 2 && (size_t)r >= iov[i].iov_len; i++) {
+            r -= iov[i].iov_len;
+        }
+        if (i < 2) {
+            iov[i].iov_base = (char*)iov[i].iov_base + r;
+            iov[i].iov_len -= r;
+        }
+    }
+    p->src.buf.current = p->src.buf.buffer;
+    return TRUE;
+#else  /*!HAVE_WRITEV*/
+    return FALSE;
+#endif /*!HAVE_WRITEV*/
+}
+
 static void file_closer(ScmPort *p)
 {
     int fd = FILE_PORT_DATA(p)->fd;
@@ -1233,6 +1289,82 @@ ScmObj Scm_MakePortWithFd(ScmObj name, int direction,
     return p;
 }
 
+/* Copies data from a file port SRC to a file port DST, up to SIZE bytes,
+   or until EOF if SIZE is negative.  If the system supports it, we use
+   sendfile(2) so that the data doesn't go through the user space.
+   Both ports must be locked by the calling thread.
+   Returns the number of bytes copied, or -1 if we can't handle the ports
+   (the caller should copy the data by itself then.) */
+ScmSmallInt Scm__CopyFilePort(ScmPort *src, ScmPort *dst, ScmSmallInt size)
+{
+    ScmVM *vm = Scm_VM();
+    if (!(SCM_IPORTP(src) && SCM_PORT_TYPE(src) == SCM_PORT_FILE
+          && src->src.buf.filler == file_filler
+          && SCM_OPORTP(dst) && SCM_PORT_TYPE(dst) == SCM_PORT_FILE
+          && dst->src.buf.flusher == file_flusher
+          && !SCM_PORT_CLOSED_P(src) && !SCM_PORT_CLOSED_P(dst)
+          && src->scrcnt == 0 && src->ungotten == SCM_CHAR_INVALID
+          && PORT_LOCKED(src, vm) && PORT_LOCKED(dst, vm))) {
+        return -1;
+    }
+
+    /* Data already read into the SRC's buffer goes first. */
+    ScmSmallInt total = (ScmSmallInt)(src->src.buf.end - src->src.buf.current);
+    if (size >= 0 && total > size) total = size;
+    if (total > 0) {
+        bufport_write(dst, src->src.buf.current, (int)total);
+        src->src.buf.current += total;
+        src->bytes += total;
+    }
+    bufport_flush(dst, 0, TRUE);
+
+    int infd = FILE_PORT_DATA(src)->fd;
+    int outfd = FILE_PORT_DATA(dst)->fd;
+    SCM_ASSERT(infd >= 0 && outfd >= 0);
+
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+    while (size < 0 || total < size) {
+        size_t chunk = 0x40000000;
+        if (size >= 0 && (size_t)(size - total) < chunk) chunk = size - total;
+        ssize_t r;
+        errno = 0;
+        SCM_SYSCALL(r, sendfile(outfd, infd, NULL, chunk));
+        if (r < 0) {
+            /* Either the ports can't be handled by sendfile, or an error
+               occurred on SRC or DST.  Errno doesn't always tell which
+               (e.g. EIO and EBADF), so we fall back to read/write; nothing
+               has been transferred by the failed call, and a persistent
+               error is reported against the port that caused it. */
+            break;
+        }
+        if (r == 0) return total;
+        total += r;
+        src->bytes += r;
+    }
+#endif /*HAVE_SENDFILE && HAVE_SYS_SENDFILE_H*/
+
+    char buf[SCM_PORT_DEFAULT_BUFSIZ];
+    while (size < 0 || total < size) {
+        size_t chunk = sizeof(buf);
+        if (size >= 0 && (size_t)(size - total) < chunk) chunk = size - total;
+        ssize_t r;
+        errno = 0;
+        SCM_SYSCALL(r, read(infd, buf, chunk));
+        if (r < 0) {
+            src->error = TRUE;
+            Scm_SysError("read failed on %S", src);
+        }
+        if (r == 0) break;
+        bufport_write(dst, buf, (int)r);
+        total += r;
+        src->bytes += r;
+    }
+    if (SCM_PORT_BUFFER_MODE(dst) != SCM_PORT_BUFFER_FULL) {
+        bufport_flush(dst, 0, TRUE);
+    }
+    return total;
+}
+
 /*===============================================================
  * String port
  */
@@ -37,9 +37,27 @@
 #include "gauche/code.h"
 #include "gauche/vminsn.h"
 #include "gauche/prof.h"
+#include "atomic_ops.h"
 
 #ifdef GAUCHE_PROFILE
 
+/* Per-thread CPU timer, used to sample every thread.  See
+   Scm_ProfilerStartAllThreads below.  If we don't have it, we fall back
+   to the process-wide ITIMER_PROF; SIGPROF is then delivered to whichever
+   thread is running, which is sampled. */
+#if !defined(GAUCHE_WINDOWS) && defined(GAUCHE_HAS_THREADS) \
+    && defined(HAVE_TIMER_CREATE)
+#include <time.h>
+#include <sys/syscall.h>
+#if defined(SIGEV_THREAD_ID) && defined(SYS_gettid) \
+    && defined(CLOCK_THREAD_CPUTIME_ID)
+#define USE_THREAD_TIMER 1
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+#endif /* SIGEV_THREAD_ID && SYS_gettid && CLOCK_THREAD_CPUTIME_ID */
+#endif /* !GAUCHE_WINDOWS && GAUCHE_HAS_THREADS && HAVE_TIMER_CREATE */
+
 /* WARNING: duplicated code - see signal.c; we should integrate them later */
 #ifdef GAUCHE_USE_PTHREADS
 #define SIGPROCMASK pthread_sigmask
@@ -132,6 +150,46 @@ static void ITIMER_STOP(void)
         setitimer(ITIMER_PROF, &tval, &oval);   \
     } while (0)
 
+#if defined(USE_THREAD_TIMER)
+/* In all-threads mode, each VM is sampled by a timer that measures the
+   CPU time of its own thread and directs SIGPROF to that thread.
+   The timer has to be created by the thread to be sampled, but it can
+   be deleted by any thread.  Both are done while holding profAll.mutex.
+   Returns -1 on failure. */
+static int thread_timer_start(ScmVM *vm)
+{
+    if (vm->prof->threadTimer != NULL) return 0;
+
+    timer_t *timer = SCM_NEW_ATOMIC(timer_t);
+    struct sigevent sev;
+    memset(&sev, 0, sizeof(sev));
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = SIGPROF;
+    sev.sigev_notify_thread_id = (pid_t)syscall(SYS_gettid);
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, timer) < 0) return -1;
+
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = 0;
+    spec.it_interval.tv_nsec = SAMPLING_PERIOD * 1000;
+    spec.it_value = spec.it_interval;
+    if (timer_settime(*timer, 0, &spec, NULL) < 0) {
+        timer_delete(*timer);
+        return -1;
+    }
+    vm->prof->threadTimer = timer;
+    return 0;
+}
+
+static void thread_timer_stop(ScmVM *vm)
+{
+    if (vm->prof->threadTimer == NULL) return;
+    timer_delete(*(timer_t*)vm->prof->threadTimer);
+    vm->prof->threadTimer = NULL;
+}
+#endif /* USE_THREAD_TIMER */
+
+static void install_sampler(void);
+
 #endif /* !GAUCHE_WINDOWS */
 
 /*=============================================================
@@ -171,15 +229,23 @@ static void sampler_sample(int sig)
     ScmVM *vm = Scm_VM();
 #endif /* !GAUCHE_WINDOWS */
     if (vm == NULL || vm->prof == NULL) return;
-    if (vm->prof->state != SCM_PROFILER_RUNNING) return;
+
+    /* Another thread may be collecting the result of this VM.  It sets
+       the state first, then waits for inSample to be cleared. */
+    vm->prof->inSample = TRUE;
+    AO_nop_full();
+    if (vm->prof->state != SCM_PROFILER_RUNNING) {
+        vm->prof->inSample = FALSE;
+        return;
+    }
 
     if (vm->prof->currentSample >= SCM_PROF_SAMPLES_IN_BUFFER) {
 #if !defined(GAUCHE_WINDOWS)
-        ITIMER_STOP();
+        if (!vm->prof->allThreads) ITIMER_STOP();
 #endif /* !GAUCHE_WINDOWS */
         sampler_flush(vm);
 #if !defined(GAUCHE_WINDOWS)
-        ITIMER_START();
+        if (!vm->prof->allThreads) ITIMER_START();
 #endif /* !GAUCHE_WINDOWS */
     }
 
@@ -200,6 +266,18 @@ static void sampler_sample(int sig)
         vm->prof->samples[i].pc = NULL;
     }
     vm->prof->totalSamples++;
+
+    /* The VM may be pushing or popping a continuation frame, so we
+       don't walk the stack here.  The VM records it at the next safe
+       point (record_stack). */
+    vm->prof->pendingStacks++;
+    vm->prof->pendingTop = vm->prof->samples[i].func;
+    if (!vm->prof->stackRequest) {
+        vm->prof->stackRequest = TRUE;
+        vm->attentionRequest = TRUE;
+    }
+    AO_nop_full();
+    vm->prof->inSample = FALSE;
 }
 
 /* register samples into the stat table.  Called from Scm_ProfilerResult */
@@ -220,26 +298,79 @@ void collect_samples(ScmVMProfiler *prof)
     }
 }
 
-/*=============================================================
- * Call Counter
- */
-
-/* Inserting data into array is done in a macro (prof.h).  It calls
-   this flush routine when the array gets full. */
+/* Adds WEIGHT samples of the call stack ST into stackTree. */
+static void fold_stack(ScmVMProfiler *prof, ScmProfStack *st, int weight)
+{
+    ScmObj node = prof->stackTree;
+    SCM_SET_CAR(node, SCM_MAKE_INT(SCM_INT_VALUE(SCM_CAR(node)) + weight));
+    /* walk from the outermost frame */
+    for (int d=st->depth-1; d>=0; d--) {
+        if (SCM_FALSEP(SCM_CDR(node))) {
+            SCM_SET_CDR(node, Scm_MakeHashTableSimple(SCM_HASH_EQ, 0));
+        }
+        ScmHashTable *children = SCM_HASH_TABLE(SCM_CDR(node));
+        ScmObj child = Scm_HashTableRef(children, st->frames[d], SCM_FALSE);
+        if (SCM_FALSEP(child)) {
+            child = Scm_Cons(SCM_MAKE_INT(0), SCM_FALSE);
+            Scm_HashTableSet(children, st->frames[d], child, 0);
+        }
+        SCM_SET_CAR(child,
+                    SCM_MAKE_INT(SCM_INT_VALUE(SCM_CAR(child)) + weight));
+        node = child;
+    }
+}
 
-void Scm_ProfilerCountBufferFlush(ScmVM *vm)
+/* Records the call stack of the pending samples into stackTree.
+   All of them are charged to the stack at this safe point, with the
+   top frame of the last one; see profiler-get-stacks in the manual.
+   If WALK is TRUE, VM must be the current VM at its safe point.
+   Otherwise the pending stacks are dropped; this is used by another
+   thread collecting the result of the paused VM. */
+static void record_stack(ScmVM *vm, int walk)
 {
-    if (vm->prof == NULL) return; /* for safety */
-    if (vm->prof->currentCount == 0) return;
+    ScmVMProfiler *prof = vm->prof;
+    ScmProfStack st;
 
-    /* suspend itimer during hash table operation */
 #if !defined(GAUCHE_WINDOWS)
     sigset_t set;
     sigemptyset(&set);
     sigaddset(&set, SIGPROF);
     SIGPROCMASK(SIG_BLOCK, &set, NULL);
 #endif /* !GAUCHE_WINDOWS */
+    SCM_INTERNAL_MUTEX_LOCK(prof->lock);
+
+    int npending = prof->pendingStacks;
+    if (npending > 0) {
+        if (walk) {
+            st.frames[0] = prof->pendingTop;
+            st.depth = 1 + Scm__VMSampleStack(vm, st.frames+1,
+                                               SCM_PROF_STACK_DEPTH-1);
+            fold_stack(prof, &st, npending);
+        } else {
+            prof->droppedStacks += npending;
+        }
+    }
+    prof->pendingStacks = 0;
+    prof->pendingTop = SCM_FALSE;
+    prof->stackRequest = FALSE;
+
+    SCM_INTERNAL_MUTEX_UNLOCK(prof->lock);
+#if !defined(GAUCHE_WINDOWS)
+    SIGPROCMASK(SIG_UNBLOCK, &set, NULL);
+#endif /* !GAUCHE_WINDOWS */
+}
+
+/*=============================================================
+ * Call Counter
+ */
+
+/* Inserting data into array is done in a macro (prof.h).  It calls
+   this flush routine when the array gets full. */
 
+/* Registers the counts in the buffer into statHash.  Must be called
+   with vm->prof->lock held and SIGPROF blocked. */
+static void count_flush(ScmVM *vm)
+{
     int ncounts = vm->prof->currentCount;
     for (int i=0; i<ncounts; i++) {
         ScmObj e;
@@ -269,6 +400,26 @@ void Scm_ProfilerCountBufferFlush(ScmVM *vm)
         SCM_SET_CAR(e, SCM_MAKE_INT(cnt));
     }
     vm->prof->currentCount = 0;
+}
+
+void Scm_ProfilerCountBufferFlush(ScmVM *vm)
+{
+    if (vm->prof == NULL) return; /* for safety */
+    if (vm->prof->currentCount == 0) return;
+
+    /* suspend itimer during hash table operation */
+#if !defined(GAUCHE_WINDOWS)
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPROF);
+    SIGPROCMASK(SIG_BLOCK, &set, NULL);
+#endif /* !GAUCHE_WINDOWS */
+
+    /* In all-threads mode, the result may be collected by another
+       thread. */
+    SCM_INTERNAL_MUTEX_LOCK(vm->prof->lock);
+    count_flush(vm);
+    SCM_INTERNAL_MUTEX_UNLOCK(vm->prof->lock);
 
     /* resume itimer */
 #if !defined(GAUCHE_WINDOWS)
@@ -276,35 +427,74 @@ void Scm_ProfilerCountBufferFlush(ScmVM *vm)
 #endif /* !GAUCHE_WINDOWS */
 }
 
+/* In all-threads mode, another thread may flush and reset the buffer
+   while collecting the result, so SCM_PROF_COUNT_CALL appends to it
+   with the lock held. */
+void Scm__ProfilerCountCall(ScmVM *vm, ScmObj func)
+{
+#if !defined(GAUCHE_WINDOWS)
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPROF);
+    SIGPROCMASK(SIG_BLOCK, &set, NULL);
+#endif /* !GAUCHE_WINDOWS */
+
+    SCM_INTERNAL_MUTEX_LOCK(vm->prof->lock);
+    if (vm->prof->currentCount == SCM_PROF_COUNTER_IN_BUFFER) {
+        count_flush(vm);
+    }
+    vm->prof->counts[vm->prof->currentCount++].func = func;
+    SCM_INTERNAL_MUTEX_UNLOCK(vm->prof->lock);
+
+#if !defined(GAUCHE_WINDOWS)
+    SIGPROCMASK(SIG_UNBLOCK, &set, NULL);
+#endif /* !GAUCHE_WINDOWS */
+}
+
 /*=============================================================
- * External API
+ * Per-VM operations
  */
-void Scm_ProfilerStart(void)
+
+/* Allocates the profiler buffer of VM, and opens the file to save
+   samples if necessary.  Can be called from other than VM's thread. */
+static void prof_init_vm(ScmVM *vm)
 {
-    ScmVM *vm = Scm_VM();
+    if (vm->prof && vm->prof->samplerFd >= 0) return;
+
     ScmObj templat = Scm_StringAppendC(SCM_STRING(Scm_TmpDir()),
                                        "/gauche-profXXXXXX", -1, -1);
     char *templat_buf = Scm_GetString(SCM_STRING(templat)); /*mutable copy*/
 
     if (!vm->prof) {
-        vm->prof = SCM_NEW(ScmVMProfiler);
-        vm->prof->state = SCM_PROFILER_INACTIVE;
-        vm->prof->samplerFd = Scm_Mkstemp(templat_buf);
-        vm->prof->currentSample = 0;
-        vm->prof->totalSamples = 0;
-        vm->prof->errorOccurred = 0;
-        vm->prof->currentCount = 0;
-        vm->prof->statHash =
+        ScmVMProfiler *prof = SCM_NEW(ScmVMProfiler);
+        prof->state = SCM_PROFILER_INACTIVE;
+        prof->samplerFd = Scm_Mkstemp(templat_buf);
+        prof->currentSample = 0;
+        prof->totalSamples = 0;
+        prof->errorOccurred = 0;
+        prof->currentCount = 0;
+        prof->statHash =
             SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_EQ, 0));
+        SCM_INTERNAL_MUTEX_INIT(prof->lock);
+        prof->allThreads = FALSE;
+        prof->timerRequest = FALSE;
+        prof->inSample = FALSE;
+        prof->threadTimer = NULL;
+        prof->pendingStacks = 0;
+        prof->pendingTop = SCM_FALSE;
+        prof->droppedStacks = 0;
+        prof->stackRequest = FALSE;
+        prof->stackTree = Scm_Cons(SCM_MAKE_INT(0), SCM_FALSE);
 #if defined(GAUCHE_WINDOWS)
-        vm->prof->hTargetThread = NULL;
-        vm->prof->hObserverThread = NULL;
-        vm->prof->hTimerEvent = NULL;
-        vm->prof->samplerFileName = templat_buf;
+        prof->hTargetThread = NULL;
+        prof->hObserverThread = NULL;
+        prof->hTimerEvent = NULL;
+        prof->samplerFileName = templat_buf;
 #else  /* !GAUCHE_WINDOWS */
         unlink(templat_buf);       /* keep anonymous tmpfile */
 #endif /* !GAUCHE_WINDOWS */
-    } else if (vm->prof->samplerFd < 0) {
+        vm->prof = prof;
+    } else {
         vm->prof->samplerFd = Scm_Mkstemp(templat_buf);
 #if defined(GAUCHE_WINDOWS)
         vm->prof->samplerFileName = templat_buf;
@@ -312,57 +502,26 @@ void Scm_ProfilerStart(void)
         unlink(templat_buf);
 #endif /* !GAUCHE_WINDOWS */
     }
+}
 
-    if (vm->prof->state == SCM_PROFILER_RUNNING) return;
+static void prof_resume(ScmVM *vm)
+{
     vm->prof->state = SCM_PROFILER_RUNNING;
     vm->profilerRunning = TRUE;
-
-    /* NB: this should be done globally!!! */
-#if defined(GAUCHE_WINDOWS)
-    if (!DuplicateHandle(GetCurrentProcess(),
-                         GetCurrentThread(),
-                         GetCurrentProcess(),
-                         &vm->prof->hTargetThread,
-                         0, FALSE, DUPLICATE_SAME_ACCESS)) {
-        vm->prof->hTargetThread = NULL;
-        Scm_SysError("DuplicateHandle failed");
-    }
-#else  /* !GAUCHE_WINDOWS */
-    struct sigaction act;
-    act.sa_handler = sampler_sample;
-    sigfillset(&act.sa_mask);
-    act.sa_flags = SA_RESTART;
-    if (sigaction(SIGPROF, &act, NULL) < 0) {
-        Scm_SysError("sigaction failed");
-    }
-#endif /* !GAUCHE_WINDOWS */
-
-    ITIMER_START();
 }
 
-int Scm_ProfilerStop(void)
+/* Stops sampling VM.  If VM's sampler is running on another thread,
+   waits for it to finish. */
+static void prof_pause(ScmVM *vm)
 {
-    ScmVM *vm = Scm_VM();
-    if (vm->prof == NULL) return 0;
-    if (vm->prof->state != SCM_PROFILER_RUNNING) return 0;
-    ITIMER_STOP();
-#if defined(GAUCHE_WINDOWS)
-    CloseHandle(vm->prof->hTargetThread);
-    vm->prof->hTargetThread = NULL;
-#endif /* GAUCHE_WINDOWS */
     vm->prof->state = SCM_PROFILER_PAUSING;
     vm->profilerRunning = FALSE;
-    return vm->prof->totalSamples;
+    AO_nop_full();
+    while (vm->prof->inSample) Scm_YieldCPU();
 }
 
-void Scm_ProfilerReset(void)
+static void prof_reset(ScmVM *vm)
 {
-    ScmVM *vm = Scm_VM();
-
-    if (vm->prof == NULL) return;
-    if (vm->prof->state == SCM_PROFILER_INACTIVE) return;
-    if (vm->prof->state == SCM_PROFILER_RUNNING) Scm_ProfilerStop();
-
     if (vm->prof->samplerFd >= 0) {
         close(vm->prof->samplerFd);
         vm->prof->samplerFd = -1;
@@ -373,21 +532,23 @@ void Scm_ProfilerReset(void)
     vm->prof->totalSamples = 0;
     vm->prof->currentSample = 0;
     vm->prof->errorOccurred = 0;
+    /* The owner thread may still be in SCM_PROF_COUNT_CALL. */
+    SCM_INTERNAL_MUTEX_LOCK(vm->prof->lock);
     vm->prof->currentCount = 0;
     vm->prof->statHash =
         SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_EQ, 0));
+    SCM_INTERNAL_MUTEX_UNLOCK(vm->prof->lock);
+    vm->prof->pendingStacks = 0;
+    vm->prof->pendingTop = SCM_FALSE;
+    vm->prof->droppedStacks = 0;
+    vm->prof->stackRequest = FALSE;
+    vm->prof->stackTree = Scm_Cons(SCM_MAKE_INT(0), SCM_FALSE);
     vm->prof->state = SCM_PROFILER_INACTIVE;
 }
 
-/* Returns the statHash */
-ScmObj Scm_ProfilerRawResult(void)
+/* Gathers the samples of paused VM into its statHash and returns it. */
+static ScmObj prof_collect(ScmVM *vm)
 {
-    ScmVM *vm = Scm_VM();
-
-    if (vm->prof == NULL) return SCM_FALSE;
-    if (vm->prof->state == SCM_PROFILER_INACTIVE) return SCM_FALSE;
-    if (vm->prof->state == SCM_PROFILER_RUNNING) Scm_ProfilerStop();
-
     if (vm->prof->errorOccurred > 0) {
         Scm_Warn("profiler: An error has been occurred during saving profiling samples.  The result may not be accurate");
     }
@@ -401,7 +562,7 @@ ScmObj Scm_ProfilerRawResult(void)
     off_t off;
     SCM_SYSCALL(off, lseek(vm->prof->samplerFd, 0, SEEK_SET));
     if (off == (off_t)-1) {
-        Scm_ProfilerReset();
+        prof_reset(vm);
         Scm_Error("profiler: seek failed in retrieving sample data");
     }
     for (;;) {
@@ -427,6 +588,365 @@ ScmObj Scm_ProfilerRawResult(void)
     return SCM_OBJ(vm->prof->statHash);
 }
 
+#if !defined(GAUCHE_WINDOWS)
+static void install_sampler(void)
+{
+    struct sigaction act;
+    act.sa_handler = sampler_sample;
+    sigfillset(&act.sa_mask);
+    act.sa_flags = SA_RESTART;
+    if (sigaction(SIGPROF, &act, NULL) < 0) {
+        Scm_SysError("sigaction failed");
+    }
+}
+#endif /* !GAUCHE_WINDOWS */
+
+/*=============================================================
+ * All-threads mode
+ */
+
+/* Once Scm_ProfilerStartAllThreads is called, the profiler works on
+ * all the VMs until it is reset.  The VMs being profiled are kept
+ * in profAll.vms, including the ones that have already finished.
+ * VMs attached while the profiler is running join automatically
+ * (Scm__ProfilerAttachVM).
+ *
+ * A thread can't create the timer for another thread.  So the thread
+ * that starts the profiler sets timerRequest of other VMs and raises
+ * their attentionRequest; each VM starts its timer when it processes
+ * the request (Scm__ProfilerHandleRequest).  A thread blocked in a system
+ * call doesn't consume CPU time, so it's ok that it starts sampling
+ * only after it resumes running.
+ */
+static struct {
+    ScmInternalMutex mutex;
+    int active;                 /* TRUE while in all-threads mode */
+    int running;                /* TRUE while sampling */
+    ScmObj vms;                 /* VMs being profiled */
+} profAll = { SCM_INTERNAL_MUTEX_INITIALIZER, FALSE, FALSE, SCM_NIL };
+
+/* Called with profAll.mutex held. */
+static void prof_join(ScmVM *vm)
+{
+    if (!vm->prof->allThreads) {
+        vm->prof->allThreads = TRUE;
+        profAll.vms = Scm_Cons(SCM_OBJ(vm), profAll.vms);
+    }
+}
+
+static ScmObj prof_all_vms(void)
+{
+    SCM_INTERNAL_MUTEX_LOCK(profAll.mutex);
+    ScmObj vms = Scm_Reverse(profAll.vms);
+    SCM_INTERNAL_MUTEX_UNLOCK(profAll.mutex);
+    return vms;
+}
+
+static int prof_stop_all(void)
+{
+    int total = 0;
+    ScmObj vp;
+
+    SCM_INTERNAL_MUTEX_LOCK(profAll.mutex);
+    if (profAll.running) {
+        SCM_FOR_EACH(vp, profAll.vms) {
+            ScmVM *vm = SCM_VM(SCM_CAR(vp));
+            prof_pause(vm);
+#if defined(USE_THREAD_TIMER)
+            thread_timer_stop(vm);
+#endif /* USE_THREAD_TIMER */
+        }
+#if !defined(USE_THREAD_TIMER) && !defined(GAUCHE_WINDOWS)
+        ITIMER_STOP();
+#endif /* !USE_THREAD_TIMER && !GAUCHE_WINDOWS */
+        profAll.running = FALSE;
+    }
+    SCM_FOR_EACH(vp, profAll.vms) {
+        total += SCM_VM(SCM_CAR(vp))->prof->totalSamples;
+    }
+    SCM_INTERNAL_MUTEX_UNLOCK(profAll.mutex);
+    return total;
+}
+
+static void prof_reset_all(void)
+{
+    prof_stop_all();
+    SCM_INTERNAL_MUTEX_LOCK(profAll.mutex);
+    ScmObj vms = profAll.vms;
+    profAll.vms = SCM_NIL;
+    profAll.active = FALSE;
+    SCM_INTERNAL_MUTEX_UNLOCK(profAll.mutex);
+
+    ScmObj vp;
+    SCM_FOR_EACH(vp, vms) {
+        ScmVM *vm = SCM_VM(SCM_CAR(vp));
+        prof_reset(vm);
+        vm->prof->allThreads = FALSE;
+    }
+}
+
+/* Sums up the results of all VMs into a fresh table. */
+static ScmObj prof_merge_all(void)
+{
+    ScmHashTable *r = SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_EQ, 0));
+    ScmObj vp;
+
+    prof_stop_all();
+    SCM_FOR_EACH(vp, prof_all_vms()) {
+        ScmObj h = prof_collect(SCM_VM(SCM_CAR(vp)));
+        ScmHashIter iter;
+        ScmDictEntry *e;
+        Scm_HashIterInit(&iter, SCM_HASH_TABLE_CORE(h));
+        while ((e = Scm_HashIterNext(&iter)) != NULL) {
+            ScmObj v = SCM_DICT_VALUE(e);
+            ScmObj p = Scm_HashTableRef(r, SCM_DICT_KEY(e), SCM_FALSE);
+            if (SCM_FALSEP(p)) {
+                Scm_HashTableSet(r, SCM_DICT_KEY(e),
+                                 Scm_Cons(SCM_CAR(v), SCM_CDR(v)), 0);
+            } else {
+                SCM_SET_CAR(p, SCM_MAKE_INT(SCM_INT_VALUE(SCM_CAR(p))
+                                            + SCM_INT_VALUE(SCM_CAR(v))));
+                SCM_SET_CDR(p, SCM_MAKE_INT(SCM_INT_VALUE(SCM_CDR(p))
+                                            + SCM_INT_VALUE(SCM_CDR(v))));
+            }
+        }
+    }
+    return SCM_OBJ(r);
+}
+
+void Scm_ProfilerStartAllThreads(void)
+{
+#if defined(GAUCHE_WINDOWS)
+    Scm_Error("profiling all threads is not supported on this platform.");
+#else  /* !GAUCHE_WINDOWS */
+    ScmVM *self = Scm_VM();
+    ScmObj vms = Scm__AttachedVMs(), vp;
+    int r = 0;
+
+    if (self->prof && !self->prof->allThreads
+        && self->prof->state != SCM_PROFILER_INACTIVE) {
+        Scm_Error("profiler is already active on this thread; "
+                  "reset it before profiling all threads.");
+    }
+
+    /* These may raise an error, so we do them before locking. */
+    SCM_FOR_EACH(vp, vms) prof_init_vm(SCM_VM(SCM_CAR(vp)));
+    install_sampler();
+
+    SCM_INTERNAL_MUTEX_LOCK(profAll.mutex);
+    if (!profAll.running) {
+        SCM_FOR_EACH(vp, vms) {
+            ScmVM *vm = SCM_VM(SCM_CAR(vp));
+            if (vm->state == SCM_VM_TERMINATED) continue;
+            prof_join(vm);
+        }
+        SCM_FOR_EACH(vp, profAll.vms) {
+            ScmVM *vm = SCM_VM(SCM_CAR(vp));
+            if (vm->state == SCM_VM_TERMINATED) continue;
+            prof_resume(vm);
+#if defined(USE_THREAD_TIMER)
+            if (vm == self) {
+                r = thread_timer_start(vm);
+            } else {
+                vm->prof->timerRequest = TRUE;
+                vm->attentionRequest = TRUE;
+            }
+#endif /* USE_THREAD_TIMER */
+        }
+#if !defined(USE_THREAD_TIMER)
+        ITIMER_START();
+#endif /* !USE_THREAD_TIMER */
+        profAll.active = TRUE;
+        profAll.running = TRUE;
+    }
+    SCM_INTERNAL_MUTEX_UNLOCK(profAll.mutex);
+
+    if (r < 0) Scm_SysError("profiler: couldn't start sampling timer");
+#endif /* !GAUCHE_WINDOWS */
+}
+
+/* Returns a list of (<vm> . <statHash>).  If the profiler isn't in
+   all-threads mode, the list contains the result of the current VM only. */
+ScmObj Scm_ProfilerRawThreadResults(void)
+{
+    if (!profAll.active) {
+        ScmObj r = Scm_ProfilerRawResult();
+        if (SCM_FALSEP(r)) return SCM_NIL;
+        return SCM_LIST1(Scm_Cons(SCM_OBJ(Scm_VM()), r));
+    }
+
+    ScmObj h = SCM_NIL, t = SCM_NIL, vp;
+    prof_stop_all();
+    SCM_FOR_EACH(vp, prof_all_vms()) {
+        ScmVM *vm = SCM_VM(SCM_CAR(vp));
+        SCM_APPEND1(h, t, Scm_Cons(SCM_OBJ(vm), prof_collect(vm)));
+    }
+    return h;
+}
+
+/* Returns a list of the roots of stackTree, one for the current VM,
+   or one for each VM in all-threads mode. */
+ScmObj Scm_ProfilerRawStacks(void)
+{
+    ScmObj vms, vp, h = SCM_NIL, t = SCM_NIL;
+
+    if (profAll.active) {
+        prof_stop_all();
+        vms = prof_all_vms();
+    } else {
+        ScmVM *vm = Scm_VM();
+        if (vm->prof == NULL) return SCM_NIL;
+        if (vm->prof->state == SCM_PROFILER_INACTIVE) return SCM_NIL;
+        if (vm->prof->state == SCM_PROFILER_RUNNING) Scm_ProfilerStop();
+        vms = SCM_LIST1(SCM_OBJ(vm));
+    }
+
+    SCM_FOR_EACH(vp, vms) {
+        ScmVM *vm = SCM_VM(SCM_CAR(vp));
+        record_stack(vm, FALSE);
+        if (vm->prof->droppedStacks > 0) {
+            Scm_Warn("profiler: call stacks of %d samples are lost.",
+                     vm->prof->droppedStacks);
+            vm->prof->droppedStacks = 0;
+        }
+        SCM_APPEND1(h, t, vm->prof->stackTree);
+    }
+    return h;
+}
+
+/* Called from Scm_AttachVM on the newly attached thread. */
+void Scm__ProfilerAttachVM(ScmVM *vm)
+{
+    if (!profAll.running) return;
+    prof_init_vm(vm);
+
+    int r = 0;
+    SCM_INTERNAL_MUTEX_LOCK(profAll.mutex);
+    if (profAll.running) {
+        prof_join(vm);
+        prof_resume(vm);
+#if defined(USE_THREAD_TIMER)
+        r = thread_timer_start(vm);
+#endif /* USE_THREAD_TIMER */
+    }
+    SCM_INTERNAL_MUTEX_UNLOCK(profAll.mutex);
+    if (r < 0) {
+        Scm_Warn("profiler: couldn't start sampling timer for %S", vm);
+    }
+}
+
+/* Called from Scm_DetachVM on the thread being detached.  We keep
+   the samples so that they're included in the result. */
+void Scm__ProfilerDetachVM(ScmVM *vm)
+{
+    if (vm->prof == NULL || !vm->prof->allThreads) return;
+    SCM_INTERNAL_MUTEX_LOCK(profAll.mutex);
+    if (vm->prof->state == SCM_PROFILER_RUNNING) prof_pause(vm);
+#if defined(USE_THREAD_TIMER)
+    thread_timer_stop(vm);
+#endif /* USE_THREAD_TIMER */
+    SCM_INTERNAL_MUTEX_UNLOCK(profAll.mutex);
+}
+
+/* Called from the VM loop when timerRequest or stackRequest is set. */
+void Scm__ProfilerHandleRequest(ScmVM *vm)
+{
+    if (vm->prof->stackRequest) record_stack(vm, TRUE);
+    if (!vm->prof->timerRequest) return;
+
+    int r = 0;
+    SCM_INTERNAL_MUTEX_LOCK(profAll.mutex);
+    vm->prof->timerRequest = FALSE;
+#if defined(USE_THREAD_TIMER)
+    if (profAll.running && vm->prof->allThreads
+        && vm->prof->state == SCM_PROFILER_RUNNING) {
+        r = thread_timer_start(vm);
+    }
+#endif /* USE_THREAD_TIMER */
+    SCM_INTERNAL_MUTEX_UNLOCK(profAll.mutex);
+    if (r < 0) {
+        Scm_Warn("profiler: couldn't start sampling timer for %S", vm);
+    }
+}
+
+/*=============================================================
+ * External API
+ */
+void Scm_ProfilerStart(void)
+{
+    if (profAll.active) {
+        Scm_ProfilerStartAllThreads();
+        return;
+    }
+
+    ScmVM *vm = Scm_VM();
+    prof_init_vm(vm);
+
+    if (vm->prof->state == SCM_PROFILER_RUNNING) return;
+    prof_resume(vm);
+
+    /* NB: this should be done globally!!! */
+#if defined(GAUCHE_WINDOWS)
+    if (!DuplicateHandle(GetCurrentProcess(),
+                         GetCurrentThread(),
+                         GetCurrentProcess(),
+                         &vm->prof->hTargetThread,
+                         0, FALSE, DUPLICATE_SAME_ACCESS)) {
+        vm->prof->hTargetThread = NULL;
+        Scm_SysError("DuplicateHandle failed");
+    }
+#else  /* !GAUCHE_WINDOWS */
+    install_sampler();
+#endif /* !GAUCHE_WINDOWS */
+
+    ITIMER_START();
+}
+
+int Scm_ProfilerStop(void)
+{
+    if (profAll.active) return prof_stop_all();
+
+    ScmVM *vm = Scm_VM();
+    if (vm->prof == NULL) return 0;
+    if (vm->prof->state != SCM_PROFILER_RUNNING) return 0;
+    ITIMER_STOP();
+#if defined(GAUCHE_WINDOWS)
+    CloseHandle(vm->prof->hTargetThread);
+    vm->prof->hTargetThread = NULL;
+#endif /* GAUCHE_WINDOWS */
+    prof_pause(vm);
+    return vm->prof->totalSamples;
+}
+
+void Scm_ProfilerReset(void)
+{
+    if (profAll.active) {
+        prof_reset_all();
+        return;
+    }
+
+    ScmVM *vm = Scm_VM();
+
+    if (vm->prof == NULL) return;
+    if (vm->prof->state == SCM_PROFILER_INACTIVE) return;
+    if (vm->prof->state == SCM_PROFILER_RUNNING) Scm_ProfilerStop();
+    prof_reset(vm);
+}
+
+/* Returns the statHash.  In all-threads mode, returns a table that
+   sums up the results of all VMs. */
+ScmObj Scm_ProfilerRawResult(void)
+{
+    if (profAll.active) return prof_merge_all();
+
+    ScmVM *vm = Scm_VM();
+
+    if (vm->prof == NULL) return SCM_FALSE;
+    if (vm->prof->state == SCM_PROFILER_INACTIVE) return SCM_FALSE;
+    if (vm->prof->state == SCM_PROFILER_RUNNING) Scm_ProfilerStop();
+    return prof_collect(vm);
+}
+
 #else  /* !GAUCHE_PROFILE */
 void Scm_ProfilerStart(void)
 {
@@ -439,6 +959,11 @@ int  Scm_ProfilerStop(void)
     return 0;
 }
 
+void Scm_ProfilerStartAllThreads(void)
+{
+    Scm_Error("profiler is not supported.");
+}
+
 void Scm_ProfilerReset(void)
 {
     Scm_Error("profiler is not supported.");
@@ -449,4 +974,16 @@ ScmObj Scm_ProfilerRawResult(void)
     Scm_Error("profiler is not supported.");
     return SCM_FALSE;
 }
+
+ScmObj Scm_ProfilerRawThreadResults(void)
+{
+    Scm_Error("profiler is not supported.");
+    return SCM_NIL;
+}
+
+ScmObj Scm_ProfilerRawStacks(void)
+{
+    Scm_Error("profiler is not supported.");
+    return SCM_NIL;
+}
 #endif /* !GAUCHE_PROFILE */
@@ -179,6 +179,49 @@ ScmObj Scm_ReadList(ScmObj port, ScmChar closer)
     return Scm_ReadListWithContext(port, closer, ctx);
 }
 
+/* Read data until EOF and returns a list of them.  Unlike calling
+   Scm_Read repeatedly, the port is locked only once.  Each datum is
+   read separately; e.g. #0# doesn't refer to a label in another datum. */
+static ScmObj read_all(ScmPort *port, ScmReadContext *ctx)
+{
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    for (;;) {
+        if (!(ctx->flags & RCTX_RECURSIVELY)) {
+            ctx->table = NULL;
+            ctx->pending = SCM_NIL;
+        }
+        ScmObj obj = read_item(port, ctx);
+        if (SCM_EOFP(obj)) return h;
+        if (!(ctx->flags & RCTX_RECURSIVELY)) {
+            read_context_flush(ctx);
+        }
+        SCM_APPEND1(h, t, obj);
+    }
+}
+
+ScmObj Scm_ReadAllWithContext(ScmObj port, ScmReadContext *ctx)
+{
+    ScmVM *vm = Scm_VM();
+    volatile ScmObj r = SCM_NIL;
+    if (!SCM_PORTP(port) || SCM_PORT_DIR(port) != SCM_PORT_INPUT) {
+        Scm_Error("input port required: %S", port);
+    }
+    if (PORT_LOCKED(SCM_PORT(port), vm)) {
+        r = read_all(SCM_PORT(port), ctx);
+    } else {
+        PORT_LOCK(SCM_PORT(port), vm);
+        PORT_SAFE_CALL(SCM_PORT(port),
+                       r = read_all(SCM_PORT(port), ctx), /*no cleanup*/);
+        PORT_UNLOCK(SCM_PORT(port));
+    }
+    return r;
+}
+
+ScmObj Scm_ReadAll(ScmObj port)
+{
+    return Scm_ReadAllWithContext(port, Scm_MakeReadContext(NULL));
+}
+
 /*----------------------------------------------------------------
  * Read context
  */
@@ -448,6 +491,16 @@ static void read_nested_comment(ScmPort *port, ScmReadContext *ctx)
 
 static void read_comment(ScmPort *port) /* leading semicolon is already read */
 {
+    const char *end;
+    int eofp;
+    const char *p = PORT_INPUT_SPAN(port, &end, &eofp);
+    if (p != NULL) {
+        const char *nl = memchr(p, '\n', end - p);
+        if (nl != NULL) {
+            PORT_INPUT_SKIP(port, nl+1, 1);
+            return;
+        }
+    }
     for (;;) {
         /* NB: comment may contain unexpected character code.
            for the safety, we read bytes here. */
@@ -461,9 +514,24 @@ static void read_comment(ScmPort *port) /* leading semicolon is already read */
     }
 }
 
+/* Skip ASCII whitespaces in the port's buffer. */
+static void skipws_buffered(ScmPort *port)
+{
+    const char *end;
+    int eofp, nlines = 0;
+    const char *p = PORT_INPUT_SPAN(port, &end, &eofp);
+    if (p == NULL) return;
+    for (; p < end; p++) {
+        if (*p == '\n') nlines++;
+        else if (*p != ' ' && *p != '\t' && *p != '\r' && *p != '\f') break;
+    }
+    PORT_INPUT_SKIP(port, p, nlines);
+}
+
 static int skipws(ScmPort *port, ScmReadContext *ctx)
 {
     for (;;) {
+        skipws_buffered(port);
         int c = Scm_GetcUnsafe(port);
         if (c == EOF) return c;
         if (c <= 127) {
@@ -1036,11 +1104,43 @@ static void read_string_xdigits(ScmPort *port, int key,
     }
 }
 
+/* Fast path of read_string.  If the whole string literal is in the
+   port's buffer and it doesn't contain escapes, we make the string
+   directly from the buffer.  Otherwise returns #f without consuming
+   the input. */
+static ScmObj read_string_buffered(ScmPort *port)
+{
+    const char *end;
+    int eofp, nlines = 0;
+    const char *start = PORT_INPUT_SPAN(port, &end, &eofp);
+    if (start == NULL) return SCM_FALSE;
+    for (const char *p = start; p < end; p++) {
+        switch (*p) {
+        case '"': {
+            int len = Scm_MBLen(start, p);
+            if (len < 0) return SCM_FALSE;
+            ScmObj s = Scm_MakeString(start, p - start, len,
+                                      SCM_STRING_COPYING|SCM_STRING_IMMUTABLE);
+            PORT_INPUT_SKIP(port, p+1, nlines);
+            return s;
+        }
+        case '\\': return SCM_FALSE;
+        case '\n': nlines++; break;
+        }
+    }
+    return SCM_FALSE;
+}
+
 static ScmObj read_string(ScmPort *port, int incompletep,
                           ScmReadContext *ctx)
 {
     int c = 0;
     ScmDString ds;
+
+    if (!incompletep) {
+        ScmObj s = read_string_buffered(port);
+        if (!SCM_FALSEP(s)) return s;
+    }
     Scm_DStringInit(&ds);
 
 #define FETCH(var)                                      \
@@ -1283,6 +1383,119 @@ static ScmObj read_word(ScmPort *port, ScmChar initial, ScmReadContext *ctx,
     }
 }
 
+/* Fast path of read_word.  If the word consists of ASCII characters and
+   the rest of it is in the port's buffer, we copy it into WB and set up
+   WB->str as a temporary string, avoiding Getc for each character and
+   an intermediate DString.  Returns NULL without consuming the input
+   if we can't.  The result is on the caller's stack; it must be copied
+   by word_string if it is to be retained. */
+#define WORD_BUFSIZ 128
+
+struct word_buf {
+    ScmString str;
+    char buf[WORD_BUFSIZ+1];
+};
+
+static ScmString *read_word_buffered(ScmPort *port, ScmChar initial,
+                                     int include_hash_sign,
+                                     struct word_buf *wb)
+{
+    const char *end;
+    int eofp;
+    const char *p = PORT_INPUT_SPAN(port, &end, &eofp);
+    if (p == NULL || SCM_PORT_CASE_FOLDING(port)) return NULL;
+
+    char *q = wb->buf;
+    if (initial != SCM_CHAR_INVALID) {
+        if (initial >= 0x80) return NULL;
+        *q++ = (char)initial;
+    }
+    for (;;) {
+        if (p == end) {
+            if (!eofp) return NULL;   /* the word may continue */
+            break;
+        }
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x80) return NULL;   /* let Getc decode it */
+        if (!char_word_constituent(c, include_hash_sign)) break;
+        if (q == wb->buf + WORD_BUFSIZ) return NULL;
+        *q++ = (char)c;
+        p++;
+    }
+    *q = '\0';
+    PORT_INPUT_SKIP(port, p, 0);
+
+    int size = (int)(q - wb->buf);
+    SCM_SET_CLASS(&wb->str, SCM_CLASS_STRING);
+    wb->str.body = NULL;
+    wb->str.initialBody.flags = SCM_STRING_IMMUTABLE|SCM_STRING_TERMINATED;
+    wb->str.initialBody.length = size;
+    wb->str.initialBody.size = size;
+    wb->str.initialBody.start = wb->buf;
+    return &wb->str;
+}
+
+/* Read a word as read_word does, possibly into a temporary string
+   in WB. */
+static ScmString *read_word_tmp(ScmPort *port, ScmChar initial,
+                                ScmReadContext *ctx, int include_hash_sign,
+                                struct word_buf *wb)
+{
+    ScmString *s = read_word_buffered(port, initial, include_hash_sign, wb);
+    if (s != NULL) return s;
+    return SCM_STRING(read_word(port, initial, ctx, FALSE, include_hash_sign));
+}
+
+/* Returns S itself, or its heap copy if S is the temporary string in WB.
+   Note that Scm_MakeSymbol etc. share the string body, so we need this
+   before passing the word to them. */
+static ScmString *word_string(ScmString *s, struct word_buf *wb)
+{
+    if (s != &wb->str) return s;
+    int size = wb->str.initialBody.size;
+    return SCM_STRING(Scm_MakeString(wb->buf, size, size,
+                                     SCM_STRING_COPYING|SCM_STRING_IMMUTABLE));
+}
+
+/* Returns a symbol named by the word S.  If it is already interned,
+   we don't need to copy the name. */
+static ScmObj word_symbol(ScmString *s, struct word_buf *wb, int interned)
+{
+    if (interned && s == &wb->str) {
+        ScmObj e = Scm__FindSymbol(s);
+        if (!SCM_FALSEP(e)) return e;
+    }
+    return Scm_MakeSymbol(word_string(s, wb), interned);
+}
+
+/* If the word is a decimal integer that fits in a fixnum, returns it.
+   Otherwise returns #f.  It covers most numbers in data files without
+   going through the full number parser. */
+#if SIZEOF_LONG >= 8
+#define FIXNUM_DIGITS 18
+#else
+#define FIXNUM_DIGITS 9
+#endif
+
+static ScmObj word_to_fixnum(ScmString *s)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(s);
+    const char *p = SCM_STRING_BODY_START(b);
+    const char *end = p + SCM_STRING_BODY_SIZE(b);
+    int negative = FALSE;
+
+    if (p < end && (*p == '+' || *p == '-')) negative = (*p++ == '-');
+    if (p == end || end - p > FIXNUM_DIGITS) return SCM_FALSE;
+    long v = 0;
+    for (; p < end; p++) {
+        if (*p < '0' || *p > '9') return SCM_FALSE;
+        v = v*10 + (*p - '0');
+    }
+    if (negative) v = -v;
+    if (v < SCM_SMALL_INT_MIN || v > SCM_SMALL_INT_MAX) return SCM_FALSE;
+    return SCM_MAKE_INT(v);
+}
+
 /* Kaveat: We don't allow '#' in symbols, but we need to read '#'
    for numbers.  To allow weird identifers like '1+', we need to read the
    word as a number fist and convert it to a symbol when the read word
@@ -1299,9 +1512,10 @@ static void check_valid_symbol(ScmString *s)
 /* Read a symbol starting with INITIAL (assuming unescaped), interned. */
 static ScmObj read_symbol(ScmPort *port, ScmChar initial, ScmReadContext *ctx)
 {
-    ScmString *s = SCM_STRING(read_word(port, initial, ctx, FALSE, TRUE));
+    struct word_buf wb;
+    ScmString *s = read_word_tmp(port, initial, ctx, TRUE, &wb);
     check_valid_symbol(s);
-    return Scm_Intern(s);
+    return word_symbol(s, &wb, TRUE);
 }
 
 /* This is called when a symbol (either bare or escaped) is expected
@@ -1315,12 +1529,13 @@ static ScmObj read_immediate_symbol(ScmPort *port, ScmChar initial,
     if (initial == '|') {
         return read_escaped_symbol(port, initial, interned, ctx);
     } else if (char_word_constituent(initial, FALSE)) {
-        ScmString *s = SCM_STRING(read_word(port, initial, ctx, FALSE, TRUE));
+        struct word_buf wb;
+        ScmString *s = read_word_tmp(port, initial, ctx, TRUE, &wb);
         check_valid_symbol(s);
         /* we have to exclude numbers.  a bit ugly - call for cleanup */
         if (!(isdigit(initial) || initial == '+' || initial == '-')
             || SCM_FALSEP(Scm_StringToNumber(s, 10, 0))) {
-            return Scm_MakeSymbol(s, interned);
+            return word_symbol(s, &wb, interned);
         }
     }
     /* If we come here, we have invalid syntax. */
@@ -1336,7 +1551,8 @@ static ScmObj read_immediate_symbol(ScmPort *port, ScmChar initial,
 static ScmObj read_number(ScmPort *port, ScmChar initial, int radix,
                           ScmReadContext *ctx)
 {
-    ScmString *s = SCM_STRING(read_word(port, initial, ctx, FALSE, TRUE));
+    struct word_buf wb;
+    ScmString *s = read_word_tmp(port, initial, ctx, TRUE, &wb);
     u_long flags = radix >=2 ? SCM_NUMBER_FORMAT_ALT_RADIX : 0;
     int default_radix = radix >= 2? radix : 10;
     ScmObj num = Scm_StringToNumber(s, default_radix, flags);
@@ -1353,11 +1569,14 @@ static ScmObj read_number(ScmPort *port, ScmChar initial, int radix,
 
 static ScmObj read_symbol_or_number(ScmPort *port, ScmChar initial, ScmReadContext *ctx)
 {
-    ScmString *s = SCM_STRING(read_word(port, initial, ctx, FALSE, TRUE));
-    ScmObj num = Scm_StringToNumber(s, 10, 0);
+    struct word_buf wb;
+    ScmString *s = read_word_tmp(port, initial, ctx, TRUE, &wb);
+    ScmObj num = word_to_fixnum(s);
+    if (num != SCM_FALSE) return num;
+    num = Scm_StringToNumber(s, 10, 0);
     if (num != SCM_FALSE) return num;
     check_valid_symbol(s);
-    return Scm_Intern(s);
+    return word_symbol(s, &wb, TRUE);
 }
 
 static ScmObj read_keyword(ScmPort *port, ScmReadContext *ctx)
@@ -1368,9 +1587,15 @@ static ScmObj read_keyword(ScmPort *port, ScmReadContext *ctx)
         ScmObj name = read_escaped_symbol(port, c2, FALSE, ctx); /* read as uninterned */
         return Scm_MakeKeyword(SCM_SYMBOL_NAME(name));
     } else {
-        Scm_UngetcUnsafe(c2, port);
-        ScmObj name = read_word(port, SCM_CHAR_INVALID, ctx, FALSE, FALSE);
-        return Scm_MakeKeyword(SCM_STRING(name));
+        struct word_buf wb;
+        ScmString *name;
+        if (char_word_constituent(c2, FALSE)) {
+            name = read_word_tmp(port, c2, ctx, FALSE, &wb);
+        } else {
+            Scm_UngetcUnsafe(c2, port);
+            name = read_word_tmp(port, SCM_CHAR_INVALID, ctx, FALSE, &wb);
+        }
+        return Scm_MakeKeyword(word_string(name, &wb));
     }
 }
 
@@ -39,6 +39,11 @@
 #include "gauche/regexp.h"
 #include "gauche/class.h"
 #include "gauche/priv/builtin-syms.h"
+#include "gauche/priv/lftableP.h"
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#endif
 
 /* I don't like to reinvent wheels, so I looked for a regexp implementation
  * that can handle multibyte encodings and not bound to Unicode.
@@ -170,6 +175,9 @@ enum {
 #define SCM_REGEXP_SIMPLE_PREFIX  (1L<<3) /* The regexp begins with a repeating
                                              character or charset, e.g. #/a+b/.
                                              See is_simple_prefixed() below. */
+#define SCM_REGEXP_LITERAL_PREFIX (1L<<6) /* The regexp begins with mustMatch
+                                             string, e.g. #/ab+/.
+                                             See calculate_must_match(). */
 
 /* AST - the first pass of regexp compiler creates intermediate AST.
  * Alternatively, you can provide AST directly to the regexp compiler,
@@ -241,6 +249,7 @@ static ScmRegexp *make_regexp(void)
     rx->flags = 0;
     rx->pattern = SCM_FALSE;
     rx->ast = SCM_FALSE;
+    rx->dfa = NULL;
     return rx;
 }
 
@@ -256,7 +265,8 @@ static int regexp_compare(ScmObj x, ScmObj y, int equalp)
         || (rx->numGroups != ry->numGroups)
         || (rx->numSets != ry->numSets)
         || !Scm_EqualP(rx->grpNames, ry->grpNames)
-        || (rx->flags != ry->flags)) {
+        || ((rx->flags & ~SCM_REGEXP_ENGINE_MASK)
+            != (ry->flags & ~SCM_REGEXP_ENGINE_MASK))) {
         return 1;
     } else {
         /* we compare bytecode. */
@@ -1876,6 +1886,97 @@ static ScmObj calculate_lasetn(ScmObj ast)
     else return calculate_laset(SCM_CAR(ast), SCM_CDR(ast));
 }
 
+/* Finds the longest run of literal characters that every match must
+   contain, which is used to prefilter the input in Scm_RegExec.
+   We only look at the characters we can reach through sequences,
+   groups and mandatory repetitions, and ignore case-folding parts. */
+typedef struct must_match_ctx_rec {
+    ScmObj run, runTail;        /* the current run of characters */
+    int runLen;
+    int runAtStart;             /* TRUE if the run begins the pattern */
+    ScmObj best;                /* the longest run so far */
+    int bestLen;
+    int bestAtStart;
+    int atStart;                /* TRUE if we've only seen characters */
+    int casefoldp;
+} must_match_ctx;
+
+static void mm_break(must_match_ctx *mm)
+{
+    if (mm->runLen > mm->bestLen) {
+        mm->best = mm->run;
+        mm->bestLen = mm->runLen;
+        mm->bestAtStart = mm->runAtStart;
+    }
+    mm->run = mm->runTail = SCM_NIL;
+    mm->runLen = 0;
+    mm->atStart = FALSE;
+}
+
+static void mm_rec(must_match_ctx *mm, ScmObj ast);
+
+static void mm_seq(must_match_ctx *mm, ScmObj seq)
+{
+    ScmObj cp;
+    SCM_FOR_EACH(cp, seq) mm_rec(mm, SCM_CAR(cp));
+}
+
+static void mm_rec(must_match_ctx *mm, ScmObj ast)
+{
+    if (SCM_CHARP(ast) && !mm->casefoldp) {
+        if (mm->runLen == 0) mm->runAtStart = mm->atStart;
+        SCM_APPEND1(mm->run, mm->runTail, ast);
+        mm->runLen++;
+        return;
+    }
+    if (SCM_PAIRP(ast)) {
+        ScmObj type = SCM_CAR(ast);
+        if (SCM_EQ(type, SCM_SYM_SEQ)) {
+            mm_seq(mm, SCM_CDR(ast));
+            return;
+        }
+        if (SCM_INTP(type)) {
+            mm_seq(mm, SCM_CDDR(ast));
+            return;
+        }
+        if (SCM_EQ(type, SCM_SYM_SEQ_UNCASE)
+            || SCM_EQ(type, SCM_SYM_SEQ_CASE)) {
+            int oldcase = mm->casefoldp;
+            mm->casefoldp = SCM_EQ(type, SCM_SYM_SEQ_UNCASE);
+            mm_seq(mm, SCM_CDR(ast));
+            mm->casefoldp = oldcase;
+            return;
+        }
+        if ((SCM_EQ(type, SCM_SYM_REP) || SCM_EQ(type, SCM_SYM_REP_MIN)
+             || SCM_EQ(type, SCM_SYM_REP_WHILE))
+            && SCM_INT_VALUE(SCM_CADR(ast)) > 0) {
+            mm_break(mm);
+            mm_seq(mm, SCM_CDR(SCM_CDDR(ast)));
+            mm_break(mm);
+            return;
+        }
+    }
+    mm_break(mm);
+}
+
+static void calculate_must_match(regcomp_ctx *ctx, ScmObj ast)
+{
+    must_match_ctx mm;
+    mm.run = mm.runTail = mm.best = SCM_NIL;
+    mm.runLen = mm.bestLen = 0;
+    mm.runAtStart = mm.bestAtStart = FALSE;
+    mm.atStart = TRUE;
+    mm.casefoldp = ctx->casefoldp;
+    mm_rec(&mm, ast);
+    mm_break(&mm);
+    if (mm.bestLen > 0) {
+        ctx->rx->mustMatch = SCM_STRING(Scm_ListToString(mm.best));
+        if (mm.bestAtStart) ctx->rx->flags |= SCM_REGEXP_LITERAL_PREFIX;
+    }
+}
+
+static void *regexp_dfa_make(ScmRegexp *rx, ScmObj ast); /* Lazy DFA */
+
 /* pass 3 */
 static ScmObj rc3(regcomp_ctx *ctx, ScmObj ast)
 {
@@ -1883,6 +1984,7 @@ static ScmObj rc3(regcomp_ctx *ctx, ScmObj ast)
     if (is_bol_anchored(ast)) ctx->rx->flags |= SCM_REGEXP_BOL_ANCHORED;
     else if (is_simple_prefixed(ast)) ctx->rx->flags |= SCM_REGEXP_SIMPLE_PREFIX;
     ctx->rx->laset = calculate_laset(ast, SCM_NIL);
+    calculate_must_match(ctx, ast);
 
     /* pass 3-1 : count # of insns */
     ctx->codemax = 1;
@@ -1897,6 +1999,14 @@ static ScmObj rc3(regcomp_ctx *ctx, ScmObj ast)
     ctx->rx->code = ctx->code;
     ctx->rx->numCodes = ctx->codep;
 
+    /* prepare DFA if possible */
+    if (!(ctx->rx->flags & SCM_REGEXP_BACKTRACK)) {
+        ctx->rx->dfa = regexp_dfa_make(ctx->rx, ast);
+        if (ctx->rx->dfa == NULL && (ctx->rx->flags & SCM_REGEXP_DFA)) {
+            Scm_Error("regexp can't be run by DFA engine: %S", ctx->pattern);
+        }
+    }
+
     ctx->rx->ast = ast;
     return SCM_OBJ(ctx->rx);
 }
@@ -1909,6 +2019,8 @@ void Scm_RegDump(ScmRegexp *rx)
         Scm_Printf(SCM_CUROUT, ",BOL_ANCHORED");
     if (rx->flags&SCM_REGEXP_SIMPLE_PREFIX)
         Scm_Printf(SCM_CUROUT, ",SIMPLE_PREFIX");
+    if (rx->flags&SCM_REGEXP_LITERAL_PREFIX)
+        Scm_Printf(SCM_CUROUT, ",LITERAL_PREFIX");
     Scm_Printf(SCM_CUROUT, ")\n");
     Scm_Printf(SCM_CUROUT, " laset = %S\n", rx->laset);
     Scm_Printf(SCM_CUROUT, "  must = ");
@@ -2247,7 +2359,7 @@ ScmObj Scm_RegComp(ScmString *pattern, int flags)
     regcomp_ctx cctx;
     rc_ctx_init(&cctx, rx, pattern);
     cctx.casefoldp = flags & SCM_REGEXP_CASE_FOLD;
-    rx->flags |= (flags & SCM_REGEXP_CASE_FOLD);
+    rx->flags |= (flags & (SCM_REGEXP_CASE_FOLD|SCM_REGEXP_ENGINE_MASK));
 
     /* pass 1 : parse regexp spec */
     ScmObj ast = rc1(&cctx);
@@ -2766,8 +2878,24 @@ static void rex_rec(const unsigned char *code,
     }
 }
 
+static struct ScmRegMatchSub **make_submatches(int numGroups)
+{
+    struct ScmRegMatchSub **matches =
+        SCM_NEW_ARRAY(struct ScmRegMatchSub *, numGroups);
+
+    for (int i = 0; i < numGroups; i++) {
+        matches[i] = SCM_NEW(struct ScmRegMatchSub);
+        matches[i]->start = -1;
+        matches[i]->length = -1;
+        matches[i]->after = -1;
+        matches[i]->startp = NULL;
+        matches[i]->endp = NULL;
+    }
+    return matches;
+}
+
 static ScmObj make_match(ScmRegexp *rx, ScmString *orig,
-                         struct match_ctx *ctx)
+                         struct ScmRegMatchSub **matches)
 {
     ScmRegMatch *rm = SCM_NEW(ScmRegMatch);
     SCM_SET_CLASS(rm, SCM_CLASS_REGMATCH);
@@ -2780,7 +2908,7 @@ static ScmObj make_match(ScmRegexp *rx, ScmString *orig,
     rm->input = SCM_STRING_BODY_START(origb);
     rm->inputLen = SCM_STRING_BODY_LENGTH(origb);
     rm->inputSize = SCM_STRING_BODY_SIZE(origb);
-    rm->matches = ctx->matches;
+    rm->matches = matches;
     return SCM_OBJ(rm);
 }
 
@@ -2796,22 +2924,13 @@ static ScmObj rex(ScmRegexp *rx, ScmString *orig,
     ctx.stop = end;
     ctx.begin_stack = (void*)&ctx;
     ctx.cont = &cont;
-    ctx.matches = SCM_NEW_ARRAY(struct ScmRegMatchSub *, rx->numGroups);
-
-    for (int i = 0; i < rx->numGroups; i++) {
-        ctx.matches[i] = SCM_NEW(struct ScmRegMatchSub);
-        ctx.matches[i]->start = -1;
-        ctx.matches[i]->length = -1;
-        ctx.matches[i]->after = -1;
-        ctx.matches[i]->startp = NULL;
-        ctx.matches[i]->endp = NULL;
-    }
+    ctx.matches = make_submatches(rx->numGroups);
 
     if (sigsetjmp(cont, FALSE) == 0) {
         rex_rec(ctx.codehead, start, &ctx);
         return SCM_FALSE;
     }
-    return make_match(rx, orig, &ctx);
+    return make_match(rx, orig, ctx.matches);
 }
 
 /* advance start pointer while the character matches (skip_match=TRUE) or does
@@ -2832,6 +2951,711 @@ static inline const char *skip_input(const char *start, const char *limit,
     return limit;
 }
 
+/*----------------------------------------------------------------------
+ * Lazy DFA
+ *
+ *  Regexps without backreferences, lookaround, conditionals, standalone
+ *  groups and word boundary assertions can also be run by a DFA, which
+ *  reads each input character at most twice no matter how much
+ *  backtracking rex_rec() would need for the same pattern.
+ *
+ *  We translate the AST (after rc2_optimize) into two NFAs, one to run
+ *  forward and another to run backward, and build DFA states from them
+ *  on demand as the matcher proceeds.
+ *
+ *  A DFA state of the forward NFA keeps the NFA threads in the order
+ *  rex_rec() tries them, and drops the threads with lower priority than
+ *  a matching one.  So the forward scan finds the same match end as
+ *  the backtracking matcher.  Unless the regexp is BOL_ANCHORED, the
+ *  forward NFA has implicit lazy .*? in front of it so that it scans
+ *  all start positions at once.  The backward NFA is run from the
+ *  match end toward the beginning of the input, to find the leftmost
+ *  position the match can start.  If the regexp has submatches, we run
+ *  rex() once from that position to fill them.
+ *
+ *  DFA states are shared by all threads.  New states and transitions
+ *  are created while holding the mutex of each DFA, and published by
+ *  release stores, so the scanning loop doesn't need locking once the
+ *  states it needs are there.  Transitions by ASCII chars are kept in
+ *  a table indexed by the char; the ones by non-ASCII chars are cached
+ *  in a small table indexed by the lower bits of the char, so that
+ *  multibyte text mostly runs without locking, too.  If we get more
+ *  than DFA_MAX_STATES, we discard the state table and start over; the
+ *  states in use by other threads are left to GC.  If it happens too
+ *  often in one search, we give up and fall back to the backtracking
+ *  matcher, unless the DFA engine is explicitly requested.
+ */
+
+enum {
+    NFA_CHAR,                   /* matches ch */
+    NFA_CHAR_CI,                /* matches ch (downcased) case-insensitively */
+    NFA_SET,                    /* matches cs */
+    NFA_NSET,                   /* matches complement of cs */
+    NFA_ANY,                    /* matches any char */
+    NFA_SPLIT,                  /* try x, then y */
+    NFA_AT_FIRST,               /* at the starting point of the scan */
+    NFA_AT_LAST,                /* at the end point of the scan */
+    NFA_MATCH                   /* success */
+};
+
+typedef struct nfa_insn_rec {
+    int op;
+    int x;                      /* next insn */
+    int y;                      /* alternative next insn for NFA_SPLIT */
+    ScmChar ch;
+    ScmCharSet *cs;
+} nfa_insn;
+
+#define NFA_MAX_INSNS  4096
+#define NFA_FAIL       (-1)
+
+typedef struct nfa_builder_rec {
+    nfa_insn *insns;
+    int numInsns;
+    int size;                   /* allocated size of insns */
+    int reverse;                /* TRUE if building backward NFA */
+    int casefoldp;
+} nfa_builder;
+
+/* Returns the index of the new insn, or NFA_FAIL if we can't add it,
+   or either of the destinations is NFA_FAIL. */
+static int nfa_emit(nfa_builder *b, int op, int x, int y)
+{
+    if (x == NFA_FAIL || y == NFA_FAIL) return NFA_FAIL;
+    if (b->numInsns >= NFA_MAX_INSNS) return NFA_FAIL;
+    if (b->numInsns == b->size) {
+        nfa_insn *n = SCM_NEW_ARRAY(nfa_insn, b->size*2);
+        memcpy(n, b->insns, sizeof(nfa_insn)*b->numInsns);
+        b->insns = n;
+        b->size *= 2;
+    }
+    nfa_insn *i = &b->insns[b->numInsns];
+    i->op = op;
+    i->x = x;
+    i->y = y;
+    i->ch = 0;
+    i->cs = NULL;
+    return b->numInsns++;
+}
+
+static int nfa_emit_char(nfa_builder *b, int op, ScmChar ch, int next)
+{
+    int i = nfa_emit(b, op, next, 0);
+    if (i != NFA_FAIL) b->insns[i].ch = ch;
+    return i;
+}
+
+static int nfa_emit_set(nfa_builder *b, int op, ScmObj cs, int next)
+{
+    int i = nfa_emit(b, op, next, 0);
+    if (i != NFA_FAIL) b->insns[i].cs = SCM_CHAR_SET(cs);
+    return i;
+}
+
+/* Chains the entries with SPLITs, so that they're tried in the order. */
+static int nfa_choice(nfa_builder *b, int *entries, int n)
+{
+    int s = entries[n-1];
+    for (int k = n-2; k >= 0; k--) s = nfa_emit(b, NFA_SPLIT, entries[k], s);
+    return s;
+}
+
+/* The builder works in continuation-passing style; each routine
+   returns the entry of the NFA that matches AST and then goes to NEXT.
+   LASTP has the same meaning as in rc3_rec. */
+static int nfa_rec(nfa_builder *b, ScmObj ast, int lastp, int next);
+
+static int nfa_seq(nfa_builder *b, ScmObj seq, int lastp, int next)
+{
+    /* We build from the item the scan reaches last. */
+    ScmObj items = b->reverse? seq : Scm_Reverse(seq);
+    ScmObj cp;
+    SCM_FOR_EACH(cp, items) {
+        int p = lastp && (b->reverse
+                          ? SCM_NULLP(SCM_CDR(cp))
+                          : SCM_EQ(cp, items));
+        next = nfa_rec(b, SCM_CAR(cp), p, next);
+    }
+    return next;
+}
+
+/* The optional part of (rep <m> <n> . <x>), that is, (rep 0 <n-m> . <x>).
+   For the limited repeat, we chain <n-m> copies of <x> and enter into
+   the chain to choose the number of iterations, in the order
+   rc3_minmax tries them. */
+static int nfa_rep_optional(nfa_builder *b, int greedy, int count,
+                            ScmObj item, int next)
+{
+    if (count < 0) {
+        int loop = nfa_emit(b, NFA_SPLIT, 0, 0);
+        if (loop == NFA_FAIL) return NFA_FAIL;
+        int body = nfa_seq(b, item, FALSE, loop);
+        if (body == NFA_FAIL) return NFA_FAIL;
+        b->insns[loop].x = greedy? body : next;
+        b->insns[loop].y = greedy? next : body;
+        return loop;
+    }
+    if (count == 0) return next;
+
+    /* entries[k] runs count-k copies */
+    int *entries = SCM_NEW_ATOMIC_ARRAY(int, count+1);
+    entries[count] = next;
+    for (int k = count-1; k >= 0; k--) {
+        entries[k] = nfa_seq(b, item, FALSE, entries[k+1]);
+    }
+    if (!greedy) {
+        for (int k = 0, j = count; k < j; k++, j--) {
+            int t = entries[k]; entries[k] = entries[j]; entries[j] = t;
+        }
+    }
+    return nfa_choice(b, entries, count+1);
+}
+
+static int nfa_rep(nfa_builder *b, ScmObj ast, int next)
+{
+    ScmObj min = SCM_CADR(ast), max = SCM_CAR(SCM_CDDR(ast));
+    ScmObj item = SCM_CDR(SCM_CDDR(ast));
+    int greedy = !SCM_EQ(SCM_CAR(ast), SCM_SYM_REP_MIN);
+    int nmin = SCM_INT_VALUE(min);
+    int count = SCM_FALSEP(max)? -1 : SCM_INT_VALUE(max) - nmin;
+    int multip = SCM_FALSEP(max) || SCM_INT_VALUE(max) > 1;
+
+    /* NB: rep-while is run as rep.  rc2_optimize only creates it where
+       it doesn't change the result. */
+    if (!b->reverse) next = nfa_rep_optional(b, greedy, count, item, next);
+    for (int k = 0; k < nmin; k++) {
+        /* The last mandatory copy gets LASTP as rc3_seq_rep does. */
+        int p = multip && (b->reverse? k == nmin-1 : k == 0);
+        next = nfa_seq(b, item, p, next);
+    }
+    if (b->reverse) next = nfa_rep_optional(b, greedy, count, item, next);
+    return next;
+}
+
+static int nfa_rec(nfa_builder *b, ScmObj ast, int lastp, int next)
+{
+    if (next == NFA_FAIL) return NFA_FAIL;
+
+    if (SCM_CHARP(ast)) {
+        return nfa_emit_char(b, b->casefoldp? NFA_CHAR_CI : NFA_CHAR,
+                             SCM_CHAR_VALUE(ast), next);
+    }
+    if (SCM_CHAR_SET_P(ast)) return nfa_emit_set(b, NFA_SET, ast, next);
+    if (SCM_EQ(ast, SCM_SYM_ANY)) return nfa_emit(b, NFA_ANY, next, 0);
+    if (SCM_EQ(ast, SCM_SYM_BOL)) {
+        return nfa_emit(b, b->reverse? NFA_AT_LAST : NFA_AT_FIRST, next, 0);
+    }
+    if (SCM_EQ(ast, SCM_SYM_EOL)) {
+        if (lastp) {
+            return nfa_emit(b, b->reverse? NFA_AT_FIRST : NFA_AT_LAST,
+                            next, 0);
+        }
+        return nfa_emit_char(b, NFA_CHAR, '$', next);
+    }
+    if (!SCM_PAIRP(ast)) return NFA_FAIL; /* wb, nwb */
+
+    ScmObj type = SCM_CAR(ast);
+    if (SCM_EQ(type, SCM_SYM_COMP)) {
+        return nfa_emit_set(b, NFA_NSET, SCM_CDR(ast), next);
+    }
+    if (SCM_EQ(type, SCM_SYM_SEQ)) {
+        return nfa_seq(b, SCM_CDR(ast), lastp, next);
+    }
+    if (SCM_INTP(type)) {
+        return nfa_seq(b, SCM_CDDR(ast), lastp, next);
+    }
+    if (SCM_EQ(type, SCM_SYM_SEQ_UNCASE)
+        || SCM_EQ(type, SCM_SYM_SEQ_CASE)) {
+        int oldcase = b->casefoldp;
+        b->casefoldp = SCM_EQ(type, SCM_SYM_SEQ_UNCASE);
+        int r = nfa_seq(b, SCM_CDR(ast), lastp, next);
+        b->casefoldp = oldcase;
+        return r;
+    }
+    if (SCM_EQ(type, SCM_SYM_ALT)) {
+        int n = Scm_Length(SCM_CDR(ast));
+        if (n <= 0) return NFA_FAIL;
+        int *entries = SCM_NEW_ATOMIC_ARRAY(int, n);
+        ScmObj cp;
+        int k = 0;
+        SCM_FOR_EACH(cp, SCM_CDR(ast)) {
+            entries[k++] = nfa_rec(b, SCM_CAR(cp), lastp, next);
+        }
+        return nfa_choice(b, entries, n);
+    }
+    if (SCM_EQ(type, SCM_SYM_REP) || SCM_EQ(type, SCM_SYM_REP_MIN)
+        || SCM_EQ(type, SCM_SYM_REP_WHILE)) {
+        return nfa_rep(b, ast, next);
+    }
+    /* once, assert, nassert, lookbehind, backref, cpat */
+    return NFA_FAIL;
+}
+
+typedef struct dfa_state_rec dfa_state;
+
+typedef struct dfa_wide_rec {
+    ScmChar ch;
+    dfa_state *next;
+} dfa_wide;
+
+#define DFA_WIDE_CACHE_SIZE  32 /* must be a power of 2 */
+
+struct dfa_state_rec {
+    AO_t next[128];             /* dfa_state* by ASCII char, or 0 */
+    AO_t wide[DFA_WIDE_CACHE_SIZE]; /* dfa_wide*; the last transition by
+                                   non-ASCII char with the same lower
+                                   bits, or 0 */
+    dfa_state *chain;           /* hash chain */
+    u_long hashval;
+    int match;                  /* TRUE if insns has NFA_MATCH */
+    int atLast;                 /* TRUE if insns has NFA_AT_LAST */
+    int numInsns;
+    int insns[1];               /* NFA insns waiting for input, in the
+                                   priority order.  Variable length. */
+};
+
+#define DFA_NUM_BUCKETS  1024
+#define DFA_MAX_STATES   1000   /* # of states before discarding them */
+#define DFA_MAX_FLUSHES  8      /* # of discards in one search we allow */
+#define DFA_MIN_INPUT    64     /* see use_dfa_p() */
+
+typedef struct dfa_rec {
+    const nfa_insn *insns;
+    int numInsns;
+    int start;                  /* entry of NFA */
+    int leftmostFirst;          /* if TRUE, drop threads after NFA_MATCH */
+    AO_t initial[2];            /* initial states, indexed by at_first */
+    u_long numFlushes;          /* # of discards of the state table */
+    ScmInternalMutex mutex;
+
+    /* The rest is only accessed while holding the mutex. */
+    dfa_state **buckets;
+    int numStates;
+    int *mark;                  /* for each insn, markGen if visited */
+    int markGen;
+    int *stack;                 /* work area of dfa_closure */
+    int *list;                  /* NFA insns of the state being built */
+} dfa;
+
+typedef struct regexp_dfa_rec {
+    dfa *forward;
+    dfa *backward;
+} regexp_dfa;
+
+static dfa *dfa_make(ScmRegexp *rx, ScmObj ast, int reverse)
+{
+    nfa_builder b;
+    b.size = 32;
+    b.insns = SCM_NEW_ARRAY(nfa_insn, b.size);
+    b.numInsns = 0;
+    b.reverse = reverse;
+    b.casefoldp = rx->flags & SCM_REGEXP_CASE_FOLD;
+
+    int start = nfa_rec(&b, ast, TRUE, nfa_emit(&b, NFA_MATCH, 0, 0));
+    if (!reverse && !(rx->flags & SCM_REGEXP_BOL_ANCHORED)) {
+        /* implicit .*? */
+        int loop = nfa_emit(&b, NFA_SPLIT, start, 0);
+        int any = nfa_emit(&b, NFA_ANY, loop, 0);
+        if (any != NFA_FAIL) b.insns[loop].y = any;
+        start = (any == NFA_FAIL)? NFA_FAIL : loop;
+    }
+    if (start == NFA_FAIL) return NULL;
+
+    dfa *d = SCM_NEW(dfa);
+    d->insns = b.insns;
+    d->numInsns = b.numInsns;
+    d->start = start;
+    d->leftmostFirst = !reverse;
+    d->initial[0] = d->initial[1] = 0;
+    d->numFlushes = 0;
+    SCM_INTERNAL_MUTEX_INIT(d->mutex);
+    d->buckets = NULL;          /* allocated on demand */
+    d->numStates = 0;
+    d->mark = NULL;
+    d->markGen = 0;
+    d->stack = NULL;
+    d->list = NULL;
+    return d;
+}
+
+/* Called from rc3.  Returns NULL if the regexp can't be run by DFA. */
+static void *regexp_dfa_make(ScmRegexp *rx, ScmObj ast)
+{
+    dfa *f = dfa_make(rx, ast, FALSE);
+    if (f == NULL) return NULL;
+    dfa *b = dfa_make(rx, ast, TRUE);
+    if (b == NULL) return NULL;
+    regexp_dfa *rd = SCM_NEW(regexp_dfa);
+    rd->forward = f;
+    rd->backward = b;
+    return rd;
+}
+
+static int nfa_insn_match(const nfa_insn *i, ScmChar ch)
+{
+    switch (i->op) {
+    case NFA_CHAR:    return ch == i->ch;
+    case NFA_CHAR_CI: return Scm_CharDowncase(ch) == i->ch;
+    case NFA_SET:     return Scm_CharSetContains(i->cs, ch);
+    case NFA_NSET:    return !Scm_CharSetContains(i->cs, ch);
+    case NFA_ANY:     return TRUE;
+    default:          return FALSE;
+    }
+}
+
+/* The following routines must be called while holding d->mutex. */
+
+static void dfa_new_mark(dfa *d)
+{
+    if (d->mark == NULL) {
+        d->mark = SCM_NEW_ATOMIC_ARRAY(int, d->numInsns);
+        d->stack = SCM_NEW_ATOMIC_ARRAY(int, d->numInsns*2+1);
+        d->list = SCM_NEW_ATOMIC_ARRAY(int, d->numInsns);
+        d->markGen = INT_MAX;
+    }
+    if (d->markGen == INT_MAX) {
+        memset(d->mark, 0, sizeof(int)*d->numInsns);
+        d->markGen = 0;
+    }
+    d->markGen++;
+}
+
+/* Adds the NFA insns reachable from PC without reading input to
+   d->list[*count..], in the priority order.  AT_FIRST and AT_LAST tell
+   whether the corresponding assertions hold. */
+static void dfa_closure(dfa *d, int pc, int at_first, int at_last, int *count)
+{
+    int sp = 0;
+    d->stack[sp++] = pc;
+    while (sp > 0) {
+        pc = d->stack[--sp];
+        if (d->mark[pc] == d->markGen) continue;
+        d->mark[pc] = d->markGen;
+        const nfa_insn *i = &d->insns[pc];
+        switch (i->op) {
+        case NFA_SPLIT:
+            d->stack[sp++] = i->y;
+            d->stack[sp++] = i->x;
+            break;
+        case NFA_AT_FIRST:
+            if (at_first) d->stack[sp++] = i->x;
+            break;
+        case NFA_AT_LAST:
+            if (at_last) d->stack[sp++] = i->x;
+            else d->list[(*count)++] = pc;
+            break;
+        default:
+            d->list[(*count)++] = pc;
+        }
+    }
+}
+
+static void dfa_flush(dfa *d)
+{
+    d->buckets = SCM_NEW_ARRAY(dfa_state*, DFA_NUM_BUCKETS);
+    for (int k = 0; k < DFA_NUM_BUCKETS; k++) d->buckets[k] = NULL;
+    d->numStates = 0;
+    Scm__LFPublish(&d->initial[0], NULL);
+    Scm__LFPublish(&d->initial[1], NULL);
+}
+
+/* Returns the state of the NFA insns in d->list[0..n). */
+static dfa_state *dfa_intern(dfa *d, int n)
+{
+    u_long h = 2166136261UL;
+    for (int k = 0; k < n; k++) {
+        h = (h ^ (u_long)d->list[k]) * 16777619UL;
+    }
+    if (d->buckets == NULL) dfa_flush(d);
+
+    for (dfa_state *s = d->buckets[h & (DFA_NUM_BUCKETS-1)]; s; s = s->chain) {
+        if (s->hashval == h && s->numInsns == n
+            && memcmp(s->insns, d->list, sizeof(int)*n) == 0) {
+            return s;
+        }
+    }
+    if (d->numStates >= DFA_MAX_STATES) {
+        dfa_flush(d);
+        d->numFlushes++;
+    }
+
+    dfa_state *s = SCM_NEW2(dfa_state*, sizeof(dfa_state) + sizeof(int)*n);
+    for (int c = 0; c < 128; c++) s->next[c] = 0;
+    for (int c = 0; c < DFA_WIDE_CACHE_SIZE; c++) s->wide[c] = 0;
+    s->hashval = h;
+    s->match = s->atLast = FALSE;
+    s->numInsns = n;
+    for (int k = 0; k < n; k++) {
+        s->insns[k] = d->list[k];
+        if (d->insns[d->list[k]].op == NFA_MATCH) s->match = TRUE;
+        if (d->insns[d->list[k]].op == NFA_AT_LAST) s->atLast = TRUE;
+    }
+    s->chain = d->buckets[h & (DFA_NUM_BUCKETS-1)];
+    d->buckets[h & (DFA_NUM_BUCKETS-1)] = s;
+    d->numStates++;
+    return s;
+}
+
+/* The following routines lock d->mutex by themselves. */
+
+static dfa_state *dfa_initial(dfa *d, int at_first)
+{
+    dfa_state *s = (dfa_state*)Scm__LFLoad(&d->initial[at_first]);
+    if (s) return s;
+
+    SCM_INTERNAL_MUTEX_LOCK(d->mutex);
+    int n = 0;
+    dfa_new_mark(d);
+    dfa_closure(d, d->start, at_first, FALSE, &n);
+    s = dfa_intern(d, n);
+    Scm__LFPublish(&d->initial[at_first], s);
+    SCM_INTERNAL_MUTEX_UNLOCK(d->mutex);
+    return s;
+}
+
+/* Computes the state after reading CH from S, and records it. */
+static dfa_state *dfa_transit(dfa *d, dfa_state *s, ScmChar ch)
+{
+    SCM_INTERNAL_MUTEX_LOCK(d->mutex);
+    int n = 0;
+    dfa_new_mark(d);
+    for (int k = 0; k < s->numInsns; k++) {
+        const nfa_insn *i = &d->insns[s->insns[k]];
+        if (i->op == NFA_MATCH) {
+            if (d->leftmostFirst) break;
+            continue;
+        }
+        if (nfa_insn_match(i, ch)) dfa_closure(d, i->x, FALSE, FALSE, &n);
+    }
+    dfa_state *ns = dfa_intern(d, n);
+    if (ch >= 0 && ch < 128) {
+        Scm__LFPublish(&s->next[ch], ns);
+    } else {
+        dfa_wide *w = SCM_NEW(dfa_wide);
+        w->ch = ch;
+        w->next = ns;
+        Scm__LFPublish(&s->wide[ch & (DFA_WIDE_CACHE_SIZE-1)], w);
+    }
+    SCM_INTERNAL_MUTEX_UNLOCK(d->mutex);
+    return ns;
+}
+
+/* Returns TRUE if S matches at the end of the scan.  AT_FIRST is TRUE
+   if the scan hasn't read any input. */
+static int dfa_final_match(dfa *d, dfa_state *s, int at_first)
+{
+    if (s->match) return TRUE;
+    if (!s->atLast) return FALSE;
+
+    int n = 0, found = FALSE;
+    SCM_INTERNAL_MUTEX_LOCK(d->mutex);
+    dfa_new_mark(d);
+    for (int k = 0; k < s->numInsns; k++) {
+        const nfa_insn *i = &d->insns[s->insns[k]];
+        if (i->op == NFA_AT_LAST) dfa_closure(d, i->x, at_first, TRUE, &n);
+    }
+    for (int k = 0; k < n; k++) {
+        if (d->insns[d->list[k]].op == NFA_MATCH) { found = TRUE; break; }
+    }
+    SCM_INTERNAL_MUTEX_UNLOCK(d->mutex);
+    return found;
+}
+
+/* Returns the cached transition from S by non-ASCII CH, or NULL. */
+static inline dfa_state *dfa_next_wide(dfa_state *s, ScmChar ch)
+{
+    dfa_wide *w =
+        (dfa_wide*)Scm__LFLoad(&s->wide[ch & (DFA_WIDE_CACHE_SIZE-1)]);
+    return (w && w->ch == ch)? w->next : NULL;
+}
+
+static const char dfa_gave_up;
+#define DFA_GAVE_UP  (&dfa_gave_up)
+
+/* Forward scan of the input beginning at START, from FROM.  Returns
+   the end of the match, NULL if no match, or DFA_GAVE_UP. */
+static const char *dfa_scan_forward(dfa *d, const char *start,
+                                    const char *from, const char *end,
+                                    int persistent)
+{
+    u_long flushes = d->numFlushes;
+    dfa_state *s = dfa_initial(d, from == start);
+    const char *p = from, *matched = NULL;
+
+    while (s->numInsns > 0) {
+        if (s->match) matched = p;
+        if (p == end) {
+            if (dfa_final_match(d, s, p == start)) matched = p;
+            break;
+        }
+        ScmChar ch = (unsigned char)*p;
+        dfa_state *ns;
+        if (ch < 128) {
+            p++;
+            ns = (dfa_state*)Scm__LFLoad(&s->next[ch]);
+        } else {
+            SCM_CHAR_GET(p, ch);
+            p += SCM_CHAR_NBYTES(ch);
+            ns = dfa_next_wide(s, ch);
+        }
+        if (ns == NULL) {
+            ns = dfa_transit(d, s, ch);
+            if (!persistent && d->numFlushes - flushes > DFA_MAX_FLUSHES) {
+                return DFA_GAVE_UP;
+            }
+        }
+        s = ns;
+    }
+    return matched;
+}
+
+/* Backward scan from FROM down to START.  Returns the leftmost
+   position from which the regexp matches up to FROM. */
+static const char *dfa_scan_backward(dfa *d, const char *start,
+                                     const char *from, const char *end,
+                                     int persistent)
+{
+    u_long flushes = d->numFlushes;
+    dfa_state *s = dfa_initial(d, from == end);
+    const char *p = from, *matched = NULL;
+
+    while (s->numInsns > 0) {
+        if (s->match) matched = p;
+        if (p == start) {
+            if (dfa_final_match(d, s, p == end)) matched = p;
+            break;
+        }
+        const char *q;
+        ScmChar ch;
+        SCM_CHAR_BACKWARD(p, start, q);
+        SCM_CHAR_GET(q, ch);
+        p = q;
+        dfa_state *ns;
+        if (ch < 128) {
+            ns = (dfa_state*)Scm__LFLoad(&s->next[ch]);
+        } else {
+            ns = dfa_next_wide(s, ch);
+        }
+        if (ns == NULL) {
+            ns = dfa_transit(d, s, ch);
+            if (!persistent && d->numFlushes - flushes > DFA_MAX_FLUSHES) {
+                return DFA_GAVE_UP;
+            }
+        }
+        s = ns;
+    }
+    return matched;
+}
+
+/* Returns the match, #f, or SCM_UNDEFINED if the caller should run
+   the backtracking matcher instead.  The match doesn't start before
+   FROM. */
+static ScmObj dfa_exec(ScmRegexp *rx, ScmString *orig, const char *start,
+                       const char *from, const char *end)
+{
+    regexp_dfa *rd = (regexp_dfa*)rx->dfa;
+    int persistent = rx->flags & SCM_REGEXP_DFA;
+
+    const char *mend = dfa_scan_forward(rd->forward, start, from, end,
+                                        persistent);
+    if (mend == DFA_GAVE_UP) return SCM_UNDEFINED;
+    if (mend == NULL) return SCM_FALSE;
+    const char *mstart = dfa_scan_backward(rd->backward, start, mend, end,
+                                           persistent);
+    if (mstart == DFA_GAVE_UP || mstart == NULL) return SCM_UNDEFINED;
+
+    if (rx->numGroups > 1) {
+        ScmObj r = rex(rx, orig, mstart, end);
+        return SCM_FALSEP(r)? SCM_UNDEFINED : r;
+    }
+    struct ScmRegMatchSub **matches = make_submatches(rx->numGroups);
+    matches[0]->startp = mstart;
+    matches[0]->endp = mend;
+    return make_match(rx, orig, matches);
+}
+
+/* Whether we run DFA for the input of SIZE bytes.  If the regexp has
+   submatches, we need to run rex() anyway, so we use DFA only when
+   the input is long enough to pay off. */
+static int use_dfa_p(ScmRegexp *rx, ScmSmallInt size)
+{
+    if (rx->dfa == NULL) return FALSE;
+    if (rx->flags & SCM_REGEXP_DFA) return TRUE;
+    if (rx->numGroups <= 1) return TRUE;
+    return !(rx->flags & SCM_REGEXP_BOL_ANCHORED) && size >= DFA_MIN_INPUT;
+}
+
+/*----------------------------------------------------------------------
+ * Prefilter
+ *
+ *  If the regexp has mustMatch string, we look for it in the input
+ *  before trying to match; if it isn't there, the regexp can't match.
+ *  If the regexp begins with it (LITERAL_PREFIX), the match can only
+ *  start where it occurs, so we can jump to those positions.
+ *  The search runs much faster than trying the match at each position
+ *  in the input.
+ */
+
+/* Don't bother with short input */
+#define PREFILTER_MIN_INPUT  256
+
+/* Returns the first occurrence of LIT (LEN bytes) in [P, END), or NULL. */
+static const char *find_literal(const char *p, const char *end,
+                                const char *lit, int len)
+{
+    if (end - p < len) return NULL;
+    const char *limit = end - len; /* last position LIT can occur */
+
+#if defined(__SSE2__) && defined(__GNUC__)
+    /* Compare the first and the last byte of LIT at 16 positions at once,
+       and only check the candidates that have both. */
+    if (len > 1) {
+        const __m128i first = _mm_set1_epi8(lit[0]);
+        const __m128i last = _mm_set1_epi8(lit[len-1]);
+        while (limit - p >= 16) {
+            __m128i b0 = _mm_loadu_si128((const __m128i*)p);
+            __m128i b1 = _mm_loadu_si128((const __m128i*)(p + len - 1));
+            unsigned int mask =
+                _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(b0, first),
+                                                _mm_cmpeq_epi8(b1, last)));
+            while (mask) {
+                int k = __builtin_ctz(mask);
+                if (memcmp(p + k + 1, lit + 1, len - 2) == 0) return p + k;
+                mask &= mask - 1;
+            }
+            p += 16;
+        }
+    }
+#endif
+    /* memchr is usually vectorized by libc. */
+    while (p <= limit) {
+        p = memchr(p, (unsigned char)lit[0], limit - p + 1);
+        if (p == NULL) return NULL;
+        if (memcmp(p, lit, len) == 0) return p;
+        p++;
+    }
+    return NULL;
+}
+
+/* In multibyte encodings other than utf-8, the bytes of LIT may appear
+   in the middle of a character, so we can't start matching where we
+   find it; we only use it to reject the input. */
+#if defined(GAUCHE_CHAR_ENCODING_UTF_8) || defined(GAUCHE_CHAR_ENCODING_NONE)
+#define PREFIX_JUMP_SAFE  TRUE
+#else
+#define PREFIX_JUMP_SAFE  FALSE
+#endif
+
+static int use_prefilter_p(ScmRegexp *rx, ScmSmallInt size)
+{
+    /* If the regexp is anchored, the match would fail as soon as it sees
+       the input doesn't begin with the pattern, or the pattern begins
+       with something like .*, for which the prefilter wouldn't help. */
+    return rx->mustMatch != NULL
+        && !(rx->flags & SCM_REGEXP_BOL_ANCHORED)
+        && size >= PREFILTER_MIN_INPUT;
+}
+
 /*----------------------------------------------------------------------
  * entry point
  */
@@ -2847,26 +3671,44 @@ ScmObj Scm_RegExec(ScmRegexp *rx, ScmString *str)
     if (SCM_STRING_INCOMPLETE_P(str)) {
         Scm_Error("incomplete string is not allowed: %S", str);
     }
-#if 0
-    /* Disabled for now; we need to use more heuristics to determine
-       when we should apply mustMatch.  For example, if the regexp
-       begins with BOL assertion and constant string, then it would be
-       faster to go for rex directly. */
-    if (rx->mustMatch) {
+    int prefix_jump = FALSE;
+    const char *from = start;
+    if (use_prefilter_p(rx, SCM_STRING_BODY_SIZE(b))) {
         /* Prescreening.  If the input string doesn't contain mustMatch
            string, it can't match the entire expression. */
-        if (SCM_FALSEP(Scm_StringScan(str, rx->mustMatch,
-                                      SCM_STRING_SCAN_INDEX))) {
-            return SCM_FALSE;
+        const char *found = find_literal(start, end, SCM_STRING_BODY_START(mb),
+                                         mustMatchLen);
+        if (found == NULL) return SCM_FALSE;
+        if ((rx->flags & SCM_REGEXP_LITERAL_PREFIX) && PREFIX_JUMP_SAFE) {
+            prefix_jump = TRUE;
+            from = found;
         }
     }
-#endif
+
+    if (use_dfa_p(rx, SCM_STRING_BODY_SIZE(b))) {
+        ScmObj r = dfa_exec(rx, str, start, from, end);
+        if (!SCM_UNDEFINEDP(r)) return r;
+    }
+
     /* short cut : if rx matches only at the beginning of the string,
        we only run from the beginning of the string */
     if (rx->flags & SCM_REGEXP_BOL_ANCHORED) {
         return rex(rx, str, start, end);
     }
 
+    /* the match can only start where the literal prefix occurs. */
+    if (prefix_jump) {
+        start = from;
+        for (;;) {
+            ScmObj r = rex(rx, str, start, end);
+            if (!SCM_FALSEP(r)) return r;
+            start += SCM_CHAR_NFOLLOWS(*start)+1;
+            start = find_literal(start, end, SCM_STRING_BODY_START(mb),
+                                 mustMatchLen);
+            if (start == NULL) return SCM_FALSE;
+        }
+    }
+
     /* if we have lookahead-set, we may be able to skip input efficiently. */
     if (!SCM_FALSEP(rx->laset)) {
         if (rx->flags & SCM_REGEXP_SIMPLE_PREFIX) {
@@ -501,6 +501,97 @@ static const char *forward_pos(const char *current, ScmSmallInt offset)
     return current;
 }
 
+/*
+ * String index
+ *
+ *  Finding the position of the k-th character of a multibyte string
+ *  requires scanning from the beginning, so an indexed access loop over
+ *  a string would be O(n^2).  To avoid it, we attach to the string body
+ *  a table of byte offsets of every STRING_INDEX_INTERVAL-th character,
+ *  so that we only need to scan less than STRING_INDEX_INTERVAL
+ *  characters from a checkpoint.
+ *
+ *  The index is built when the body is accessed by an offset larger than
+ *  STRING_INDEX_THRESHOLD for the second time; a single access doesn't
+ *  pay off building the index, which requires scanning the whole string.
+ *  String bodies are immutable, so the index never gets stale.
+ *
+ *  ScmStringBody is public and may be statically allocated by
+ *  SCM_STRING_CONST_INITIALIZER, so we can't add a slot to it.  Instead
+ *  we keep the index in a weak hash table keyed by the body; the entry is
+ *  #f after the first access, and the index after the second.  Only
+ *  bodies in the GC heap are indexed.  A body not in the heap is either
+ *  a static constant, which is short, or a temporary on the C stack,
+ *  whose address may be reused for a different content.
+ */
+
+#define STRING_INDEX_SHIFT      5
+#define STRING_INDEX_INTERVAL   (1L<<STRING_INDEX_SHIFT)
+#define STRING_INDEX_THRESHOLD  256
+
+static struct {
+    ScmWeakHashTable *table;    /* body -> #f or index */
+    ScmInternalMutex mutex;
+} string_indices = { NULL, SCM_INTERNAL_MUTEX_INITIALIZER };
+
+static const unsigned int *string_index(const ScmStringBody *b)
+{
+    ScmObj key = SCM_OBJ(b);
+    ScmObj e;
+
+    (void)SCM_INTERNAL_MUTEX_LOCK(string_indices.mutex);
+    if (string_indices.table == NULL) {
+        string_indices.table =
+            SCM_WEAK_HASH_TABLE(Scm_MakeWeakHashTableSimple(SCM_HASH_EQ,
+                                                            SCM_WEAK_KEY,
+                                                            0, SCM_FALSE));
+    }
+    e = Scm_WeakHashTableRef(string_indices.table, key, SCM_UNBOUND);
+    if (SCM_UNBOUNDP(e) && GC_base((void*)b) != NULL) {
+        Scm_WeakHashTableSet(string_indices.table, key, SCM_FALSE, 0);
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(string_indices.mutex);
+    if (!SCM_FALSEP(e)) {
+        return SCM_UNBOUNDP(e)? NULL : (const unsigned int*)e;
+    }
+
+    /* Second access.  We build the index outside of the lock.  If more
+       than one thread builds the index at the same time, they compute
+       the same table and one of them wins. */
+    ScmSmallInt n = (SCM_STRING_BODY_LENGTH(b) >> STRING_INDEX_SHIFT) + 1;
+    unsigned int *v = SCM_NEW_ATOMIC_ARRAY(unsigned int, n);
+    const char *start = SCM_STRING_BODY_START(b);
+    const char *p = start;
+    for (ScmSmallInt k = 0; k < n; k++) {
+        if (k > 0) p = forward_pos(p, STRING_INDEX_INTERVAL);
+        v[k] = (unsigned int)(p - start);
+    }
+    (void)SCM_INTERNAL_MUTEX_LOCK(string_indices.mutex);
+    Scm_WeakHashTableSet(string_indices.table, key, SCM_OBJ(v), 0);
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(string_indices.mutex);
+    return v;
+}
+
+/* Returns the pointer to the OFFSET-th character of a complete,
+   multibyte string body B, whose content begins at START.  We take START
+   separately, since get_string_from_body may replace the body's start
+   with a copy.  OFFSET must be in range. */
+static const char *index_pos(const ScmStringBody *b, const char *start,
+                             ScmSmallInt offset)
+{
+    if (offset < STRING_INDEX_THRESHOLD) return forward_pos(start, offset);
+    const unsigned int *idx = string_index(b);
+    if (idx == NULL) return forward_pos(start, offset);
+    return forward_pos(start + idx[offset >> STRING_INDEX_SHIFT],
+                       offset & (STRING_INDEX_INTERVAL-1));
+}
+
+static inline const char *body_position(const ScmStringBody *b,
+                                        ScmSmallInt offset)
+{
+    return index_pos(b, SCM_STRING_BODY_START(b), offset);
+}
+
 /* string-ref.
  * If POS is out of range,
  *   - returns SCM_CHAR_INVALID if range_error is FALSE
@@ -529,7 +620,7 @@ ScmChar Scm_StringRef(ScmString *str, ScmSmallInt pos, int range_error)
     if (SCM_STRING_BODY_SINGLE_BYTE_P(b)) {
         return (ScmChar)(((unsigned char *)SCM_STRING_BODY_START(b))[pos]);
     } else {
-        const char *p = forward_pos(SCM_STRING_BODY_START(b), pos);
+        const char *p = body_position(b, pos);
         ScmChar c;
         SCM_CHAR_GET(p, c);
         return c;
@@ -567,7 +658,7 @@ const char *Scm_StringBodyPosition(const ScmStringBody *b, ScmSmallInt offset)
     if (SCM_STRING_BODY_INCOMPLETE_P(b)) {
         return (SCM_STRING_BODY_START(b)+offset);
     } else {
-        return (forward_pos(SCM_STRING_BODY_START(b), offset));
+        return body_position(b, offset);
     }
 }
 
@@ -809,12 +900,13 @@ static ScmObj substring(const ScmStringBody *xb,
                                 flags));
     } else {
         const char *s, *e;
-        if (start) s = forward_pos(SCM_STRING_BODY_START(xb), start);
-        else s = SCM_STRING_BODY_START(xb);
+        const char *bstart = SCM_STRING_BODY_START(xb);
+        s = index_pos(xb, bstart, start);
         if (len == end) {
-            e = SCM_STRING_BODY_START(xb) + SCM_STRING_BODY_SIZE(xb);
+            e = bstart + SCM_STRING_BODY_SIZE(xb);
         } else {
-            e = forward_pos(s, end - start);
+            if (end - start < STRING_INDEX_INTERVAL) e = forward_pos(s, end - start);
+            else e = index_pos(xb, bstart, end);
             flags &= ~SCM_STRING_TERMINATED;
         }
         return SCM_OBJ(make_str((int)(end - start), (int)(e - s), s, flags));
@@ -1416,6 +1508,7 @@ ScmObj Scm_MakeStringPointer(ScmString *src, ScmSmallInt index,
     const ScmStringBody *srcb = SCM_STRING_BODY(src);
     ScmSmallInt len = SCM_STRING_BODY_LENGTH(srcb);
     ScmSmallInt effective_size;
+    const char *bstart = SCM_STRING_BODY_START(srcb);
     const char *sptr, *ptr, *eptr;
 
     SCM_CHECK_START_END(start, end, len);
@@ -1423,16 +1516,16 @@ ScmObj Scm_MakeStringPointer(ScmString *src, ScmSmallInt index,
     if (index > (end - start)) goto badindex;
 
     if (SCM_STRING_BODY_SINGLE_BYTE_P(srcb)) {
-        sptr = SCM_STRING_BODY_START(srcb) + start;
+        sptr = bstart + start;
         ptr = sptr + index;
         effective_size = end - start;
     } else {
-        sptr = forward_pos(SCM_STRING_BODY_START(srcb), start);
-        ptr = forward_pos(sptr, index);
+        sptr = index_pos(srcb, bstart, start);
+        ptr = index_pos(srcb, bstart, start + index);
         if (end == len) {
-            eptr = SCM_STRING_BODY_START(srcb) + SCM_STRING_BODY_SIZE(srcb);
+            eptr = bstart + SCM_STRING_BODY_SIZE(srcb);
         } else {
-            eptr = forward_pos(sptr, end - start);
+            eptr = index_pos(srcb, bstart, end);
         }
         effective_size = (int)(eptr - ptr);
     }
@@ -1443,6 +1536,9 @@ ScmObj Scm_MakeStringPointer(ScmString *src, ScmSmallInt index,
     sp->start = sptr;
     sp->index = index;
     sp->current = ptr;
+    sp->body = srcb;
+    sp->bodyStart = bstart;
+    sp->bodyOffset = start;
     return SCM_OBJ(sp);
   badindex:
     Scm_Error("index out of range: %ld", index);
@@ -1508,7 +1604,8 @@ ScmObj Scm_StringPointerSet(ScmStringPointer *sp, ScmSmallInt index)
     } else {
         if (index > sp->length) goto badindex;
         sp->index = (int)index;
-        sp->current = forward_pos(sp->start, index);
+        sp->current = index_pos(sp->body, sp->bodyStart,
+                                sp->bodyOffset + index);
     }
     return SCM_OBJ(sp);
   badindex:
@@ -1547,6 +1644,9 @@ ScmObj Scm_StringPointerCopy(ScmStringPointer *sp1)
     sp2->start   = sp1->start;
     sp2->index   = sp1->index;
     sp2->current = sp1->current;
+    sp2->body    = sp1->body;
+    sp2->bodyStart = sp1->bodyStart;
+    sp2->bodyOffset = sp1->bodyOffset;
     return SCM_OBJ(sp2);
 }
 
@@ -35,6 +35,11 @@
 #include "gauche.h"
 #include "gauche/priv/builtin-syms.h"
 #include "gauche/priv/moduleP.h"
+#include "gauche/priv/lftableP.h"
+
+/* We use the siphash function directly, with a fixed key; see below. */
+#define SCM_DWSIPHASH_INTERFACE
+#include "gauche/priv/dws_adapter.h"
 
 /*-----------------------------------------------------------
  * Symbols
@@ -55,9 +60,97 @@ static ScmClass *keyword_cpl[] = {
 SCM_DEFINE_BUILTIN_CLASS(Scm_KeywordClass, symbol_print, symbol_compare,
                          NULL, NULL, keyword_cpl);
 
-/* name -> symbol mapper */
+/* name -> symbol mapper
+ *
+ *   We don't use ScmHashTable here, for we want lookups of already
+ *   interned symbols (by far the most common case) not to take any lock.
+ *   See gauche/priv/lftableP.h for the table.  Entries are added while
+ *   holding obtable_mutex.  When the table gets crowded, we replace it
+ *   with a larger one.  A reader missing in the old table falls back to
+ *   the locked path, which always looks at the current table.
+ *
+ *   The hash value is computed with a fixed salt taken at initialization,
+ *   so that the table doesn't depend on the (thread-local) hash-salt
+ *   parameter.
+ */
+typedef struct SymtabEntryRec {
+    ScmLFEntry hdr;
+    ScmSymbol *sym;
+} SymtabEntry;
+
+#define SYMTAB_INITIAL_BUCKETS  4096
+#define SYMTAB_MAX_AVG_CHAIN    2
+#define SYMTAB_EXTEND_FACTOR    4
+
 static ScmInternalMutex obtable_mutex = SCM_INTERNAL_MUTEX_INITIALIZER;
-static ScmHashTable *obtable = NULL;
+static AO_t obtable = 0;        /* ScmLFTable* */
+static u_long obtable_salt = 0;
+
+static inline u_long symtab_hash(const ScmStringBody *b)
+{
+    return Scm__DwSipDefaultHash((uint8_t*)SCM_STRING_BODY_START(b),
+                                 (uint32_t)SCM_STRING_BODY_SIZE(b),
+                                 obtable_salt, obtable_salt);
+}
+
+/* Lock-free lookup.  Returns NULL if not found. */
+static ScmSymbol *symtab_lookup(ScmLFTable *t, const ScmStringBody *b,
+                                u_long hashval)
+{
+    ScmSmallInt size = SCM_STRING_BODY_SIZE(b);
+    const char *start = SCM_STRING_BODY_START(b);
+    for (ScmLFEntry *e = Scm__LFTableChain(t, hashval); e; e = e->next) {
+        if (e->hashval != hashval) continue;
+        ScmSymbol *sym = ((SymtabEntry*)e)->sym;
+        const ScmStringBody *eb = SCM_STRING_BODY(SCM_SYMBOL_NAME(sym));
+        if (SCM_STRING_BODY_SIZE(eb) == size
+            && memcmp(SCM_STRING_BODY_START(eb), start, size) == 0) {
+            return sym;
+        }
+    }
+    return NULL;
+}
+
+static ScmLFEntry *symtab_copy_entry(const ScmLFEntry *e)
+{
+    SymtabEntry *ne = SCM_NEW(SymtabEntry);
+    ne->sym = ((const SymtabEntry*)e)->sym;
+    return &ne->hdr;
+}
+
+/* Register SYM with its name, unless a symbol with the same name is
+   already there.  Returns the interned symbol. */
+static ScmSymbol *symtab_intern(ScmSymbol *sym)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(SCM_SYMBOL_NAME(sym));
+    u_long hashval = symtab_hash(b);
+    ScmSymbol *r;
+
+    SCM_INTERNAL_MUTEX_LOCK(obtable_mutex);
+    ScmLFTable *t = (ScmLFTable*)AO_load(&obtable);
+    r = symtab_lookup(t, b, hashval);
+    if (r == NULL) {
+        if (t->numEntries >= t->numBuckets*SYMTAB_MAX_AVG_CHAIN) {
+            t = Scm__LFTableRehash(t, t->numBuckets*SYMTAB_EXTEND_FACTOR,
+                                   symtab_copy_entry);
+            Scm__LFPublish(&obtable, t);
+        }
+        SymtabEntry *e = SCM_NEW(SymtabEntry);
+        e->sym = sym;
+        Scm__LFTableAdd(t, &e->hdr, hashval);
+        r = sym;
+    }
+    SCM_INTERNAL_MUTEX_UNLOCK(obtable_mutex);
+    return r;
+}
+
+/* Fast path.  Returns NULL if NAME isn't interned yet. */
+static ScmSymbol *symtab_find(ScmString *name)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(name);
+    return symtab_lookup((ScmLFTable*)Scm__LFLoad(&obtable), b,
+                         symtab_hash(b));
+}
 
 #if GAUCHE_KEEP_DISJOINT_KEYWORD_OPTION
 /* Global keyword table. */
@@ -74,10 +167,8 @@ static ScmSymbol *make_sym(ScmClass *klass, ScmString *name, int interned)
 {
     if (interned) {
         /* fast path */
-        SCM_INTERNAL_MUTEX_LOCK(obtable_mutex);
-        ScmObj e = Scm_HashTableRef(obtable, SCM_OBJ(name), SCM_FALSE);
-        SCM_INTERNAL_MUTEX_UNLOCK(obtable_mutex);
-        if (!SCM_FALSEP(e)) return SCM_SYMBOL(e);
+        ScmSymbol *e = symtab_find(name);
+        if (e != NULL) return e;
     }
 
     ScmSymbol *sym = SCM_NEW(ScmSymbol);
@@ -88,20 +179,30 @@ static ScmSymbol *make_sym(ScmClass *klass, ScmString *name, int interned)
     if (!interned) {
         return sym;
     } else {
-        /* Using SCM_DICT_NO_OVERWRITE ensures that if another thread interns
-           the same name symbol between above HashTableRef and here, we'll
-           get the already interned symbol. */
-        SCM_INTERNAL_MUTEX_LOCK(obtable_mutex);
-        ScmObj e = Scm_HashTableSet(obtable, SCM_OBJ(name), SCM_OBJ(sym),
-                                    SCM_DICT_NO_OVERWRITE);
-        SCM_INTERNAL_MUTEX_UNLOCK(obtable_mutex);
-        return SCM_SYMBOL(e);
+        /* If another thread interns the same name symbol between the
+           above lookup and here, symtab_intern returns the already
+           interned symbol. */
+        return symtab_intern(sym);
     }
 }
 
+/* Returns the interned symbol named NAME, or #f if there's none.
+   Unlike Scm_Intern, NAME isn't retained, so it can be a temporary
+   string; the reader uses it to look up a symbol without allocation. */
+ScmObj Scm__FindSymbol(ScmString *name)
+{
+    ScmSymbol *e = symtab_find(name);
+    return (e != NULL)? SCM_OBJ(e) : SCM_FALSE;
+}
+
 /* Intern */
 ScmObj Scm_MakeSymbol(ScmString *name, int interned)
 {
+    if (interned) {
+        /* Avoid copying NAME if the symbol already exists. */
+        ScmSymbol *e = symtab_find(name);
+        if (e != NULL) return SCM_OBJ(e);
+    }
     ScmObj sname = Scm_CopyStringWithFlags(name, SCM_STRING_IMMUTABLE,
                                            SCM_STRING_IMMUTABLE);
     return SCM_OBJ(make_sym(SCM_CLASS_SYMBOL, SCM_STRING(sname), interned));
@@ -464,7 +565,8 @@ ScmObj Scm_ExtractKeywords(ScmObj kv_list,
 void Scm__InitSymbol(void)
 {
     SCM_INTERNAL_MUTEX_INIT(obtable_mutex);
-    obtable = SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_STRING, 4096));
+    obtable_salt = (u_long)Scm_HashSaltRef();
+    Scm__LFPublish(&obtable, Scm__LFTableNew(SYMTAB_INITIAL_BUCKETS));
     init_builtin_syms();
 #if GAUCHE_KEEP_DISJOINT_KEYWORD_OPTION
     (void)SCM_INTERNAL_MUTEX_INIT(keywords.mutex);
@@ -2506,10 +2506,9 @@ void Scm_UnsetEnv(const char *name)
     ScmObj sname = Scm_MakeString(name, -1, -1, SCM_STRING_COPYING);
     (void)SCM_INTERNAL_MUTEX_LOCK(env_mutex);
     int r = unsetenv(name);
-    ScmDictEntry *e = Scm_HashCoreSearch(&env_strings,
-                                         (intptr_t)sname,
-                                         SCM_DICT_DELETE);
-    if (e != NULL) { prev_mem = (char*)e->value; e->value = (intptr_t)NULL; }
+    ScmDictEntry d;
+    ScmDictEntry *e = Scm_HashCoreDelete(&env_strings, (intptr_t)sname, &d);
+    if (e != NULL) prev_mem = (char*)e->value;
     (void)SCM_INTERNAL_MUTEX_UNLOCK(env_mutex);
     if (r < 0) Scm_SysError("unsetenv failed on %s", name);
     if (prev_mem != NULL) free(prev_mem);
@@ -273,7 +273,7 @@ int Scm_UVectorElementSize(ScmClass *klass)
 }
 
 /* Returns the size of the vector body in bytes */
-int Scm_UVectorSizeInBytes(ScmUVector *uv)
+ScmSmallInt Scm_UVectorSizeInBytes(ScmUVector *uv)
 {
     return SCM_UVECTOR_SIZE(uv) * Scm_UVectorElementSize(Scm_ClassOf(SCM_OBJ(uv)));
 }
@@ -284,6 +284,9 @@ ScmObj Scm_MakeUVectorFull(ScmClass *klass, ScmSmallInt size, void *init,
 {
     int eltsize = Scm_UVectorElementSize(klass);
     SCM_ASSERT(eltsize >= 1);
+    if (size < 0 || size > SCM_UVECTOR_MAX_SIZE) {
+        Scm_Error("uvector size out of range: %ld", size);
+    }
     ScmUVector *vec = SCM_NEW(ScmUVector);
     SCM_SET_CLASS(vec, klass);
     if (init) {
@@ -315,7 +318,7 @@ ScmObj Scm_ListToUVector(ScmClass *klass, ScmObj list, int clamp)
 
     ScmUVector *v = (ScmUVector*)Scm_MakeUVector(klass, length, NULL);
     ScmObj cp = list;
-    for (int i=0; i<length; i++, cp = SCM_CDR(cp)) {
+    for (ScmSmallInt i=0; i<length; i++, cp = SCM_CDR(cp)) {
         switch (type) {
         case SCM_UVECTOR_S8:
             SCM_S8VECTOR_ELEMENTS(v)[i] =
@@ -548,7 +551,7 @@ ScmObj Scm_ReadUVector(ScmPort *port, const char *tag, ScmReadContext *ctx)
     
     /* If we are reading source file, let literal uvectors be immutable. */
     if (Scm_ReadContextLiteralImmutable(ctx)) {
-        SCM_UVECTOR_IMMUTABLE_P(uv) = TRUE;
+        SCM_UVECTOR_IMMUTABLE_SET(uv, TRUE);
     }
     return uv;
 }
@@ -567,7 +570,7 @@ static void SCM_CPP_CAT3(print_,tag,vector)(ScmObj obj,                 \
     const ScmWriteControls *wp =                                        \
         Scm_GetWriteControls(ctx, out->writeState);                     \
     Scm_Printf(out, "#"#tag"(");                                        \
-    for (int i=0; i<SCM_CPP_CAT3(SCM_,TAG,VECTOR_SIZE)(obj); i++) {     \
+    for (ScmSmallInt i=0; i<SCM_CPP_CAT3(SCM_,TAG,VECTOR_SIZE)(obj); i++) {\
         T elt = SCM_CPP_CAT3(SCM_,TAG,VECTOR_ELEMENTS)(obj)[i];         \
         if (i != 0) Scm_Printf(out, " ");                               \
         if (wp->printLength >= 0 && i >= wp->printLength) {             \
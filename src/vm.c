@@ -40,6 +40,8 @@
 #include "gauche/vminsn.h"
 #include "gauche/prof.h"
 
+#include "atomic_ops.h"
+
 
 /* Experimental code to use custom mark procedure for stack gc.
    Currently it doens't show any improvement, so we disable it
@@ -139,10 +141,10 @@ static ScmEnvFrame *get_env(ScmVM *vm);
 
 static void   call_error_reporter(ScmObj e);
 
+/* Define this to count instructions from the start and dump the
+   result at exit.  Otherwise counting can be turned on at runtime. */
 /*#define COUNT_INSN_FREQUENCY*/
-#ifdef COUNT_INSN_FREQUENCY
 #include "vmstat.c"
-#endif /*COUNT_INSN_FREQUENCY*/
 
 /*
  * Constructor
@@ -297,6 +299,9 @@ int Scm_AttachVM(ScmVM *vm)
     }
     vm->state = SCM_VM_RUNNABLE;
     vm_register(vm);
+#ifdef GAUCHE_PROFILE
+    Scm__ProfilerAttachVM(vm);
+#endif /*GAUCHE_PROFILE*/
     return TRUE;
 #else  /* no threads */
     return FALSE;
@@ -311,6 +316,9 @@ void Scm_DetachVM(ScmVM *vm)
 {
 #ifdef GAUCHE_HAS_THREADS
     if (vm != NULL) {
+#ifdef GAUCHE_PROFILE
+        Scm__ProfilerDetachVM(vm);
+#endif /*GAUCHE_PROFILE*/
         (void)SCM_INTERNAL_THREAD_SETSPECIFIC(Scm_VMKey(), NULL);
         vm_unregister(vm);
     }
@@ -399,11 +407,30 @@ static void vm_register(ScmVM *vm)
 
 static void vm_unregister(ScmVM *vm)
 {
+    ScmDictEntry d;
     SCM_INTERNAL_MUTEX_LOCK(vm_table_mutex);
-    (void)Scm_HashCoreSearch(&vm_table, (intptr_t)vm, SCM_DICT_DELETE);
+    (void)Scm_HashCoreDelete(&vm_table, (intptr_t)vm, &d);
     SCM_INTERNAL_MUTEX_UNLOCK(vm_table_mutex);
 }
 
+/* Returns a list of the primordial VM and the VMs currently attached
+   to threads.  Used by the profiler to reach every running VM. */
+ScmObj Scm__AttachedVMs(void)
+{
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    ScmHashIter iter;
+    ScmDictEntry *e;
+
+    SCM_APPEND1(h, t, SCM_OBJ(rootVM));
+    SCM_INTERNAL_MUTEX_LOCK(vm_table_mutex);
+    Scm_HashIterInit(&iter, &vm_table);
+    while ((e = Scm_HashIterNext(&iter)) != NULL) {
+        if ((ScmVM*)e->key != rootVM) SCM_APPEND1(h, t, SCM_OBJ(e->key));
+    }
+    SCM_INTERNAL_MUTEX_UNLOCK(vm_table_mutex);
+    return h;
+}
+
 /*====================================================================
  * VM interpreter
  *
@@ -420,11 +447,7 @@ static void vm_unregister(ScmVM *vm)
 #define FETCH_OPERAND(var)      ((var) = SCM_OBJ(*PC))
 #define FETCH_OPERAND_PUSH      (*SP++ = SCM_OBJ(*PC))
 
-#ifndef COUNT_INSN_FREQUENCY
-#define FETCH_INSN(var)         ((var) = *PC++)
-#else
-#define FETCH_INSN(var)         ((var) = fetch_insn_counting(vm, var))
-#endif
+/* FETCH_INSN(var) is defined for each VM loop.  See run_loop(). */
 
 /* For sanity check in debugging mode */
 #ifdef PARANOIA
@@ -555,7 +578,7 @@ static void vm_unregister(ScmVM *vm)
 #define RETURN_OP()                                     \
     do {                                                \
         if (CONT == NULL || BOUNDARY_FRAME_P(CONT)) {   \
-            return; /* no more continuations */         \
+            return FALSE; /* no more continuations */   \
         }                                               \
         POP_CONT();                                     \
     } while (0)
@@ -853,52 +876,27 @@ static void local_env_shift(ScmVM *vm, int env_depth)
 /*===================================================================
  * Main loop of VM
  */
-static void run_loop()
-{
-    ScmVM *vm = theVM;
-    ScmWord code = 0;
+#define RUN_LOOP_NAME           run_loop_plain
+#define FETCH_INSN(var)         ((var) = *PC++)
+#include "vmloop.c"
+#undef RUN_LOOP_NAME
+#undef FETCH_INSN
 
-#ifdef __GNUC__
-    static void *dispatch_table[256] = {
-#define DEFINSN(insn, name, nargs, type, flags)   && SCM_CPP_CAT(LABEL_, insn),
-#include "vminsn.c"
-#undef DEFINSN
-    };
-#endif /* __GNUC__ */
-
-    /* Records the offset of each instruction handler from run_loop entry
-       address.  They can be retrieved by gauche.internal#%vm-get-insn-offsets.
-       Useful for tuning if used with machine instruction-level profiler. */
-    if (vminsn_offsets[0] == 0) {
-        /* No need to lock, for this is only executed when run_loop runs for
-           the first time, which is in Scm_Init(). */
-        for (int i=0; i<SCM_VM_NUM_INSNS; i++) {
-            vminsn_offsets[i] =
-                (unsigned long)((char*)dispatch_table[i] - (char*)run_loop);
-        }
-    }
+#define RUN_LOOP_NAME           run_loop_counting
+#define RUN_LOOP_COUNTING
+#define FETCH_INSN(var)         ((var) = fetch_insn_counting(vm, var))
+#include "vmloop.c"
+#undef RUN_LOOP_NAME
+#undef RUN_LOOP_COUNTING
+#undef FETCH_INSN
 
+/* The instruction counting is turned on and off at any time, so we
+   switch between the two loops as needed. */
+static void run_loop()
+{
     for (;;) {
-        DISPATCH;
-        /*VM_DUMP("");*/
-        if (vm->attentionRequest) goto process_queue;
-        FETCH_INSN(code);
-        SWITCH(SCM_VM_INSN_CODE(code)) {
-#define VMLOOP
-#include "vminsn.c"
-#undef  VMLOOP
-#ifndef __GNUC__
-        default:
-            Scm_Panic("Illegal vm instruction: %08x",
-                      SCM_VM_INSN_CODE(code));
-#endif
-        }
-      process_queue:
-        CHECK_STACK(CONT_FRAME_SIZE);
-        PUSH_CONT(PC);
-        process_queued_requests(vm);
-        POP_CONT();
-        NEXT;
+        int switched = insn_counting? run_loop_counting() : run_loop_plain();
+        if (!switched) return;
     }
 }
 /* End of run_loop */
@@ -936,6 +934,16 @@ static void run_loop()
    Better strategy is to put an effort in the compiler to avoid closure
    creation as much as possible.  */
 
+/* # of env frames moved to the heap, counted when SCM_COLLECT_VM_STATS
+   is set.  It is summed over all VMs; we keep it out of ScmVMStat,
+   which is embedded in ScmVM. */
+static AO_t envSaveCount = 0;
+
+u_long Scm__VMEnvSaveCount(void)
+{
+    return (u_long)AO_load(&envSaveCount);
+}
+
 /* Move the chain of env frames from the stack to the heap,
    replacing the in-stack frames for forwarding env frames.
 
@@ -959,6 +967,9 @@ static inline ScmEnvFrame *save_env(ScmVM *vm, ScmEnvFrame *env_begin)
 
         ScmObj *d = SCM_NEW2(ScmObj*, ENV_SIZE(esize) * sizeof(ScmObj));
         ScmObj *s = (ScmObj*)e - esize;
+        if (SCM_VM_RUNTIME_FLAG_IS_SET(vm, SCM_COLLECT_VM_STATS)) {
+            AO_fetch_and_add1(&envSaveCount);
+        }
         for (long i=esize; i>0; i--) {
             SCM_FLONUM_ENSURE_MEM(*s);
             *d++ = *s++;
@@ -2648,6 +2659,13 @@ static void process_queued_requests(ScmVM *vm)
        VM level. */
     if (vm->signalPending)   Scm_SigCheck(vm);
     if (vm->finalizerPending) Scm_VMFinalizerRun(vm);
+#ifdef GAUCHE_PROFILE
+    /* Profiler started on another thread wants us to sample ourselves,
+       or the sampler wants us to record the call stack.  See prof.c */
+    if (vm->prof && (vm->prof->timerRequest || vm->prof->stackRequest)) {
+        Scm__ProfilerHandleRequest(vm);
+    }
+#endif /*GAUCHE_PROFILE*/
 
     /* VM STOP is required from other thread.
        See Scm_ThreadStop() in ext/threads/threads.c */
@@ -2712,6 +2730,25 @@ ScmObj Scm_VMGetStackLite(ScmVM *vm)
     return stack;
 }
 
+/* Records the compiled code of the continuation frames into FRAMES,
+   innermost first, and returns the number of recorded entries.  If there
+   are more than MAXDEPTH frames, the last entry is #t.
+   Called from the sampling profiler at a safe point of VM, where the
+   continuation frames are consistent.  VM must be the current VM. */
+int Scm__VMSampleStack(ScmVM *vm, ScmObj *frames, int maxdepth)
+{
+    int n = 0;
+    for (ScmContFrame *c = vm->cont; c; c = c->prev) {
+        if (C_CONTINUATION_P(c) || c->base == NULL) continue;
+        if (n == maxdepth) {
+            frames[maxdepth-1] = SCM_TRUE;
+            break;
+        }
+        frames[n++] = SCM_OBJ(c->base);
+    }
+    return n;
+}
+
 #define DEFAULT_ENV_TABLE_SIZE  64
 
 struct EnvTab {
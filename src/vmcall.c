@@ -247,12 +247,13 @@
             VAL0 = SCM_OBJ(&Scm_GenericApplyGeneric);
         }
       GENERIC_ENTRY:
-        /* pure generic application.  we implement MOP in C. */
-        mm = Scm_ComputeApplicableMethods(SCM_GENERIC(VAL0), ARGP, argc, APP);
+        /* pure generic application.  we implement MOP in C.
+           the sorted applicable methods are looked up from the
+           per-generic dispatch cache. */
+        mm = Scm_SortedApplicableMethods(SCM_GENERIC(VAL0), ARGP, argc, APP);
         if (!SCM_NULLP(mm)) {
-            /* sort methods.  we only need as many args as
-               gf->maxReqargs to order methods, so we only unfold that
-               many args if applyargs.
+            /* if applyargs, unfold as many args as gf->maxReqargs
+               before passing them to the method.
             */
 #if defined(APPLY_CALL)
             if (argc-1<SCM_GENERIC(VAL0)->maxReqargs) {
@@ -274,7 +275,6 @@
                 for (int i=0;i<argc; i++, ap++) SCM_FLONUM_ENSURE_MEM(*ap);
             }
 #endif /*GAUCHE_FFX*/
-            mm = Scm_SortMethods(mm, ARGP, argc);
             nm = Scm_MakeNextMethod(SCM_GENERIC(VAL0), SCM_CDR(mm),
                                     ARGP, argc, TRUE, APP);
             VAL0 = SCM_CAR(mm);
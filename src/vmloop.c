@@ -0,0 +1,99 @@
+/*
+ * vmloop.c - main loop of VM
+ *
+ *   Copyright (c) 2005-2016  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file is included from vm.c twice, to define the normal VM loop
+   (run_loop_plain) and the one that counts the executed instructions
+   (run_loop_counting).  The includer defines RUN_LOOP_NAME and FETCH_INSN,
+   and RUN_LOOP_COUNTING for the latter.
+
+   The loop returns FALSE when it returns to the boundary frame, or TRUE
+   when it has noticed that the instruction counting is turned on or off
+   (see vmstat.c).  In the latter case the VM registers are between two
+   instructions, so run_loop() can just continue with the other loop.
+ */
+
+static int RUN_LOOP_NAME()
+{
+    ScmVM *vm = theVM;
+    ScmWord code = 0;
+
+#ifdef __GNUC__
+    static void *dispatch_table[256] = {
+#define DEFINSN(insn, name, nargs, type, flags)   && SCM_CPP_CAT(LABEL_, insn),
+#include "vminsn.c"
+#undef DEFINSN
+    };
+#endif /* __GNUC__ */
+
+#ifndef RUN_LOOP_COUNTING
+    /* Records the offset of each instruction handler from run_loop entry
+       address.  They can be retrieved by gauche.internal#%vm-get-insn-offsets.
+       Useful for tuning if used with machine instruction-level profiler. */
+    if (vminsn_offsets[0] == 0) {
+        /* No need to lock, for this is only executed when run_loop runs for
+           the first time, which is in Scm_Init(). */
+        for (int i=0; i<SCM_VM_NUM_INSNS; i++) {
+            vminsn_offsets[i] =
+                (unsigned long)((char*)dispatch_table[i] - (char*)RUN_LOOP_NAME);
+        }
+    }
+#endif /* !RUN_LOOP_COUNTING */
+
+    for (;;) {
+        DISPATCH;
+        /*VM_DUMP("");*/
+        if (vm->attentionRequest) goto process_queue;
+        FETCH_INSN(code);
+        SWITCH(SCM_VM_INSN_CODE(code)) {
+#define VMLOOP
+#include "vminsn.c"
+#undef  VMLOOP
+#ifndef __GNUC__
+        default:
+            Scm_Panic("Illegal vm instruction: %08x",
+                      SCM_VM_INSN_CODE(code));
+#endif
+        }
+      process_queue:
+        CHECK_STACK(CONT_FRAME_SIZE);
+        PUSH_CONT(PC);
+        process_queued_requests(vm);
+        POP_CONT();
+#ifdef RUN_LOOP_COUNTING
+        if (!insn_counting) return TRUE;
+#else
+        if (insn_counting) return TRUE;
+#endif
+        NEXT;
+    }
+}
@@ -33,8 +33,20 @@
 
 /* This file is included from vm.c */
 
+/* Instruction counting.
+ * While insn_counting is TRUE, the VM runs run_loop_counting, which calls
+ * fetch_insn_counting for every instruction.  When it is turned on or
+ * off, each VM switches the loop at its next safe point; so the normal
+ * loop doesn't pay anything for this.
+ * The counters are shared by all threads and not protected, since they
+ * are just statistics.
+ */
 #ifdef COUNT_INSN_FREQUENCY
-/* for statistics */
+static volatile int insn_counting = TRUE;
+#else
+static volatile int insn_counting = FALSE;
+#endif
+
 static u_long insn1_freq[SCM_VM_NUM_INSNS];
 static u_long insn2_freq[SCM_VM_NUM_INSNS][SCM_VM_NUM_INSNS];
 
@@ -50,17 +62,18 @@ static ScmWord fetch_insn_counting(ScmVM *vm, ScmWord code)
     code = *vm->pc++;
     insn1_freq[SCM_VM_INSN_CODE(code)]++;
     switch (SCM_VM_INSN_CODE(code)) {
-    case SCM_VM_LREF0: lref_freq[0][0]++; break;
-    case SCM_VM_LREF1: lref_freq[0][1]++; break;
-    case SCM_VM_LREF2: lref_freq[0][2]++; break;
-    case SCM_VM_LREF3: lref_freq[0][3]++; break;
-    case SCM_VM_LREF4: lref_freq[0][4]++; break;
-    case SCM_VM_LREF10: lref_freq[1][0]++; break;
-    case SCM_VM_LREF11: lref_freq[1][1]++; break;
-    case SCM_VM_LREF12: lref_freq[1][2]++; break;
-    case SCM_VM_LREF13: lref_freq[1][3]++; break;
-    case SCM_VM_LREF14: lref_freq[1][4]++; break;
+    case SCM_VM_LREF0:  case SCM_VM_LREF0_PUSH:  lref_freq[0][0]++; break;
+    case SCM_VM_LREF1:  case SCM_VM_LREF1_PUSH:  lref_freq[0][1]++; break;
+    case SCM_VM_LREF2:  case SCM_VM_LREF2_PUSH:  lref_freq[0][2]++; break;
+    case SCM_VM_LREF3:  case SCM_VM_LREF3_PUSH:  lref_freq[0][3]++; break;
+    case SCM_VM_LREF10: case SCM_VM_LREF10_PUSH: lref_freq[1][0]++; break;
+    case SCM_VM_LREF11: case SCM_VM_LREF11_PUSH: lref_freq[1][1]++; break;
+    case SCM_VM_LREF12: case SCM_VM_LREF12_PUSH: lref_freq[1][2]++; break;
+    case SCM_VM_LREF20: case SCM_VM_LREF20_PUSH: lref_freq[2][0]++; break;
+    case SCM_VM_LREF21: case SCM_VM_LREF21_PUSH: lref_freq[2][1]++; break;
+    case SCM_VM_LREF30: case SCM_VM_LREF30_PUSH: lref_freq[3][0]++; break;
     case SCM_VM_LREF:
+    case SCM_VM_LREF_PUSH:
     {
         int dep = SCM_VM_INSN_ARG0(code);
         int off = SCM_VM_INSN_ARG1(code);
@@ -69,11 +82,6 @@ static ScmWord fetch_insn_counting(ScmVM *vm, ScmWord code)
         lref_freq[dep][off]++;
         break;
     }
-    case SCM_VM_LSET0: lset_freq[0][0]++; break;
-    case SCM_VM_LSET1: lset_freq[0][1]++; break;
-    case SCM_VM_LSET2: lset_freq[0][2]++; break;
-    case SCM_VM_LSET3: lset_freq[0][3]++; break;
-    case SCM_VM_LSET4: lset_freq[0][4]++; break;
     case SCM_VM_LSET:
     {
         int dep = SCM_VM_INSN_ARG0(code);
@@ -87,6 +95,72 @@ static ScmWord fetch_insn_counting(ScmVM *vm, ScmWord code)
     return code;
 }
 
+static void insn_counting_set(int flag)
+{
+    ScmObj vp;
+    insn_counting = flag;
+    /* Let every VM notice the change. */
+    SCM_FOR_EACH(vp, Scm__AttachedVMs()) {
+        SCM_VM(SCM_CAR(vp))->attentionRequest = TRUE;
+    }
+}
+
+void Scm_VMInsnCountingStart(void)
+{
+    insn_counting_set(TRUE);
+}
+
+void Scm_VMInsnCountingStop(void)
+{
+    insn_counting_set(FALSE);
+}
+
+void Scm_VMInsnCountingReset(void)
+{
+    memset(insn1_freq, 0, sizeof(insn1_freq));
+    memset(insn2_freq, 0, sizeof(insn2_freq));
+    memset(lref_freq, 0, sizeof(lref_freq));
+    memset(lset_freq, 0, sizeof(lset_freq));
+}
+
+static ScmObj freq_vector(u_long *v, int n)
+{
+    ScmObj r = Scm_MakeVector(n, SCM_FALSE);
+    for (int i=0; i<n; i++) {
+        SCM_VECTOR_ELEMENT(r, i) = Scm_MakeIntegerU(v[i]);
+    }
+    return r;
+}
+
+static ScmObj freq_matrix(u_long *v, int n)
+{
+    ScmObj r = Scm_MakeVector(n, SCM_FALSE);
+    for (int i=0; i<n; i++) {
+        SCM_VECTOR_ELEMENT(r, i) = freq_vector(v + i*n, n);
+    }
+    return r;
+}
+
+/* Returns the current counts as a list:
+     (:insn1 #(<count> ...)          ; indexed by insn code
+      :insn2 #(#(<count> ...) ...)   ; [code][next code]
+      :lref  #(#(<count> ...) ...)   ; [depth][offset]
+      :lset  #(#(<count> ...) ...))  ; [depth][offset]
+   Depth and offset of LREF/LSET are clipped to LREF_FREQ_COUNT_MAX-1. */
+ScmObj Scm_VMInsnCountingSnapshot(void)
+{
+    return Scm_List(SCM_MAKE_KEYWORD("insn1"),
+                    freq_vector(insn1_freq, SCM_VM_NUM_INSNS),
+                    SCM_MAKE_KEYWORD("insn2"),
+                    freq_matrix(&insn2_freq[0][0], SCM_VM_NUM_INSNS),
+                    SCM_MAKE_KEYWORD("lref"),
+                    freq_matrix(&lref_freq[0][0], LREF_FREQ_COUNT_MAX),
+                    SCM_MAKE_KEYWORD("lset"),
+                    freq_matrix(&lset_freq[0][0], LREF_FREQ_COUNT_MAX),
+                    NULL);
+}
+
+#ifdef COUNT_INSN_FREQUENCY
 static void dump_insn_frequency(void *data)
 {
     Scm_Printf(SCM_CUROUT, "(:instruction-frequencies (");
@@ -370,8 +370,9 @@ ScmObj Scm_WeakHashTableSet(ScmWeakHashTable *ht, ScmObj key, ScmObj value,
 
 ScmObj Scm_WeakHashTableDelete(ScmWeakHashTable *ht, ScmObj key)
 {
-    ScmDictEntry *e = Scm_HashCoreSearch(SCM_WEAK_HASH_TABLE_CORE(ht),
-                                         (intptr_t)key, SCM_DICT_DELETE);
+    ScmDictEntry d;
+    ScmDictEntry *e = Scm_HashCoreDelete(SCM_WEAK_HASH_TABLE_CORE(ht),
+                                         (intptr_t)key, &d);
     if (e && e->value) {
         if (ht->weakness&SCM_WEAK_VALUE) {
             void *val = Scm_WeakBoxRef((ScmWeakBox*)e->value);
@@ -88,6 +88,12 @@ static const ScmWriteControls *defaultWriteControls;
    writing only when requested specifically. */
 #define WRITER_NEED_2PASS(ctx) (SCM_WRITE_MODE(ctx) != SCM_WRITE_SIMPLE)
 
+/* Objects that can't refer to other objects.  Writing them never needs
+   the walk pass, whatever the mode is. */
+#define WRITER_LEAF_P(obj)                                      \
+    (!SCM_PTRP(obj) || SCM_NUMBERP(obj) || SCM_STRINGP(obj)     \
+     || SCM_SYMBOLP(obj) || SCM_KEYWORDP(obj))
+
 /*
  * WriteContext public API
  */
@@ -241,13 +247,22 @@ void Scm_WriteWithControls(ScmObj obj, ScmObj p, int mode,
         /* We're in the toplevel call.*/
         ScmWriteContext ctx;
         write_context_init(&ctx, mode, 0, 0);
+        int need2pass = WRITER_NEED_2PASS(&ctx) && !WRITER_LEAF_P(obj);
+        if (WRITER_NEED_2PASS(&ctx)) ctx.controls = ctrl;
+        if (!need2pass && PORT_LOCK_OWNER_P(port, vm)) {
+            /* The port is already locked by us, e.g. in with-port-locking
+               or a private port.  Whoever locked it takes care of
+               unlocking in case of error, so we can skip the cost of
+               unwind-protect. */
+            write_rec(obj, port, &ctx);
+            return;
+        }
         PORT_LOCK(port, vm);
-        if (WRITER_NEED_2PASS(&ctx)) {
-            ctx.controls = ctrl;
+        if (need2pass) {
             PORT_SAFE_CALL(port, write_ss(obj, port, &ctx),
                            cleanup_port_write_state(port));
         } else {
-            /* write-simple case.  CTRL is ignored. */
+            /* write-simple case (CTRL is ignored), or OBJ is a leaf. */
             PORT_SAFE_CALL(port, write_rec(obj, port, &ctx), /*no cleanup*/);
         }
         PORT_UNLOCK(port);
@@ -1105,9 +1120,13 @@ void Scm_Vprintf(ScmPort *out, const char *fmt, va_list ap, int sharedp)
     ScmObj args = vprintf_pass1(out, fmt, ap);
 
     ScmVM *vm = Scm_VM();
-    PORT_LOCK(out, vm);
-    PORT_SAFE_CALL(out, vprintf_pass2(out, fmt, args), /*no cleanup*/);
-    PORT_UNLOCK(out);
+    if (PORT_LOCK_OWNER_P(out, vm)) {
+        vprintf_pass2(out, fmt, args); /* see Scm_WriteWithControls */
+    } else {
+        PORT_LOCK(out, vm);
+        PORT_SAFE_CALL(out, vprintf_pass2(out, fmt, args), /*no cleanup*/);
+        PORT_UNLOCK(out);
+    }
 }
 
 void Scm_Printf(ScmPort *out, const char *fmt, ...)
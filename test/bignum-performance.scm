@@ -0,0 +1,72 @@
+;;
+;; finding the thresholds of bignum multiplication algorithms
+;;
+;;  gosh bignum-performance.scm
+;;
+;; Bignum multiplication switches from the schoolbook method to Karatsuba,
+;; and then to Toom-3, as the smaller operand gets longer.  The best
+;; switching points depend on the platform.  This script measures
+;; the multiplication of each size with and without one level of
+;; the faster algorithm, and shows the smallest size where it wins.
+;; Give the results to configure as
+;;
+;;   CFLAGS="-DBIGNUM_KARATSUBA_THRESHOLD=<n> -DBIGNUM_TOOM3_THRESHOLD=<n>"
+;;
+;; Sizes are in words.
+
+(use gauche.time)
+(use data.random)
+(use srfi-1)
+
+(define %thresholds (with-module gauche.internal %bignum-mul-thresholds))
+
+(define *word-bits* (* 8 (if (fixnum? (expt 2 40)) 8 4)))
+
+;; a random positive integer of exactly N words
+(define (random-bignum n)
+  (+ (expt 2 (- (* n *word-bits*) 1))
+     ((integers$ (expt 2 (- (* n *word-bits*) 1))))))
+
+;; Returns the user time of multiplying N-word numbers, with the given
+;; thresholds.
+(define (time-mul n karatsuba toom3)
+  (let ([x (random-bignum n)]
+        [y (random-bignum n)])
+    (%thresholds karatsuba toom3)
+    (time-result-user (time-this '(cpu 0.2) (^[] (* x y))))))
+
+;; Find the smallest size in SIZES where the algorithm switched on by
+;; (ON n) wins over the one switched on by (OFF n).  ON and OFF return
+;; the arguments to %thresholds.
+(define (find-crossover title sizes on off)
+  (format #t "~a:\n" title)
+  (let loop ([sizes sizes] [found #f])
+    (if (null? sizes)
+      found
+      (let* ([n (car sizes)]
+             [t-off (apply time-mul n (off n))]
+             [t-on  (apply time-mul n (on n))])
+        (format #t "  ~5d words  ~10,3f  ~10,3f  ~5,1f%\n"
+                n (* t-off 1e6) (* t-on 1e6) (* 100 (/ t-on t-off)))
+        (loop (cdr sizes)
+              (or found (and (< t-on t-off) n)))))))
+
+(define (main args)
+  (receive (k0 t0) (%thresholds)
+    (format #t "current thresholds: karatsuba ~d, toom3 ~d\n" k0 t0)
+    (format #t "(usec per multiplication; without and with one more level)\n")
+    (let* ([k (find-crossover "karatsuba"
+                              '(8 12 16 24 32 48 64 96 128)
+                              (^n `(,n ,(* n 2)))
+                              (^n `(,(+ n 1) ,(* n 2))))]
+           [t (find-crossover "toom3"
+                              '(250 500 1000 1500 2000 3000 4000 6000)
+                              (^n `(,(or k k0) ,n))
+                              (^n `(,(or k k0) ,(+ n 1))))])
+      (%thresholds k0 t0)
+      (format #t "\nsuggested: -DBIGNUM_KARATSUBA_THRESHOLD=~a \
+                  -DBIGNUM_TOOM3_THRESHOLD=~a\n"
+              (or k "(larger than tested)") (or t "(larger than tested)"))
+      (format #t "\n(expt 3 1000000): ~a\n"
+              (time-this 1 (^[] (expt 3 1000000))))))
+  0)
@@ -33,4 +33,120 @@
                      [_ #f])
                    (call/cc (^x (ra x) #f))))
 
+(test-section "instruction counting")
+
+(define (count-loop n) (let loop ([i 0]) (when (< i n) (loop (+ i 1)))))
+(define (total-insns)
+  (fold + 0 (vector->list (get-keyword :insn1 (vm-insn-counting-snapshot)))))
+
+(test* "counting" #t
+       (begin (vm-insn-counting-reset)
+              (vm-insn-counting-start)
+              (count-loop 1000)
+              (vm-insn-counting-stop)
+              (> (total-insns) 1000)))
+(test* "counting stopped" #t
+       (let1 n (total-insns)
+         (count-loop 1000)
+         (= n (total-insns))))
+(test* "snapshot shape" '(#t #t #t)
+       (let1 s (vm-insn-counting-snapshot)
+         (list (= (vector-length (get-keyword :insn1 s))
+                  (vector-length (get-keyword :insn2 s)))
+               (vector? (vector-ref (get-keyword :insn2 s) 0))
+               (vector? (vector-ref (get-keyword :lref s) 0)))))
+(test* "counting reset" 0
+       (begin (vm-insn-counting-reset) (total-insns)))
+
+(test-section "profiler call stacks")
+
+(use gauche.uvector)
+
+;; Build a tree like the one profiler-raw-stacks returns.
+;; Each node is (<hits> . <children>); KIDS are (<frame> . <node>).
+(define (stack-node hits . kids)
+  (cons hits
+        (and (pair? kids)
+             (rlet1 h (make-hash-table 'eq?)
+               (dolist [k kids] (hash-table-put! h (car k) (cdr k)))))))
+
+(define stack-roots
+  (list (stack-node 10
+                    `(main . ,(stack-node 10
+                                          `(foo . ,(stack-node 6
+                                                               `(bar . ,(stack-node 4))))
+                                          `(baz . ,(stack-node 3
+                                                               `(#t . ,(stack-node 3)))))))
+        (stack-node 2
+                    `(main . ,(stack-node 2
+                                          `(foo . ,(stack-node 2)))))))
+
+(define expected-stacks
+  '((("main" "foo") . 4)
+    (("main" "foo" "bar") . 4)
+    (("main" "baz" "...") . 3)
+    (("main") . 1)))
+
+(test* "stack trees" expected-stacks
+       ((with-module gauche.vm.profiler stack-trees->stacks) stack-roots))
+
+(test* "folded stacks"
+       "main;foo 4\nmain;foo;bar 4\nmain;baz;... 3\nmain 1\n"
+       (call-with-output-string
+         (cut (with-module gauche.vm.profiler write-folded-stacks)
+              expected-stacks <>)))
+
+;; Minimal protocol buffer decoder.  Returns ((<field> . <value>) ...),
+;; where <value> is an integer or a string of bytes.
+(define (pb-read-varint in)
+  (let loop ([n 0] [shift 0])
+    (let1 b (read-byte in)
+      (if (< b 128)
+        (+ n (ash b shift))
+        (loop (+ n (ash (logand b #x7f) shift)) (+ shift 7))))))
+(define (pb-decode str)
+  (let1 in (open-input-string str)
+    (let loop ([r '()])
+      (if (eof-object? (peek-byte in))
+        (reverse r)
+        (let1 key (pb-read-varint in)
+          (if (= (logand key 7) 2)
+            (let1 len (pb-read-varint in)
+              (loop (acons (ash key -3)
+                           (u8vector->string
+                            (read-uvector <u8vector> len in))
+                           r)))
+            (loop (acons (ash key -3) (pb-read-varint in) r))))))))
+(define (pb-decode-packed str)
+  (let1 in (open-input-string str)
+    (let loop ([r '()])
+      (if (eof-object? (peek-byte in))
+        (reverse r)
+        (loop (cons (pb-read-varint in) r))))))
+(define (pb-fields field msg)
+  (filter-map (^p (and (= (car p) field) (cdr p))) msg))
+
+(let* ([msg (pb-decode
+             (call-with-output-string
+               (cut (with-module gauche.vm.profiler write-pprof)
+                    expected-stacks <>)))]
+       [strtab (list->vector (pb-fields 6 msg))]
+       [funcs (map (^f (let1 m (pb-decode f)
+                         (cons (car (pb-fields 1 m))
+                               (vector-ref strtab (car (pb-fields 2 m))))))
+                   (pb-fields 5 msg))])
+  (test* "pprof string table" "" (vector-ref strtab 0))
+  (test* "pprof samples"
+         (map (^e (list (car e) (cdr e) (* (cdr e) 10000000)))
+              expected-stacks)
+         (map (^s (let1 m (pb-decode s)
+                    (cons (reverse
+                           (map (cut assv-ref funcs <>)
+                                (pb-decode-packed (car (pb-fields 1 m)))))
+                          (pb-decode-packed (car (pb-fields 2 m))))))
+              (pb-fields 2 msg)))
+  (test* "pprof locations" (map car funcs)
+         (map (^l (car (pb-fields 1 (pb-decode l)))) (pb-fields 4 msg)))
+  (test* "pprof period" '(10000000) (pb-fields 12 msg)))
+
 (test-end)
@@ -411,6 +411,92 @@
          (list (assoc "a" a)
                (assoc "b" a))))
 
+;;------------------------------------------------------------------
+(test-section "growing and shrinking")
+
+;; eq?, eqv? and string=? tables use open addressing, whose slots are
+;; moved when the table is rebuilt.  Check some corner cases.
+
+(dolist [type '(eq? eqv? string=?)]
+  (define (key i) (if (eq? type 'string=?) (number->string i) i))
+
+  (test* #"many entries (~type)" '(10000 #t)
+         (let1 h (make-hash-table type)
+           (dotimes [i 10000] (hash-table-put! h (key i) i))
+           (list (hash-table-num-entries h)
+                 (every (^i (eqv? (hash-table-get h (key i) #f) i))
+                        (iota 10000)))))
+
+  (test* #"put and delete alternately (~type)" '(500 #t #f)
+         (let1 h (make-hash-table type)
+           (dotimes [i 1000]
+             (hash-table-put! h (key i) i)
+             (when (odd? i) (hash-table-delete! h (key (- i 1)))))
+           (list (hash-table-num-entries h)
+                 (hash-table-get h (key 999) #f)
+                 (hash-table-get h (key 998) #f))))
+
+  (test* #"update! whose proc modifies the table (~type)" '(-1 101)
+         (let1 h (make-hash-table type)
+           (hash-table-put! h (key -1) 0)
+           (hash-table-update! h (key -1)
+                               (^v (dotimes [i 100]
+                                     (hash-table-put! h (key i) i))
+                                   (- v 1)))
+           (list (hash-table-get h (key -1))
+                 (hash-table-num-entries h))))
+
+  (test* #"update! whose proc deletes the key (~type)" '(#f 0)
+         (let1 h (make-hash-table type)
+           (hash-table-put! h (key -1) 0)
+           (hash-table-update! h (key -1)
+                               (^v (hash-table-delete! h (key -1)) (+ v 1)))
+           (list (hash-table-get h (key -1) #f)
+                 (hash-table-num-entries h))))
+
+  (test* #"delete during iteration (~type)" '(0 100)
+         (let ([h (make-hash-table type)]
+               [n 0])
+           (dotimes [i 100] (hash-table-put! h (key i) i))
+           (hash-table-for-each h (^[k v] (inc! n) (hash-table-delete! h k)))
+           (list (hash-table-num-entries h) n)))
+  )
+
+(dolist [type '(eq? equal?)]
+  (test* #"incremental rehashing (~type)" '(#t 100000 #t)
+         (let ([h (make-hash-table type)]
+               [seen #f])
+           (dotimes [i 100000]
+             (hash-table-put! h i i)
+             ;; NB: hash-table-stat is O(n), so we don't call it every time.
+             (when (and (zero? (modulo i 256))
+                        (pair? (get-keyword :rehash-progress
+                                            (hash-table-stat h))))
+               (set! seen #t)))
+           (list seen
+                 (hash-table-num-entries h)
+                 (every (^i (eqv? (hash-table-get h i #f) i))
+                        (iota 100000)))))
+
+  (test* #"copy and stat during incremental rehashing (~type)" '(#t #t #t #t)
+         (let1 h (make-hash-table type)
+           (let loop ([i 0])
+             (hash-table-put! h i i)
+             (unless (and (zero? (modulo i 256))
+                          (pair? (get-keyword :rehash-progress
+                                              (hash-table-stat h))))
+               (loop (+ i 1))))
+           (let* ([n (hash-table-num-entries h)]
+                  [c (hash-table-copy h)]
+                  [stat (hash-table-stat h)])
+             ;; The copy must not complete the rehashing of the original.
+             (list (pair? (get-keyword :rehash-progress stat))
+                   (= n (hash-table-num-entries c))
+                   (every (^i (eqv? (hash-table-get c i #f) i)) (iota n))
+                   (= n (fold (^[b s] (+ s (length b))) 0
+                              (vector->list (get-keyword :contents stat))))))))
+  )
+
 (test-module 'gauche.hashutil) ; autoloaded module
 
 (test-end)
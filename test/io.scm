@@ -327,6 +327,49 @@
        (with-input-from-string "abc"
          (cut port-map (^x `(,x ,(port-tell (current-input-port)))) read-char)))
 
+;;-------------------------------------------------------------------
+(test-section "large writes and copy-port")
+
+(let ([big (with-output-to-string
+             (^[] (dotimes [i 20000] (display i) (write-char #\space))))])
+  (test* "write larger than buffer" (string-append "abc" big "xyz" big)
+         (begin
+           (call-with-output-file "tmp1.o"
+             (^[out]
+               (display "abc" out)
+               (display big out)     ; goes with the pending "abc"
+               (display "xyz" out)
+               (write-string big out)))
+           (call-with-input-file "tmp1.o" port->string)))
+
+  (test* "copy-port file->file" (list (string-length big) big)
+         (begin
+           (with-output-to-file "tmp1.o" (cut display big))
+           (let1 n (call-with-input-file "tmp1.o"
+                     (^[in] (call-with-output-file "tmp2.o"
+                              (^[out] (copy-port in out)))))
+             (list n (call-with-input-file "tmp2.o" port->string)))))
+
+  (test* "copy-port file->file (partly read, size)"
+         (list (substring big 0 5) 12345 (substring big 5 12350)
+               (substring big 12350 12355))
+         (call-with-input-file "tmp1.o"
+           (^[in]
+             (let* ([head (read-string 5 in)]
+                    [n (call-with-output-file "tmp2.o"
+                         (^[out] (copy-port in out :size 12345)))])
+               (list head n (call-with-input-file "tmp2.o" port->string)
+                     (read-string 5 in))))))
+
+  (test* "copy-port file->file (byte)" big
+         (begin
+           (call-with-input-file "tmp1.o"
+             (^[in] (call-with-output-file "tmp2.o"
+                      (^[out] (copy-port in out :unit 'byte)))))
+           (call-with-input-file "tmp2.o" port->string))))
+
+(sys-unlink "tmp2.o")
+
 ;;-------------------------------------------------------------------
 (test-section "with-ports")
 
@@ -413,6 +456,52 @@
                  (write-char (read-char) (current-error-port))))))
          (list (get-output-string o0) (get-output-string o1))))
 
+;;-------------------------------------------------------------------
+(test-section "port locking")
+
+(let ([locked? (with-module gauche.internal %port-locked?)])
+  (test* "with-port-locking" '(#f #t #t "1(a b)\"c\"d#0=(x . #0#)" #f)
+         (let1 out (open-output-file "tmp1.o")
+           (unwind-protect
+               (let* ([r0 (locked? out)]
+                      [r (with-port-locking out
+                           (^[] (list (locked? out)
+                                      (with-port-locking out
+                                        (^[]
+                                          (write 1 out)
+                                          (write '(a b) out)
+                                          (write "c" out)
+                                          (display 'd out)
+                                          (let1 x (list 'x)
+                                            (set-cdr! x x)
+                                            (write x out))
+                                          (locked? out))))))])
+                 (close-port out)
+                 `(,r0 ,@r ,(call-with-input-file "tmp1.o" port->string)
+                       ,(locked? out)))
+             (close-port out))))
+  (test* "with-port-locking extra args" "3"
+         (call-with-output-string
+           (^[out] (with-port-locking out write 3 out))))
+  (test* "with-port-locking and error" '(error #f)
+         (let1 out (open-output-file "tmp1.o")
+           (unwind-protect
+               (list (guard (e [else 'error])
+                       (with-port-locking out
+                         (^[] (with-port-locking out
+                                (^[] (write (list 'a (undefined)) out)
+                                     (error "boo"))))))
+                     (locked? out))
+             (close-port out))))
+  (test* "locked leaf write with controls" "ff"
+         (let1 out (open-output-file "tmp1.o")
+           (with-port-locking out
+             (^[] (write 255 out (make-write-controls :print-base 16))))
+           (close-port out)
+           (call-with-input-file "tmp1.o" port->string))))
+
+(sys-unlink "tmp1.o")
+
 ;;-------------------------------------------------------------------
 (test-section "seeking")
 
@@ -848,6 +937,59 @@
        (begin (list #,(countup) #;#,(countup) #,(countup))
               *counter*))
 
+;;-------------------------------------------------------------------
+(test-section "reader buffer fast path")
+
+;; The reader scans words and strings directly in the port's buffer when
+;; they're entirely in it.  With unbuffered file port, tokens are split
+;; at buffer boundaries so that the reader falls back to the slow path.
+(let ()
+  (define data
+    `(abc :key |a b| "string" "multi\nline" "esc\"aped\\"
+      0 -1 +1 123456789012345678 1234567890123456789012 -0.5 1e10 #x1f
+      ,(string->symbol (make-string 200 #\a))
+      ,(make-string 300 #\z)
+      (a . b) #(1 2 "x") #t #f #\a))
+  (define text
+    (with-output-to-string
+      (^[] (dotimes [i 50]
+             (write data) (newline)
+             (display "; comment\n#| block |# 1+ -> .5 ...\n")))))
+  (define expected
+    (append-map (^_ (list data '1+ '-> .5 '...)) (iota 50)))
+
+  (test* "string port" expected (port->sexp-list (open-input-string text)))
+  (test* "string port, read" expected
+         (let1 p (open-input-string text)
+           (let loop ([r '()])
+             (let1 x (read p)
+               (if (eof-object? x) (reverse r) (loop (cons x r)))))))
+  (sys-unlink "tmp2.o")
+  (with-output-to-file "tmp2.o" (cut display text))
+  (test* "file port" expected
+         (call-with-input-file "tmp2.o" port->sexp-list))
+  (test* "file port, small buffer" expected
+         (call-with-input-file "tmp2.o"
+           (^p (set! (port-buffering p) :none) (port->sexp-list p))))
+  (test* "line count" '((a "b\nc") 2 (d) 6)
+         (let* ([p (open-input-string "(a \"b\nc\")\n\n(d) ; x\n\n")]
+                [x (read p)]
+                [l (port-current-line p)]
+                [y (read p)])
+           (read p)
+           (list x l y (port-current-line p))))
+  (test* "symbol followed by peeked char" '(abc def)
+         (let1 p (open-input-string "abc def")
+           (peek-char p)
+           (list (read p) (read p))))
+  (test* "symbol at the end" 'xyz
+         (read (open-input-string "xyz")))
+  (test* "fixnum and bignum" (list (greatest-fixnum) (+ (greatest-fixnum) 1))
+         (read (open-input-string
+                (format "(~a ~a)" (greatest-fixnum) (+ (greatest-fixnum) 1)))))
+  (test* "case folding" '(abc xyz)
+         (read (open-input-string "#!fold-case (ABC Xyz)"))))
+
 ;;-------------------------------------------------------------------
 (test-section "port->* basic")
 
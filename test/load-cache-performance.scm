@@ -0,0 +1,44 @@
+;;
+;; measuring the effect of the load cache on startup time
+;;
+;;  gosh load-cache-performance.scm [gosh-path] [module ...]
+;;
+;; Runs `gosh -u <module> -E exit' repeatedly, without the load cache,
+;; and with GAUCHE_LOAD_CACHE set to a temporary directory (the first
+;; run fills the cache).  Modules default to a few large libraries
+;; written in Scheme.
+;;
+
+(use gauche.time)
+(use gauche.process)
+(use file.util)
+
+(define *runs* 10)
+
+(define (run-gosh gosh modules)
+  (process-wait
+   (run-process `(,gosh ,@(append-map (^m `("-u" ,m)) modules) "-E" "exit"))))
+
+(define (startup-time gosh modules)
+  (time-result-real (time-this *runs* (^[] (run-gosh gosh modules)))))
+
+(define (main args)
+  (let ([gosh (if (> (length args) 1) (cadr args) "gosh")]
+        [modules (if (> (length args) 2)
+                   (cddr args)
+                   '("rfc.http" "text.html-lite" "util.match"))]
+        [cache (build-path (temporary-directory)
+                           #"gauche-load-cache-~(sys-getpid)")])
+    (format #t "modules: ~s\n" modules)
+    (sys-unsetenv "GAUCHE_LOAD_CACHE")
+    (let1 t0 (startup-time gosh modules)
+      (format #t "without cache: ~8,3f ms/run\n" (* t0 (/ 1000 *runs*)))
+      (sys-setenv "GAUCHE_LOAD_CACHE" cache #t)
+      (unwind-protect
+          (begin
+            (run-gosh gosh modules)
+            (let1 t1 (startup-time gosh modules)
+              (format #t "with cache:    ~8,3f ms/run  (~5,1f%)\n"
+                      (* t1 (/ 1000 *runs*)) (* 100 (/ t1 t0)))))
+        (remove-directory* cache))))
+  0)
@@ -424,4 +424,154 @@
          ((with-module gauche.internal %delete-load-path-hook!)
           dummy-load-path-hook)))
 
+;; Load cache -----------------------------------
+
+(test-section "load cache")
+
+(rmrf "test.o")
+(sys-mkdir "test.o" #o777)
+
+(define (write-load-cache-test-file v)
+  (with-output-to-file "test.o/lc.scm"
+    (^[]
+      (write '(define-module load-cache.test (export lc-twice lc-sum lc-v)))
+      (write '(select-module load-cache.test))
+      (write '(define-syntax twice (syntax-rules () [(_ x) (* 2 x)])))
+      (write '(define (lc-twice x) (twice x)))
+      (write '(define lc-table '#(1 2 (3 . "a"))))
+      (write '(define (lc-sum)
+                (let loop ([i 0] [s 0])
+                  (if (= i 3)
+                    s
+                    (let1 x (vector-ref lc-table i)
+                      (loop (+ i 1) (+ s (if (pair? x) (car x) x))))))))
+      (write `(define lc-v ,v))))
+  ;; Cache isn't created for a file modified just now.
+  (sys-utime "test.o/lc.scm" 0 1000000))
+
+(define (load-cache-test-result)
+  (load "./test.o/lc.scm")
+  (list (eval '(lc-twice 4) (find-module 'load-cache.test))
+        (eval '(lc-sum) (find-module 'load-cache.test))
+        (eval 'lc-v (find-module 'load-cache.test))))
+
+(write-load-cache-test-file 1)
+(unwind-protect
+    (begin
+      ((with-module gauche.internal %load-cache-directory) "test.o/cache")
+      (test* "load cache (first)" '(8 6 1) (load-cache-test-result))
+      (test* "load cache file" #t
+             (file-exists?
+              ((with-module gauche.internal %load-cache-file)
+               "./test.o/lc.scm" #f)))
+      ;; Same size and mtime; the cache should be used.
+      (write-load-cache-test-file 2)
+      (test* "load cache (cached)" '(8 6 1) (load-cache-test-result))
+      (write-load-cache-test-file 10)
+      (test* "load cache (invalidated)" '(8 6 10) (load-cache-test-result)))
+  ((with-module gauche.internal %load-cache-directory) #f))
+
+;; A cache written when the file is reloaded in the same process, where
+;; define-module, export etc. change nothing, must still recreate the
+;; module when it is replayed afresh.  We simulate a fresh process by
+;; renaming the module in the cache and replaying it for another file.
+(define (write-load-cache-reload-file file modname v)
+  (with-output-to-file file
+    (^[]
+      (write '(use srfi-1))
+      (write `(define-module ,modname (export lr-twice lr-v)))
+      (write `(select-module ,modname))
+      (write '(define-syntax twice (syntax-rules () [(_ x) (* 2 x)])))
+      (write '(define (lr-twice x) (twice x)))
+      (write `(define lr-v ,v))))
+  (sys-utime file 0 1000000))
+
+(define (load-cache-entries file)
+  (call-with-input-file
+      ((with-module gauche.internal %load-cache-file) file #f)
+    (^[in] (read in) (port->list read in))))
+
+(write-load-cache-reload-file "test.o/lr1.scm" 'load-cache.reload1 1)
+(load "./test.o/lr1.scm")
+(unwind-protect
+    (begin
+      ((with-module gauche.internal %load-cache-directory) "test.o/cache")
+      (load "./test.o/lr1.scm")
+      (test* "load cache after reload" '(eval use srfi-1)
+             (car (load-cache-entries "./test.o/lr1.scm")))
+      (test* "load cache after reload (module forms)"
+             '((eval define-module load-cache.reload1 (export lr-twice lr-v))
+               (eval select-module load-cache.reload1))
+             (take (cdr (load-cache-entries "./test.o/lr1.scm")) 2))
+      ;; Same size and mtime, so lr2.scm's cache is used instead of lr2.scm.
+      (write-load-cache-reload-file "test.o/lr2.scm" 'load-cache.reload2 2)
+      (call-with-input-file
+          ((with-module gauche.internal %load-cache-file)
+           "./test.o/lr1.scm" #f)
+        (^[in]
+          (let1 entries (port->list read in)
+            (call-with-output-file
+                ((with-module gauche.internal %load-cache-file)
+                 "./test.o/lr2.scm" #f)
+              (^[out]
+                (dolist [e entries]
+                  (write (let rec ([x e])
+                           (cond [(pair? x) (cons (rec (car x)) (rec (cdr x)))]
+                                 [(eq? x 'load-cache.reload1)
+                                  'load-cache.reload2]
+                                 [(string? x)
+                                  (regexp-replace #/lr1\.scm$/ x "lr2.scm")]
+                                 [else x]))
+                         out)
+                  (newline out)))))))
+      (load "./test.o/lr2.scm")
+      (test* "load cache replayed into a fresh module" '(8 1)
+             (eval '(list (lr-twice 4) lr-v)
+                   (find-module 'load-cache.reload2)))
+      (test* "load cache replayed into a fresh module (exports)"
+             '(lr-twice lr-v)
+             (sort (module-exports (find-module 'load-cache.reload2))
+                   (^[a b] (string<? (symbol->string a)
+                                     (symbol->string b))))))
+  ((with-module gauche.internal %load-cache-directory) #f))
+
+;; Forms with compile-time effects must be kept as source, even if
+;; they're nested in toplevel conditionals.
+(test* "load cache keeps compile-time forms as source"
+       '(#t #t #t #t #t #f #f)
+       (map (with-module gauche.internal %load-cache-eval-form?)
+            '((export-all)
+              (cond-expand [gauche (use srfi-1)] [else])
+              (cond-expand [(not gauche) (define x 1)]
+                           [else (begin (export x))])
+              (when #t (import srfi-1))
+              (unless #f (define-syntax foo (syntax-rules ())))
+              (cond-expand [gauche (define x 1)])
+              (when (use? x) (define y 1)))))
+
+(define (write-load-cache-nested-file file)
+  (with-output-to-file file
+    (^[]
+      (write '(define-module load-cache.nested))
+      (write '(select-module load-cache.nested))
+      (write '(export-all))
+      (write '(cond-expand [gauche (use srfi-13)] [else]))
+      (write '(define (ln-up s) (string-upcase s)))))
+  (sys-utime file 0 1000000))
+
+(write-load-cache-nested-file "test.o/ln.scm")
+(unwind-protect
+    (begin
+      ((with-module gauche.internal %load-cache-directory) "test.o/cache")
+      (load "./test.o/ln.scm")
+      (test* "load cache entries of export-all and cond-expand"
+             '(eval eval eval eval code)
+             (map car (load-cache-entries "./test.o/ln.scm")))
+      (load "./test.o/ln.scm")
+      (test* "load cache (replayed)" "ABC"
+             (eval '(ln-up "abc") (find-module 'load-cache.nested))))
+  ((with-module gauche.internal %load-cache-directory) #f))
+
+(rmrf "test.o")
+
 (test-end)
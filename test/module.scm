@@ -587,6 +587,64 @@
           (eval '(define x 13) m0)
           (eval 'x m1))))
 
+;;------------------------------------------------------------------
+;; global references resolved after the bindings change
+
+(define-module binding-cache-a
+  (export bca-x)
+  (define bca-x 10))
+
+(define (binding-cache-check m)
+  (eval '(define (bca-ref) bca-x) m)
+  (guard (e [(<error> e) 'unbound]) (eval '(bca-ref) m)))
+
+(define (binding-cache-test name setup)
+  (let* ([m (make-module name)]
+         [r (binding-cache-check m)])
+    (eval setup m)
+    (list r (eval '(bca-ref) m))))
+
+;; Named modules cache the resolution; anonymous ones don't.
+(dolist [named? '(#t #f)]
+  (define (name base) (and named? base))
+  (test* #"reference resolved after define (named=~|named?|)" '(unbound 20)
+         (binding-cache-test (name 'binding-cache-m1) '(define bca-x 20)))
+  (test* #"reference resolved after import (named=~|named?|)" '(unbound 10)
+         (binding-cache-test (name 'binding-cache-m2)
+                             '(import binding-cache-a)))
+  (test* #"reference resolved after extend (named=~|named?|)" '(unbound 10)
+         (binding-cache-test (name 'binding-cache-m3)
+                             '(extend binding-cache-a))))
+
+;; The cache is invalidated per symbol.  Defining a binding of another
+;; name doesn't affect the resolution.
+(define-module binding-cache-b
+  (export-all))
+
+(define-module binding-cache-m4
+  (import binding-cache-b)
+  (define (bcb-ref) (guard (e [(<error> e) 'unbound]) bcb-x)))
+
+(define-module binding-cache-m5
+  (import (binding-cache-b :prefix p:))
+  (define (bcb-ref) (guard (e [(<error> e) 'unbound]) p:bcb-y)))
+
+(test* "reference resolved after define in imported module"
+       '(unbound unbound 30)
+       (let* ([m (find-module 'binding-cache-m4)]
+              [r0 (eval '(bcb-ref) m)])
+         (eval '(define bcb-other 0) (find-module 'binding-cache-b))
+         (let1 r1 (eval '(bcb-ref) m)
+           (eval '(define bcb-x 30) (find-module 'binding-cache-b))
+           (list r0 r1 (eval '(bcb-ref) m)))))
+
+(test* "reference resolved after define in prefixed import"
+       '(unbound 40)
+       (let* ([m (find-module 'binding-cache-m5)]
+              [r0 (eval '(bcb-ref) m)])
+         (eval '(define bcb-y 40) (find-module 'binding-cache-b))
+         (list r0 (eval '(bcb-ref) m))))
+
 ;;-------------------------------------------------------------------
 ;; Macro and builtin inliner
 ;; https://twitter.com/tk_riple/status/647865265154326528
@@ -317,6 +317,42 @@
        (list (= 0.0 (string->number "0e324"))
              (= 0.0 (string->number "0e325"))))
        
+;; The fast paths of flonum printing (Ryu) and reading (Eisel-Lemire)
+;; must agree with the bignum-based algorithms.  We compare them over
+;; pseudo random flonums, including subnormals, and decimal notations.
+(let ()
+  (define fast (with-module gauche.internal %fast-flonum-conversion))
+  (define seed 1)
+  (define (rand n)                      ;64bit LCG
+    (set! seed (logand (+ (* seed 6364136223846793005) 1442695040888963407)
+                       (- (expt 2 64) 1)))
+    (modulo (ash seed -11) n))
+  (define flonums
+    (map (^i (case (modulo i 4)
+               [(0) (ldexp (+ (expt 2 52) (rand (expt 2 52)))
+                           (- (rand 2046) 1074))]
+               [(1) (ldexp (+ (rand (expt 2 52)) 1) -1074)]
+               [(2) (- (ldexp 1.0 (- (rand 2098) 1074)))]
+               [(3) (/ (rand 100000000) (expt 10.0 (rand 30)))]))
+         (iota 2000)))
+  (define decimals
+    (map (^_ (format "~ae~a" (rand (expt 10 (+ (rand 19) 1)))
+                     (- (rand 660) 340)))
+         (iota 2000)))
+  (define (with-fast flag thunk)
+    (let1 prev (fast)
+      (dynamic-wind (^[] (fast flag)) thunk (^[] (fast prev)))))
+  (define (print-all) (map number->string flonums))
+  (define (read-all strs) (map string->number strs))
+
+  (let ([printed-fast (with-fast #t print-all)]
+        [printed-slow (with-fast #f print-all)])
+    (test* "flonum printer fast path" printed-slow printed-fast)
+    (test* "flonum reader fast path (round trip)" flonums
+           (with-fast #t (cut read-all printed-fast)))
+    (test* "flonum reader fast path" (with-fast #f (cut read-all decimals))
+           (with-fast #t (cut read-all decimals)))))
+
 ;; We used to allow 1#1 to be read as a symbol.  As of 0.9.4, it is an error.
 (test* "padding" '(10.0 #t) (flonum-test "1#"))
 (test* "padding" '(10.0 #t) (flonum-test "1#."))
@@ -491,6 +527,42 @@
         "-340282366920938463463374607431768211457")
       (i-tester2 (exp2 127)))
 
+;; Long numbers are converted by divide-and-conquer.
+(let ()
+  (define (digits d n) (make-string n d))
+  (define (t name expected thunk) (test* name expected (thunk)))
+
+  (dolist [n '(1000 5000 40000)]
+    (let ([ten^n (string->number (string-append "1" (digits #\0 n)))])
+      (t #"10^~|n|" (string-append "1" (digits #\0 n))
+         (cut number->string ten^n))
+      (t #"10^~|n|-1" (digits #\9 n)
+         (cut number->string (- ten^n 1)))
+      (t #"-(10^~|n|-1)" (string-append "-" (digits #\9 n))
+         (cut number->string (- 1 ten^n)))
+      (t #"10^~|n|-1 read" (- ten^n 1)
+         (cut string->number (digits #\9 n)))
+      (t #"2^~|n| radix 16" (string-append "1" (make-string (/ n 4) #\0))
+         (cut number->string (ash 1 n) 16))
+      (t #"2^~|n|-1 radix 2" (digits #\1 n)
+         (cut number->string (- (ash 1 n) 1) 2))
+      (t #"2^~|n|-1 read radix 2" (- (ash 1 n) 1)
+         (cut string->number (digits #\1 n) 2))))
+
+  (let1 x (- (ash 1 70000) (* 12345678987654321 (ash 1 35000)) 3)
+    (dolist [radix '(2 3 7 10 16 36)]
+      (t #"roundtrip radix ~|radix|" x
+         (cut string->number (number->string x radix) radix))
+      (t #"roundtrip radix ~|radix| (upcase)" x
+         (cut string->number (number->string x radix #t) radix))))
+
+  (let1 s (string-append "12" (digits #\3 3000))
+    (t "long digits followed by _" (+ (* (string->number s) 1000) 456)
+       (cut string->number (string-append "#d" s "_456")))
+    (t "long digits followed by #" (* (string->number s) 100)
+       (cut string->number (string-append "#e" s "##"))))
+  )
+
 ;;==================================================================
 ;; Conversions
 ;;
@@ -1273,6 +1345,44 @@
            173462447179147555430258970864309778377421844723664084649347019061363579192879108857591038330408837177983810868451546421940712978306134189864280826014542758708589243873685563973118948869399158545506611147420216132557017260564139394366945793220968665108959685482705388072645828554151936401912464931182546092879815733057795573358504982279280090942872567591518912118622751714319229788100979251036035496917279912663527358783236647193154777091427745377038294584918917590325110939381322486044298573971650711059244462177542540706913047034664643603491382441723306598834177
            ))
 
+;; Karatsuba and Toom-3.  We lower the thresholds so that moderate sized
+;; numbers go through them, and compare the results with the schoolbook
+;; multiplication.
+(let ()
+  (define thresholds (with-module gauche.internal %bignum-mul-thresholds))
+  (define (numbers)
+    ;; all-one bits, sparse bits, and pseudo random bits of various sizes
+    (append-map (^[bits]
+                  (list (- (expt 2 bits) 1)
+                        (+ (expt 2 bits) (expt 2 (quotient bits 3)) 1)
+                        (+ (expt 7 (quotient bits 3))
+                           (expt 11 (quotient bits 4)))))
+                '(300 1000 2047 2048 2049 3333 6000 9000)))
+  (define (products)
+    (append-map (^x (map (^y (list (* x y) (* (- x) y) (* x x))) (numbers)))
+                (numbers)))
+  (receive (k t) (thresholds)
+    (thresholds 100000 100000)
+    (let ([expected (products)]
+          [e3 (expt 3 12000)])
+      (for-each (^[kt]
+                  (apply thresholds kt)
+                  (test* #"multiplication with thresholds ~kt" expected
+                         (products)))
+                '((8 16) (8 100000) (12 20) (16 40)))
+      (thresholds 8 16)
+      (test* "square of all-ones"
+             (+ (- (expt 2 20000) (expt 2 10001)) 1)
+             (let1 x (- (expt 2 10000) 1) (* x x)))
+      (test* "(x+1)(x-1)"
+             (- e3 1)
+             (* (+ (expt 3 6000) 1) (- (expt 3 6000) 1)))
+      (test* "expt" e3 (expt 3 12000))
+      (test* "exact-integer-sqrt"
+             (list (expt 7 4000) 12345)
+             (receive r (exact-integer-sqrt (+ (expt 7 8000) 12345)) r))
+      (thresholds k t))))
+
 ;;------------------------------------------------------------------
 (test-section "multiplication short cuts")
 
@@ -1408,6 +1408,53 @@
 (test* "apply special path (apply->normal)" '(z c b a)
        (app-sp-path-test2 (make <app-sp-path2>) 'a 'b 'c))
 
+;;----------------------------------------------------------------
+(test-section "dispatch cache")
+
+;; The sorted applicable methods are cached per generic function.
+;; Make sure the cache follows changes of methods and classes.
+
+(define-class <dc-a> () ())
+(define-class <dc-b> (<dc-a>) ())
+(define-class <dc-c> () ())
+
+(define-method dc-test ((x <dc-a>)) 'a)
+(define-method dc-test ((x <dc-a>) (y <integer>)) 'a-int)
+(define-method dc-test ((x <dc-a>) (y <top>)) 'a-top)
+
+(define (dc-run)
+  (let ([a (make <dc-a>)] [b (make <dc-b>)])
+    (list (dc-test a) (dc-test b) (dc-test a 1) (dc-test b 'x)
+          (apply dc-test b '(2)))))
+
+(test* "dispatch cache" '(a a a-int a-top a-int)
+       (begin (dc-run) (dc-run)))
+
+(test* "dispatch cache (hits)" #t
+       (let1 hits (get-keyword :hits (generic-dispatch-stat dc-test))
+         (dc-run)
+         (>= (get-keyword :hits (generic-dispatch-stat dc-test)) (+ hits 5))))
+
+(define-method dc-test ((x <dc-b>)) (cons 'b (next-method)))
+
+(test* "dispatch cache (add-method!)" '(a (b . a) a-int a-top a-int)
+       (dc-run))
+
+(test* "dispatch cache (delete-method!)" '(a a a-int a-top a-int)
+       (let1 m (find (^m (equal? (slot-ref m 'specializers) (list <dc-b>)))
+                     (slot-ref dc-test 'methods))
+         (delete-method! dc-test m)
+         (dc-run)))
+
+(test* "dispatch cache (no applicable method)" (test-error)
+       (dc-test (make <dc-c>)))
+
+(test* "dispatch cache (class redefinition)" '(a a-int)
+       (begin
+         (eval '(define-class <dc-c> (<dc-a>) ()) (current-module))
+         (let1 c (make <dc-c>)
+           (list (dc-test c) (dc-test c 3)))))
+
 ;;----------------------------------------------------------------
 (test-section "applicable?")
 
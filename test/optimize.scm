@@ -84,6 +84,38 @@
 (test* "constant closure identity" #t
        (eq? (make-constant-closure) (make-constant-closure)))
 
+(test-section "non-escaping closures")
+
+;; A literal lambda passed to for-each/map with a single list is expanded
+;; into a loop, so it shouldn't create a closure even if it has free
+;; variables.
+(test* "for-each with closure" '()
+       (filter-insn (^[xs n] (for-each (^x (print (+ x n))) xs)) 'CLOSURE))
+(test* "map with closure" '()
+       (filter-insn (^[xs n] (map (^x (+ x n)) xs)) 'CLOSURE))
+(test* "for-each with closure (result)" '(13 12 11)
+       (let1 r '()
+         (for-each (^x (push! r (+ x 10))) '(1 2 3))
+         r))
+(test* "map with closure (result)" '(11 12 13)
+       (let1 n 10 (map (^x (+ x n)) '(1 2 3))))
+(test* "map with closure (empty)" '()
+       (let1 n 10 (map (^x (+ x n)) '())))
+(test* "for-each with closure (improper list)" (test-error)
+       (let1 n 0 (for-each (^x (inc! n x)) '(1 2 . 3))))
+(test* "map with closure (improper list)" (test-error)
+       (let1 n 0 (map (^x (+ x n)) '(1 2 . 3))))
+;; Re-entering the loop by a continuation must not affect the previous result
+(test* "map with closure (reentrance)" '((1 2 3) (1 20 3))
+       (let ([k #f] [r '()] [n 0])
+         (let1 v (map (^x (if (= x 2)
+                            (call/cc (^c (set! k c) x))
+                            x))
+                      '(1 2 3))
+           (push! r v)
+           (when (< (inc! n) 2) (k 20))
+           (reverse r))))
+
 (test-section "transformation")
 
 ;; pass2 intermediate lref elimination
@@ -955,4 +955,97 @@
                                               (seq #\a #\b)))
                         "abc"))
 
+;;-------------------------------------------------------------------------
+(test-section "DFA engine")
+
+(test* "regexp-engine" '(dfa dfa backtrack backtrack backtrack)
+       (map regexp-engine
+            (list #/(a|b)*c/ #/^ab$/i #/(a)\1/ #/a(?=b)/ #/\bfoo/)))
+(test* "regexp-engine (forced)" '(backtrack dfa)
+       (list (regexp-engine (string->regexp "abc" :engine 'backtrack))
+             (regexp-engine (string->regexp "abc" :engine 'dfa))))
+(test* "regexp-engine (error)" (test-error)
+       (string->regexp "(a)\\1" :engine 'dfa))
+(test* "regexp-engine (error)" (test-error)
+       (string->regexp "abc" :engine 'nfa))
+(test* "engine doesn't affect equality" #t
+       (equal? (string->regexp "abc" :engine 'dfa)
+               (string->regexp "abc" :engine 'backtrack)))
+
+;; Both engines should find the same match.
+(let ()
+  (define (match-info rx str)
+    (and-let* ([m (rxmatch rx str)])
+      (map (^i (list (rxmatch-start m i) (rxmatch-end m i)))
+           (iota (rxmatch-num-matches m)))))
+  (define (test-engines pat str :optional (case-fold #f))
+    (test* #"~pat ~str" (match-info (string->regexp pat :case-fold case-fold
+                                                    :engine 'backtrack)
+                                    str)
+           (match-info (string->regexp pat :case-fold case-fold :engine 'dfa)
+                       str)))
+  (define long-input (string-append (make-string 100 #\x) "abcab"))
+
+  (dolist [s '("" "a" "ab" "abc" "xabcx" "aaab" "cabab" "ba$b" "あb")]
+    (dolist [p '("a" "ab|a" "a|ab" "a*" "a*?" "a+b" "(a|ab)(c|bcd)?"
+                 "a{2,3}" "a{2,3}?" "(?:a|b){1,3}?b" "^a" "b$" "a$b"
+                 "^$" "(a+)*$" "[^a]" "." ".*b" "(.)(.)" "(?i:A)B"
+                 "あ" "(?:^|b)a?$")])
+      (test-engines p s)
+      (test-engines p (string-append long-input s))))
+  (test-engines "ab" "xAbAB" #t)
+  (test-engines "[a-c]+あ" "zzCbAあ" #t)
+  ;; Many distinct non-ASCII chars; あ and ぢ share a slot of the
+  ;; per-state cache of non-ASCII transitions.
+  (let1 kana (list->string (map integer->char (iota 86 #x3041)))
+    (test-engines "[ぁ-ゖ]+ゖ" kana)
+    (test-engines "(?:あ|ぢ)+[^ぁ-ゖ]" (string-append kana "あぢあぢx"))
+    (test-engines "ぢ.*?ゔ" (string-append kana kana))))
+
+;; The backtracking matcher would take exponential time on these.
+(let1 s (make-string 40 #\a)
+  (test* "no catastrophic backtracking" #f
+         (rxmatch #/^(?:a|aa)*c/ s))
+  (test* "no catastrophic backtracking" (string-append s "c")
+         (rxmatch->string #/(?:a|aa)*c/ (string-append "b" s "c")))
+  (test* "no catastrophic backtracking (submatch)" #f
+         (rxmatch (string->regexp "(?:a|aa)*(a)c" :engine 'dfa) s)))
+
+;;-------------------------------------------------------------------------
+(test-section "prefilter")
+
+;; The prefilter looks for a literal string every match must contain
+;; before matching.  It only kicks in for long input.
+(let ([pad (make-string 1000 #\x)]
+      [padj (make-string 500 #\い)])
+  (define (test-prefilter rx str expect)
+    (test* (format "~s (~a chars)" rx (string-length str)) expect
+           (cond [(rxmatch rx str)
+                  => (^m (list (rxmatch-start m) (rxmatch-substring m)))]
+                 [else #f])))
+  (dolist [engine '(backtrack auto)]
+    (let1 rx (^[pat] (string->regexp pat :engine engine))
+      ;; literal prefix
+      (test-prefilter (rx "abc\\d+") (string-append pad "abc" pad "abc12")
+                      '(2003 "abc12"))
+      (test-prefilter (rx "abc\\d+") (string-append pad "abc" pad "abd12")
+                      #f)
+      (test-prefilter (rx "ab(c|d)") (string-append pad "abe" pad "abdx")
+                      '(2003 "abd"))
+      (test-prefilter (rx "xxa") (string-append pad "a") '(998 "xxa"))
+      (test-prefilter (rx "あい+う") (string-append padj "あいいう" padj)
+                      '(500 "あいいう"))
+      ;; required substring
+      (test-prefilter (rx "\\d+foo") (string-append pad "12foo") '(1000 "12foo"))
+      (test-prefilter (rx "\\d+foo") (string-append pad "12fo") #f)
+      (test-prefilter (rx "[a-z]+(?:bar)+") (string-append pad "barbar")
+                      `(0 ,(string-append pad "barbar")))
+      (test-prefilter (rx "(?i:foo)bar") (string-append pad "FoObar")
+                      '(1000 "FoObar"))
+      (test-prefilter (rx "(?i:foo)bar") (string-append pad "FoObaR")
+                      #f)
+      ;; the prefilter isn't used for anchored regexps, but they should work
+      (test-prefilter (rx "^x+y") (string-append pad "y")
+                      `(0 ,(string-append pad "y"))))))
+
 (test-end)
@@ -127,6 +127,71 @@
            '("bbb" "CCC" "AAA" "aaa" "BBB" "ccc")
            '("CCC" "ccc" "bbb" "BBB" "AAA" "aaa"))
 
+;; builtin sort
+(test* "sort stability (default order)" '(1.0 1 1 2 2.0)
+       (sort '(2 1.0 1 2.0 1)))
+(test* "sort stability (<)" '#(1 1.0 1 2.0 2)
+       (sort '#(2.0 1 1.0 2 1) <))
+(test* "sort stability (string<?)" '("a" "b" "b" "c")
+       (map (^p (car p))
+            (sort-by '(("b" . 1) ("a" . 2) ("c" . 3) ("b" . 4)) car string<?)))
+(test* "sort (<, mixed)" '(-1 1/2 0.75 1 2)
+       (sort '(1 0.75 2 -1 1/2) <))
+(test* "sort (<, nan)" #t
+       (let1 r (sort (list 3.0 +nan.0 1.0) <)
+         (and (= (length r) 3) (boolean (memv 1.0 r)) (boolean (memv 3.0 r)))))
+(test* "sort (<, error)" (test-error)
+       (sort '(3 1 a 2) <))
+(test* "sort! with error keeps elements" '(0 1 2 3 4 5 6 7 8 9)
+       (let1 v (vector 3 4 8 2 0 1 5 9 7 6)
+         (guard (e [else #f])
+           (sort! v (^[a b] (if (or (= a 0) (= b 0)) (error "boo") (< a b)))))
+         (sort (vector->list v))))
+
+;; large input, possibly sorted in parallel
+(let* ([seed 12345]
+       [rand (^[] (set! seed (modulo (+ (* seed 1103515245) 12345) 2147483648))
+                  seed)]
+       [ints (list-tabulate 200000 (^_ (- (rand) 1073741824)))]
+       [flos (map (^i (/ i 7.0)) ints)]
+       [strs (map number->string (take ints 50000))])
+  (define (check name data cmp)
+    (test* #"sort large (~name)" #t
+           (let ([r (sort (list->vector data) cmp)]
+                 [r2 (sort data (^[a b] (cmp a b)))])
+             (equal? (vector->list r) r2))))
+  (check "fixnum" ints <)
+  (check "flonum" flos <)
+  (check "string" strs string<?)
+  (test* "sort large (presorted)" #t
+         (let1 v (sort (list->vector ints))
+           (equal? v (sort! (vector-copy v))))))
+
+;; builtin sort with key
+(test* "sort with key, called once per element" '(100 (0 1 2 3 4))
+       (let* ([n 0]
+              [v (list-tabulate 100 (^i (cons (modulo (* i 37) 100) i)))]
+              [r (sort v < (^p (inc! n) (car p)))])
+         (list n (map car (take r 5)))))
+(test* "sort with key (radix, fixnum)" #t
+       (let* ([data (list-tabulate 1000
+                                   (^i (cons (- (modulo (* i 7919) 1013) 500) i)))]
+              [r1 (sort data < car)]
+              [r2 (sort data (^[a b] (< (car a) (car b))))])
+         (equal? r1 r2)))
+(test* "sort with key (radix, flonum)" '((-1.5 . 3) (-0.0 . 0) (0.0 . 1) (-0.0 . 4))
+       (take (sort! (append '((-0.0 . 0) (0.0 . 1) (2.5 . 2) (-1.5 . 3) (-0.0 . 4))
+                            (list-tabulate 100 (^i (cons (+ 10.0 i) (+ i 5)))))
+                    < car)
+             4))
+(test* "sort with key (stability)" '((1 . b) (1 . d) (2 . a) (2 . c))
+       (sort '((2 . a) (1 . b) (2 . c) (1 . d)) #f car))
+(test* "sort! with key (vector, string)" '#("a" "bb" "ccc" "dddd")
+       (sort! (vector "ccc" "a" "dddd" "bb") string<?
+              (^s (make-string (string-length s) #\x))))
+(test* "sort with key (error)" (test-error)
+       (sort '(1 2 3) < (^x (if (= x 2) (error "boo") x))))
+
 (test-section "sort-by")
 
 (define (sort-by-nocmp key . in&exps)
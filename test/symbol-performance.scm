@@ -0,0 +1,40 @@
+;;
+;; measure symbol interning throughput from multiple threads
+;;
+;;  gosh symbol-performance.scm [nthreads [nnames [rounds]]]
+;;
+;; Each thread interns the same set of names repeatedly.  After the first
+;; round all names are already interned, so this mostly exercises the
+;; lookup path of the symbol table.  A fraction of fresh names is mixed
+;; in every round to keep the insertion path busy as well.
+
+(use gauche.time)
+(use gauche.threads)
+
+(define (make-names prefix n)
+  (vector-tabulate n (^i (format "~a-~d" prefix i))))
+
+(define (intern-loop names fresh rounds)
+  (^[]
+    (dotimes [r rounds]
+      (vector-for-each string->symbol names)
+      (dotimes [i fresh]
+        (string->symbol (format "fresh-~a-~d-~d" (current-thread) r i))))))
+
+(define (run nthreads names fresh rounds)
+  (let* ([thunk (intern-loop names fresh rounds)]
+         [ths (map (^_ (make-thread thunk)) (iota nthreads))])
+    (for-each thread-start! ths)
+    (for-each thread-join! ths)))
+
+(define (main args)
+  (define (arg k default)
+    (if (> (length args) k) (string->number (list-ref args k)) default))
+  (let ([nthreads (arg 1 4)]
+        [nnames   (arg 2 10000)]
+        [rounds   (arg 3 100)])
+    (let1 names (make-names "key" nnames)
+      (dolist [n (delete-duplicates (list 1 nthreads))]
+        (format #t "~2d thread(s), ~d names x ~d rounds:\n" n nnames rounds)
+        (print (time-this 1 (cut run n names 10 rounds))))))
+  0)
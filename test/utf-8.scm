@@ -125,6 +125,34 @@
         (list (string-pointer-substring sp)
               (string-pointer-substring sp :after #t))))
 
+;;-------------------------------------------------------------------
+(test-section "indexed access to long strings")
+
+;; Long multibyte strings get an index on repeated access.  Check
+;; the positions around the checkpoints.
+(let* ([chars (map (^i (case (modulo i 7) [(0 3) #] [(5) #\あ] [else #\𝄞]))
+                   (iota 2000))]
+       [vec (list->vector chars)]
+       [str (list->string chars)])
+  (test* "string-ref" chars
+         (map (cut string-ref str <>) (iota 2000)))
+  (test* "string-ref (backward)" (reverse chars)
+         (map (cut string-ref str <>) (iota 2000 1999 -1)))
+  (dolist [range '((0 300) (255 257) (256 288) (300 1999) (1000 2000)
+                   (1990 2000) (2000 2000))]
+    (test* #"substring ~range"
+           (list->string (apply vector->list vec range))
+           (apply substring str range)))
+  (test* "string-pointer" (map (^i (vector-ref vec (+ i 500))) '(0 700 1 1499))
+         (let1 sp (make-string-pointer str 0 500)
+           (map (^i (string-pointer-set! sp i) (string-pointer-ref sp))
+                '(0 700 1 1499))))
+  (test* "string-pointer-substring"
+         (list->string (vector->list vec 300 1000))
+         (let1 sp (make-string-pointer str 400 300 1200)
+           (string-pointer-set! sp 700)
+           (string-pointer-substring sp))))
+
 ;;-------------------------------------------------------------------
 (test-section "incomplete strings")
 
@@ -355,6 +383,13 @@
        (let1 s (open-input-string "なむ\n")
          (peek-byte s) (read-line s)))
 
+;; the reader makes strings directly from the port buffer
+(test* "read (multibyte string and symbol)" '("イロハ" ニホ "ヘ\nト" |あ b|)
+       (port->sexp-list
+        (open-input-string "\"イロハ\" ニホ \"ヘ\nト\" |あ b|")))
+(test* "read (incomplete string literal)" #*"\xe3\x82"
+       (read (open-input-string "#*\"\\xe3\\x82\"")))
+
 ;;-------------------------------------------------------------------
 (test-section "buffered ports")
 
@@ -0,0 +1,114 @@
+;;
+;; measure VM instruction dispatches of small standard benchmarks
+;;
+;;  gosh vminsn-performance.scm [profile-output]
+;;
+;; Runs each benchmark with instruction counting on, and shows the number
+;; of dispatched instructions and the most frequent instruction pairs.
+;; Compare the numbers before and after adding combined instructions
+;; to see whether they actually reduce dispatches.
+;;
+;; If profile-output is given, the accumulated counts are written to it,
+;; which can be fed to src/gen-superinsn.scm to generate the candidates:
+;;
+;;   gosh vminsn-performance.scm vminsn.prof
+;;   gosh ../src/gen-superinsn.scm vminsn.prof
+
+(use gauche.time)
+(use srfi-1)
+
+(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))
+
+(define (tak x y z)
+  (if (not (< y x))
+    z
+    (tak (tak (- x 1) y z) (tak (- y 1) z x) (tak (- z 1) x y))))
+
+(define (nqueens n)
+  (define (ok? row dist placed)
+    (or (null? placed)
+        (and (not (= (car placed) (+ row dist)))
+             (not (= (car placed) (- row dist)))
+             (ok? row (+ dist 1) (cdr placed)))))
+  (define (try x y z)
+    (if (null? x)
+      (if (null? y) 1 0)
+      (+ (if (ok? (car x) 1 z) (try (append (cdr x) y) '() (cons (car x) z)) 0)
+         (try (cdr x) (cons (car x) y) z))))
+  (try (iota n 1) '() '()))
+
+(define (deriv a)
+  (cond [(not (pair? a)) (if (eq? a 'x) 1 0)]
+        [(eq? (car a) '+) (cons '+ (map deriv (cdr a)))]
+        [(eq? (car a) '-) (cons '- (map deriv (cdr a)))]
+        [(eq? (car a) '*)
+         (list '* a (cons '+ (map (^a (list '/ (deriv a) a)) (cdr a))))]
+        [(eq? (car a) '/)
+         (list '- (list '/ (deriv (cadr a)) (caddr a))
+               (list '/ (cadr a) (list '* (caddr a) (caddr a)
+                                       (deriv (caddr a)))))]
+        [else (error "deriv: no derivation method available" (car a))]))
+
+(define (vector-sum n)
+  (let1 v (make-vector n 1)
+    (let loop ([i 0] [s 0])
+      (if (= i n) s (loop (+ i 1) (+ s (vector-ref v i)))))))
+
+(define (string-walk n)
+  (let1 s (make-string n #\a)
+    (let loop ([i 0] [c 0])
+      (if (= i n)
+        c
+        (loop (+ i 1) (if (char=? (string-ref s i) #\a) (+ c 1) c))))))
+
+(define *benchmarks*
+  `((fib     ,(cut fib 22))
+    (tak     ,(cut tak 18 12 6))
+    (nqueens ,(cut nqueens 8))
+    (deriv   ,(^[] (dotimes [_ 20000] (deriv '(+ (* 3 x x) (* a x x) (* b x) 5)))))
+    (vector  ,(cut vector-sum 300000))
+    (string  ,(cut string-walk 300000))))
+
+(define (total-dispatches snapshot)
+  (fold + 0 (vector->list (get-keyword :insn1 snapshot))))
+
+(define (top-pairs snapshot n)
+  (let1 insn2 (get-keyword :insn2 snapshot)
+    (take* (sort-by (append-map (^i (map (^j (cons (list i j)
+                                                     (~ insn2 i j)))
+                                         (iota (vector-length insn2))))
+                                (iota (vector-length insn2)))
+                    cdr >)
+           n)))
+
+(define (insn-name code) ((with-module gauche.vm.code vm-insn-code->name) code))
+
+(define (main args)
+  (define accumulated '())
+  (dolist [b *benchmarks*]
+    (vm-insn-counting-reset)
+    (vm-insn-counting-start)
+    (let1 t (time-this 1 (cadr b))
+      (vm-insn-counting-stop)
+      (let* ([snapshot (vm-insn-counting-snapshot)]
+             [total (total-dispatches snapshot)])
+        (format #t "~8a ~12d dispatches  ~a\n" (car b) total t)
+        (dolist [p (top-pairs snapshot 5)]
+          (format #t "         ~12d ~a ~a\n" (cdr p)
+                  (insn-name (car (car p))) (insn-name (cadr (car p)))))
+        (push! accumulated snapshot))))
+  (when (> (length args) 1)
+    (with-output-to-file (cadr args)
+      (^[] (write (sum-snapshots accumulated)) (newline))))
+  0)
+
+;; Sums up the snapshots, which have the same shape.
+(define (sum-snapshots snapshots)
+  (define (add a b)
+    (if (vector? a) (vector-map add a b) (+ a b)))
+  (let loop ([keys '(:insn1 :insn2 :lref :lset)] [r '()])
+    (if (null? keys)
+      (reverse r)
+      (loop (cdr keys)
+            `(,(reduce add #f (map (cut get-keyword (car keys) <>) snapshots))
+              ,(car keys) ,@r)))))